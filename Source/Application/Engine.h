@@ -11,13 +11,17 @@
 
 #include "../Utils/Source/Multithreading.h"
 #include "../Utils/Source/Timer.h"
+#include "../Utils/Source/FrameLimiter.h"
+#include "../Utils/Source/BinaryLog.h"
+#include "../Utils/Source/Profiler.h"
 #include "Source/Renderer/Renderer.h"
 #include "Input.h"
+#include "FrameStats.h"
 
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
-// Outputs Render/Update thread sync values on each Tick()
-#define DEBUG_LOG_THREAD_SYNC_VERBOSE 0
 
 struct FFrameData
 {
@@ -93,6 +97,8 @@ public:
 	
 
 	void MainThread_Tick();
+	void MainThread_FlushPendingWindowEvents();
+	void MainThread_PushInputEvent(const FEventRecord& Event);
 
 	// ---------------------------------------------------------
 	// Render Thread
@@ -148,7 +154,7 @@ public:
 private:
 	using BuiltinMeshArray_t     = std::array<Mesh      , EBuiltInMeshes::NUM_BUILTIN_MESHES>;
 	using BuiltinMeshNameArray_t = std::array<std::string, EBuiltInMeshes::NUM_BUILTIN_MESHES>;
-	using EventQueue_t = BufferedContainer<std::queue<std::unique_ptr<IEvent>>, std::unique_ptr<IEvent>>;
+	using EventQueue_t = MPSCChannel<FEventRecord, 256>;
 	using UpdateContextLookup_t = std::unordered_map<HWND, IWindowUpdateContext*>;
 
 	// threads
@@ -159,8 +165,8 @@ private:
 
 	// sync
 	std::atomic<bool>          mbStopAllThreads;
-	std::unique_ptr<Semaphore> mpSemUpdate;
-	std::unique_ptr<Semaphore> mpSemRender;
+	std::unique_ptr<LightweightSemaphore> mpSemUpdate;
+	std::unique_ptr<LightweightSemaphore> mpSemRender;
 	
 	// windows
 	std::unique_ptr<Window>    mpWinMain;
@@ -176,10 +182,16 @@ private:
 	std::atomic<uint64>        mNumRenderLoopsExecuted;
 	std::atomic<uint64>        mNumUpdateLoopsExecuted;
 	std::atomic<bool>          mbLoadingLevel;
+	TaskGraph                  mLoadSceneTaskGraph;
 	FEngineSettings            mSettings;
 	EAppState                  mAppState;
 	SystemInfo::FSystemInfo    mSysInfo;
 	Timer mTimer;
+	FrameLimiter               mFrameLimiter; // update thread
+
+	// perf report of the automated test runs
+	FrameStats                 mFrameStats;
+	uint64                     mRenderThreadPresentTicks; // render thread: CpuTimestamp ticks spent presenting in the current frame
 
 	// scene
 	MainWindowScene					mScene_MainWnd;
@@ -192,6 +204,11 @@ private:
 	// events
 	EventQueue_t	mWinEventQueue;
 	EventQueue_t    mInputEventQueue;
+	// main thread: the window procedure never blocks on a full queue, the window events that didn't fit
+	// are kept here and pushed again by MainThread_Tick(), the input events are dropped.
+	std::unordered_map<HWND, WindowResizeEvent> mPendingWindowResizeEvents; // latest size per window
+	std::vector<HWND>                           mPendingToggleFullscreenEvents;
+	uint64                                      mNumDroppedInputEvents = 0;
 
 	// Reads EngineSettings.ini from next to the executable and returns a 
 	// FStartupParameters struct as it readily has override booleans for engine settings
@@ -202,6 +219,7 @@ private:
 
 	void                     InitializeThreads();
 	void                     ExitThreads();
+	void                     WriteFrameStatsReport() const;
 
 	void                     InitializeBuiltinMeshes();
 	void                     LoadLoadingScreenData(); // data is loaded in parallel but it blocks the calling thread until load is complete
@@ -1,10 +1,12 @@
 #include "Engine.h"
 
 #include "../Utils/Source/utils.h"
+#include "../Utils/Source/CPUTopology.h"
 
 #include <fstream>
 #include <sstream>
 #include <cassert>
+#include <algorithm>
 
 #ifdef _DEBUG
 constexpr char* BUILD_CONFIG = "Debug";
@@ -24,6 +26,9 @@ void Engine::MainThread_Tick()
 		}
 	}
 
+	// window events that didn't fit in the render thread's queue
+	MainThread_FlushPendingWindowEvents();
+
 	// TODO: populate input queue and signal Update thread 
 	//       to drain the buffered input from the queue
 }
@@ -40,6 +45,8 @@ bool Engine::Initialize(const FStartupParameters& Params)
 	this->mSysInfo = SystemInfo::GetSystemInfo();
 	#endif
 	// -------------------------------------------------------------------------
+	Profiler::SetThreadName("Main", 0xFF7EC894);
+
 	InititalizeEngineSettings(Params);
 	InitializeApplicationWindows(Params);
 	InitializeThreads();
@@ -65,6 +72,8 @@ void Engine::InititalizeEngineSettings(const FStartupParameters& Params)
 	s.gfx.bVsync = false;
 	s.gfx.bUseTripleBuffering = true;
 	s.gfx.RenderScale = 1.0f;
+	s.gfx.MaxFrameRate = 0.0f;
+	s.gfx.bCookTextures = false;
 	
 	s.WndMain.Width = 1920;
 	s.WndMain.Height = 1080;
@@ -82,6 +91,8 @@ void Engine::InititalizeEngineSettings(const FStartupParameters& Params)
 	if (paramFile.bOverrideGFXSetting_bVSync     )                 s.gfx.bVsync              = pf.gfx.bVsync;
 	if (paramFile.bOverrideGFXSetting_bUseTripleBuffering)         s.gfx.bUseTripleBuffering = pf.gfx.bUseTripleBuffering;
 	if (paramFile.bOverrideGFXSetting_RenderScale)                 s.gfx.RenderScale         = pf.gfx.RenderScale;
+	if (paramFile.bOverrideGFXSetting_MaxFrameRate)                s.gfx.MaxFrameRate        = pf.gfx.MaxFrameRate;
+	if (paramFile.bOverrideGFXSetting_bCookTextures)               s.gfx.bCookTextures       = pf.gfx.bCookTextures;
 
 	if (paramFile.bOverrideENGSetting_MainWindowWidth)             s.WndMain.Width            = pf.WndMain.Width;
 	if (paramFile.bOverrideENGSetting_MainWindowHeight)            s.WndMain.Height           = pf.WndMain.Height;
@@ -100,6 +111,8 @@ void Engine::InititalizeEngineSettings(const FStartupParameters& Params)
 	if (Params.bOverrideGFXSetting_bVSync     )                 s.gfx.bVsync              = p.gfx.bVsync;
 	if (Params.bOverrideGFXSetting_bUseTripleBuffering)         s.gfx.bUseTripleBuffering = p.gfx.bUseTripleBuffering;
 	if (Params.bOverrideGFXSetting_RenderScale)                 s.gfx.RenderScale         = p.gfx.RenderScale;
+	if (Params.bOverrideGFXSetting_MaxFrameRate)                s.gfx.MaxFrameRate        = p.gfx.MaxFrameRate;
+	if (Params.bOverrideGFXSetting_bCookTextures)               s.gfx.bCookTextures       = p.gfx.bCookTextures;
 
 	if (Params.bOverrideENGSetting_MainWindowWidth)             s.WndMain.Width            = p.WndMain.Width;
 	if (Params.bOverrideENGSetting_MainWindowHeight)            s.WndMain.Height           = p.WndMain.Height;
@@ -130,25 +143,60 @@ void Engine::InitializeApplicationWindows(const FStartupParameters& Params)
 	};
 
 	fnInitializeWindows(mSettings.WndMain, Params.hExeInstance, mpWinMain);
-	Log::Info("Created main window<0x%x>: %dx%d", mpWinMain->GetHWND(), mpWinMain->GetWidth(), mpWinMain->GetHeight());
+	LOG_INFO("Created main window<0x%x>: %dx%d", mpWinMain->GetHWND(), mpWinMain->GetWidth(), mpWinMain->GetHeight());
 
 }
 
 void Engine::InitializeThreads()
 {
 	const int NUM_SWAPCHAIN_BACKBUFFERS = mSettings.gfx.bUseTripleBuffering ? 3 : 2;
-	mpSemUpdate.reset(new Semaphore(NUM_SWAPCHAIN_BACKBUFFERS, NUM_SWAPCHAIN_BACKBUFFERS));
-	mpSemRender.reset(new Semaphore(0                        , NUM_SWAPCHAIN_BACKBUFFERS));
+	mpSemUpdate.reset(new LightweightSemaphore(NUM_SWAPCHAIN_BACKBUFFERS, NUM_SWAPCHAIN_BACKBUFFERS));
+	mpSemRender.reset(new LightweightSemaphore(0                        , NUM_SWAPCHAIN_BACKBUFFERS));
+
+	// Worker pools are placed on physical cores: the fastest cores are reserved for the Update, Render 
+	// and Main threads and the rest is split between the update & render pools so that the two 
+	// pools don't compete for the same cores and caches. Cores are ordered by L3 group, so each pool
+	// gets a contiguous range of cores sharing as few L3s with the other pool as possible.
+	constexpr size_t NUM_RESERVED_CORES = 2; // (Update + Render) + Main threads
+	constexpr SystemInfo::EThreadAffinityPolicy WORKER_AFFINITY_POLICY = SystemInfo::EThreadAffinityPolicy::L3_GROUP;
+	const SystemInfo::FCPUTopology CPUTopology = SystemInfo::GetCPUTopology();
+	const std::vector<uint32_t>    Cores = CPUTopology.GetCoresByPreference();
+	const size_t NumWorkerCores = Cores.size() > NUM_RESERVED_CORES ? Cores.size() - NUM_RESERVED_CORES : 0;
+
+	size_t NumUpdateWorkers = 1;
+	size_t NumRenderWorkers = 1;
+	std::vector<FThreadAffinity> UpdateWorkerAffinities;
+	std::vector<FThreadAffinity> RenderWorkerAffinities;
+	if (NumWorkerCores >= 2)
+	{
+		NumUpdateWorkers = NumWorkerCores / 2;
+		NumRenderWorkers = NumWorkerCores - NumUpdateWorkers;
+		const std::vector<uint32_t> UpdateCores(Cores.begin() + NUM_RESERVED_CORES, Cores.begin() + NUM_RESERVED_CORES + NumUpdateWorkers);
+		const std::vector<uint32_t> RenderCores(Cores.begin() + NUM_RESERVED_CORES + NumUpdateWorkers, Cores.end());
+		UpdateWorkerAffinities = SystemInfo::GetWorkerAffinities(CPUTopology, UpdateCores, WORKER_AFFINITY_POLICY);
+		RenderWorkerAffinities = SystemInfo::GetWorkerAffinities(CPUTopology, RenderCores, WORKER_AFFINITY_POLICY);
+	}
+	// else: not enough cores for disjoint pools, a single unpinned worker per pool so that tasks still run asynchronously
+
+	LOG_INFO("CPU Topology: %zu cores, %u threads, %u L3 groups, %u NUMA nodes%s%s"
+		, CPUTopology.GetNumCores(), CPUTopology.NumLogicalProcessors, CPUTopology.NumL3Groups, CPUTopology.NumNUMANodes
+		, CPUTopology.bHybrid ? ", hybrid" : ""
+		, CPUTopology.bQueriedFromOS ? "" : " (fallback)"
+	);
+	LOG_INFO("Worker threads: Update=%zu, Render=%zu, affinity=%s", NumUpdateWorkers, NumRenderWorkers
+		, SystemInfo::GetThreadAffinityPolicyName(UpdateWorkerAffinities.empty() ? SystemInfo::EThreadAffinityPolicy::NO_AFFINITY : WORKER_AFFINITY_POLICY)
+	);
+
+	// the worker pools are used by the update & render threads right away: initialize them first
+	mUpdateWorkerThreads.Initialize(NumUpdateWorkers, "UpdateWorkers", 0xFF85A0D2, EThreadPoolSchedulingMode::WORK_STEALING, UpdateWorkerAffinities);
+	mRenderWorkerThreads.Initialize(NumRenderWorkers, "RenderWorkers", 0xFFEE8E00, EThreadPoolSchedulingMode::WORK_STEALING, RenderWorkerAffinities);
+
+	if (mSettings.bAutomatedTestRun)
+		mFrameStats.Initialize(static_cast<size_t>(std::max(mSettings.NumAutomatedTestFrames, 0)) + 64);
 
 	mbStopAllThreads.store(false);
 	mRenderThread = std::thread(&Engine::RenderThread_Main, this);
 	mUpdateThread = std::thread(&Engine::UpdateThread_Main, this);
-
-	const size_t HWThreads = ThreadPool::sHardwareThreadCount;
-	const size_t HWCores   = HWThreads/2;
-	const size_t NumWorkers = HWCores - 2; // reserve 2 cores for (Update + Render) + Main threads
-	mUpdateWorkerThreads.Initialize(NumWorkers, mUpdateWorkerThreads.GetThreadPoolName());
-	mRenderWorkerThreads.Initialize(NumWorkers, mRenderWorkerThreads.GetThreadPoolName());
 }
 
 void Engine::ExitThreads()
@@ -157,12 +205,45 @@ void Engine::ExitThreads()
 	mRenderThread.join();
 	mUpdateThread.join();
 
+	if (mSettings.bAutomatedTestRun)
+	{
+		mUpdateWorkerThreads.LogStats();
+		mRenderWorkerThreads.LogStats();
+		WriteFrameStatsReport();
+	}
+
 	mUpdateWorkerThreads.Destroy();
 	mRenderWorkerThreads.Destroy();
 }
 
 
 
+void Engine::WriteFrameStatsReport() const
+{
+	const std::string Time = GetCurrentTimeAsString();
+	std::string FilePath = "PerfReport_" + Time;
+	std::replace(FilePath.begin(), FilePath.end(), ':', '-');
+
+	const std::vector<std::pair<std::string, std::string>> Properties =
+	{
+		  { "EngineVersion"   , ENGINE_VERSION }
+		, { "BuildConfig"     , BUILD_CONFIG }
+		, { "Time"            , Time }
+		, { "NumFrames"       , std::to_string(mNumRenderLoopsExecuted.load()) }
+		, { "Resolution"      , std::to_string(mSettings.WndMain.Width) + "x" + std::to_string(mSettings.WndMain.Height) }
+		, { "DisplayMode"     , mSettings.WndMain.DisplayMode == EDisplayMode::EXCLUSIVE_FULLSCREEN ? "ExclusiveFullscreen" : (mSettings.WndMain.DisplayMode == EDisplayMode::BORDERLESS_FULLSCREEN ? "BorderlessFullscreen" : "Windowed") }
+		, { "VSync"           , mSettings.gfx.bVsync ? "true" : "false" }
+		, { "TripleBuffering" , mSettings.gfx.bUseTripleBuffering ? "true" : "false" }
+		, { "MaxFrameRate"    , std::to_string(mSettings.gfx.MaxFrameRate) }
+		, { "UpdateWorkers"   , std::to_string(mUpdateWorkerThreads.GetThreadPoolSize()) }
+		, { "RenderWorkers"   , std::to_string(mRenderWorkerThreads.GetThreadPoolSize()) }
+		, { "TimerSource"     , CpuTimestamp::IsUsingTsc() ? "TSC" : "steady_clock" }
+	};
+
+	mFrameStats.LogSummary();
+	mFrameStats.WriteReport(FilePath, Properties);
+}
+
 std::unique_ptr<Window>& Engine::GetWindow(HWND hwnd)
 {
 	if (mpWinMain->GetHWND() == hwnd)
@@ -170,7 +251,7 @@ std::unique_ptr<Window>& Engine::GetWindow(HWND hwnd)
 
 	// TODO: handle other windows here when they're implemented
 
-	Log::Warning("Engine::GetWindow() : Invalid hwnd=0x%x, returning Main Window", hwnd);
+	LOG_WARNING_RATE_LIMITED(1, "Engine::GetWindow() : Invalid hwnd=0x%x, returning Main Window", hwnd);
 	return mpWinMain;
 }
 
@@ -181,7 +262,7 @@ const FWindowSettings& Engine::GetWindowSettings(HWND hwnd) const
 	
 	// TODO: handle other windows here when they're implemented
 
-	Log::Warning("Engine::GetWindowSettings() : Invalid hwnd=0x%x, returning Main Window Settings", hwnd);
+	LOG_WARNING_RATE_LIMITED(1, "Engine::GetWindowSettings() : Invalid hwnd=0x%x, returning Main Window Settings", hwnd);
 	return mSettings.WndMain;
 }
 FWindowSettings& Engine::GetWindowSettings(HWND hwnd)
@@ -191,7 +272,7 @@ FWindowSettings& Engine::GetWindowSettings(HWND hwnd)
 	
 	// TODO: handle other windows here when they're implemented
 
-	Log::Warning("Engine::GetWindowSettings() : Invalid hwnd=0x%x, returning Main Window Settings", hwnd);
+	LOG_WARNING_RATE_LIMITED(1, "Engine::GetWindowSettings() : Invalid hwnd=0x%x, returning Main Window Settings", hwnd);
 	return mSettings.WndMain;
 }
 
@@ -277,6 +358,16 @@ FStartupParameters Engine::ParseEngineSettingsFile()
 				params.bOverrideGFXSetting_bUseTripleBuffering = true;
 				params.EngineSettings.gfx.bUseTripleBuffering = ParseBool(SettingValue);
 			}
+			if (SettingName == "MaxFrameRate")
+			{
+				params.bOverrideGFXSetting_MaxFrameRate = true;
+				params.EngineSettings.gfx.MaxFrameRate = ParseFloat(SettingValue);
+			}
+			if (SettingName == "CookTextures")
+			{
+				params.bOverrideGFXSetting_bCookTextures = true;
+				params.EngineSettings.gfx.bCookTextures = ParseBool(SettingValue);
+			}
 
 
 			// 
@@ -309,8 +400,8 @@ FStartupParameters Engine::ParseEngineSettingsFile()
 	}
 	else
 	{
-		Log::Warning("Cannot find settings file %s in current directory: %s", ENGINE_SETTINGS_FILE_NAME, DirectoryUtil::GetCurrentPath().c_str());
-		Log::Warning("Will use default settings for Engine & Graphics.", ENGINE_SETTINGS_FILE_NAME, DirectoryUtil::GetCurrentPath().c_str());
+		LOG_WARNING("Cannot find settings file %s in current directory: %s", ENGINE_SETTINGS_FILE_NAME, DirectoryUtil::GetCurrentPath().c_str());
+		LOG_WARNING("Will use default settings for Engine & Graphics.", ENGINE_SETTINGS_FILE_NAME, DirectoryUtil::GetCurrentPath().c_str());
 	}
 
 	return params;
@@ -12,41 +12,58 @@
 // ------------------------------------------------------------------------------------------------------------------------------------------------------------
 void Engine::RenderThread_Main()
 {
-	Log::Info("RenderThread_Main()");
+	LOG_INFO("RenderThread_Main()");
+	Profiler::SetThreadName("Render", 0xFFF44A3F);
 	RenderThread_Inititalize();
 
 
 	bool bQuit = false;
+	uint64 FrameBeginTicks = CpuTimestamp::Now();
 	while (!this->mbStopAllThreads && !bQuit)
 	{
+		Profiler::BeginFrame();
+
 		RenderThread_HandleEvents();
 
+		const uint64 WaitBeginTicks = CpuTimestamp::Now();
 		RenderThread_WaitForUpdateThread();
+		const uint64 RenderBeginTicks = CpuTimestamp::Now();
 
-#if DEBUG_LOG_THREAD_SYNC_VERBOSE
-		Log::Info(/*"RenderThread_Tick() : */"r%d (u=%llu)", mNumRenderLoopsExecuted.load(), mNumUpdateLoopsExecuted.load());
-#endif
+		BLOG_INFO(/*"RenderThread_Tick() : */"r%d (u=%llu)", mNumRenderLoopsExecuted.load(), mNumUpdateLoopsExecuted.load());
 
+		const bool bRecordFrameStats = mSettings.bAutomatedTestRun && !mbLoadingLevel; // loading frames would skew the stats
+		mRenderThreadPresentTicks = 0;
 		RenderThread_PreRender();
 		RenderThread_Render();
+		const uint64 RenderEndTicks = CpuTimestamp::Now();
 
 		++mNumRenderLoopsExecuted;
 
 		RenderThread_SignalUpdateThread();
 
 		RenderThread_HandleEvents();
+
+		const uint64 FrameEndTicks = CpuTimestamp::Now();
+		if (bRecordFrameStats)
+		{
+			auto fnMs = [](uint64 Ticks) { return static_cast<float>(CpuTimestamp::ToMilliseconds(Ticks)); };
+			mFrameStats.Record(FRAME_STAT_FRAME_TIME   , fnMs(FrameEndTicks - FrameBeginTicks));
+			mFrameStats.Record(FRAME_STAT_RENDER_WAIT  , fnMs(RenderBeginTicks - WaitBeginTicks));
+			mFrameStats.Record(FRAME_STAT_RENDER_RECORD, fnMs(RenderEndTicks - RenderBeginTicks - mRenderThreadPresentTicks));
+			mFrameStats.Record(FRAME_STAT_PRESENT      , fnMs(mRenderThreadPresentTicks));
+		}
+		FrameBeginTicks = FrameEndTicks;
 	}
 
 	RenderThread_Exit();
-	Log::Info("RenderThread_Main() : Exit");
+	LOG_INFO("RenderThread_Main() : Exit");
 }
 
 
 void Engine::RenderThread_WaitForUpdateThread()
 {
-#if DEBUG_LOG_THREAD_SYNC_VERBOSE
-	Log::Info("r:wait : u=%llu, r=%llu", mNumUpdateLoopsExecuted.load(), mNumRenderLoopsExecuted.load());
-#endif
+	PROFILE_SCOPE("WaitForUpdateThread");
+	BLOG_INFO("r:wait : u=%llu, r=%llu", mNumUpdateLoopsExecuted.load(), mNumRenderLoopsExecuted.load());
 
 	mpSemRender->Wait();
 }
@@ -176,6 +193,7 @@ void Engine::RenderThread_PreRender()
 
 void Engine::RenderThread_Render()
 {
+	PROFILE_SCOPE("Render");
 	RenderThread_RenderMainWindow();
 }
 
@@ -295,8 +313,12 @@ HRESULT Engine::RenderThread_RenderMainWindow_LoadingScreen(FWindowRenderContext
 	//
 	// PRESENT
 	//
-	hr = ctx.SwapChain.Present(ctx.bVsync);
-	ctx.SwapChain.MoveToNextFrame();
+	{
+		PROFILE_SCOPE("Present");
+		ScopedTimer PresentTimer(mRenderThreadPresentTicks);
+		hr = ctx.SwapChain.Present(ctx.bVsync);
+		ctx.SwapChain.MoveToNextFrame();
+	}
 	return hr;
 }
 
@@ -422,8 +444,12 @@ HRESULT Engine::RenderThread_RenderMainWindow_Scene(FWindowRenderContext& ctx)
 	//
 	// PRESENT
 	//
-	hr = ctx.SwapChain.Present(ctx.bVsync);
-	ctx.SwapChain.MoveToNextFrame();
+	{
+		PROFILE_SCOPE("Present");
+		ScopedTimer PresentTimer(mRenderThreadPresentTicks);
+		hr = ctx.SwapChain.Present(ctx.bVsync);
+		ctx.SwapChain.MoveToNextFrame();
+	}
 	return hr;
 }
 
@@ -436,41 +462,34 @@ HRESULT Engine::RenderThread_RenderMainWindow_Scene(FWindowRenderContext& ctx)
 // ------------------------------------------------------------------------------------------------------------------------------------------------------------
 void Engine::RenderThread_HandleEvents()
 {
-	// Swap event recording buffers so we can read & process a limited number of events safely.
+	// Only process the events recorded so far.
 	//   Otherwise, theoretically the producer (Main) thread could keep adding new events 
 	//   while we're spinning on the queue items below, and cause render thread to stall while, say, resizing.
-	mWinEventQueue.SwapBuffers();
-	std::queue<std::unique_ptr<IEvent>>& q = mWinEventQueue.GetBackContainer();
-	if (q.empty())
-		return;
-
-	// process the events
-	std::shared_ptr<IEvent> pEvent = nullptr;
-	std::shared_ptr<WindowResizeEvent> pResizeEvent = nullptr;
-	while (!q.empty())
+	FEventRecord LastResizeEvent;
+	mWinEventQueue.ConsumeAll([&](const FEventRecord& Event)
 	{
-		pEvent = std::move(q.front());
-		q.pop();
-
-		switch (pEvent->mType)
+		switch (Event.GetType())
 		{
 		case EEventType::WINDOW_RESIZE_EVENT: 
 			// noop, we only care about the last RESIZE event to avoid calling SwapchainResize() unneccessarily
-			pResizeEvent = std::static_pointer_cast<WindowResizeEvent>(pEvent);
-
+			LastResizeEvent = Event;
 			break;
 		case EEventType::TOGGLE_FULLSCREEN_EVENT:
 			// handle every fullscreen event
-			RenderThread_HandleToggleFullscreenEvent(pEvent.get());
+			RenderThread_HandleToggleFullscreenEvent(&Event.Get());
 			break;
 		}
-	}
+	});
+
 	// Process Window Resize
-	if (pResizeEvent && pResizeEvent->width != 0 && pResizeEvent->height != 0)
+	if (LastResizeEvent.GetType() == EEventType::WINDOW_RESIZE_EVENT)
 	{
-		RenderThread_HandleResizeWindowEvent(pResizeEvent.get());
+		const WindowResizeEvent& ResizeEvent = LastResizeEvent.As<WindowResizeEvent>();
+		if (ResizeEvent.width != 0 && ResizeEvent.height != 0)
+		{
+			RenderThread_HandleResizeWindowEvent(&ResizeEvent);
+		}
 	}
-	
 }
 
 void Engine::RenderThread_HandleResizeWindowEvent(const IEvent* pEvent)
@@ -482,7 +501,7 @@ void Engine::RenderThread_HandleResizeWindowEvent(const IEvent* pEvent)
 	SwapChain&                  Swapchain = mRenderer.GetWindowSwapChain(hwnd);
 	std::unique_ptr<Window>&         pWnd = GetWindow(hwnd);
 
-	Log::Info("RenderThread: Handle Resize event, set resolution to %dx%d", WIDTH , HEIGHT);
+	LOG_INFO("RenderThread: Handle Resize event, set resolution to %dx%d", WIDTH , HEIGHT);
 
 	Swapchain.WaitForGPU();
 	Swapchain.Resize(WIDTH, HEIGHT);
@@ -503,7 +522,7 @@ void Engine::RenderThread_HandleToggleFullscreenEvent(const IEvent* pEvent)
 	const bool            bFullscreenStateToSet = !Swapchain.IsFullscreen();
 	std::unique_ptr<Window>&               pWnd = GetWindow(hwnd);
 
-	Log::Info("RenderThread: Handle Fullscreen(exclusiveFS=%s) transition to %dx%d"
+	LOG_INFO("RenderThread: Handle Fullscreen(exclusiveFS=%s) transition to %dx%d"
 		, (bFullscreenStateToSet ? "true" : "false")
 		, WndSettings.Width
 		, WndSettings.Height
@@ -2,24 +2,31 @@
 #include "Math.h"
 #include "../Utils/Source/utils.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace DirectX;
 
 void Engine::UpdateThread_Main()
 {
-	Log::Info("UpdateThread_Main()");
+	LOG_INFO("UpdateThread_Main()");
+	Profiler::SetThreadName("Update", 0xFF43877D);
 	UpdateThread_Inititalize();
 
 	bool bQuit = false;
 	float dt = 0.0f;
 	while (!mbStopAllThreads && !bQuit)
 	{
+		const float PacingErrorMs = mFrameLimiter.Wait();
+
+		const bool bRecordFrameStats = mSettings.bAutomatedTestRun && !mbLoadingLevel; // loading frames would skew the stats
+		const uint64 UpdateBeginTicks = CpuTimestamp::Now();
+
 		UpdateThread_HandleEvents();
 
 		UpdateThread_PreUpdate(dt);
 
-#if DEBUG_LOG_THREAD_SYNC_VERBOSE
-		Log::Info(/*"UpdateThread_Tick() : */"u%d (r=%llu)", mNumUpdateLoopsExecuted.load(), mNumRenderLoopsExecuted.load());
-#endif
+		BLOG_INFO(/*"UpdateThread_Tick() : */"u%d (r=%llu)", mNumUpdateLoopsExecuted.load(), mNumRenderLoopsExecuted.load());
 
 		UpdateThread_UpdateAppState(dt);
 
@@ -29,11 +36,21 @@ void Engine::UpdateThread_Main()
 
 		UpdateThread_SignalRenderThread();
 
+		const uint64 WaitBeginTicks = CpuTimestamp::Now();
 		UpdateThread_WaitForRenderThread();
+		const uint64 WaitEndTicks = CpuTimestamp::Now();
+
+		if (bRecordFrameStats)
+		{
+			mFrameStats.Record(FRAME_STAT_UPDATE     , static_cast<float>(CpuTimestamp::ToMilliseconds(WaitBeginTicks - UpdateBeginTicks)));
+			mFrameStats.Record(FRAME_STAT_UPDATE_WAIT, static_cast<float>(CpuTimestamp::ToMilliseconds(WaitEndTicks - WaitBeginTicks)));
+			if (mFrameLimiter.IsEnabled())
+				mFrameStats.Record(FRAME_STAT_PACING_ERROR, std::abs(PacingErrorMs));
+		}
 	}
 
 	UpdateThread_Exit();
-	Log::Info("UpdateThread_Main() : Exit");
+	LOG_INFO("UpdateThread_Main() : Exit");
 }
 
 void Engine::UpdateThread_Inititalize()
@@ -47,21 +64,24 @@ void Engine::UpdateThread_Inititalize()
 	// Do not show windows until we have the loading screen data ready.
 	mpWinMain->Show();
 
+	mFrameLimiter.Initialize(mSettings.gfx.MaxFrameRate);
+
 	mTimer.Reset();
 	mTimer.Start();
 }
 
 void Engine::UpdateThread_Exit()
 {
+	mFrameLimiter.LogStats();
+	mFrameLimiter.Exit();
 }
 
 
 
 void Engine::UpdateThread_WaitForRenderThread()
 {
-#if DEBUG_LOG_THREAD_SYNC_VERBOSE
-	Log::Info("u:wait : u=%llu, r=%llu", mNumUpdateLoopsExecuted.load(), mNumRenderLoopsExecuted.load());
-#endif
+	PROFILE_SCOPE("WaitForRenderThread");
+	BLOG_INFO("u:wait : u=%llu, r=%llu", mNumUpdateLoopsExecuted.load(), mNumRenderLoopsExecuted.load());
 
 	mpSemUpdate->Wait();
 }
@@ -77,7 +97,12 @@ void Engine::UpdateThread_PreUpdate(float& dt)
 	dt = mTimer.Tick();
 
 	// update input
-
+	if (mInput.IsKeyTriggered(KeyCode::F9))
+	{
+		std::string FilePath = "Profile_" + GetCurrentTimeAsString() + ".json";
+		std::replace(FilePath.begin(), FilePath.end(), ':', '-');
+		Profiler::RequestCapture(Profiler::DEFAULT_CAPTURE_NUM_FRAMES, FilePath);
+	}
 }
 
 void Engine::UpdateThread_UpdateAppState(const float& dt)
@@ -87,7 +112,7 @@ void Engine::UpdateThread_UpdateAppState(const float& dt)
 	if (mAppState == EAppState::INITIALIZING)
 	{
 		// start loading
-		Log::Info("Main Thread starts loading...");
+		LOG_INFO("Main Thread starts loading...");
 
 		// start load level
 		Load_SceneData_Dispatch();
@@ -100,11 +125,10 @@ void Engine::UpdateThread_UpdateAppState(const float& dt)
 
 
 		// check if loading is done
-		const int NumActiveTasks = mUpdateWorkerThreads.GetNumActiveTasks();
-		const bool bLoadDone = NumActiveTasks == 0;
+		const bool bLoadDone = mLoadSceneTaskGraph.IsDone();
 		if (bLoadDone)
 		{
-			Log::Info("Main Thread loaded");
+			LOG_INFO("Main Thread loaded");
 			mAppState = EAppState::SIMULATING;
 		}
 
@@ -112,13 +136,18 @@ void Engine::UpdateThread_UpdateAppState(const float& dt)
 
 	else
 	{
-		UpdateThread_UpdateScene(dt);
+		// the render thread waits on the frame data: FRAME_CRITICAL, ahead of the streaming work queued on the
+		// update workers. This thread runs it unless a worker picked it up first.
+		std::future<void> SceneUpdate = mUpdateWorkerThreads.AddTask([this, dt]() { UpdateThread_UpdateScene(dt); }, ETaskPriority::FRAME_CRITICAL);
+		mUpdateWorkerThreads.YieldToFrameCriticalTasks();
+		SceneUpdate.wait();
 	}
 
 }
 
 void Engine::UpdateThread_UpdateScene(const float dt)
 {
+	PROFILE_SCOPE("UpdateScene");
 	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
 	const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
 	FFrameData& FrameData = mScene_MainWnd.mFrameData[FRAME_DATA_INDEX];
@@ -164,75 +193,89 @@ void Engine::UpdateThread_PostUpdate()
 
 void Engine::UpdateThread_HandleEvents()
 {
-	// Swap event recording buffers so we can read & process a limited number of events safely.
-	mInputEventQueue.SwapBuffers();
-	std::queue<std::unique_ptr<IEvent>>& q = mInputEventQueue.GetBackContainer();
-	if (q.empty())
-		return;
-	// process the events
-	std::shared_ptr<IEvent> pEvent = nullptr;
-	while (!q.empty())
+	// Only the events recorded so far are processed, events recorded while we're 
+	// processing are left for the next update loop.
+	mInputEventQueue.ConsumeAll([&](const FEventRecord& Event)
 	{
-		pEvent = std::move(q.front());
-		q.pop();
-		switch (pEvent->mType)
+		switch (Event.GetType())
 		{
 		case KEY_DOWN_EVENT:
-		{
-			std::shared_ptr<KeyDownEvent> p = std::static_pointer_cast<KeyDownEvent>(pEvent);
-			mInput.UpdateKeyDown(static_cast<KeyCode>(p->wparam));
-		} break;
+			mInput.UpdateKeyDown(static_cast<KeyCode>(Event.As<KeyDownEvent>().wparam));
+			break;
 		case KEY_UP_EVENT:
-		{
-			std::shared_ptr<KeyUpEvent> p = std::static_pointer_cast<KeyUpEvent>(pEvent);
-			mInput.UpdateKeyUp(static_cast<KeyCode>(p->wparam));
-		} break;
+			mInput.UpdateKeyUp(static_cast<KeyCode>(Event.As<KeyUpEvent>().wparam));
+			break;
 		}
-	}
+	});
 }
 
 void Engine::Load_SceneData_Dispatch()
 {
 	mbLoadingLevel.store(true);
-	mUpdateWorkerThreads.AddTask([&]()
-		{
-			const int NumBackBuffer_WndMain = mRenderer.GetSwapChainBackBufferCount(mpWinMain);
-			const int currentBackBufferIDX = mRenderer.GetWindowSwapChain(mpWinMain->GetHWND()).GetCurrentBackBufferIndex();
-
-			// TODO: initialize window scene data here for now
-			FFrameData data;
-			data.SwapChainClearColor = { 0.07f, 0.07f, 0.07f, 1.0f };
-
-			// Cube Data
-			constexpr XMFLOAT3 CUBE_POSITION = XMFLOAT3(0, 0, 4);
-			constexpr float    CUBE_SCALE = 1.0f;
-			constexpr XMFLOAT3 CUBE_ROTATION_VECTOR = XMFLOAT3(1, 1, 1);
-			constexpr float    CUBE_ROTATION_DEGREES = 60.0f;
-			const XMVECTOR     CUBE_ROTATION_AXIS = XMVector3Normalize(XMLoadFloat3(&CUBE_ROTATION_VECTOR));
-			data.TFCube = Transform(
-				CUBE_POSITION
-				, XMQuaternionRotationAxis(CUBE_ROTATION_AXIS, CUBE_ROTATION_DEGREES * DEG2RAD)
-				, XMFLOAT3(CUBE_SCALE, CUBE_SCALE, CUBE_SCALE)
-			);
-			CameraData camData = {};
-			camData.nearPlane = 0.01f;
-			camData.farPlane = 1000.0f;
-			camData.x = 0.0f; camData.y = 3.0f; camData.z = -5.0f;
-			camData.pitch = 10.0f;
-			camData.yaw = 0.0f;
-			camData.fovH_Degrees = 60.0f;
-			data.SceneCamera.InitializeCamera(camData, mpWinMain->GetWidth(), mpWinMain->GetHeight());
-
-			TextureID texID = mRenderer.CreateTextureFromFile("Data/Textures/1.png");
-			SRV_ID    srvID = mRenderer.CreateAndInitializeSRV(texID);
-			data.CubeTexture = srvID;
-
-			mScene_MainWnd.mFrameData.resize(NumBackBuffer_WndMain, data);
-
-			mWindowUpdateContextLookup[mpWinMain->GetHWND()] = &mScene_MainWnd;
-			mbLoadingLevel.store(false);
-		}
-	);
+
+	// Scene loading stages:
+	//
+	//   LoadCubeTexture ------> CreateCubeTextureSRV ---+
+	//                                                   +---> FinalizeSceneData
+	//   InitializeSceneObjects -------------------------+
+	//
+	std::shared_ptr<FFrameData> pData = std::make_shared<FFrameData>();
+	std::shared_ptr<TextureID> pCubeTexture = std::make_shared<TextureID>(INVALID_ID);
+
+	TaskGraph& graph = mLoadSceneTaskGraph;
+	graph.Reset();
+
+	const TaskGraph::TaskID LoadCubeTexture = graph.AddTask([=]()
+	{
+		// the scene's textures are loaded in one batch. With a single texture the batch loader prepares it on
+		// this thread, the update workers only parallelize its mip generation: add the scene's other textures here.
+		const std::vector<std::string> SceneTextureFilePaths = { "Data/Textures/1.png" };
+		const std::vector<TextureID> TextureIDs = mRenderer.CreateTexturesFromFiles(SceneTextureFilePaths, &mUpdateWorkerThreads);
+		*pCubeTexture = TextureIDs[0];
+	});
+
+	const TaskGraph::TaskID CreateCubeTextureSRV = graph.AddTask([=]()
+	{
+		pData->CubeTexture = mRenderer.CreateAndInitializeSRV(*pCubeTexture);
+	}, { LoadCubeTexture });
+
+	const TaskGraph::TaskID InitializeSceneObjects = graph.AddTask([=]()
+	{
+		// TODO: initialize window scene data here for now
+		FFrameData& data = *pData;
+		data.SwapChainClearColor = { 0.07f, 0.07f, 0.07f, 1.0f };
+
+		// Cube Data
+		constexpr XMFLOAT3 CUBE_POSITION = XMFLOAT3(0, 0, 4);
+		constexpr float    CUBE_SCALE = 1.0f;
+		constexpr XMFLOAT3 CUBE_ROTATION_VECTOR = XMFLOAT3(1, 1, 1);
+		constexpr float    CUBE_ROTATION_DEGREES = 60.0f;
+		const XMVECTOR     CUBE_ROTATION_AXIS = XMVector3Normalize(XMLoadFloat3(&CUBE_ROTATION_VECTOR));
+		data.TFCube = Transform(
+			CUBE_POSITION
+			, XMQuaternionRotationAxis(CUBE_ROTATION_AXIS, CUBE_ROTATION_DEGREES * DEG2RAD)
+			, XMFLOAT3(CUBE_SCALE, CUBE_SCALE, CUBE_SCALE)
+		);
+		CameraData camData = {};
+		camData.nearPlane = 0.01f;
+		camData.farPlane = 1000.0f;
+		camData.x = 0.0f; camData.y = 3.0f; camData.z = -5.0f;
+		camData.pitch = 10.0f;
+		camData.yaw = 0.0f;
+		camData.fovH_Degrees = 60.0f;
+		data.SceneCamera.InitializeCamera(camData, mpWinMain->GetWidth(), mpWinMain->GetHeight());
+	});
+
+	graph.AddTask([=]()
+	{
+		const int NumBackBuffer_WndMain = mRenderer.GetSwapChainBackBufferCount(mpWinMain);
+		mScene_MainWnd.mFrameData.resize(NumBackBuffer_WndMain, *pData);
+
+		mWindowUpdateContextLookup[mpWinMain->GetHWND()] = &mScene_MainWnd;
+		mbLoadingLevel.store(false);
+	}, { CreateCubeTextureSRV, InitializeSceneObjects });
+
+	graph.Dispatch(mUpdateWorkerThreads, ETaskPriority::BACKGROUND); // streaming: per-frame jobs go first
 }
 
 void Engine::LoadSceneData()
@@ -247,8 +290,11 @@ void Engine::LoadLoadingScreenData()
 
 	data.SwapChainClearColor = { 0.0f, 0.2f, 0.4f, 1.0f };
 
-	const std::string LoadingScreenTextureFilePath = "Data/Textures/0.png";
-	TextureID texID = mRenderer.CreateTextureFromFile(LoadingScreenTextureFilePath.c_str());
+	// the window is shown once the loading screen textures are uploaded. The batch loader prepares a single
+	// texture on this thread, the update workers only parallelize its mip generation.
+	const std::vector<std::string> LoadingScreenTextureFilePaths = { "Data/Textures/0.png" };
+	const std::vector<TextureID> TextureIDs = mRenderer.CreateTexturesFromFiles(LoadingScreenTextureFilePaths, &mUpdateWorkerThreads);
+	TextureID texID = TextureIDs[0];
 	SRV_ID    srvID = mRenderer.CreateAndInitializeSRV(texID);
 	data.SRVLoadingScreen = srvID;
 
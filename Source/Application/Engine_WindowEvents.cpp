@@ -99,15 +99,18 @@ void Engine::OnWindowResize(HWND hWnd)
 	int h = clientRect.bottom - clientRect.top;
 	
 	// Due to multi-threading, this thread will record the events and 
-	// Render Thread will process the queue at the of a render loop
-	mWinEventQueue.AddItem(std::make_unique<WindowResizeEvent>(w, h, hWnd));
+	// Render Thread will process the queue at the of a render loop.
+	// Only the latest size of a window matters: a resize that doesn't fit in the queue replaces the pending one.
+	mPendingWindowResizeEvents.insert_or_assign(hWnd, WindowResizeEvent(w, h, hWnd));
+	MainThread_FlushPendingWindowEvents();
 }
 
 void Engine::OnToggleFullscreen(HWND hWnd)
 {
 	// Due to multi-threading, this thread will record the events and 
 	// Render Thread will process the queue at the of a render loop
-	mWinEventQueue.AddItem(std::make_unique<ToggleFullscreenEvent>(hWnd));
+	mPendingToggleFullscreenEvents.push_back(hWnd);
+	MainThread_FlushPendingWindowEvents();
 }
 
 void Engine::OnWindowMinimize(IWindow* pWnd)
@@ -124,13 +127,39 @@ void Engine::OnWindowKeyDown(HWND hwnd, WPARAM wParam)
 {
 	// Due to multi-threading, this thread will record the events and 
 	// Update Thread will process the queue at the beginning of an update loop
-	mInputEventQueue.AddItem(std::make_unique<KeyDownEvent>(hwnd, wParam));
+	MainThread_PushInputEvent(KeyDownEvent(hwnd, wParam));
 }
 void Engine::OnWindowKeyUp(HWND hwnd, WPARAM wParam)
 {
 	// Due to multi-threading, this thread will record the events and 
 	// Update Thread will process the queue at the beginning of an update loop
-	mInputEventQueue.AddItem(std::make_unique<KeyUpEvent>(hwnd, wParam));
+	MainThread_PushInputEvent(KeyUpEvent(hwnd, wParam));
+}
+
+void Engine::MainThread_FlushPendingWindowEvents()
+{
+	// TryPush(): the window procedure can't wait for the render thread, e.g. while a level loads
+	size_t NumPushed = 0;
+	while (NumPushed < mPendingToggleFullscreenEvents.size() && mWinEventQueue.TryPush(ToggleFullscreenEvent(mPendingToggleFullscreenEvents[NumPushed])))
+		++NumPushed;
+	mPendingToggleFullscreenEvents.erase(mPendingToggleFullscreenEvents.begin(), mPendingToggleFullscreenEvents.begin() + NumPushed);
+
+	for (auto it = mPendingWindowResizeEvents.begin(); it != mPendingWindowResizeEvents.end(); )
+	{
+		if (!mWinEventQueue.TryPush(it->second))
+			break;
+		it = mPendingWindowResizeEvents.erase(it);
+	}
+}
+
+void Engine::MainThread_PushInputEvent(const FEventRecord& Event)
+{
+	if (mInputEventQueue.TryPush(Event))
+		return;
+
+	// the update thread isn't draining the queue: drop the event, warn at most once a second
+	++mNumDroppedInputEvents;
+	LOG_WARNING_RATE_LIMITED(1, "Input event queue full: %llu input events dropped", mNumDroppedInputEvents);
 }
 
 void Engine::OnWindowClose(IWindow* pWindow)
@@ -150,7 +179,7 @@ void Engine::OnWindowClose(IWindow* pWindow)
 static void LogWndMsg(UINT uMsg, HWND hwnd)
 {
 #if LOG_WINDOW_MESSAGE_EVENTS
-#define HANDLE_CASE(EVENT)    case EVENT: Log::Info(#EVENT"\t(0x%04x)\t\t<hwnd=0x%x>", EVENT, hwnd); break
+#define HANDLE_CASE(EVENT)    case EVENT: LOG_VERBOSE(#EVENT"\t(0x%04x)\t\t<hwnd=0x%x>", EVENT, hwnd); break
 	switch (uMsg)
 	{
 		// https://www.autoitscript.com/autoit3/docs/appendix/WinMsgCodes.htm
@@ -376,7 +405,7 @@ static void LogWndMsg(UINT uMsg, HWND hwnd)
 		///HANDLE_CASE(WM_MOUSEMOVE);
 		///HANDLE_CASE(WM_UNICHAR);
 		///HANDLE_CASE(WM_WININICHANGE);
-	default: Log::Warning("LogWndMsg not defined for msg=0x%x", uMsg); break;
+	default: LOG_VERBOSE("LogWndMsg not defined for msg=0x%x", uMsg); break;
 	}
 #undef HANDLE_CASE
 #endif
@@ -2,6 +2,9 @@
 
 #include <Windows.h>
 
+#include <type_traits>
+#include <new>
+
 //
 // As this is a threaded application, we'll need to utilize an enum-based
 // messaging system to handle events on different threads (say, render thread)
@@ -65,4 +68,36 @@ struct KeyUpEvent : public IEvent
 
 	WPARAM wparam = 0;
 	HWND hwnd = 0;
-};
\ No newline at end of file
+};
+
+
+//
+// Fixed size, tagged storage for any of the events above. Events are recorded by value into
+// lock-free event channels (see MPSCChannel<>) instead of being heap allocated one by one.
+// The event types must stay trivially copyable, the mType of the IEvent base is the tag.
+//
+struct FEventRecord
+{
+	FEventRecord() { new (&mStorage) IEvent(EEventType::NUM_EVENT_TYPES); }
+	template<class TEvent> FEventRecord(const TEvent& Event)
+	{
+		static_assert(std::is_base_of_v<IEvent, TEvent>, "FEventRecord can only store IEvent types");
+		static_assert(std::is_trivially_copyable_v<TEvent>, "Events must be trivially copyable to be recorded");
+		static_assert(sizeof(TEvent) <= sizeof(Storage_t), "Add the event type to FEventRecord::Storage_t");
+		new (&mStorage) TEvent(Event);
+	}
+
+	inline EEventType    GetType() const { return Get().mType; }
+	inline const IEvent& Get()     const { return *std::launder(reinterpret_cast<const IEvent*>(&mStorage)); }
+	template<class TEvent> inline const TEvent& As() const { return *std::launder(reinterpret_cast<const TEvent*>(&mStorage)); }
+
+private:
+	using Storage_t = std::aligned_union_t<0
+		, WindowResizeEvent
+		, ToggleFullscreenEvent
+		, SetFullscreenEvent
+		, KeyDownEvent
+		, KeyUpEvent
+	>;
+	Storage_t mStorage;
+};
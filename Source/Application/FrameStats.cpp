@@ -0,0 +1,196 @@
+#include "FrameStats.h"
+
+#include "../Utils/Source/Log.h"
+#include "../Utils/Source/utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+
+static const char* FRAME_STAT_NAMES[NUM_FRAME_STATS] =
+{
+	  "FrameTime"
+	, "RenderWait"
+	, "RenderRecord"
+	, "Present"
+	, "Update"
+	, "UpdateWait"
+	, "PacingError"
+};
+
+const char* FrameStats::GetStatName(EFrameStat Stat) { return FRAME_STAT_NAMES[Stat]; }
+
+void FrameStats::Initialize(size_t NumFramesToReserve)
+{
+	for (std::vector<float>& Samples : mSamples)
+	{
+		Samples.clear();
+		Samples.reserve(NumFramesToReserve);
+	}
+}
+
+// nearest-rank percentile of the sorted samples
+static float GetPercentile(const std::vector<float>& SortedSamples, float Percentile)
+{
+	const size_t Rank = static_cast<size_t>(std::ceil(Percentile / 100.0f * SortedSamples.size()));
+	return SortedSamples[std::clamp<size_t>(Rank, 1, SortedSamples.size()) - 1];
+}
+
+FFrameStatSummary FrameStats::ComputeSummary(EFrameStat Stat) const
+{
+	FFrameStatSummary s = {};
+	const std::vector<float>& Samples = mSamples[Stat];
+	if (Samples.empty())
+		return s;
+
+	std::vector<float> Sorted = Samples;
+	std::sort(Sorted.begin(), Sorted.end());
+
+	const double Sum = std::accumulate(Sorted.begin(), Sorted.end(), 0.0);
+	const double Avg = Sum / Sorted.size();
+	double SumSquaredDiff = 0.0;
+	for (float Sample : Sorted)
+		SumSquaredDiff += (Sample - Avg) * (Sample - Avg);
+
+	s.NumSamples = Sorted.size();
+	s.MinMs = Sorted.front();
+	s.MaxMs = Sorted.back();
+	s.AvgMs = static_cast<float>(Avg);
+	s.StdDevMs = static_cast<float>(std::sqrt(SumSquaredDiff / Sorted.size()));
+	s.P50Ms = GetPercentile(Sorted, 50.0f);
+	s.P95Ms = GetPercentile(Sorted, 95.0f);
+	s.P99Ms = GetPercentile(Sorted, 99.0f);
+
+	const float HitchThresholdMs       = s.P50Ms * FRAME_STAT_HITCH_THRESHOLD;
+	const float SevereHitchThresholdMs = s.P50Ms * FRAME_STAT_SEVERE_HITCH_THRESHOLD;
+	s.NumHitches       = Sorted.end() - std::upper_bound(Sorted.begin(), Sorted.end(), HitchThresholdMs);
+	s.NumSevereHitches = Sorted.end() - std::upper_bound(Sorted.begin(), Sorted.end(), SevereHitchThresholdMs);
+
+	for (float Sample : Sorted)
+	{
+		const auto it = std::lower_bound(FRAME_STAT_HISTOGRAM_BUCKET_UPPER_BOUNDS_MS.begin(), FRAME_STAT_HISTOGRAM_BUCKET_UPPER_BOUNDS_MS.end(), Sample);
+		++s.Histogram[it - FRAME_STAT_HISTOGRAM_BUCKET_UPPER_BOUNDS_MS.begin()];
+	}
+	return s;
+}
+
+bool FrameStats::WriteReport(const std::string& FilePathWithoutExtension, const std::vector<std::pair<std::string, std::string>>& Properties) const
+{
+	std::array<FFrameStatSummary, NUM_FRAME_STATS> Summaries;
+	for (int i = 0; i < NUM_FRAME_STATS; ++i)
+		Summaries[i] = ComputeSummary(static_cast<EFrameStat>(i));
+
+	char Line[512];
+
+	// JSON: run properties, summary & histogram per stat
+	{
+		const std::string FilePath = FilePathWithoutExtension + ".json";
+		std::ofstream File(FilePath);
+		if (!File)
+		{
+			Log::Error("FrameStats: Cannot open file: %s", FilePath.c_str());
+			return false;
+		}
+
+		File << "{\n\t\"Properties\": {";
+		for (size_t i = 0; i < Properties.size(); ++i)
+			File << (i == 0 ? "\n" : ",\n") << "\t\t\"" << StrUtil::EscapeJSON(Properties[i].first) << "\": \"" << StrUtil::EscapeJSON(Properties[i].second) << "\"";
+		File << "\n\t},\n";
+
+		File << "\t\"HitchThreshold\": " << FRAME_STAT_HITCH_THRESHOLD << ",\n";
+		File << "\t\"SevereHitchThreshold\": " << FRAME_STAT_SEVERE_HITCH_THRESHOLD << ",\n";
+		File << "\t\"HistogramBucketUpperBoundsMs\": [";
+		for (size_t i = 0; i < FRAME_STAT_HISTOGRAM_BUCKET_UPPER_BOUNDS_MS.size(); ++i)
+			File << (i == 0 ? "" : ", ") << FRAME_STAT_HISTOGRAM_BUCKET_UPPER_BOUNDS_MS[i];
+		File << "],\n";
+
+		File << "\t\"Stats\": {";
+		for (int i = 0; i < NUM_FRAME_STATS; ++i)
+		{
+			const FFrameStatSummary& s = Summaries[i];
+			snprintf(Line, sizeof(Line)
+				, "%s\n\t\t\"%s\": { \"NumSamples\": %zu, \"MinMs\": %.4f, \"AvgMs\": %.4f, \"P50Ms\": %.4f, \"P95Ms\": %.4f, \"P99Ms\": %.4f, \"MaxMs\": %.4f, \"StdDevMs\": %.4f, \"NumHitches\": %zu, \"NumSevereHitches\": %zu, \"Histogram\": ["
+				, i == 0 ? "" : ","
+				, FRAME_STAT_NAMES[i], s.NumSamples, s.MinMs, s.AvgMs, s.P50Ms, s.P95Ms, s.P99Ms, s.MaxMs, s.StdDevMs, s.NumHitches, s.NumSevereHitches
+			);
+			File << Line;
+			for (size_t iBucket = 0; iBucket < s.Histogram.size(); ++iBucket)
+				File << (iBucket == 0 ? "" : ", ") << s.Histogram[iBucket];
+			File << "] }";
+		}
+		File << "\n\t}\n}\n";
+	}
+
+	// CSV: a summary row per stat
+	{
+		const std::string FilePath = FilePathWithoutExtension + ".csv";
+		std::ofstream File(FilePath);
+		if (!File)
+		{
+			Log::Error("FrameStats: Cannot open file: %s", FilePath.c_str());
+			return false;
+		}
+
+		File << "Stat,NumSamples,MinMs,AvgMs,P50Ms,P95Ms,P99Ms,MaxMs,StdDevMs,NumHitches,NumSevereHitches\n";
+		for (int i = 0; i < NUM_FRAME_STATS; ++i)
+		{
+			const FFrameStatSummary& s = Summaries[i];
+			snprintf(Line, sizeof(Line), "%s,%zu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%zu,%zu\n"
+				, FRAME_STAT_NAMES[i], s.NumSamples, s.MinMs, s.AvgMs, s.P50Ms, s.P95Ms, s.P99Ms, s.MaxMs, s.StdDevMs, s.NumHitches, s.NumSevereHitches
+			);
+			File << Line;
+		}
+	}
+
+	// CSV: the samples, a row per frame. Stats recorded on different threads can differ in length by a frame.
+	{
+		const std::string FilePath = FilePathWithoutExtension + "_Frames.csv";
+		std::ofstream File(FilePath);
+		if (!File)
+		{
+			Log::Error("FrameStats: Cannot open file: %s", FilePath.c_str());
+			return false;
+		}
+
+		size_t NumFrames = 0;
+		File << "Frame";
+		for (int i = 0; i < NUM_FRAME_STATS; ++i)
+		{
+			File << "," << FRAME_STAT_NAMES[i] << "Ms";
+			NumFrames = std::max(NumFrames, mSamples[i].size());
+		}
+		File << "\n";
+
+		for (size_t iFrame = 0; iFrame < NumFrames; ++iFrame)
+		{
+			File << iFrame;
+			for (int i = 0; i < NUM_FRAME_STATS; ++i)
+			{
+				File << ",";
+				if (iFrame < mSamples[i].size())
+				{
+					snprintf(Line, sizeof(Line), "%.4f", mSamples[i][iFrame]);
+					File << Line;
+				}
+			}
+			File << "\n";
+		}
+	}
+
+	Log::Info("FrameStats: Perf report written: %s.json/.csv", FilePathWithoutExtension.c_str());
+	return true;
+}
+
+void FrameStats::LogSummary() const
+{
+	Log::Info("FrameStats: %-12s %8s %8s %8s %8s %8s %8s %8s %8s", "", "Samples", "Min", "Avg", "P50", "P95", "P99", "Max", "Hitches");
+	for (int i = 0; i < NUM_FRAME_STATS; ++i)
+	{
+		const FFrameStatSummary s = ComputeSummary(static_cast<EFrameStat>(i));
+		Log::Info("FrameStats: %-12s %8zu %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f %5zu/%zu"
+			, FRAME_STAT_NAMES[i], s.NumSamples, s.MinMs, s.AvgMs, s.P50Ms, s.P95Ms, s.P99Ms, s.MaxMs, s.NumHitches, s.NumSevereHitches
+		);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// Per-frame CPU timings of the automated test runs (-Test/-TestFrames), written out as
+// a perf report (JSON + CSV) when the run ends so that builds & machines can be compared.
+//
+// Each stat is recorded by a single thread (see EFrameStat) and read once the threads have
+// exited, so recording is a push_back into preallocated memory without any synchronization.
+//
+enum EFrameStat
+{
+	FRAME_STAT_FRAME_TIME = 0,  // render thread : begin of frame N -> begin of frame N+1
+	FRAME_STAT_RENDER_WAIT,     // render thread : waiting for the update thread
+	FRAME_STAT_RENDER_RECORD,   // render thread : PreRender() + Render(), excluding Present
+	FRAME_STAT_PRESENT,         // render thread : Present() + waiting for the next back buffer
+	FRAME_STAT_UPDATE,          // update thread : HandleEvents() -> PostUpdate()
+	FRAME_STAT_UPDATE_WAIT,     // update thread : waiting for the render thread
+	FRAME_STAT_PACING_ERROR,    // update thread : |FrameLimiter wake-up - deadline|, only recorded when the frame rate is limited
+
+	NUM_FRAME_STATS
+};
+
+// Histogram bucket upper bounds in milliseconds, the last bucket takes the rest
+constexpr std::array<float, 16> FRAME_STAT_HISTOGRAM_BUCKET_UPPER_BOUNDS_MS = { 0.5f, 1.0f, 2.0f, 4.0f, 6.0f, 8.0f, 10.0f, 12.0f, 14.0f, 16.7f, 20.0f, 25.0f, 33.3f, 50.0f, 66.7f, 100.0f };
+constexpr size_t NUM_FRAME_STAT_HISTOGRAM_BUCKETS = FRAME_STAT_HISTOGRAM_BUCKET_UPPER_BOUNDS_MS.size() + 1;
+
+// A sample is a hitch if it's longer than HITCH_THRESHOLD x median, a severe one above SEVERE_HITCH_THRESHOLD x median.
+constexpr float FRAME_STAT_HITCH_THRESHOLD        = 2.0f;
+constexpr float FRAME_STAT_SEVERE_HITCH_THRESHOLD = 4.0f;
+
+struct FFrameStatSummary
+{
+	size_t NumSamples = 0;
+	float  MinMs = 0.0f;
+	float  AvgMs = 0.0f;
+	float  P50Ms = 0.0f;
+	float  P95Ms = 0.0f;
+	float  P99Ms = 0.0f;
+	float  MaxMs = 0.0f;
+	float  StdDevMs = 0.0f;
+	size_t NumHitches = 0;
+	size_t NumSevereHitches = 0;
+	std::array<size_t, NUM_FRAME_STAT_HISTOGRAM_BUCKETS> Histogram = {};
+};
+
+class FrameStats
+{
+public:
+	void Initialize(size_t NumFramesToReserve);
+
+	inline void Record(EFrameStat Stat, float Milliseconds) { mSamples[Stat].push_back(Milliseconds); }
+
+	FFrameStatSummary ComputeSummary(EFrameStat Stat) const;
+
+	// Writes <FilePathWithoutExtension>.json (summaries & histograms), <..>.csv (one row of summary
+	// per stat) and <..>_Frames.csv (the samples). @Properties: build/run info added to the JSON report.
+	bool WriteReport(const std::string& FilePathWithoutExtension, const std::vector<std::pair<std::string, std::string>>& Properties) const;
+
+	void LogSummary() const;
+
+	static const char* GetStatName(EFrameStat Stat);
+
+private:
+	std::array<std::vector<float>, NUM_FRAME_STATS> mSamples;
+};
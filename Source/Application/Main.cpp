@@ -34,6 +34,22 @@ void ParseCommandLineParameters(FStartupParameters& refStartupParams, PSTR pScmd
 			refStartupParams.LogInitParams.bLogFile = true;
 			refStartupParams.LogInitParams.LogFilePath = std::move(paramValue);
 		}
+		if (paramName == "-LogAsync") // -LogAsync[=Drop|Block]
+		{
+			refStartupParams.LogInitParams.bLogAsync = true;
+			const std::string policy = StrUtil::GetLowercased(paramValue);
+			if (policy == "block")
+				refStartupParams.LogInitParams.AsyncOverflowPolicy = Log::EAsyncLogOverflowPolicy::BLOCK;
+			else if (policy.empty() || policy == "drop")
+				refStartupParams.LogInitParams.AsyncOverflowPolicy = Log::EAsyncLogOverflowPolicy::DROP;
+			else
+				Log::Warning("Unknown -LogAsync overflow policy: %s, using default: Drop", paramValue.c_str());
+		}
+		if (paramName == "-LogBinary") // -LogBinary[=path], decode with LogDecoder.exe
+		{
+			refStartupParams.LogInitParams.bLogBinary = true;
+			refStartupParams.LogInitParams.BinaryLogFilePath = std::move(paramValue);
+		}
 
 		//
 		// Engine Settings
@@ -89,6 +105,16 @@ void ParseCommandLineParameters(FStartupParameters& refStartupParams, PSTR pScmd
 			refStartupParams.bOverrideGFXSetting_bVSync= true;
 			refStartupParams.EngineSettings.gfx.bVsync= true;
 		}
+		if (paramName == "-MaxFPS" || paramName == "-MaxFrameRate")
+		{
+			refStartupParams.bOverrideGFXSetting_MaxFrameRate = true;
+			refStartupParams.EngineSettings.gfx.MaxFrameRate = static_cast<float>(std::atof(paramValue.c_str()));
+		}
+		if (paramName == "-CookTextures")
+		{
+			refStartupParams.bOverrideGFXSetting_bCookTextures = true;
+			refStartupParams.EngineSettings.gfx.bCookTextures = true;
+		}
 		if (paramName == "-TripleBuffering")
 		{
 			refStartupParams.bOverrideGFXSetting_bUseTripleBuffering = true;
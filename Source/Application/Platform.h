@@ -28,6 +28,8 @@ struct FStartupParameters
 	uint8 bOverrideGFXSetting_RenderScale         : 1;
 	uint8 bOverrideGFXSetting_bVSync              : 1;
 	uint8 bOverrideGFXSetting_bUseTripleBuffering : 1;
+	uint8 bOverrideGFXSetting_MaxFrameRate        : 1;
+	uint8 bOverrideGFXSetting_bCookTextures       : 1;
 
 	uint8 bOverrideENGSetting_MainWindowHeight    : 1;
 	uint8 bOverrideENGSetting_MainWindowWidth     : 1;
@@ -15,6 +15,10 @@ struct FGraphicsSettings
 	bool bUseTripleBuffering = false;
 
 	float RenderScale = 1.0f;
+
+	float MaxFrameRate = 0.0f; // <= 0: unlimited. Paces the update thread, see FrameLimiter
+
+	bool bCookTextures = false; // write Cooked/<name>.vqtex for the textures loaded from file, the existing cooked files are always used
 };
 
 struct FWindowSettings
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//
+// Micro benchmarks for the Utils library.
+// Each benchmark prints its own result table, run 'Benchmark.exe [filter...]'
+// to only run the benchmarks whose names contain any of the given filters.
+//
+namespace Benchmark
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	// returns the wall clock time in seconds spent in @fn
+	template<class F> double Measure(F&& fn)
+	{
+		const Clock::time_point t0 = Clock::now();
+		fn();
+		const Clock::time_point t1 = Clock::now();
+		return std::chrono::duration<double>(t1 - t0).count();
+	}
+
+	inline void PrintHeader(const char* pBenchmarkName)
+	{
+		printf("\n===================================================================\n");
+		printf(" %s\n", pBenchmarkName);
+		printf("===================================================================\n");
+	}
+
+	// returns the files in Data/Textures/ with the given extension, searched from the working directory
+	// (the build's Bin/ folder or the repository root), empty if the folder isn't found
+	std::vector<std::string> ListDataTextures(const char* pExtension);
+
+	//
+	// Benchmark entry points
+	//
+	void ThreadPool_Throughput();
+	void ThreadPool_PriorityLanes();
+	void ThreadPool_ExternalDrain();
+	void ParallelFor_Scaling();
+	void EventQueue_MPSC();
+	void Semaphore_PingPong();
+	void ParallelAlgorithms_Sort();
+	void ParallelAlgorithms_Scan();
+	void ParallelAlgorithms_Compaction();
+	void SPSCChannel_Throughput();
+	void SPSCChannel_Latency();
+	void Coroutines_AssetLoading();
+	void BlockCompression_Encode();
+	void CookedTexture_Load();
+	void HalfFloat_Convert();
+}
@@ -0,0 +1,108 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/BlockCompression.h"
+#include "../Utils/Source/Image.h"
+#include "../Utils/Source/Multithreading.h"
+#include "../Utils/Source/utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct FChannelMask { bool bChannel[4]; };
+
+	// channels each format stores, the PSNR is computed over these
+	FChannelMask GetEncodedChannels(EBlockCompressionFormat Format)
+	{
+		switch (Format)
+		{
+		case BC_FORMAT_BC1 : return { true, true , true , false };
+		case BC_FORMAT_BC4 : return { true, false, false, false };
+		case BC_FORMAT_BC5 : return { true, true , false, false };
+		case BC_FORMAT_BC6H: return { true, true , true , false };
+		default            : return { true, true , true , true  };
+		}
+	}
+
+	// peak signal: 255 for the 8-bit formats, 1.0 for BC6H (the source is the RGBA8 texture as [0, 1] floats)
+	double CalculatePSNR(const Image& Source, const Image& Decoded, EBlockCompressionFormat Format)
+	{
+		const FChannelMask Mask = GetEncodedChannels(Format);
+		const bool bFloat = Format == BC_FORMAT_BC6H;
+		const size_t NumPixels = static_cast<size_t>(Source.Width) * Source.Height;
+		double SumSqError = 0.0;
+		size_t NumSamples = 0;
+		for (size_t i = 0; i < NumPixels; ++i)
+		for (int c = 0; c < 4; ++c)
+		{
+			if (!Mask.bChannel[c])
+				continue;
+			const double Reference = static_cast<const uint8_t*>(Source.pData)[i * 4 + c] / (bFloat ? 255.0 : 1.0);
+			const double Value = bFloat
+				? static_cast<const float*>(Decoded.pData)[i * 4 + c]
+				: static_cast<const uint8_t*>(Decoded.pData)[i * 4 + c];
+			SumSqError += (Value - Reference) * (Value - Reference);
+			++NumSamples;
+		}
+		const double Peak = bFloat ? 1.0 : 255.0;
+		const double MSE = SumSqError / NumSamples;
+		return MSE > 0.0 ? 10.0 * std::log10(Peak * Peak / MSE) : 99.0;
+	}
+}
+
+void Benchmark::BlockCompression_Encode()
+{
+	PrintHeader("BlockCompression: encode throughput & quality (Data/Textures)");
+
+	const std::vector<std::string> TextureFiles = ListDataTextures("png");
+	if (TextureFiles.empty())
+	{
+		printf(" Skipped: Data/Textures/ not found, run from the build's Bin/ folder or the repository root\n");
+		return;
+	}
+
+	ThreadPool Pool;
+	Pool.Initialize(std::max<size_t>(1, ThreadPool::sHardwareThreadCount - 1), "Benchmark_BC");
+	printf(" %zu workers + the calling thread\n\n", Pool.GetThreadPoolSize());
+
+	for (const std::string& File : TextureFiles)
+	{
+		Image Source = Image::LoadFromFile(File.c_str());
+		if (!Source.IsValid())
+			continue;
+		printf(" %s (%dx%d)\n", DirectoryUtil::GetFileNameFromPath(File).c_str(), Source.Width, Source.Height);
+		printf(" %-6s | %-7s | %10s | %10s | %10s\n", "Format", "Quality", "Encode(ms)", "MPixels/s", "PSNR(dB)");
+		printf("-------------------------------------------------------------------\n");
+
+		const double NumMegaPixels = static_cast<double>(Source.Width) * Source.Height / 1e6;
+		for (int f = 0; f < NUM_BC_FORMATS; ++f)
+		for (int q = 0; q < NUM_BC_QUALITIES; ++q)
+		{
+			FBlockCompressionDesc Desc;
+			Desc.Format = static_cast<EBlockCompressionFormat>(f);
+			Desc.Quality = static_cast<EBlockCompressionQuality>(q);
+
+			FCompressedTexture Compressed;
+			const double Seconds = Measure([&]() { Compressed = BlockCompression::Compress(Source, Desc, &Pool); });
+
+			Image Decoded = BlockCompression::Decompress(Compressed);
+			const double PSNR = CalculatePSNR(Source, Decoded, Desc.Format);
+			Decoded.Destroy();
+
+			printf(" %-6s | %-7s | %10.2f | %10.2f | %10.2f\n"
+				, BlockCompression::GetFormatName(Desc.Format)
+				, BlockCompression::GetQualityName(Desc.Quality)
+				, Seconds * 1000.0
+				, NumMegaPixels / Seconds
+				, PSNR
+			);
+		}
+		printf("\n");
+		Source.Destroy();
+	}
+
+	Pool.Destroy();
+}
@@ -0,0 +1,132 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/BlockCompression.h"
+#include "../Utils/Source/CookedTexture.h"
+#include "../Utils/Source/Image.h"
+#include "../Utils/Source/MipChain.h"
+#include "../Utils/Source/Multithreading.h"
+#include "../Utils/Source/utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr int NUM_ITERATIONS = 5; // best of
+
+	// stands in for the upload heap: Texture::Create() copies the subresources into it
+	struct FUploadBuffer
+	{
+		std::unique_ptr<uint8_t[]> pData;
+		size_t                     Size = 0;
+		void Reserve(size_t NewSize) { if (NewSize > Size) { pData.reset(new uint8_t[NewSize]); Size = NewSize; } }
+	};
+
+	// the decoding path of Texture::CreateFromFile(): stb_image decode, mip chain, row by row copy into the upload buffer
+	void LoadDecoded(const std::string& File, ThreadPool* pWorkers, FUploadBuffer& Upload)
+	{
+		Image Source = Image::LoadFromFile(File.c_str(), pWorkers);
+		FMipChainDesc MipDesc = {};
+		const FMipChain Chain = GenerateMipChain(Source, MipDesc, pWorkers);
+		Source.Destroy();
+
+		Upload.Reserve(Chain.SizeInBytes * 2); // pitch padding
+		uint8_t* pDst = Upload.pData.get();
+		for (size_t i = 0; i < Chain.Levels.size(); ++i)
+		{
+			const FMipLevel& Level = Chain.Levels[i];
+			const size_t RowPitch = (Level.RowPitch + CookedTexture::PITCH_ALIGNMENT - 1) & ~(CookedTexture::PITCH_ALIGNMENT - 1);
+			for (int y = 0; y < Level.Height; ++y)
+				memcpy(pDst + y * RowPitch, static_cast<const uint8_t*>(Chain.GetLevelData(i)) + y * Level.RowPitch, Level.RowPitch);
+			pDst += RowPitch * Level.Height;
+		}
+	}
+
+	// the cooked path: map the file, one memcpy into the upload buffer
+	size_t LoadCooked(const std::string& CookedFile, FUploadBuffer& Upload)
+	{
+		CookedTextureFile File;
+		if (!File.Open(CookedFile))
+			return 0;
+		const size_t DataSize = static_cast<size_t>(File.GetHeader().DataSize);
+		Upload.Reserve(DataSize);
+		memcpy(Upload.pData.get(), File.GetData(), DataSize);
+		return DataSize;
+	}
+
+	template<class F> double BestOf(F&& fn)
+	{
+		double Best = 1e9;
+		for (int i = 0; i < NUM_ITERATIONS; ++i)
+			Best = std::min(Best, Benchmark::Measure(fn));
+		return Best;
+	}
+}
+
+void Benchmark::CookedTexture_Load()
+{
+	PrintHeader("CookedTexture: decode + mips vs. mapped cooked file (Data/Textures)");
+
+	const std::vector<std::string> TextureFiles = ListDataTextures("png");
+	if (TextureFiles.empty())
+	{
+		printf(" Skipped: Data/Textures/ not found, run from the build's Bin/ folder or the repository root\n");
+		return;
+	}
+
+	ThreadPool Pool;
+	Pool.Initialize(std::max<size_t>(1, ThreadPool::sHardwareThreadCount - 1), "Benchmark_Cook");
+	printf(" %zu workers + the calling thread, best of %d, the cooked files are in the OS file cache\n\n", Pool.GetThreadPoolSize(), NUM_ITERATIONS);
+
+	FUploadBuffer Upload;
+	for (const std::string& File : TextureFiles)
+	{
+		// cooked next to the engine's cache under another name, so the engine's cooked files aren't overwritten
+		const std::string CookedRGBA = DirectoryUtil::GetFolderPath(File) + "Cooked/Benchmark_" + DirectoryUtil::GetFileNameWithoutExtension(File) + "_rgba8." + CookedTexture::FILE_EXTENSION;
+		const std::string CookedBC7  = DirectoryUtil::GetFolderPath(File) + "Cooked/Benchmark_" + DirectoryUtil::GetFileNameWithoutExtension(File) + "_bc7."   + CookedTexture::FILE_EXTENSION;
+
+		Image Source = Image::LoadFromFile(File.c_str());
+		if (!Source.IsValid())
+			continue;
+		const FMipChain Chain = GenerateMipChain(Source, FMipChainDesc{}, &Pool);
+		printf(" %s (%dx%d, %zu mips)\n", DirectoryUtil::GetFileNameFromPath(File).c_str(), Source.Width, Source.Height, Chain.Levels.size());
+		Source.Destroy();
+
+		bool bCooked[2] = {};
+		double CookSeconds[2] = {};
+		CookSeconds[0] = Measure([&]() { bCooked[0] = CookedTexture::Write(CookedRGBA, Chain, 0); });
+		CookSeconds[1] = Measure([&]()
+		{
+			FBlockCompressionDesc Desc = {};
+			bCooked[1] = CookedTexture::Write(CookedBC7, BlockCompression::Compress(Chain, Desc, &Pool), 0);
+		});
+		if (!bCooked[0] || !bCooked[1])
+		{
+			printf(" Skipped: couldn't write the cooked files\n\n");
+			continue;
+		}
+
+		size_t Bytes[2] = {};
+		const double DecodeSeconds = BestOf([&]() { LoadDecoded(File, &Pool, Upload); });
+		const double CookedSeconds[2] =
+		{
+			  BestOf([&]() { Bytes[0] = LoadCooked(CookedRGBA, Upload); })
+			, BestOf([&]() { Bytes[1] = LoadCooked(CookedBC7 , Upload); })
+		};
+
+		printf(" %-22s | %10s | %10s | %10s | %8s\n", "Path", "Load(ms)", "Cook(ms)", "Upload", "Speedup");
+		printf("-------------------------------------------------------------------------\n");
+		printf(" %-22s | %10.2f | %10s | %10s | %8s\n", "png decode + mips", DecodeSeconds * 1000.0, "-", StrUtil::FormatByte(Chain.SizeInBytes).c_str(), "1.00x");
+		printf(" %-22s | %10.2f | %10.2f | %10s | %7.2fx\n", "cooked RGBA8", CookedSeconds[0] * 1000.0, CookSeconds[0] * 1000.0, StrUtil::FormatByte(Bytes[0]).c_str(), DecodeSeconds / CookedSeconds[0]);
+		printf(" %-22s | %10.2f | %10.2f | %10s | %7.2fx\n", "cooked BC7", CookedSeconds[1] * 1000.0, CookSeconds[1] * 1000.0, StrUtil::FormatByte(Bytes[1]).c_str(), DecodeSeconds / CookedSeconds[1]);
+		printf("\n");
+
+		std::remove(CookedRGBA.c_str());
+		std::remove(CookedBC7.c_str());
+	}
+
+	Pool.Destroy();
+}
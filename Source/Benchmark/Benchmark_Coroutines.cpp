@@ -0,0 +1,87 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/Coroutines.h"
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#if UTILS_HAS_COROUTINES
+namespace
+{
+	constexpr int    NUM_ASSETS         = 128;
+	constexpr int    NUM_IO_WORKERS     = 16;
+	constexpr double IO_LATENCY_MS      = 2.0; // simulated file read: the thread waits on the disk
+	constexpr double DECODE_DURATION_MS = 0.5; // simulated decode: the thread is busy
+
+	void SimulateFileRead()
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(IO_LATENCY_MS));
+	}
+	void SimulateDecode()
+	{
+		const Benchmark::Clock::time_point tEnd = Benchmark::Clock::now() + std::chrono::duration_cast<Benchmark::Clock::duration>(std::chrono::duration<double, std::milli>(DECODE_DURATION_MS));
+		while (Benchmark::Clock::now() < tEnd);
+	}
+
+	// the asset loading task blocks its worker through the file read
+	double RunBlocking(ThreadPool& CPUPool)
+	{
+		return Benchmark::Measure([&]()
+		{
+			std::vector<std::future<void>> Futures;
+			for (int i = 0; i < NUM_ASSETS; ++i)
+				Futures.push_back(CPUPool.AddTask([]() { SimulateFileRead(); SimulateDecode(); }));
+			for (std::future<void>& f : Futures)
+				f.wait();
+		});
+	}
+
+	Async::Task<void> LoadAsset(ThreadPool& CPUPool, ThreadPool& IOPool)
+	{
+		co_await IOPool.Schedule();
+		SimulateFileRead();
+		co_await CPUPool.Schedule();
+		SimulateDecode();
+	}
+
+	// the asset loading coroutine is suspended through the file read, freeing the CPU worker
+	double RunCoroutines(ThreadPool& CPUPool, ThreadPool& IOPool)
+	{
+		return Benchmark::Measure([&]()
+		{
+			std::vector<Async::Task<void>> Tasks;
+			for (int i = 0; i < NUM_ASSETS; ++i)
+				Tasks.push_back(LoadAsset(CPUPool, IOPool));
+			Async::SyncWait(Async::WhenAll(std::move(Tasks)));
+		});
+	}
+
+	void PrintRow(const char* pName, size_t NumCPUWorkers, double Seconds)
+	{
+		printf(" %-22s | %12zu | %12.2f | %12.0f\n", pName, NumCPUWorkers, Seconds * 1000.0, NUM_ASSETS / Seconds);
+	}
+}
+#endif
+
+void Benchmark::Coroutines_AssetLoading()
+{
+	PrintHeader("Coroutines: loading assets (file read + decode)");
+#if UTILS_HAS_COROUTINES
+	printf(" %-22s | %-12s | %-12s | %-12s\n", "Loader", "CPU Workers", "Total (ms)", "Assets/s");
+	printf("-------------------------------------------------------------------\n");
+
+	const size_t NumCPUWorkers = std::max<size_t>(2, ThreadPool::sHardwareThreadCount);
+	ThreadPool CPUPool, IOPool;
+	CPUPool.Initialize(NumCPUWorkers, "Benchmark_CPU");
+	IOPool.Initialize(NUM_IO_WORKERS, "Benchmark_IO");
+
+	PrintRow("Blocking"  , NumCPUWorkers, RunBlocking(CPUPool));
+	PrintRow("Coroutines", NumCPUWorkers, RunCoroutines(CPUPool, IOPool));
+
+	CPUPool.Destroy();
+	IOPool.Destroy();
+#else
+	printf(" Skipped: requires C++20 coroutines (/std:c++20)\n");
+#endif
+}
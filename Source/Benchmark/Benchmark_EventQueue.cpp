@@ -0,0 +1,100 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/Multithreading.h"
+#include "../Application/Events.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <algorithm>
+
+namespace
+{
+	constexpr int    NUM_EVENTS_PER_PRODUCER = 200000;
+	constexpr int    NUM_REPETITIONS         = 3;
+	constexpr size_t CHANNEL_CAPACITY        = 256; // same as the Engine's event queues
+
+	using BufferedEventQueue_t = BufferedContainer<std::queue<std::unique_ptr<IEvent>>, std::unique_ptr<IEvent>>;
+	using EventChannel_t       = MPSCChannel<FEventRecord, CHANNEL_CAPACITY>;
+
+	// @fnProduce(iProducer, iEvent) records one event, @fnConsume() drains what's available and returns the count
+	template<class FProduce, class FConsume>
+	double Run(int NumProducers, FProduce&& fnProduce, FConsume&& fnConsume)
+	{
+		return Benchmark::Measure([&]()
+		{
+			std::vector<std::thread> Producers;
+			for (int iProducer = 0; iProducer < NumProducers; ++iProducer)
+			{
+				Producers.emplace_back([&fnProduce, iProducer]()
+				{
+					for (int i = 0; i < NUM_EVENTS_PER_PRODUCER; ++i)
+						fnProduce(iProducer, i);
+				});
+			}
+
+			const size_t NumEventsTotal = size_t(NumProducers) * NUM_EVENTS_PER_PRODUCER;
+			size_t NumEventsConsumed = 0;
+			while (NumEventsConsumed < NumEventsTotal)
+			{
+				const size_t NumConsumed = fnConsume();
+				if (NumConsumed == 0)
+					std::this_thread::yield();
+				NumEventsConsumed += NumConsumed;
+			}
+
+			for (std::thread& th : Producers)
+				th.join();
+		});
+	}
+}
+
+void Benchmark::EventQueue_MPSC()
+{
+	PrintHeader("Event queue: BufferedContainer<unique_ptr<IEvent>> vs MPSCChannel<FEventRecord>");
+	printf(" %-10s | %-22s | %-22s\n", "Producers", "BufferedContainer", "MPSCChannel");
+	printf("-------------------------------------------------------------------\n");
+
+	for (int NumProducers : { 1, 2, 4 })
+	{
+		double tBuffered = 1e30, tChannel = 1e30;
+		for (int iRep = 0; iRep < NUM_REPETITIONS; ++iRep)
+		{
+			BufferedEventQueue_t BufferedQueue;
+			uint64_t Checksum = 0;
+			tBuffered = std::min(tBuffered, Run(NumProducers
+				, [&](int iProducer, int i) { BufferedQueue.AddItem(std::make_unique<KeyDownEvent>(nullptr, WPARAM(i))); }
+				, [&]()
+				{
+					BufferedQueue.SwapBuffers();
+					std::queue<std::unique_ptr<IEvent>>& q = BufferedQueue.GetBackContainer();
+					const size_t NumEvents = q.size();
+					while (!q.empty())
+					{
+						Checksum += static_cast<const KeyDownEvent*>(q.front().get())->wparam;
+						q.pop();
+					}
+					return NumEvents;
+				}
+			));
+
+			EventChannel_t* pChannel = new EventChannel_t(); // ~10KB, keep it off the stack
+			tChannel = std::min(tChannel, Run(NumProducers
+				, [&](int iProducer, int i) { pChannel->Push(KeyDownEvent(nullptr, WPARAM(i))); }
+				, [&]()
+				{
+					return pChannel->ConsumeAll([&](const FEventRecord& Event) { Checksum += Event.As<KeyDownEvent>().wparam; });
+				}
+			));
+			delete pChannel;
+		}
+
+		const double NumEvents = double(NumProducers) * NUM_EVENTS_PER_PRODUCER;
+		printf(" %-10d | %12.3f Mevents/s | %12.3f Mevents/s\n", NumProducers
+			, NumEvents / tBuffered * 1e-6
+			, NumEvents / tChannel * 1e-6
+		);
+	}
+}
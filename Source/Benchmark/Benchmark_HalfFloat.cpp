@@ -0,0 +1,138 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/HalfFloat.h"
+#include "../Utils/Source/Multithreading.h"
+#include "../Utils/Source/SystemInfo.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr int NUM_REPETITIONS = 5;
+
+	// RGBA32F environment maps: 2K & 4K equirectangular
+	const size_t NUM_PIXELS[] = { 2048 * 1024, 4096 * 2048 };
+
+	template<class F> double BestOf(F&& fn)
+	{
+		double t = 1e30;
+		for (int i = 0; i < NUM_REPETITIONS; ++i)
+			t = std::min(t, Benchmark::Measure(fn));
+		return t;
+	}
+
+	// NaNs, infinities and the edges of the half range, in a full vector so the kernels see them rather than the scalar tails
+	const uint32_t SPECIAL_FLOAT_BITS[16] =
+	{
+		  0x7FFFFFFF, 0xFFFFFFFF, 0x7F800001, 0xFFC00000 // NaNs
+		, 0x7F800000, 0xFF800000, 0x477FF000, 0x477FEFFF // infinities, 65520 rounds to infinity, 65519.99
+		, 0x477FE000, 0x38800000, 0x387FFFFF, 0x33000000 // 65504, smallest half normal, largest half denormal, half of the smallest denormal
+		, 0x33000001, 0x80000000, 0x00000001, 0x3F800000 // rounds up to the smallest denormal, -0, float denormal, 1
+	};
+
+	// Every float and every half through the array path (the kernel the CPU dispatches to) against the scalar conversions.
+	// Returns the number of values that don't convert to the same bits.
+	size_t VerifyAllValues(ThreadPool& Pool)
+	{
+		std::atomic<size_t> NumMismatches = 0;
+
+		float    SpecialFloats[16];
+		uint16_t SpecialHalves[16];
+		memcpy(SpecialFloats, SPECIAL_FLOAT_BITS, sizeof(SpecialFloats));
+		HalfFloat::FromFloat(SpecialFloats, SpecialHalves, 16);
+		for (int i = 0; i < 16; ++i)
+		{
+			if (SpecialHalves[i] != HalfFloat::FromFloat(SpecialFloats[i]))
+			{
+				printf(" mismatch: 0x%08X -> 0x%04X, scalar 0x%04X\n", SPECIAL_FLOAT_BITS[i], SpecialHalves[i], HalfFloat::FromFloat(SpecialFloats[i]));
+				++NumMismatches;
+			}
+		}
+
+		constexpr uint64_t NUM_FLOATS = 1ull << 32;
+		constexpr size_t   CHUNK_SIZE = 1 << 16;
+		Pool.ParallelForRange(0, static_cast<size_t>(NUM_FLOATS / CHUNK_SIZE), [&](size_t iBegin, size_t iEnd)
+		{
+			std::vector<uint32_t> Bits(CHUNK_SIZE);
+			std::vector<float>    Floats(CHUNK_SIZE);
+			std::vector<uint16_t> Halves(CHUNK_SIZE);
+			size_t NumRangeMismatches = 0;
+			for (size_t iChunk = iBegin; iChunk < iEnd; ++iChunk)
+			{
+				for (size_t i = 0; i < CHUNK_SIZE; ++i)
+					Bits[i] = static_cast<uint32_t>(iChunk * CHUNK_SIZE + i);
+				memcpy(Floats.data(), Bits.data(), CHUNK_SIZE * sizeof(float));
+
+				HalfFloat::FromFloat(Floats.data(), Halves.data(), CHUNK_SIZE);
+				for (size_t i = 0; i < CHUNK_SIZE; ++i)
+					NumRangeMismatches += Halves[i] != HalfFloat::FromFloat(Floats[i]) ? 1 : 0;
+			}
+			NumMismatches += NumRangeMismatches;
+		});
+
+		std::vector<uint16_t> AllHalves(1 << 16);
+		std::vector<float>    Restored(1 << 16);
+		for (size_t i = 0; i < AllHalves.size(); ++i)
+			AllHalves[i] = static_cast<uint16_t>(i);
+		HalfFloat::ToFloat(AllHalves.data(), Restored.data(), AllHalves.size());
+		for (size_t i = 0; i < AllHalves.size(); ++i)
+		{
+			const float Scalar = HalfFloat::ToFloat(AllHalves[i]);
+			NumMismatches += memcmp(&Scalar, &Restored[i], sizeof(float)) != 0 ? 1 : 0;
+		}
+		return NumMismatches.load();
+	}
+}
+
+void Benchmark::HalfFloat_Convert()
+{
+	PrintHeader("HalfFloat: float32 <-> float16 conversion (RGBA32F -> RGBA16F)");
+
+	ThreadPool Pool;
+	Pool.Initialize(std::max<size_t>(1, ThreadPool::sHardwareThreadCount - 1), "Benchmark_Half");
+	printf(" kernels: %s, %zu workers + the calling thread\n", SystemInfo::GetCPUFeatures().bF16C ? "F16C" : "SSE2", Pool.GetThreadPoolSize());
+
+	const size_t NumMismatches = VerifyAllValues(Pool);
+	printf(" verification: all 2^32 floats & 2^16 halves vs scalar: %s (%zu mismatches)\n\n", NumMismatches == 0 ? "bit-exact" : "FAILED", NumMismatches);
+	printf(" %-10s | %-14s | %11s | %11s | %10s\n", "Pixels", "Path", "f32->f16 ms", "f16->f32 ms", "GB/s (f32)");
+	printf("-------------------------------------------------------------------\n");
+
+	for (size_t NumPixels : NUM_PIXELS)
+	{
+		const size_t Count = NumPixels * 4;
+		std::vector<float> Source(Count);
+		std::vector<float> Restored(Count);
+		std::vector<uint16_t> Halves(Count);
+		for (size_t i = 0; i < Count; ++i)
+			Source[i] = std::exp2(static_cast<float>(i % 4096) / 256.0f - 8.0f); // HDR range: 2^-8 .. 2^8
+
+		const double Scalar[2] =
+		{
+			  BestOf([&]() { for (size_t i = 0; i < Count; ++i) Halves[i] = HalfFloat::FromFloat(Source[i]); })
+			, BestOf([&]() { for (size_t i = 0; i < Count; ++i) Restored[i] = HalfFloat::ToFloat(Halves[i]); })
+		};
+		const double Vector[2] =
+		{
+			  BestOf([&]() { HalfFloat::FromFloat(Source.data(), Halves.data(), Count); })
+			, BestOf([&]() { HalfFloat::ToFloat(Halves.data(), Restored.data(), Count); })
+		};
+		const double Parallel[2] =
+		{
+			  BestOf([&]() { HalfFloat::FromFloat(Source.data(), Halves.data(), Count, &Pool); })
+			, BestOf([&]() { HalfFloat::ToFloat(Halves.data(), Restored.data(), Count, &Pool); })
+		};
+
+		const double GBytes = Count * sizeof(float) / 1e9;
+		const std::string Name = std::to_string(NumPixels / (1024 * 1024)) + "M";
+		printf(" %-10s | %-14s | %11.2f | %11.2f | %10.2f\n", Name.c_str(), "scalar"        , Scalar[0]   * 1000.0, Scalar[1]   * 1000.0, GBytes / Scalar[0]);
+		printf(" %-10s | %-14s | %11.2f | %11.2f | %10.2f\n", ""          , "vector"        , Vector[0]   * 1000.0, Vector[1]   * 1000.0, GBytes / Vector[0]);
+		printf(" %-10s | %-14s | %11.2f | %11.2f | %10.2f\n", ""          , "vector+workers", Parallel[0] * 1000.0, Parallel[1] * 1000.0, GBytes / Parallel[0]);
+	}
+
+	Pool.Destroy();
+}
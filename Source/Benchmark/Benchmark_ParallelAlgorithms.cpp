@@ -0,0 +1,141 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/ParallelAlgorithms.h"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <execution>
+
+namespace
+{
+	const size_t NUM_ELEMENTS[] = { 1000000, 10000000, 50000000 };
+
+	template<class T> std::vector<T> GenerateRandomKeys(size_t Count, uint32_t Seed)
+	{
+		std::mt19937_64 rng(Seed);
+		std::vector<T> Keys(Count);
+		for (T& Key : Keys)
+			Key = static_cast<T>(rng());
+		return Keys;
+	}
+
+	void PrintRow(size_t NumElements, const char* pAlgorithm, double Seconds, double BaselineSeconds)
+	{
+		printf(" %-10zu | %-34s | %10.2f | %8.2fx\n", NumElements, pAlgorithm, Seconds * 1000.0, BaselineSeconds / Seconds);
+	}
+
+	void PrintTableHeader()
+	{
+		printf(" %-10s | %-34s | %-10s | %-9s\n", "Elements", "Algorithm", "Time (ms)", "Speedup");
+		printf("-------------------------------------------------------------------\n");
+	}
+}
+
+void Benchmark::ParallelAlgorithms_Sort()
+{
+	PrintHeader("ParallelAlgorithms: RadixSort() vs std::sort");
+	PrintTableHeader();
+
+	ThreadPool Pool;
+	Pool.Initialize(std::max<size_t>(1, ThreadPool::sHardwareThreadCount - 1), "Benchmark_Workers", 0xFFAAAAAA, EThreadPoolSchedulingMode::WORK_STEALING);
+
+	for (size_t NumElements : NUM_ELEMENTS)
+	{
+		// 64-bit draw keys with a 32-bit payload (e.g. draw index)
+		const std::vector<uint64_t> Keys = GenerateRandomKeys<uint64_t>(NumElements, 7);
+		std::vector<uint64_t> Work; // sorted in place: fresh copy of the keys for every run
+
+		Work = Keys;
+		const double tSort = Benchmark::Measure([&]() { std::sort(Work.begin(), Work.end()); });
+		PrintRow(NumElements, "std::sort (u64)", tSort, tSort);
+		Work = Keys;
+		const double tSortPar = Benchmark::Measure([&]() { std::sort(std::execution::par_unseq, Work.begin(), Work.end()); });
+		PrintRow(NumElements, "std::sort(par_unseq) (u64)", tSortPar, tSort);
+		Work = Keys;
+		const double tRadix = Benchmark::Measure([&]() { Parallel::RadixSort(Pool, Work.data(), Work.size()); });
+		PrintRow(NumElements, "Parallel::RadixSort (u64)", tRadix, tSort);
+		if (!std::is_sorted(Work.begin(), Work.end()))
+			printf(" ERROR: RadixSort output isn't sorted\n");
+
+		// key + payload
+		std::vector<std::pair<uint64_t, uint32_t>> Pairs(NumElements);
+		for (size_t i = 0; i < NumElements; ++i)
+			Pairs[i] = { Keys[i], static_cast<uint32_t>(i) };
+		const double tSortPairs = Benchmark::Measure([&]() { std::stable_sort(Pairs.begin(), Pairs.end(), [](const auto& a, const auto& b) { return a.first < b.first; }); });
+		PrintRow(NumElements, "std::stable_sort (u64 + u32)", tSortPairs, tSortPairs);
+
+		std::vector<uint64_t> KeysWithPayload = Keys;
+		std::vector<uint32_t> Payload(NumElements);
+		std::iota(Payload.begin(), Payload.end(), 0u);
+		const double tRadixPairs = Benchmark::Measure([&]() { Parallel::RadixSort(Pool, KeysWithPayload.data(), Payload.data(), NumElements); });
+		PrintRow(NumElements, "Parallel::RadixSort (u64 + u32)", tRadixPairs, tSortPairs);
+	}
+
+	Pool.Destroy();
+}
+
+void Benchmark::ParallelAlgorithms_Scan()
+{
+	PrintHeader("ParallelAlgorithms: ExclusiveScan() vs std::exclusive_scan");
+	PrintTableHeader();
+
+	ThreadPool Pool;
+	Pool.Initialize(std::max<size_t>(1, ThreadPool::sHardwareThreadCount - 1), "Benchmark_Workers", 0xFFAAAAAA, EThreadPoolSchedulingMode::WORK_STEALING);
+
+	for (size_t NumElements : NUM_ELEMENTS)
+	{
+		std::vector<uint32_t> Input(NumElements);
+		std::vector<uint32_t> Output(NumElements);
+		std::mt19937 rng(3);
+		for (uint32_t& v : Input)
+			v = rng() & 0xFF;
+
+		const double tSerial = Benchmark::Measure([&]() { std::exclusive_scan(Input.begin(), Input.end(), Output.begin(), 0u); });
+		PrintRow(NumElements, "std::exclusive_scan", tSerial, tSerial);
+		const double tPar = Benchmark::Measure([&]() { std::exclusive_scan(std::execution::par_unseq, Input.begin(), Input.end(), Output.begin(), 0u); });
+		PrintRow(NumElements, "std::exclusive_scan(par_unseq)", tPar, tSerial);
+		const double tScan = Benchmark::Measure([&]() { Parallel::ExclusiveScan(Pool, Input.data(), Output.data(), NumElements, 0u); });
+		PrintRow(NumElements, "Parallel::ExclusiveScan", tScan, tSerial);
+	}
+
+	Pool.Destroy();
+}
+
+void Benchmark::ParallelAlgorithms_Compaction()
+{
+	PrintHeader("ParallelAlgorithms: Compact() / StablePartition() vs std::");
+	PrintTableHeader();
+
+	ThreadPool Pool;
+	Pool.Initialize(std::max<size_t>(1, ThreadPool::sHardwareThreadCount - 1), "Benchmark_Workers", 0xFFAAAAAA, EThreadPoolSchedulingMode::WORK_STEALING);
+
+	// visibility list: ~50% of the objects pass
+	auto fnIsVisible = [](uint32_t ObjectID) { return (ObjectID * 2654435761u) >> 31; };
+	for (size_t NumElements : NUM_ELEMENTS)
+	{
+		std::vector<uint32_t> Input(NumElements);
+		std::iota(Input.begin(), Input.end(), 0u);
+		std::vector<uint32_t> Output(NumElements);
+
+		const double tCopyIf = Benchmark::Measure([&]() { std::copy_if(Input.begin(), Input.end(), Output.begin(), fnIsVisible); });
+		PrintRow(NumElements, "std::copy_if", tCopyIf, tCopyIf);
+		const double tCopyIfPar = Benchmark::Measure([&]() { std::copy_if(std::execution::par_unseq, Input.begin(), Input.end(), Output.begin(), fnIsVisible); });
+		PrintRow(NumElements, "std::copy_if(par_unseq)", tCopyIfPar, tCopyIf);
+		const double tCompact = Benchmark::Measure([&]() { Parallel::Compact(Pool, Input.data(), NumElements, Output.data(), fnIsVisible); });
+		PrintRow(NumElements, "Parallel::Compact", tCompact, tCopyIf);
+
+		std::vector<uint32_t> Work = Input;
+		const double tPartition = Benchmark::Measure([&]() { std::stable_partition(Work.begin(), Work.end(), fnIsVisible); });
+		PrintRow(NumElements, "std::stable_partition", tPartition, tPartition);
+		Work = Input;
+		const double tPartitionPar = Benchmark::Measure([&]() { std::stable_partition(std::execution::par_unseq, Work.begin(), Work.end(), fnIsVisible); });
+		PrintRow(NumElements, "std::stable_partition(par_unseq)", tPartitionPar, tPartition);
+		Work = Input;
+		const double tStablePartition = Benchmark::Measure([&]() { Parallel::StablePartition(Pool, Work.data(), NumElements, fnIsVisible); });
+		PrintRow(NumElements, "Parallel::StablePartition", tStablePartition, tPartition);
+	}
+
+	Pool.Destroy();
+}
@@ -0,0 +1,93 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/Multithreading.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	constexpr int NUM_REPETITIONS = 5;
+
+	struct FWorkload
+	{
+		const char* pName;
+		size_t      NumItems;
+		int         NumInnerIterations; // per-item cost knob
+	};
+
+	// cheap items (e.g. transform updates) to expensive items (e.g. per-pixel filtering)
+	const FWorkload WORKLOADS[] =
+	{
+		  { "100k x cheap"   , 100000 , 1   }
+		, { "1M x cheap"     , 1000000, 1   }
+		, { "100k x medium"  , 100000 , 32  }
+		, { "10k x expensive", 10000  , 1024}
+		, { "64 x expensive" , 64     , 1024}
+	};
+
+	inline float ItemWork(size_t i, int NumInnerIterations)
+	{
+		float f = static_cast<float>(i);
+		for (int k = 0; k < NumInnerIterations; ++k)
+			f = std::sqrt(f * 1.0001f + 1.0f);
+		return f;
+	}
+
+	template<class F> double BestOf(F&& fn)
+	{
+		double t = 1e30;
+		for (int i = 0; i < NUM_REPETITIONS; ++i)
+			t = std::min(t, Benchmark::Measure(fn));
+		return t;
+	}
+}
+
+void Benchmark::ParallelFor_Scaling()
+{
+	PrintHeader("ThreadPool: ParallelFor() / ParallelReduce() vs serial loop");
+	printf(" %-16s | %-8s | %-12s | %-14s | %-14s\n", "Workload", "Workers", "Serial (ms)", "ParallelFor", "ParallelReduce");
+	printf("-------------------------------------------------------------------\n");
+
+	std::vector<size_t> WorkerCounts;
+	for (size_t n = 1; n < ThreadPool::sHardwareThreadCount; n *= 2)
+		WorkerCounts.push_back(n);
+	WorkerCounts.push_back(ThreadPool::sHardwareThreadCount);
+
+	for (const FWorkload& w : WORKLOADS)
+	{
+		std::vector<float> Output(w.NumItems);
+
+		const double tSerial = BestOf([&]()
+		{
+			for (size_t i = 0; i < w.NumItems; ++i)
+				Output[i] = ItemWork(i, w.NumInnerIterations);
+		});
+
+		for (size_t NumWorkers : WorkerCounts)
+		{
+			ThreadPool pool;
+			pool.Initialize(NumWorkers, "BenchmarkWorker", 0xFFAAAAAA, EThreadPoolSchedulingMode::WORK_STEALING);
+
+			const double tFor = BestOf([&]()
+			{
+				pool.ParallelFor(0, w.NumItems, [&](size_t i) { Output[i] = ItemWork(i, w.NumInnerIterations); });
+			});
+			const double tReduce = BestOf([&]()
+			{
+				volatile float Sum = pool.ParallelReduce(0, w.NumItems, 0.0f
+					, [&](size_t iBegin, size_t iEnd, float Acc) { for (size_t i = iBegin; i < iEnd; ++i) Acc += ItemWork(i, w.NumInnerIterations); return Acc; }
+					, [](float a, float b) { return a + b; }
+				);
+				(void)Sum;
+			});
+			pool.Destroy();
+
+			printf(" %-16s | %-8zu | %12.3f | %6.3fms %5.2fx | %6.3fms %5.2fx\n", w.pName, NumWorkers, tSerial * 1e3
+				, tFor * 1e3, tSerial / tFor
+				, tReduce * 1e3, tSerial / tReduce
+			);
+		}
+	}
+}
@@ -0,0 +1,197 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/Multithreading.h"
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+	constexpr size_t NUM_ITEMS        = 4 * 1024 * 1024;
+	constexpr size_t CHANNEL_CAPACITY = 1024;
+	constexpr size_t BATCH_SIZE       = 64;
+	constexpr int    NUM_ROUND_TRIPS  = 50000;
+
+	using Channel_t = SPSCChannel<uint64_t, CHANNEL_CAPACITY>;
+
+	// ------------------------------------------------------------------------------------------------
+	// Throughput: one producer streams NUM_ITEMS to one consumer, returns the items/s
+	// ------------------------------------------------------------------------------------------------
+	template<class FProduce, class FConsume>
+	double RunThroughput(FProduce&& fnProduce, FConsume&& fnConsume)
+	{
+		uint64_t Checksum = 0;
+		const double Seconds = Benchmark::Measure([&]()
+		{
+			std::thread Producer(fnProduce);
+			Checksum = fnConsume();
+			Producer.join();
+		});
+		if (Checksum != uint64_t(NUM_ITEMS) * (NUM_ITEMS - 1) / 2)
+			printf(" ERROR: checksum mismatch\n");
+		return NUM_ITEMS / Seconds;
+	}
+
+	double Throughput_ConcurrentQueue()
+	{
+		ConcurrentQueue<uint64_t> Queue(nullptr);
+		return RunThroughput(
+			[&]() { for (uint64_t i = 0; i < NUM_ITEMS; ++i) Queue.Enqueue(uint64_t(i)); },
+			[&]()
+			{
+				uint64_t Sum = 0, Item = 0;
+				for (size_t NumPopped = 0; NumPopped < NUM_ITEMS; )
+				{
+					if (Queue.TryDequeue(Item)) { Sum += Item; ++NumPopped; }
+					else                        std::this_thread::yield();
+				}
+				return Sum;
+			});
+	}
+
+	double Throughput_SPSCChannel()
+	{
+		std::unique_ptr<Channel_t> pChannel = std::make_unique<Channel_t>();
+		return RunThroughput(
+			[&]()
+			{
+				for (uint64_t i = 0; i < NUM_ITEMS; ++i)
+					while (!pChannel->TryPush(i))
+						std::this_thread::yield();
+			},
+			[&]()
+			{
+				uint64_t Sum = 0, Item = 0;
+				for (size_t NumPopped = 0; NumPopped < NUM_ITEMS; )
+				{
+					if (pChannel->TryPop(Item)) { Sum += Item; ++NumPopped; }
+					else                        std::this_thread::yield();
+				}
+				return Sum;
+			});
+	}
+
+	double Throughput_SPSCChannelBatch()
+	{
+		std::unique_ptr<Channel_t> pChannel = std::make_unique<Channel_t>();
+		return RunThroughput(
+			[&]()
+			{
+				uint64_t Batch[BATCH_SIZE];
+				for (uint64_t i = 0; i < NUM_ITEMS; i += BATCH_SIZE)
+				{
+					for (size_t j = 0; j < BATCH_SIZE; ++j)
+						Batch[j] = i + j;
+					for (size_t NumPushed = 0; NumPushed < BATCH_SIZE; )
+					{
+						const size_t n = pChannel->TryPushBatch(&Batch[NumPushed], BATCH_SIZE - NumPushed);
+						NumPushed += n;
+						if (n == 0)
+							std::this_thread::yield();
+					}
+				}
+			},
+			[&]()
+			{
+				uint64_t Sum = 0;
+				uint64_t Batch[BATCH_SIZE];
+				for (size_t NumPopped = 0; NumPopped < NUM_ITEMS; )
+				{
+					const size_t n = pChannel->TryPopBatch(Batch, BATCH_SIZE);
+					for (size_t j = 0; j < n; ++j)
+						Sum += Batch[j];
+					NumPopped += n;
+					if (n == 0)
+						std::this_thread::yield();
+				}
+				return Sum;
+			});
+	}
+
+	// ------------------------------------------------------------------------------------------------
+	// Latency: A sends an item to B and waits for B's answer, returns the round trip latencies in us
+	// ------------------------------------------------------------------------------------------------
+	struct FLatencyStats
+	{
+		double Median;
+		double P99;
+		double Max;
+	};
+
+	template<class TQueue, class FPush, class FTryPop>
+	FLatencyStats RunPingPong(TQueue& Ping, TQueue& Pong, FPush&& fnPush, FTryPop&& fnTryPop)
+	{
+		auto fnPop = [&](TQueue& Queue)
+		{
+			uint64_t Item = 0;
+			while (!fnTryPop(Queue, Item))
+				std::this_thread::yield();
+			return Item;
+		};
+
+		std::thread Ponger([&]()
+		{
+			for (int i = 0; i < NUM_ROUND_TRIPS; ++i)
+				fnPush(Pong, fnPop(Ping));
+		});
+
+		std::vector<double> Latencies(NUM_ROUND_TRIPS);
+		for (int i = 0; i < NUM_ROUND_TRIPS; ++i)
+		{
+			const Benchmark::Clock::time_point t0 = Benchmark::Clock::now();
+			fnPush(Ping, uint64_t(i));
+			fnPop(Pong);
+			Latencies[i] = std::chrono::duration<double, std::micro>(Benchmark::Clock::now() - t0).count();
+		}
+		Ponger.join();
+
+		std::sort(Latencies.begin(), Latencies.end());
+		return { Latencies[NUM_ROUND_TRIPS / 2], Latencies[NUM_ROUND_TRIPS * 99 / 100], Latencies.back() };
+	}
+
+	FLatencyStats Latency_ConcurrentQueue()
+	{
+		ConcurrentQueue<uint64_t> Ping(nullptr), Pong(nullptr);
+		return RunPingPong(Ping, Pong
+			, [](ConcurrentQueue<uint64_t>& Queue, uint64_t Item) { Queue.Enqueue(std::move(Item)); }
+			, [](ConcurrentQueue<uint64_t>& Queue, uint64_t& Item) { return Queue.TryDequeue(Item); }
+		);
+	}
+
+	FLatencyStats Latency_SPSCChannel()
+	{
+		std::unique_ptr<Channel_t> pPing = std::make_unique<Channel_t>();
+		std::unique_ptr<Channel_t> pPong = std::make_unique<Channel_t>();
+		return RunPingPong(*pPing, *pPong
+			, [](Channel_t& Channel, uint64_t Item) { Channel.TryPush(Item); } // never full: one item in flight
+			, [](Channel_t& Channel, uint64_t& Item) { return Channel.TryPop(Item); }
+		);
+	}
+}
+
+void Benchmark::SPSCChannel_Throughput()
+{
+	PrintHeader("SPSC Channel: throughput, 1 producer -> 1 consumer (Mitems/s)");
+	printf(" %-30s | %-12s\n", "Queue", "Mitems/s");
+	printf("-------------------------------------------------------------------\n");
+
+	printf(" %-30s | %12.2f\n", "ConcurrentQueue"             , Throughput_ConcurrentQueue()  / 1e6);
+	printf(" %-30s | %12.2f\n", "SPSCChannel"                 , Throughput_SPSCChannel()      / 1e6);
+	printf(" %-30s | %12.2f\n", "SPSCChannel (batches of 64)" , Throughput_SPSCChannelBatch() / 1e6);
+}
+
+void Benchmark::SPSCChannel_Latency()
+{
+	PrintHeader("SPSC Channel: ping-pong round trip latency (us)");
+	printf(" %-22s | %-12s | %-12s | %-12s\n", "Queue", "Median", "P99", "Max");
+	printf("-------------------------------------------------------------------\n");
+
+	auto fnPrintRow = [](const char* pName, const FLatencyStats& Stats)
+	{
+		printf(" %-22s | %12.2f | %12.2f | %12.2f\n", pName, Stats.Median, Stats.P99, Stats.Max);
+	};
+	fnPrintRow("ConcurrentQueue", Latency_ConcurrentQueue());
+	fnPrintRow("SPSCChannel"    , Latency_SPSCChannel());
+}
@@ -0,0 +1,65 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/Multithreading.h"
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+	constexpr int NUM_ROUND_TRIPS = 50000;
+
+	struct FLatencyStats
+	{
+		double Median;
+		double P99;
+		double Max;
+	};
+
+	// Update/Render style handoff: thread A signals B and waits for B's answer, one round trip per iteration.
+	// Returns the round trip latencies in microseconds.
+	template<class TSemaphore>
+	FLatencyStats RunPingPong()
+	{
+		TSemaphore SemPing(0, 1);
+		TSemaphore SemPong(0, 1);
+
+		std::thread Ponger([&]()
+		{
+			for (int i = 0; i < NUM_ROUND_TRIPS; ++i)
+			{
+				SemPing.Wait();
+				SemPong.Signal();
+			}
+		});
+
+		std::vector<double> Latencies(NUM_ROUND_TRIPS);
+		for (int i = 0; i < NUM_ROUND_TRIPS; ++i)
+		{
+			const Benchmark::Clock::time_point t0 = Benchmark::Clock::now();
+			SemPing.Signal();
+			SemPong.Wait();
+			Latencies[i] = std::chrono::duration<double, std::micro>(Benchmark::Clock::now() - t0).count();
+		}
+		Ponger.join();
+
+		std::sort(Latencies.begin(), Latencies.end());
+		return { Latencies[NUM_ROUND_TRIPS / 2], Latencies[NUM_ROUND_TRIPS * 99 / 100], Latencies.back() };
+	}
+
+	void PrintRow(const char* pName, const FLatencyStats& Stats)
+	{
+		printf(" %-22s | %12.2f | %12.2f | %12.2f\n", pName, Stats.Median, Stats.P99, Stats.Max);
+	}
+}
+
+void Benchmark::Semaphore_PingPong()
+{
+	PrintHeader("Semaphore: ping-pong round trip latency (us)");
+	printf(" %-22s | %-12s | %-12s | %-12s\n", "Semaphore", "Median", "P99", "Max");
+	printf("-------------------------------------------------------------------\n");
+
+	PrintRow("Semaphore"           , RunPingPong<Semaphore>());
+	PrintRow("LightweightSemaphore", RunPingPong<LightweightSemaphore>());
+}
@@ -0,0 +1,279 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/Multithreading.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+	constexpr int NUM_FLAT_TASKS               = 200000;
+	constexpr int NUM_NESTED_ROOT_TASKS        = 2000;
+	constexpr int NUM_NESTED_CHILDREN_PER_ROOT = 100;
+	constexpr int NUM_REPETITIONS              = 3;
+
+	void WaitForPool(const ThreadPool& pool)
+	{
+		while (pool.GetNumActiveTasks() != 0)
+			std::this_thread::yield();
+	}
+
+	// a single external thread submits all the tasks
+	double RunFlatSubmission(ThreadPool& pool, std::atomic<int>& Counter)
+	{
+		return Benchmark::Measure([&]()
+		{
+			for (int i = 0; i < NUM_FLAT_TASKS; ++i)
+				pool.AddTask([&Counter]() { Counter.fetch_add(1, std::memory_order_relaxed); });
+			WaitForPool(pool);
+		});
+	}
+
+	// same as above without the std::future<>: tasks don't allocate at all
+	double RunFlatSubmissionNoFuture(ThreadPool& pool, std::atomic<int>& Counter)
+	{
+		return Benchmark::Measure([&]()
+		{
+			for (int i = 0; i < NUM_FLAT_TASKS; ++i)
+				pool.AddTaskNoFuture([&Counter]() { Counter.fetch_add(1, std::memory_order_relaxed); });
+			WaitForPool(pool);
+		});
+	}
+
+	// tasks spawn tasks from the worker threads, e.g. a loading task fanning out per-mip work
+	double RunNestedSubmission(ThreadPool& pool, std::atomic<int>& Counter)
+	{
+		return Benchmark::Measure([&]()
+		{
+			for (int i = 0; i < NUM_NESTED_ROOT_TASKS; ++i)
+			{
+				pool.AddTaskNoFuture([&pool, &Counter]()
+				{
+					for (int j = 0; j < NUM_NESTED_CHILDREN_PER_ROOT; ++j)
+						pool.AddTaskNoFuture([&Counter]() { Counter.fetch_add(1, std::memory_order_relaxed); });
+				});
+			}
+			WaitForPool(pool);
+		});
+	}
+}
+
+void Benchmark::ThreadPool_Throughput()
+{
+	PrintHeader("ThreadPool: AddTask() throughput, SHARED_QUEUE vs WORK_STEALING");
+	printf(" %-8s | %-14s | %-18s | %-18s | %-18s\n", "Workers", "Scheduler", "Flat (Mtasks/s)", "Flat NoFuture", "Nested NoFuture");
+	printf("-------------------------------------------------------------------\n");
+
+	std::vector<size_t> WorkerCounts;
+	for (size_t n = 1; n < ThreadPool::sHardwareThreadCount; n *= 2)
+		WorkerCounts.push_back(n);
+	WorkerCounts.push_back(ThreadPool::sHardwareThreadCount);
+
+	const EThreadPoolSchedulingMode Modes[] = { EThreadPoolSchedulingMode::SHARED_QUEUE, EThreadPoolSchedulingMode::WORK_STEALING };
+	const char* ModeNames[] = { "SHARED_QUEUE", "WORK_STEALING" };
+
+	for (size_t NumWorkers : WorkerCounts)
+	{
+		for (int iMode = 0; iMode < 2; ++iMode)
+		{
+			ThreadPool pool;
+			pool.Initialize(NumWorkers, "BenchmarkWorker", 0xFFAAAAAA, Modes[iMode]);
+
+			std::atomic<int> Counter = 0;
+			double tFlat = 1e30, tFlatNoFuture = 1e30, tNested = 1e30;
+			for (int iRep = 0; iRep < NUM_REPETITIONS; ++iRep)
+			{
+				tFlat         = std::min(tFlat        , RunFlatSubmission(pool, Counter));
+				tFlatNoFuture = std::min(tFlatNoFuture, RunFlatSubmissionNoFuture(pool, Counter));
+				tNested       = std::min(tNested      , RunNestedSubmission(pool, Counter));
+			}
+			pool.Destroy();
+
+			const double NumNestedTasks = double(NUM_NESTED_ROOT_TASKS) * (NUM_NESTED_CHILDREN_PER_ROOT + 1);
+			printf(" %-8zu | %-14s | %18.3f | %18.3f | %18.3f\n", NumWorkers, ModeNames[iMode]
+				, NUM_FLAT_TASKS / tFlat * 1e-6
+				, NUM_FLAT_TASKS / tFlatNoFuture * 1e-6
+				, NumNestedTasks / tNested * 1e-6
+			);
+		}
+	}
+}
+
+namespace
+{
+	constexpr int    NUM_FRAMES                    = 50;
+	constexpr int    NUM_FRAME_JOBS                = 8;
+	constexpr double FRAME_JOB_DURATION_MS         = 0.05;
+	constexpr double BACKGROUND_TASK_DURATION_MS   = 20.0;
+	constexpr double BACKGROUND_TASK_SLICE_MS      = 0.1;  // work done between two safe points
+	constexpr int    NUM_BACKGROUND_TASKS_PER_WORKER = 4;
+
+	void BusyWork(double DurationMs)
+	{
+		const Benchmark::Clock::time_point tEnd = Benchmark::Clock::now() + std::chrono::duration_cast<Benchmark::Clock::duration>(std::chrono::duration<double, std::milli>(DurationMs));
+		while (Benchmark::Clock::now() < tEnd);
+	}
+
+	struct FFrameLatency { double AvgMs; double MaxMs; };
+
+	// Saturates the pool with long background tasks (e.g. texture decodes) and measures
+	// how long the per-frame jobs take to complete.
+	FFrameLatency RunFrameJobsUnderBackgroundLoad(ThreadPool& pool, bool bUsePriorityLanes)
+	{
+		const ETaskPriority BackgroundPriority = bUsePriorityLanes ? ETaskPriority::BACKGROUND     : ETaskPriority::NORMAL;
+		const ETaskPriority FramePriority      = bUsePriorityLanes ? ETaskPriority::FRAME_CRITICAL : ETaskPriority::NORMAL;
+
+		const size_t NumBackgroundTasks = pool.GetThreadPoolSize() * NUM_BACKGROUND_TASKS_PER_WORKER;
+		for (size_t i = 0; i < NumBackgroundTasks; ++i)
+		{
+			pool.AddTaskNoFuture([&pool, bUsePriorityLanes]()
+			{
+				for (double t = 0.0; t < BACKGROUND_TASK_DURATION_MS; t += BACKGROUND_TASK_SLICE_MS)
+				{
+					BusyWork(BACKGROUND_TASK_SLICE_MS);
+					if (bUsePriorityLanes)
+						pool.YieldToFrameCriticalTasks(); // safe point
+				}
+			}, BackgroundPriority);
+		}
+
+		double TotalMs = 0.0, MaxMs = 0.0;
+		for (int iFrame = 0; iFrame < NUM_FRAMES; ++iFrame)
+		{
+			std::atomic<int> NumJobsDone = 0;
+			const double tFrame = Benchmark::Measure([&]()
+			{
+				for (int iJob = 0; iJob < NUM_FRAME_JOBS; ++iJob)
+					pool.AddTaskNoFuture([&NumJobsDone]() { BusyWork(FRAME_JOB_DURATION_MS); ++NumJobsDone; }, FramePriority);
+				while (NumJobsDone.load() != NUM_FRAME_JOBS)
+					std::this_thread::yield();
+			}) * 1000.0;
+			TotalMs += tFrame;
+			MaxMs = std::max(MaxMs, tFrame);
+		}
+		WaitForPool(pool);
+		return { TotalMs / NUM_FRAMES, MaxMs };
+	}
+}
+
+void Benchmark::ThreadPool_PriorityLanes()
+{
+	PrintHeader("ThreadPool: per-frame job latency under background load");
+	printf(" %-14s | %-9s | %-12s | %-12s | %-18s | %-18s\n", "Scheduler", "Lanes", "Frame avg ms", "Frame max ms", "Frame job wait", "Background wait");
+	printf("-------------------------------------------------------------------\n");
+
+	const size_t NumWorkers = std::max<size_t>(1, ThreadPool::sHardwareThreadCount - 1);
+	const EThreadPoolSchedulingMode Modes[] = { EThreadPoolSchedulingMode::SHARED_QUEUE, EThreadPoolSchedulingMode::WORK_STEALING };
+	const char* ModeNames[] = { "SHARED_QUEUE", "WORK_STEALING" };
+	for (int iMode = 0; iMode < 2; ++iMode)
+	{
+		for (bool bUsePriorityLanes : { false, true })
+		{
+			ThreadPool pool;
+			pool.Initialize(NumWorkers, "BenchmarkWorker", 0xFFAAAAAA, Modes[iMode]);
+			const FFrameLatency Latency = RunFrameJobsUnderBackgroundLoad(pool, bUsePriorityLanes);
+			// without lanes, everything goes through the NORMAL lane
+			const ThreadPool::FLaneStats FrameStats      = pool.GetLaneStats(bUsePriorityLanes ? ETaskPriority::FRAME_CRITICAL : ETaskPriority::NORMAL);
+			const ThreadPool::FLaneStats BackgroundStats = pool.GetLaneStats(bUsePriorityLanes ? ETaskPriority::BACKGROUND     : ETaskPriority::NORMAL);
+			pool.Destroy();
+
+			printf(" %-14s | %-9s | %12.3f | %12.3f | %7.3f avg %6.2f max | %7.3f avg %6.2f max\n", ModeNames[iMode], bUsePriorityLanes ? "yes" : "no (FIFO)"
+				, Latency.AvgMs, Latency.MaxMs
+				, FrameStats.AvgWaitTimeMs, FrameStats.MaxWaitTimeMs
+				, BackgroundStats.AvgWaitTimeMs, BackgroundStats.MaxWaitTimeMs
+			);
+		}
+	}
+}
+
+namespace
+{
+	constexpr int NUM_DRAIN_ROUNDS          = 50000;
+	constexpr int NUM_DRAIN_TASKS_PER_ROUND = 8; // the queue is close to empty most of the time: the pops race
+
+	thread_local bool tbExternalThread = false;
+
+	struct FDrainResult
+	{
+		double  Seconds;
+		int64_t NumExecuted;
+		int64_t NumExecutedExternally;
+	};
+
+	// The submitting thread drains the queue with RunRemainingTasksOnThisThread() and a second external thread
+	// runs the frame critical tasks through YieldToFrameCriticalTasks(), both racing the live workers for the tasks.
+	FDrainResult RunExternalDrain(ThreadPool& pool)
+	{
+		std::atomic<int64_t> NumExecuted = 0;
+		std::atomic<int64_t> NumExecutedExternally = 0;
+		auto fnTask = [&NumExecuted, &NumExecutedExternally]()
+		{
+			NumExecuted.fetch_add(1, std::memory_order_relaxed);
+			if (tbExternalThread)
+				NumExecutedExternally.fetch_add(1, std::memory_order_relaxed);
+		};
+
+		std::atomic<bool> bStop = false;
+		std::thread SafePointThread([&pool, &bStop]()
+		{
+			tbExternalThread = true;
+			while (!bStop.load())
+			{
+				if (pool.YieldToFrameCriticalTasks() == 0)
+					std::this_thread::yield();
+			}
+		});
+
+		tbExternalThread = true;
+		const double Seconds = Benchmark::Measure([&]()
+		{
+			for (int iRound = 0; iRound < NUM_DRAIN_ROUNDS; ++iRound)
+			{
+				for (int i = 0; i < NUM_DRAIN_TASKS_PER_ROUND; ++i)
+					pool.AddTaskNoFuture(fnTask, static_cast<ETaskPriority>(i % NUM_TASK_PRIORITIES));
+				pool.RunRemainingTasksOnThisThread();
+			}
+			WaitForPool(pool);
+		});
+		tbExternalThread = false;
+
+		bStop.store(true);
+		SafePointThread.join();
+		return { Seconds, NumExecuted.load(), NumExecutedExternally.load() };
+	}
+}
+
+void Benchmark::ThreadPool_ExternalDrain()
+{
+	PrintHeader("ThreadPool: external threads draining the queue while the workers are live");
+	printf(" %-8s | %-14s | %-12s | %-12s | %-10s | %s\n", "Workers", "Scheduler", "Mtasks/s", "Executed", "External %", "Result");
+	printf("-------------------------------------------------------------------\n");
+
+	const int64_t NumExpected = int64_t(NUM_DRAIN_ROUNDS) * NUM_DRAIN_TASKS_PER_ROUND;
+	// oversubscribed last: the workers get preempted between their checks and their pops
+	std::vector<size_t> WorkerCounts = { 1 };
+	if (ThreadPool::sHardwareThreadCount > 2)
+		WorkerCounts.push_back(ThreadPool::sHardwareThreadCount - 1);
+	WorkerCounts.push_back(std::max<size_t>(16, ThreadPool::sHardwareThreadCount * 2));
+	const EThreadPoolSchedulingMode Modes[] = { EThreadPoolSchedulingMode::SHARED_QUEUE, EThreadPoolSchedulingMode::WORK_STEALING };
+	const char* ModeNames[] = { "SHARED_QUEUE", "WORK_STEALING" };
+	for (size_t NumWorkers : WorkerCounts)
+	{
+		for (int iMode = 0; iMode < 2; ++iMode)
+		{
+			ThreadPool pool;
+			pool.Initialize(NumWorkers, "BenchmarkWorker", 0xFFAAAAAA, Modes[iMode]);
+			const FDrainResult Result = RunExternalDrain(pool);
+			pool.Destroy();
+
+			printf(" %-8zu | %-14s | %12.3f | %12lld | %10.1f | %s\n", NumWorkers, ModeNames[iMode]
+				, Result.NumExecuted / Result.Seconds * 1e-6
+				, static_cast<long long>(Result.NumExecuted)
+				, 100.0 * Result.NumExecutedExternally / std::max<int64_t>(1, Result.NumExecuted)
+				, Result.NumExecuted == NumExpected ? "ok" : "FAILED: tasks lost or run twice"
+			);
+		}
+	}
+}
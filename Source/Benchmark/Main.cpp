@@ -0,0 +1,64 @@
+#include "Benchmark.h"
+
+#include "../Utils/Source/utils.h"
+
+#include <string>
+#include <vector>
+
+struct FBenchmarkEntry
+{
+	const char* pName;
+	void      (*pfnRun)();
+};
+
+static const FBenchmarkEntry BENCHMARKS[] =
+{
+	  { "ThreadPool_Throughput"        , &Benchmark::ThreadPool_Throughput         }
+	, { "ThreadPool_PriorityLanes"     , &Benchmark::ThreadPool_PriorityLanes      }
+	, { "ThreadPool_ExternalDrain"     , &Benchmark::ThreadPool_ExternalDrain      }
+	, { "ParallelFor_Scaling"          , &Benchmark::ParallelFor_Scaling           }
+	, { "EventQueue_MPSC"              , &Benchmark::EventQueue_MPSC               }
+	, { "Semaphore_PingPong"           , &Benchmark::Semaphore_PingPong            }
+	, { "ParallelAlgorithms_Sort"      , &Benchmark::ParallelAlgorithms_Sort       }
+	, { "ParallelAlgorithms_Scan"      , &Benchmark::ParallelAlgorithms_Scan       }
+	, { "ParallelAlgorithms_Compaction", &Benchmark::ParallelAlgorithms_Compaction }
+	, { "SPSCChannel_Throughput"       , &Benchmark::SPSCChannel_Throughput        }
+	, { "SPSCChannel_Latency"          , &Benchmark::SPSCChannel_Latency           }
+	, { "Coroutines_AssetLoading"      , &Benchmark::Coroutines_AssetLoading       }
+	, { "BlockCompression_Encode"      , &Benchmark::BlockCompression_Encode       }
+	, { "CookedTexture_Load"           , &Benchmark::CookedTexture_Load            }
+	, { "HalfFloat_Convert"            , &Benchmark::HalfFloat_Convert             }
+};
+
+std::vector<std::string> Benchmark::ListDataTextures(const char* pExtension)
+{
+	const char* DIRECTORIES[] = { "Data/Textures/", "../Data/Textures/", "../../Data/Textures/", "../../../Data/Textures/" };
+	for (const char* pDirectory : DIRECTORIES)
+	{
+		if (DirectoryUtil::FileExists(pDirectory))
+			return DirectoryUtil::ListFilesInDirectory(pDirectory, pExtension);
+	}
+	return {};
+}
+
+static bool ShouldRun(const char* pName, const std::vector<std::string>& Filters)
+{
+	if (Filters.empty())
+		return true;
+	for (const std::string& Filter : Filters)
+		if (std::string(pName).find(Filter) != std::string::npos)
+			return true;
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	const std::vector<std::string> Filters(argv + 1, argv + argc);
+
+	for (const FBenchmarkEntry& Entry : BENCHMARKS)
+	{
+		if (ShouldRun(Entry.pName, Filters))
+			Entry.pfnRun();
+	}
+	return 0;
+}
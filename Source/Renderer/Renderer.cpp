@@ -69,6 +69,7 @@ void Renderer::Initialize(const FRendererInitializeParameters& params)
 	Device* pEdgeDevice = &mDevice;
 	const FGraphicsSettings& Settings = params.Settings;
 	const int NUM_SWAPCHAIN_BUFFERS   = Settings.bUseTripleBuffering ? 3 : 2;
+	mbCookTextures = Settings.bCookTextures;
 
 
 	// Create the device
@@ -145,7 +146,7 @@ void Renderer::Initialize(const FRendererInitializeParameters& params)
 	InitializeD3D12MA();
 	InitializeHeaps();
 
-	Log::Info("[Renderer] Initialized.");
+	LOG_INFO("[Renderer] Initialized.");
 	// TODO: Log system info
 }
 
@@ -235,7 +236,7 @@ bool Renderer::CheckContext(HWND hwnd) const
 {
 	if (mRenderContextLookup.find(hwnd) == mRenderContextLookup.end())
 	{
-		Log::Warning("Render Context not found for <hwnd=0x%x>", hwnd);
+		LOG_WARNING_RATE_LIMITED(1, "Render Context not found for <hwnd=0x%x>", hwnd);
 		return false;
 	}
 	return true;
@@ -643,7 +644,7 @@ std::vector< FGPUInfo > Renderer::EnumerateDX12Adapters(bool bEnableDebugLayer,
 		else
 		{
 			const std::string AdapterDesc = StrUtil::UnicodeToASCII(desc.Description);
-			Log::Warning("Device::Create(): D3D12CreateDevice() with Feature Level 12_1 failed with adapter=%s, retrying with Feature Level 12_0", AdapterDesc.c_str());
+			LOG_WARNING("Device::Create(): D3D12CreateDevice() with Feature Level 12_1 failed with adapter=%s, retrying with Feature Level 12_0", AdapterDesc.c_str());
 			hr = D3D12CreateDevice(pAdapter, D3D_FEATURE_LEVEL_12_0, _uuidof(ID3D12Device), nullptr);
 			if (SUCCEEDED(hr))
 			{
@@ -103,7 +103,10 @@ public:
 
 	// Resource management
 	BufferID                     CreateBuffer(const FBufferDesc& desc);
-	TextureID                    CreateTextureFromFile(const char* pFilePath);
+	TextureID                    CreateTextureFromFile(const char* pFilePath, ThreadPool* pWorkers = nullptr);
+	// Loads the textures in a pipeline: @pWorkers decode them in parallel while this thread records the uploads,
+	// the GPU copies a batch while the next one is recorded. Returns INVALID_ID for the textures that failed to load.
+	std::vector<TextureID>       CreateTexturesFromFiles(const std::vector<std::string>& FilePaths, ThreadPool* pWorkers = nullptr);
 	TextureID                    CreateTexture(const std::string& name, const D3D12_RESOURCE_DESC& desc, const void* pData = nullptr);
 
 	SRV_ID                       CreateSRV();
@@ -190,6 +193,7 @@ private:
 
 	// data
 	std::unordered_map<HWND, FWindowRenderContext> mRenderContextLookup;
+	bool                                           mbCookTextures = false; // FGraphicsSettings::bCookTextures
 
 	// bookkeeping
 	std::unordered_map<TextureID, std::string>     mLookup_TextureDiskLocations;
@@ -6,10 +6,14 @@
 
 #include "../Utils/Source/Log.h"
 #include "../Utils/Source/utils.h"
+#include "../Utils/Source/Multithreading.h"
+#include "../Utils/Source/Timer.h"
 #include "../../Libs/D3D12MemoryAllocator/src/Common.h"
 
 #include <cassert>
 #include <atomic>
+#include <algorithm>
+#include <memory>
 
 using namespace Microsoft::WRL;
 using namespace SystemInfo;
@@ -50,33 +54,271 @@ BufferID Renderer::CreateBuffer(const FBufferDesc& desc)
 	return Id;
 }
 
-TextureID Renderer::CreateTextureFromFile(const char* pFilePath)
+TextureID Renderer::CreateTextureFromFile(const char* pFilePath, ThreadPool* pWorkers)
 {
 	// TODO: check if file already loaded
 
-	Texture tex;
+	Timer LoadTimer;
+	LoadTimer.Start();
+	ID3D12Device* pDevice = mDevice.GetDevicePtr();
+
+	TextureCreateDesc tDesc(DirectoryUtil::GetFileNameFromPath(pFilePath));
+	tDesc.pAllocator = mpAllocator;
+	tDesc.pDevice = pDevice;
+	tDesc.pWorkers = pWorkers;
+	tDesc.bWriteCookedFile = mbCookTextures;
+	tDesc.Desc = {};
+
+	FTextureFileData Data;
+	if (!Texture::LoadFileData(tDesc, pFilePath, Data))
+		return INVALID_ID;
 
 	// https://docs.microsoft.com/en-us/windows/win32/direct3d12/residency#heap-resources
 	// Heap creation can be slow; but it is optimized for background thread processing. 
 	// It's recommended to create heaps on background threads to avoid glitching the render 
 	// thread. In D3D12, multiple threads may safely call create routines concurrently.
+	//
+	// The heap is sized for the texture's mip chain, as CreateTexturesFromFiles() does for the textures
+	// that don't fit in its shared heaps
+	UINT64 UploadSize = 0;
+	pDevice->GetCopyableFootprints(&Data.Desc, 0, Data.Desc.MipLevels, 0, nullptr, nullptr, nullptr, &UploadSize);
 	UploadHeap uploadHeap;
-	uploadHeap.Create(mDevice.GetDevicePtr(), 32 * MEGABYTE); // TODO: drive the heapsize through RendererSettings.ini
-
-	TextureCreateDesc tDesc(DirectoryUtil::GetFileNameFromPath(pFilePath));
-	tDesc.pAllocator = mpAllocator;
-	tDesc.pDevice = mDevice.GetDevicePtr();
+	uploadHeap.Create(pDevice, SIZE_T(UploadSize + 2 * D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT));
 	tDesc.pUploadHeap = &uploadHeap;
-	tDesc.Desc = {};
-
-	tex.CreateFromFile(tDesc, pFilePath);
 
-	uploadHeap.UploadToGPUAndWait(mGFXQueue.pQueue);
+	Texture tex;
+	const bool bCreated = tex.CreateFromFileData(tDesc, Data);
+	if (bCreated)
+		uploadHeap.UploadToGPUAndWait(mGFXQueue.pQueue);
 	uploadHeap.Destroy();
+	if (!bCreated)
+		return INVALID_ID;
 
+	LOG_INFO("Renderer::CreateTextureFromFile(): %s: %.2fms (%s)", pFilePath, LoadTimer.Tick() * 1000.0f
+		, Data.IsDataInUploadLayout() ? (Data.StageSeconds[TEXTURE_LOAD_STAGE_COOK] > 0.0f ? "decoded & cooked" : "cooked") : "decoded");
 	return AddTexture_ThreadSafe(std::move(tex));
 }
 
+// shared with the worker tasks: a helper task can start after CreateTexturesFromFiles() returned
+struct FTextureBatchLoadState
+{
+	FTextureBatchLoadState(const std::vector<std::string>& FilePaths)
+		: FilePaths(FilePaths)
+		, Data(FilePaths.size())
+		, ReadySemaphore(0, static_cast<int>(FilePaths.size()))
+	{}
+
+	std::vector<std::string>      FilePaths;
+	std::vector<FTextureFileData> Data;           // invalid if the texture couldn't be loaded
+	std::atomic<size_t>           NextTexture = 0;
+	MPSCChannel<size_t, 64>       ReadyTextures;  // indices of the textures prepared by the workers
+	LightweightSemaphore          ReadySemaphore; // signaled after each push into ReadyTextures
+};
+
+std::vector<TextureID> Renderer::CreateTexturesFromFiles(const std::vector<std::string>& FilePaths, ThreadPool* pWorkers)
+{
+	static const char* STAGE_NAMES[NUM_TEXTURE_LOAD_STAGES] = { "Decode", "Mips", "Convert", "Cook", "Upload", "GPU copy" };
+	constexpr SIZE_T UPLOAD_HEAP_SIZE = 32 * MEGABYTE; // TODO: drive the heapsize through RendererSettings.ini
+
+	const size_t NumTextures = FilePaths.size();
+	std::vector<TextureID> TextureIDs(NumTextures, INVALID_ID);
+	if (NumTextures == 0)
+		return TextureIDs;
+
+	Timer BatchTimer;
+	BatchTimer.Start();
+	ID3D12Device* pDevice = mDevice.GetDevicePtr();
+	std::shared_ptr<FTextureBatchLoadState> pState = std::make_shared<FTextureBatchLoadState>(FilePaths);
+
+	// stage 1: decoding, mips, conversion & cooking, no GPU access: the workers prepare the textures in parallel
+	auto fnPrepare = [pDevice, pWorkers, bCookTextures = mbCookTextures](FTextureBatchLoadState& State, size_t iTexture)
+	{
+		const std::string Name = DirectoryUtil::GetFileNameFromPath(State.FilePaths[iTexture]);
+		TextureCreateDesc tDesc(Name);
+		tDesc.pDevice = pDevice;
+		tDesc.pWorkers = pWorkers;
+		tDesc.bWriteCookedFile = bCookTextures;
+		if (!Texture::LoadFileData(tDesc, State.FilePaths[iTexture], State.Data[iTexture]))
+			State.Data[iTexture] = FTextureFileData();
+	};
+	const size_t NumHelpers = pWorkers && !pWorkers->IsExiting() ? std::min(NumTextures - 1, pWorkers->GetThreadPoolSize()) : 0;
+	for (size_t i = 0; i < NumHelpers; ++i)
+	{
+		pWorkers->AddTaskNoFuture([pState, fnPrepare, pWorkers]()
+		{
+			for (size_t iTexture = pState->NextTexture.fetch_add(1); iTexture < pState->FilePaths.size(); iTexture = pState->NextTexture.fetch_add(1))
+			{
+				fnPrepare(*pState, iTexture);
+				pState->ReadyTextures.Push(iTexture);
+				pState->ReadySemaphore.Signal();
+				pWorkers->YieldToFrameCriticalTasks(); // safe point between the textures
+			}
+		}, ETaskPriority::BACKGROUND);
+	}
+
+	// stage 2, on this thread: resource creation & copies into two upload heaps in turns,
+	// the GPU copies from one heap while the textures prepared meanwhile are written into the other
+	struct FUploadHeapSlot
+	{
+		UploadHeap Heap;
+		size_t     NumTextures = 0; // recorded since the last submission
+		bool       bInFlight = false;
+	};
+	FUploadHeapSlot Slots[2];
+	size_t iSlot = 0;
+	for (FUploadHeapSlot& Slot : Slots)
+		Slot.Heap.Create(pDevice, UPLOAD_HEAP_SIZE);
+
+	double StageSeconds[NUM_TEXTURE_LOAD_STAGES] = {};
+	size_t StageBytes[NUM_TEXTURE_LOAD_STAGES] = {};
+	size_t StageNumTextures[NUM_TEXTURE_LOAD_STAGES] = {};
+	size_t NumBytesUploaded = 0;
+	Timer UploadTimer;
+	UploadTimer.Start();
+
+	auto fnWaitForGPU = [&](UploadHeap& Heap)
+	{
+		UploadTimer.Tick();
+		Heap.WaitForUpload();
+		StageSeconds[TEXTURE_LOAD_STAGE_GPU_COPY] += UploadTimer.Tick();
+	};
+	auto fnSubmit = [&]()
+	{
+		FUploadHeapSlot& Slot = Slots[iSlot];
+		if (Slot.NumTextures == 0)
+			return;
+		Slot.Heap.UploadToGPU(mGFXQueue.pQueue);
+		Slot.bInFlight = true;
+		Slot.NumTextures = 0;
+		iSlot = (iSlot + 1) % _countof(Slots);
+	};
+	auto fnGetCurrentHeap = [&]() -> UploadHeap&
+	{
+		FUploadHeapSlot& Slot = Slots[iSlot];
+		if (Slot.bInFlight)
+		{
+			fnWaitForGPU(Slot.Heap);
+			Slot.bInFlight = false;
+		}
+		return Slot.Heap;
+	};
+	auto fnUpload = [&](size_t iTexture)
+	{
+		FTextureFileData& Data = pState->Data[iTexture];
+		if (!Data.IsValid())
+			return;
+
+		const size_t SizeInBytes = Data.GetSizeInBytes();
+		for (int iStage = 0; iStage < TEXTURE_LOAD_STAGE_UPLOAD; ++iStage)
+		{
+			if (Data.StageSeconds[iStage] <= 0.0f)
+				continue;
+			StageSeconds[iStage] += Data.StageSeconds[iStage];
+			StageBytes[iStage] += SizeInBytes;
+			++StageNumTextures[iStage];
+		}
+
+		UINT64 UploadSize = 0;
+		pDevice->GetCopyableFootprints(&Data.Desc, 0, Data.Desc.MipLevels, 0, nullptr, nullptr, nullptr, &UploadSize);
+
+		const std::string Name = DirectoryUtil::GetFileNameFromPath(pState->FilePaths[iTexture]);
+		TextureCreateDesc tDesc(Name);
+		tDesc.pAllocator = mpAllocator;
+		tDesc.pDevice = pDevice;
+
+		Texture tex;
+		bool bCreated = false;
+		UploadTimer.Tick();
+		if (UploadSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT >= UPLOAD_HEAP_SIZE)
+		{
+			// larger than the shared heaps: uploaded on its own
+			UploadHeap DedicatedHeap;
+			DedicatedHeap.Create(pDevice, SIZE_T(UploadSize + 2 * D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT));
+			tDesc.pUploadHeap = &DedicatedHeap;
+			bCreated = tex.CreateFromFileData(tDesc, Data);
+			StageSeconds[TEXTURE_LOAD_STAGE_UPLOAD] += UploadTimer.Tick();
+			if (bCreated)
+			{
+				DedicatedHeap.UploadToGPU(mGFXQueue.pQueue);
+				fnWaitForGPU(DedicatedHeap);
+			}
+			DedicatedHeap.Destroy();
+		}
+		else
+		{
+			UploadHeap* pHeap = &fnGetCurrentHeap();
+			if (!pHeap->CanSuballocate(SIZE_T(UploadSize), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT))
+			{
+				fnSubmit();
+				pHeap = &fnGetCurrentHeap();
+			}
+			tDesc.pUploadHeap = pHeap;
+			bCreated = tex.CreateFromFileData(tDesc, Data);
+			if (bCreated)
+				++Slots[iSlot].NumTextures;
+			StageSeconds[TEXTURE_LOAD_STAGE_UPLOAD] += UploadTimer.Tick();
+		}
+		Data = FTextureFileData(); // the data is in the upload heap: release the mip chain / unmap the cooked file
+		if (!bCreated)
+			return;
+		StageBytes[TEXTURE_LOAD_STAGE_UPLOAD] += SizeInBytes;
+		++StageNumTextures[TEXTURE_LOAD_STAGE_UPLOAD];
+		NumBytesUploaded += SizeInBytes;
+
+		TextureIDs[iTexture] = AddTexture_ThreadSafe(std::move(tex));
+	};
+
+	size_t NumProcessed = 0;
+	while (NumProcessed < NumTextures)
+	{
+		// upload what the workers prepared
+		const size_t NumReady = pState->ReadyTextures.ConsumeAll([&](size_t iTexture) { fnUpload(iTexture); });
+		NumProcessed += NumReady;
+		if (NumReady > 0)
+			continue;
+
+		// nothing ready: let the GPU copy what's been recorded so far and help with the remaining textures.
+		// This thread prepares every texture when there are no workers.
+		fnSubmit();
+		const size_t iTexture = pState->NextTexture.fetch_add(1);
+		if (iTexture < NumTextures)
+		{
+			fnPrepare(*pState, iTexture);
+			fnUpload(iTexture);
+			++NumProcessed;
+			continue;
+		}
+
+		// all the textures are claimed: wait for the workers
+		pState->ReadySemaphore.Wait();
+	}
+
+	fnSubmit();
+	for (FUploadHeapSlot& Slot : Slots)
+	{
+		if (Slot.bInFlight)
+			fnWaitForGPU(Slot.Heap);
+		Slot.Heap.Destroy();
+	}
+	StageBytes[TEXTURE_LOAD_STAGE_GPU_COPY] = NumBytesUploaded;
+	StageNumTextures[TEXTURE_LOAD_STAGE_GPU_COPY] = StageNumTextures[TEXTURE_LOAD_STAGE_UPLOAD];
+
+	// the CPU stages' times are summed over the threads that ran them: a stage keeps up with the
+	// others if its throughput times its number of threads does
+	const float BatchSeconds = BatchTimer.Tick();
+	LOG_INFO("Renderer::CreateTexturesFromFiles(): %zu textures, %.2f MB in %.2fms (%zu MB/s), %zu threads"
+		, NumTextures, NumBytesUploaded / (1024.0 * 1024.0), BatchSeconds * 1000.0f
+		, static_cast<size_t>(NumBytesUploaded / (1024.0 * 1024.0) / std::max(BatchSeconds, 1e-6f)), NumHelpers + 1);
+	for (int iStage = 0; iStage < NUM_TEXTURE_LOAD_STAGES; ++iStage)
+	{
+		if (StageNumTextures[iStage] == 0)
+			continue;
+		LOG_INFO("    %-8s : %3zu textures | %9.2f ms | %9.2f MB/s", STAGE_NAMES[iStage], StageNumTextures[iStage]
+			, StageSeconds[iStage] * 1000.0, StageBytes[iStage] / (1024.0 * 1024.0) / std::max(StageSeconds[iStage], 1e-6));
+	}
+	return TextureIDs;
+}
+
 TextureID Renderer::CreateTexture(const std::string& name, const D3D12_RESOURCE_DESC& desc, const void* pData)
 {
 	Texture tex;
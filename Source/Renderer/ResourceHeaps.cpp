@@ -141,11 +141,27 @@ UINT8* UploadHeap::Suballocate(SIZE_T uSize, UINT64 uAlign)
     return pRet;
 }
 
+bool UploadHeap::CanSuballocate(SIZE_T uSize, UINT64 uAlign) const
+{
+    const UINT8* pDataCur = reinterpret_cast<UINT8*>(AlignOffset(reinterpret_cast<SIZE_T>(mpDataCur), SIZE_T(uAlign)));
+    return pDataCur < mpDataEnd && pDataCur + uSize < mpDataEnd;
+}
+
 void UploadHeap::UploadToGPUAndWait(ID3D12CommandQueue* pCmdQueue)
+{
+    UploadToGPU(pCmdQueue);
+    WaitForUpload();
+}
+
+void UploadHeap::UploadToGPU(ID3D12CommandQueue* pCmdQueue)
 {
     mpCommandList->Close();
     pCmdQueue->ExecuteCommandLists(1, CommandListCast(&mpCommandList));
     pCmdQueue->Signal(mpFence, mFenceValue);
+}
+
+void UploadHeap::WaitForUpload()
+{
     if (mpFence->GetCompletedValue() < mFenceValue)
     {
         mpFence->SetEventOnCompletion(mFenceValue, mHEvent);
@@ -42,6 +42,7 @@ public:
     void Destroy();
 
     UINT8* Suballocate(SIZE_T uSize, UINT64 uAlign);
+    bool   CanSuballocate(SIZE_T uSize, UINT64 uAlign) const;
 
     inline UINT8*                     BasePtr()         const { return mpDataBegin; }
     inline ID3D12Resource*            GetResource()     const { return mpUploadHeap; }
@@ -49,6 +50,11 @@ public:
 
     void UploadToGPUAndWait(ID3D12CommandQueue* pCmdQueue);
 
+    // UploadToGPUAndWait() in two steps: the CPU can fill another heap while the copies execute.
+    // The heap isn't suballocated from until WaitForUpload() resets it.
+    void UploadToGPU(ID3D12CommandQueue* pCmdQueue);
+    void WaitForUpload();
+
 private:
     ID3D12Device*              mpDevice     = nullptr;
     ID3D12Resource*            mpUploadHeap = nullptr;
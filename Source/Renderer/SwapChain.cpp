@@ -362,7 +362,7 @@ void SwapChain::MoveToNextFrame()
     switch (hr)
     {
     case WAIT_TIMEOUT:
-        Log::Warning("SwapChain<hwnd=0x%x> timed out on WaitForGPU(): Signal=%d, ICurrBackBuffer=%d, NumFramesPresented=%d"
+        LOG_WARNING_RATE_LIMITED(1, "SwapChain<hwnd=0x%x> timed out on WaitForGPU(): Signal=%d, ICurrBackBuffer=%d, NumFramesPresented=%d"
             , mHwnd, mFenceValues[mICurrentBackBuffer], mICurrentBackBuffer, this->GetNumPresentedFrames());
         break;
     default: break;
@@ -6,21 +6,71 @@
 #include "../../Libs/D3D12MemoryAllocator/include/D3D12MemAlloc.h"
 #include "../Utils/Source/utils.h"
 #include "../Utils/Source/Image.h"
+#include "../Utils/Source/BlockCompression.h"
+#include "../Utils/Source/CookedTexture.h"
+#include "../Utils/Source/Timer.h"
 
 #include <unordered_map>
 #include <cassert>
  
 
+static DXGI_FORMAT GetDXGIFormat(ECookedTextureFormat Format)
+{
+    switch (Format)
+    {
+    case COOKED_FORMAT_RGBA8: return DXGI_FORMAT_R8G8B8A8_UNORM;
+    case COOKED_FORMAT_BC1  : return DXGI_FORMAT_BC1_UNORM;
+    case COOKED_FORMAT_BC3  : return DXGI_FORMAT_BC3_UNORM;
+    case COOKED_FORMAT_BC4  : return DXGI_FORMAT_BC4_UNORM;
+    case COOKED_FORMAT_BC5  : return DXGI_FORMAT_BC5_UNORM;
+    case COOKED_FORMAT_BC6H : return DXGI_FORMAT_BC6H_UF16;
+    case COOKED_FORMAT_BC7  : return DXGI_FORMAT_BC7_UNORM;
+    case COOKED_FORMAT_RGBA16F: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    default                 : assert(false); return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+// the texture settings that change the cooked data: a cooked file written with other settings is stale
+static uint32_t GetCookSettings(const TextureCreateDesc& desc)
+{
+    return (desc.bGenerateMips ? 1u : 0u)
+        | (static_cast<uint32_t>(desc.MipFilter) << 1)
+        | (desc.bCookBlockCompressed ? 1u << 8 : 0u);
+}
+
 //
 // TEXTURE
 //
-void Texture::CreateFromFile(const TextureCreateDesc& tDesc, const std::string& FilePath)
+bool Texture::CreateFromFile(const TextureCreateDesc& tDesc, const std::string& FilePath)
 {
+    Timer LoadTimer;
+    LoadTimer.Start();
+
+    FTextureFileData Data;
+    if (!LoadFileData(tDesc, FilePath, Data))
+        return false;
+    if (!CreateFromFileData(tDesc, Data))
+        return false;
+
+    Log::Info("Texture::CreateFromFile(): %s: %.2fms (%s)", FilePath.c_str(), LoadTimer.Tick() * 1000.0f
+        , Data.IsDataInUploadLayout() ? (Data.StageSeconds[TEXTURE_LOAD_STAGE_COOK] > 0.0f ? "decoded & cooked" : "cooked") : "decoded");
+    return true;
+}
 
+bool Texture::CreateFromFileData(const TextureCreateDesc& tDesc, const FTextureFileData& Data)
+{
+    assert(Data.IsValid());
+    TextureCreateDesc desc = tDesc;
+    desc.Desc = Data.Desc;
+    return Create(desc, Data.GetData(), Data.IsDataInUploadLayout());
+}
+
+bool Texture::LoadFileData(const TextureCreateDesc& tDesc, const std::string& FilePath, FTextureFileData& OutData)
+{
     if (FilePath.empty())
     {
         Log::Error("Cannot create Texture from file: empty FilePath provided.");
-        return;
+        return false;
     }
 
     // process file path
@@ -31,36 +81,162 @@ void Texture::CreateFromFile(const TextureCreateDesc& tDesc, const std::string&
     const std::vector<std::string> FileNameTokens = StrUtil::split(FileNameAndExtension, '.');
     assert(FileNameTokens.size() == 2);
 
-    const std::string FileDirectory = FilePath.substr(0, FilePath.find(FileNameAndExtension));
-    const std::string FileName = FileNameTokens.front();
     const std::string FileExtension = StrUtil::GetLowercased(FileNameTokens.back());
 
     const bool bHDR = FileExtension == "hdr";
+    Timer StageTimer;
+    StageTimer.Start();
+
+    // cooked texture: the file is mapped and copied into the upload heap as is, the source isn't decoded
+    const bool bCooked = tDesc.bUseCookedFile;
+    const std::string CookedFilePath = bCooked ? CookedTexture::GetCookedFilePath(FilePath) : std::string();
+    const uint32_t CookSettings = GetCookSettings(tDesc);
+    if (bCooked && CookedTexture::IsUpToDate(CookedFilePath, FilePath))
+    {
+        const bool bLoaded = LoadCookedFile(tDesc, CookedFilePath, CookSettings, OutData);
+        OutData.StageSeconds[TEXTURE_LOAD_STAGE_DECODE] += StageTimer.Tick();
+        if (bLoaded)
+            return true;
+        // stale or invalid: decoded below, and cooked again if bWriteCookedFile
+    }
 
     // load img
-    Image image = Image::LoadFromFile(FilePath.c_str());
-    assert(image.pData && image.BytesPerPixel > 0);
+    Image image = Image::LoadFromFile(FilePath.c_str(), tDesc.pWorkers);
+    if (!image.pData || image.BytesPerPixel <= 0)
+    {
+        Log::Error("Texture: couldn't load %s", FilePath.c_str());
+        return false;
+    }
+    OutData.StageSeconds[TEXTURE_LOAD_STAGE_DECODE] += StageTimer.Tick();
+
+    // mips: filtered in linear space, the SDR textures are sRGB encoded.
+    // The data is always uploaded from a chain, a single level if mips are disabled.
+    FMipChain& MipChain = OutData.MipChain;
+    FMipChainDesc MipDesc = {};
+    MipDesc.Filter = tDesc.MipFilter;
+    MipDesc.bSRGB = !bHDR;
+    MipDesc.MaxNumMips = tDesc.bGenerateMips ? 0 : 1;
+    MipChain = GenerateMipChain(image, MipDesc, tDesc.pWorkers);
+    image.Destroy(); // level 0 is copied into the chain
+    OutData.StageSeconds[TEXTURE_LOAD_STAGE_MIPS] += StageTimer.Tick();
+    if (!MipChain.IsValid())
+    {
+        Log::Error("Texture: couldn't generate the mips of %s", FilePath.c_str());
+        return false;
+    }
 
-    TextureCreateDesc desc = tDesc;
-    desc.Desc.Width  = image.Width;
-    desc.Desc.Height = image.Height;
-    desc.Desc.Format = bHDR ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+    if (bCooked && tDesc.bWriteCookedFile)
+    {
+        // BC textures need mip 0 dimensions in multiples of 4
+        const bool bBlockCompress = tDesc.bCookBlockCompressed && MipChain.Levels[0].Width % 4 == 0 && MipChain.Levels[0].Height % 4 == 0;
+        bool bWritten = false;
+        if (bBlockCompress)
+        {
+            FBlockCompressionDesc CompressionDesc = {};
+            CompressionDesc.Format = bHDR ? BC_FORMAT_BC6H : BC_FORMAT_BC7; // BC6H encodes the RGBA32F chain
+            CompressionDesc.Quality = BC_QUALITY_NORMAL;
+            bWritten = CookedTexture::Write(CookedFilePath, BlockCompression::Compress(MipChain, CompressionDesc, tDesc.pWorkers), CookSettings);
+        }
+        else
+        {
+            if (tDesc.bCookBlockCompressed)
+                Log::Warning("Texture: %s: %dx%d isn't a multiple of 4, cooked uncompressed", FileNameAndExtension.c_str(), MipChain.Levels[0].Width, MipChain.Levels[0].Height);
+            if (bHDR)
+            {
+                StageTimer.Tick();
+                ConvertMipChainToHalf(MipChain, tDesc.pWorkers);
+                OutData.StageSeconds[TEXTURE_LOAD_STAGE_CONVERT] += StageTimer.Tick();
+            }
+            bWritten = CookedTexture::Write(CookedFilePath, MipChain, CookSettings);
+        }
+        OutData.StageSeconds[TEXTURE_LOAD_STAGE_COOK] += StageTimer.Tick();
+
+        // upload what the next runs will load
+        if (bWritten && LoadCookedFile(tDesc, CookedFilePath, CookSettings, OutData))
+        {
+            MipChain = FMipChain();
+            OutData.StageSeconds[TEXTURE_LOAD_STAGE_COOK] += StageTimer.Tick();
+            return true;
+        }
+    }
+
+    // HDR: stb_image returns RGBA32F, the texture is RGBA16F
+    if (bHDR && MipChain.BytesPerPixel == 16)
+    {
+        StageTimer.Tick();
+        ConvertMipChainToHalf(MipChain, tDesc.pWorkers);
+        OutData.StageSeconds[TEXTURE_LOAD_STAGE_CONVERT] += StageTimer.Tick();
+    }
+
+    D3D12_RESOURCE_DESC& Desc = OutData.Desc;
+    Desc.Width  = MipChain.Levels[0].Width;
+    Desc.Height = MipChain.Levels[0].Height;
+    Desc.Format = bHDR ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+    //-------------------------------
+    Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    Desc.Alignment = 0;
+    Desc.DepthOrArraySize = 1;
+    Desc.MipLevels = static_cast<UINT16>(MipChain.Levels.size());
+    Desc.SampleDesc.Count = 1;
+    Desc.SampleDesc.Quality = 0;
+    Desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    Desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+    //-------------------------------
+    return true;
+}
+
+bool Texture::LoadCookedFile(const TextureCreateDesc& tDesc, const std::string& CookedFilePath, uint32_t CookSettings, FTextureFileData& OutData)
+{
+    std::unique_ptr<CookedTextureFile> pFile = std::make_unique<CookedTextureFile>();
+    if (!pFile->Open(CookedFilePath) || pFile->GetHeader().CookSettings != CookSettings)
+        return false;
+
+    const CookedTexture::FFileHeader& Header = pFile->GetHeader();
+
+    D3D12_RESOURCE_DESC Desc = {};
+    Desc.Width  = Header.Width;
+    Desc.Height = Header.Height;
+    Desc.Format = GetDXGIFormat(Header.Format);
     //-------------------------------
-    desc.Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-    desc.Desc.Alignment = 0;
-    desc.Desc.DepthOrArraySize = 1;
-    desc.Desc.MipLevels = 1;
-    desc.Desc.SampleDesc.Count = 1;
-    desc.Desc.SampleDesc.Quality = 0;
-    desc.Desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-    desc.Desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+    Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    Desc.Alignment = 0;
+    Desc.DepthOrArraySize = 1;
+    Desc.MipLevels = static_cast<UINT16>(Header.NumMips);
+    Desc.SampleDesc.Count = 1;
+    Desc.SampleDesc.Quality = 0;
+    Desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    Desc.Flags = D3D12_RESOURCE_FLAG_NONE;
     //-------------------------------
-    Create(desc, image.pData);
-    image.Destroy();
+
+    // the payload is copied into the upload heap with a single memcpy: its layout has to match the footprints
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Footprints(Header.NumMips);
+    std::vector<UINT> NumRows(Header.NumMips);
+    std::vector<UINT64> RowSizesInBytes(Header.NumMips);
+    UINT64 TotalBytes = 0;
+    tDesc.pDevice->GetCopyableFootprints(&Desc, 0, Header.NumMips, 0, Footprints.data(), NumRows.data(), RowSizesInBytes.data(), &TotalBytes);
+
+    bool bLayoutMatches = Header.DataSize == TotalBytes;
+    for (UINT i = 0; bLayoutMatches && i < Header.NumMips; ++i)
+    {
+        const CookedTexture::FMipDesc& Mip = pFile->GetMip(i);
+        bLayoutMatches = Footprints[i].Offset == Mip.Offset
+            && Footprints[i].Footprint.RowPitch == Mip.RowPitch
+            && NumRows[i] == Mip.NumRows
+            && RowSizesInBytes[i] == Mip.RowSizeInBytes;
+    }
+    if (!bLayoutMatches)
+    {
+        Log::Warning("Texture: the cooked layout of %s doesn't match the copyable footprints", CookedFilePath.c_str());
+        return false;
+    }
+
+    OutData.Desc = Desc;
+    OutData.pCookedFile = std::move(pFile);
+    return true;
 }
 
 // TODO: clean up function
-void Texture::Create(const TextureCreateDesc& desc, const void* pData /*= nullptr*/)
+bool Texture::Create(const TextureCreateDesc& desc, const void* pData /*= nullptr*/, bool bDataInUploadLayout /*= false*/)
 {
     HRESULT hr = {};
 
@@ -103,7 +279,7 @@ void Texture::Create(const TextureCreateDesc& desc, const void* pData /*= nullpt
     if (FAILED(hr))
     {
         Log::Error("Couldn't create texture: ", desc.TexName.c_str());
-        return;
+        return false;
     }
 
     SetName(mpTexture, desc.TexName.c_str());
@@ -111,33 +287,52 @@ void Texture::Create(const TextureCreateDesc& desc, const void* pData /*= nullpt
     // upload the data
     if (pData)
     {
-        const UINT64 UploadBufferSize = GetRequiredIntermediateSize(mpTexture, 0, 1);
+        const D3D12_RESOURCE_DESC ResourceDesc = mpTexture->GetDesc(); // MipLevels=0 is resolved to the full chain
+        const UINT NumSubresources = ResourceDesc.MipLevels * ResourceDesc.DepthOrArraySize;
+        const UINT64 UploadBufferSize = GetRequiredIntermediateSize(mpTexture, 0, NumSubresources);
 
         UINT8* pUploadBufferMem = desc.pUploadHeap->Suballocate(SIZE_T(UploadBufferSize), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
         if (pUploadBufferMem == NULL)
         {
-            assert(false);
+            Log::Error("Texture::Create(): %s: the upload heap can't fit %llu bytes", desc.TexName.c_str(), UploadBufferSize);
+            Destroy();
+            return false;
         }
 
         UINT64 UplHeapSize;
-        uint32_t num_rows = {};
-        UINT64 row_sizes_in_bytes = {};
-        D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedTex2D = {};
-        desc.pDevice->GetCopyableFootprints(&desc.Desc, 0, 1, 0, &placedTex2D, &num_rows, &row_sizes_in_bytes, &UplHeapSize);
-        placedTex2D.Offset += UINT64(pUploadBufferMem - desc.pUploadHeap->BasePtr());
+        std::vector<UINT> num_rows(NumSubresources);
+        std::vector<UINT64> row_sizes_in_bytes(NumSubresources);
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> placedTex2D(NumSubresources);
+        desc.pDevice->GetCopyableFootprints(&ResourceDesc, 0, NumSubresources, 0, placedTex2D.data(), num_rows.data(), row_sizes_in_bytes.data(), &UplHeapSize);
 
-        // copy all the mip slices into the offsets specified by the footprint structure
+        // copy all the mip slices into the offsets specified by the footprint structure,
+        // the source subresources are either tightly packed one after the other or already placed
         //
-
-        for (uint32_t y = 0; y < num_rows; y++)
+        if (bDataInUploadLayout)
         {
-            memcpy(pUploadBufferMem + y * placedTex2D.Footprint.RowPitch,
-                (UINT8*)pData + y * row_sizes_in_bytes, row_sizes_in_bytes);
+            memcpy(pUploadBufferMem, pData, SIZE_T(UploadBufferSize));
+        }
+        const UINT8* pSrcSubresource = static_cast<const UINT8*>(pData);
+        for (UINT i = 0; i < NumSubresources; ++i)
+        {
+            if (!bDataInUploadLayout)
+            {
+                UINT8* pDstSubresource = pUploadBufferMem + placedTex2D[i].Offset;
+                for (uint32_t y = 0; y < num_rows[i]; y++)
+                {
+                    memcpy(pDstSubresource + y * placedTex2D[i].Footprint.RowPitch,
+                        pSrcSubresource + y * row_sizes_in_bytes[i], row_sizes_in_bytes[i]);
+                }
+                pSrcSubresource += num_rows[i] * row_sizes_in_bytes[i];
+            }
+
+            D3D12_PLACED_SUBRESOURCE_FOOTPRINT SrcFootprint = placedTex2D[i];
+            SrcFootprint.Offset += UINT64(pUploadBufferMem - desc.pUploadHeap->BasePtr());
+
+            CD3DX12_TEXTURE_COPY_LOCATION Dst(mpTexture, i);
+            CD3DX12_TEXTURE_COPY_LOCATION Src(desc.pUploadHeap->GetResource(), SrcFootprint);
+            pCmd->CopyTextureRegion(&Dst, 0, 0, 0, &Src, NULL);
         }
-
-        CD3DX12_TEXTURE_COPY_LOCATION Dst(mpTexture, 0);
-        CD3DX12_TEXTURE_COPY_LOCATION Src(desc.pUploadHeap->GetResource(), placedTex2D);
-        desc.pUploadHeap->GetCommandList()->CopyTextureRegion(&Dst, 0, 0, 0, &Src, NULL);
 
         D3D12_RESOURCE_BARRIER textureBarrier = {};
         textureBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -147,6 +342,7 @@ void Texture::Create(const TextureCreateDesc& desc, const void* pData /*= nullpt
         textureBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
         pCmd->ResourceBarrier(1, &textureBarrier);
     }
+    return true;
 }
 
 void Texture::Destroy()
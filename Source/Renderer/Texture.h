@@ -2,11 +2,16 @@
 
 #include "Common.h"
 
+#include "../Utils/Source/MipChain.h"
+#include "../Utils/Source/CookedTexture.h"
+
+#include <memory>
 #include <vector>
 
 namespace D3D12MA { class Allocation; class Allocator; }
 
 class UploadHeap;
+class ThreadPool;
 class CBV_SRV_UAV;
 class DSV;
 struct D3D12_SHADER_RESOURCE_VIEW_DESC;
@@ -17,10 +22,42 @@ struct TextureCreateDesc
 	ID3D12Device*         pDevice   = nullptr;
 	D3D12MA::Allocator*   pAllocator = nullptr;
 	UploadHeap*           pUploadHeap = nullptr;
+	ThreadPool*           pWorkers = nullptr; // optional: parallelizes the CPU-side processing of the image
+	bool                  bGenerateMips = true; // CreateFromFile(): full mip chain, filtered on the CPU
+	EMipFilter            MipFilter = MIP_FILTER_BOX;
+	bool                  bUseCookedFile = true; // CreateFromFile(): load from Cooked/<name>.vqtex next to the source file when it's up to date
+	bool                  bWriteCookedFile = false; // CreateFromFile(): (re)write the cooked file when it's missing or stale, opt-in: see FGraphicsSettings::bCookTextures
+	bool                  bCookBlockCompressed = false; // cooked textures are BC7 (SDR) or BC6H (HDR) when their dimensions are multiples of 4
 	D3D12_RESOURCE_DESC   Desc = {};
 	const std::string&    TexName;
 };
 
+enum ETextureLoadStage
+{
+	TEXTURE_LOAD_STAGE_DECODE = 0, // file read & decode, or mapping & validating the cooked file
+	TEXTURE_LOAD_STAGE_MIPS,
+	TEXTURE_LOAD_STAGE_CONVERT,    // RGBA32F -> RGBA16F
+	TEXTURE_LOAD_STAGE_COOK,       // block compression & writing the cooked file
+	TEXTURE_LOAD_STAGE_UPLOAD,     // resource creation & copy into the upload heap
+	TEXTURE_LOAD_STAGE_GPU_COPY,   // waiting for the upload heap's copies
+
+	NUM_TEXTURE_LOAD_STAGES
+};
+
+// The CPU side of Texture::CreateFromFile(): the texture decoded, or mapped from its cooked file, ready to be uploaded
+struct FTextureFileData
+{
+	D3D12_RESOURCE_DESC                Desc = {};   // Width, Height, Format & MipLevels
+	FMipChain                          MipChain;    // decoded: the subresources tightly packed
+	std::unique_ptr<CookedTextureFile> pCookedFile; // cooked: the payload is in the upload layout
+	float                              StageSeconds[NUM_TEXTURE_LOAD_STAGES] = {};
+
+	inline bool        IsValid()              const { return pCookedFile || MipChain.IsValid(); }
+	inline bool        IsDataInUploadLayout() const { return pCookedFile != nullptr; }
+	inline const void* GetData()              const { return pCookedFile ? pCookedFile->GetData() : MipChain.GetLevelData(0); }
+	inline size_t      GetSizeInBytes()       const { return pCookedFile ? size_t(pCookedFile->GetHeader().DataSize) : MipChain.SizeInBytes; }
+};
+
 
 class Texture
 {
@@ -29,8 +66,16 @@ public:
 	Texture()  = default;
 	~Texture() = default;
 
-	void CreateFromFile(const TextureCreateDesc& desc, const std::string& FilePath);
-	void Create(const TextureCreateDesc& desc, const void* pData = nullptr);
+	// Returns false if the file couldn't be loaded or the texture couldn't be created, nothing is left allocated then
+	bool CreateFromFile(const TextureCreateDesc& desc, const std::string& FilePath);
+	// CreateFromFile() in two steps for the batch loads: LoadFileData() doesn't touch the upload heap and
+	// can run on any thread, CreateFromFileData() creates the texture and records its upload.
+	static bool LoadFileData(const TextureCreateDesc& desc, const std::string& FilePath, FTextureFileData& OutData);
+	bool CreateFromFileData(const TextureCreateDesc& desc, const FTextureFileData& Data);
+	// @pData: the subresources tightly packed one after the other (mip 0 first), see FMipChain
+	//         or, if @bDataInUploadLayout, placed as GetCopyableFootprints() lays them out at offset 0 (cooked textures)
+	// Returns false if the resource couldn't be created or @pData doesn't fit in the upload heap
+	bool Create(const TextureCreateDesc& desc, const void* pData = nullptr, bool bDataInUploadLayout = false);
 
 	void Destroy();
 
@@ -39,6 +84,9 @@ public:
 
 public:
 
+private:
+	static bool LoadCookedFile(const TextureCreateDesc& desc, const std::string& CookedFilePath, uint32_t CookSettings, FTextureFileData& OutData);
+
 private:
 	D3D12MA::Allocation* mpAlloc = nullptr;
 	ID3D12Resource*      mpTexture = nullptr;
@@ -0,0 +1,337 @@
+//
+// Turns a binary log (Engine.exe -LogBinary[=path]) into text:
+//
+//     LogDecoder.exe <input.blog> [output.txt]
+//
+// Messages of all threads are sorted by timestamp, TSC timestamps are converted to wall clock time
+// using the clock sync blocks the writer thread emits with every flush.
+//
+#include "../../Utils/Source/BinaryLog.h"
+#include "../../Utils/Source/utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace BinaryLog;
+
+struct FFormat
+{
+	uint8_t               Level;
+	uint32_t              Line;
+	std::vector<EArgType> ArgTypes;
+	std::string           Format;
+	std::string           File;
+};
+
+struct FMessage
+{
+	uint64_t    Tsc;
+	uint32_t    ThreadIndex;
+	uint8_t     Level;
+	std::string Text;
+};
+
+static const char* LOG_LEVEL_PREFIXES[Log::NUM_LOG_LEVELS] =
+{
+	  "[VERBOSE]\t: "
+	, "   [INFO]\t: "
+	, "[WARNING]\t: "
+	, "  [ERROR]\t: "
+};
+
+// Bounds checked reads from the file contents
+class FReader
+{
+public:
+	FReader(const uint8_t* pData, size_t Size) : mpData(pData), mSize(Size) {}
+
+	template<class T> bool Read(T& Value)
+	{
+		if (mOffset + sizeof(T) > mSize) return false;
+		memcpy(&Value, mpData + mOffset, sizeof(T));
+		mOffset += sizeof(T);
+		return true;
+	}
+	bool Read(std::string& Str, size_t Length)
+	{
+		if (mOffset + Length > mSize) return false;
+		Str.assign(reinterpret_cast<const char*>(mpData + mOffset), Length);
+		mOffset += Length;
+		return true;
+	}
+	inline const uint8_t* GetData() const { return mpData + mOffset; }
+	inline size_t GetNumBytesLeft() const { return mSize - mOffset; }
+	inline void Skip(size_t NumBytes) { mOffset = std::min(mSize, mOffset + NumBytes); }
+
+private:
+	const uint8_t* mpData;
+	size_t         mSize;
+	size_t         mOffset = 0;
+};
+
+template<class T>
+static std::string Print(const std::string& Spec, T Value)
+{
+	char buf[512];
+	const int len = snprintf(buf, sizeof(buf), Spec.c_str(), Value);
+	return std::string(buf, len > 0 ? std::min<size_t>(len, sizeof(buf) - 1) : 0);
+}
+
+// Formats a single argument for the printf conversion @Conv. The length modifiers of the original
+// format string are ignored: the argument's type is known, which makes e.g. "%d" with a uint64_t safe.
+static std::string FormatArg(const std::string& Spec, char Conv, EArgType Type, FReader& Args)
+{
+	const bool bIntConv    = strchr("diouxXc", Conv) != nullptr;
+	const bool bFloatConv  = strchr("eEfFgGaA", Conv) != nullptr;
+	const char IntConv     = bIntConv ? Conv : 'd';
+
+	switch (Type)
+	{
+	case I32:
+	case U32:
+	case I64:
+	case U64:
+	case POINTER:
+	{
+		int64_t  i = 0; uint64_t u = 0;
+		if (Type == I32) { int32_t v;  if (!Args.Read(v)) return "<?>"; i = v; u = static_cast<uint64_t>(v); }
+		if (Type == U32) { uint32_t v; if (!Args.Read(v)) return "<?>"; i = v; u = v; }
+		if (Type == I64) { int64_t v;  if (!Args.Read(v)) return "<?>"; i = v; u = static_cast<uint64_t>(v); }
+		if (Type == U64 || Type == POINTER) { uint64_t v; if (!Args.Read(v)) return "<?>"; i = static_cast<int64_t>(v); u = v; }
+
+		if (Type == POINTER && !bIntConv) return Print(Spec + "llX", static_cast<unsigned long long>(u));
+		if (bFloatConv)                   return Print(Spec + Conv, static_cast<double>(i));
+		if (Conv == 'c')                  return Print(Spec + 'c', static_cast<int>(i));
+		const bool bSigned = IntConv == 'd' || IntConv == 'i';
+		return bSigned ? Print(Spec + "ll" + IntConv, static_cast<long long>(i))
+		               : Print(Spec + "ll" + IntConv, static_cast<unsigned long long>(u));
+	}
+	case F64:
+	{
+		double v;
+		if (!Args.Read(v)) return "<?>";
+		if (bIntConv) return Print(Spec + "lld", static_cast<long long>(v));
+		return Print(Spec + (bFloatConv ? Conv : 'g'), v);
+	}
+	case STRING:
+	{
+		uint16_t Length;
+		std::string Str;
+		if (!Args.Read(Length) || !Args.Read(Str, Length)) return "<?>";
+		return Conv == 's' ? Print(Spec + 's', Str.c_str()) : Str;
+	}
+	}
+	return "<?>";
+}
+
+static std::string FormatMessageText(const FFormat& Format, FReader Args)
+{
+	const std::string& f = Format.Format;
+	std::string Text;
+	size_t iArg = 0;
+	for (size_t i = 0; i < f.size(); ++i)
+	{
+		if (f[i] != '%')
+		{
+			Text += f[i];
+			continue;
+		}
+		if (i + 1 < f.size() && f[i + 1] == '%')
+		{
+			Text += '%';
+			++i;
+			continue;
+		}
+
+		// %[flags][width][.precision][length]conversion
+		size_t j = i + 1;
+		std::string Spec = "%";
+		while (j < f.size() && strchr("-+ #0123456789.", f[j]))
+			Spec += f[j++];
+		while (j < f.size() && strchr("hlLzjtqI", f[j]))
+		{
+			if (f[j] == 'I' && (f.compare(j, 3, "I64") == 0 || f.compare(j, 3, "I32") == 0)) j += 3; // MSVC
+			else ++j;
+		}
+		if (j >= f.size())
+		{
+			Text += f.substr(i);
+			break;
+		}
+
+		const char Conv = f[j];
+		i = j;
+		if (iArg >= Format.ArgTypes.size())
+		{
+			Text += "<missing arg>";
+			continue;
+		}
+		Text += FormatArg(Spec, Conv, Format.ArgTypes[iArg++], Args);
+	}
+	return Text;
+}
+
+static std::string FormatTime(int64_t TimeNs)
+{
+	const std::time_t Seconds = static_cast<std::time_t>(TimeNs / 1000000000);
+	char buf[16];
+	snprintf(buf, sizeof(buf), ".%06lld", static_cast<long long>((TimeNs % 1000000000) / 1000));
+	return "[" + GetTimeAsString(Seconds) + buf + "]";
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: LogDecoder.exe <input.blog> [output.txt]\n");
+		return 1;
+	}
+
+	std::ifstream InFile(argv[1], std::ios::binary | std::ios::ate);
+	if (!InFile)
+	{
+		printf("Cannot open %s\n", argv[1]);
+		return 1;
+	}
+	std::vector<uint8_t> Data(static_cast<size_t>(InFile.tellg()));
+	InFile.seekg(0);
+	InFile.read(reinterpret_cast<char*>(Data.data()), Data.size());
+
+	FReader Reader(Data.data(), Data.size());
+	FFileHeader FileHeader;
+	if (!Reader.Read(FileHeader) || FileHeader.Magic != FILE_MAGIC || FileHeader.Version != FILE_VERSION)
+	{
+		printf("%s is not a binary log file (version %u)\n", argv[1], FILE_VERSION);
+		return 1;
+	}
+
+	std::unordered_map<uint32_t, FFormat> Formats;
+	std::vector<FClockSync>               ClockSyncs;
+	std::vector<FMessage>                 Messages;
+	std::vector<uint64_t>                 LastTscPerThread;
+	uint64_t NumDroppedMessages = 0;
+	uint64_t NumUnknownFormats = 0;
+
+	FBlockHeader Block;
+	while (Reader.Read(Block))
+	{
+		if (Block.Size > Reader.GetNumBytesLeft())
+		{
+			fprintf(stderr, "Warning: truncated file, the last block is ignored\n");
+			break;
+		}
+		FReader BlockReader(Reader.GetData(), Block.Size);
+		Reader.Skip(Block.Size);
+
+		switch (Block.Type)
+		{
+		case BLOCK_TYPE_CLOCK_SYNC:
+		{
+			FClockSync Sync;
+			if (BlockReader.Read(Sync))
+				ClockSyncs.push_back(Sync);
+			break;
+		}
+		case BLOCK_TYPE_FORMAT:
+		{
+			FFormatHeader Header;
+			if (!BlockReader.Read(Header))
+				break;
+			FFormat& Format = Formats[Header.FormatId];
+			Format.Level = std::min<uint8_t>(Header.Level, Log::NUM_LOG_LEVELS - 1);
+			Format.Line = Header.Line;
+			for (uint8_t i = 0; i < Header.NumArgs; ++i)
+			{
+				uint8_t Type = NUM_ARG_TYPES;
+				BlockReader.Read(Type);
+				Format.ArgTypes.push_back(static_cast<EArgType>(std::min<uint8_t>(Type, NUM_ARG_TYPES)));
+			}
+			BlockReader.Read(Format.Format, Header.FormatLength);
+			BlockReader.Read(Format.File, Header.FileLength);
+			break;
+		}
+		case BLOCK_TYPE_RECORDS:
+		{
+			uint32_t ThreadIndex;
+			if (!BlockReader.Read(ThreadIndex))
+				break;
+			if (LastTscPerThread.size() <= ThreadIndex)
+				LastTscPerThread.resize(ThreadIndex + 1, 0);
+
+			FRecordHeader Header;
+			while (BlockReader.Read(Header))
+			{
+				const size_t MessageSize = GetNumRecords(Header.PayloadSize) * RECORD_SIZE - sizeof(FRecordHeader);
+				FReader Args(BlockReader.GetData(), std::min<size_t>(Header.PayloadSize, BlockReader.GetNumBytesLeft()));
+				BlockReader.Skip(MessageSize);
+
+				auto it = Formats.find(Header.FormatId);
+				if (it == Formats.end())
+				{
+					++NumUnknownFormats;
+					continue;
+				}
+				Messages.push_back({ Header.Tsc, ThreadIndex, it->second.Level, FormatMessageText(it->second, Args) });
+				LastTscPerThread[ThreadIndex] = Header.Tsc;
+			}
+			break;
+		}
+		case BLOCK_TYPE_DROPPED:
+		{
+			uint32_t ThreadIndex;
+			uint64_t NumDropped;
+			if (!BlockReader.Read(ThreadIndex) || !BlockReader.Read(NumDropped))
+				break;
+			const uint64_t Tsc = ThreadIndex < LastTscPerThread.size() ? LastTscPerThread[ThreadIndex] : 0;
+			Messages.push_back({ Tsc, ThreadIndex, Log::LOG_LEVEL_WARNING, "[BinaryLog] Buffer full: dropped " + std::to_string(NumDropped) + " message(s)" });
+			NumDroppedMessages += NumDropped;
+			break;
+		}
+		default:
+			break; // unknown block: skip
+		}
+	}
+
+	// TSC -> wall clock: the first and last clock syncs give the TSC frequency
+	double NsPerTick = 1.0;
+	FClockSync Origin = { 0, 0 };
+	if (!ClockSyncs.empty())
+	{
+		Origin = ClockSyncs.front();
+		const FClockSync& Last = ClockSyncs.back();
+		if (Last.Tsc > Origin.Tsc && Last.SystemTimeNs > Origin.SystemTimeNs)
+			NsPerTick = static_cast<double>(Last.SystemTimeNs - Origin.SystemTimeNs) / static_cast<double>(Last.Tsc - Origin.Tsc);
+	}
+
+	std::stable_sort(Messages.begin(), Messages.end(), [](const FMessage& a, const FMessage& b) { return a.Tsc < b.Tsc; });
+
+	std::ofstream OutFile;
+	if (argc > 2)
+	{
+		OutFile.open(argv[2]);
+		if (!OutFile)
+		{
+			printf("Cannot open %s\n", argv[2]);
+			return 1;
+		}
+	}
+	std::ostream& Out = argc > 2 ? static_cast<std::ostream&>(OutFile) : std::cout;
+
+	for (const FMessage& Message : Messages)
+	{
+		const int64_t TimeNs = Origin.SystemTimeNs + static_cast<int64_t>((static_cast<double>(Message.Tsc) - static_cast<double>(Origin.Tsc)) * NsPerTick);
+		Out << FormatTime(TimeNs) << "[t" << Message.ThreadIndex << "]" << LOG_LEVEL_PREFIXES[Message.Level] << Message.Text << "\n";
+	}
+
+	fprintf(stderr, "Decoded %zu messages, %llu dropped", Messages.size(), static_cast<unsigned long long>(NumDroppedMessages));
+	if (NumUnknownFormats)
+		fprintf(stderr, ", %llu with an unknown format", static_cast<unsigned long long>(NumUnknownFormats));
+	fprintf(stderr, " (%.3f GHz TSC)\n", 1.0 / NsPerTick);
+	return 0;
+}
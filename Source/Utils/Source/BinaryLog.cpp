@@ -0,0 +1,243 @@
+#include "BinaryLog.h"
+#include "Multithreading.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Windows.h>
+
+namespace BinaryLog
+{
+namespace Detail
+{
+	std::atomic<bool> gbEnabled = false;
+}
+
+// The writer only polls: no wake-ups on the logging path. A thread can log
+// NUM_RECORDS_PER_THREAD records per FLUSH_INTERVAL before messages are dropped.
+constexpr size_t                    NUM_RECORDS_PER_THREAD = BUFFER_SIZE_PER_THREAD / RECORD_SIZE;
+constexpr std::chrono::milliseconds FLUSH_INTERVAL(10);
+
+struct FThreadBuffer
+{
+	SPSCChannel<Detail::FRecord, NUM_RECORDS_PER_THREAD> Records;
+	std::atomic<uint64_t> NumDroppedMessages = 0;
+	std::atomic<bool>     bThreadExited = false;
+	uint32_t              ThreadIndex = 0;
+};
+
+static std::mutex                                  sBuffersMtx;
+static std::vector<std::unique_ptr<FThreadBuffer>> sBuffers;
+static uint32_t                                    sNumThreadsRegistered = 0;
+
+static std::mutex                        sFormatsMtx;
+static std::vector<std::vector<uint8_t>> sFormatBlocks; // serialized BLOCK_TYPE_FORMAT payloads, indexed by format ID
+
+static std::ofstream           sFile;
+static std::thread             sWriterThread;
+static std::atomic<bool>       sbStopWriter = false;
+static std::mutex              sWakeMtx;
+static std::condition_variable sWakeCV;
+
+struct FThreadBufferHandle
+{
+	FThreadBuffer* pBuffer = nullptr;
+	~FThreadBufferHandle() { if (pBuffer) pBuffer->bThreadExited.store(true, std::memory_order_release); }
+};
+static thread_local FThreadBufferHandle tBufferHandle;
+
+static FThreadBuffer& GetThreadBuffer()
+{
+	if (!tBufferHandle.pBuffer)
+	{
+		std::unique_ptr<FThreadBuffer> pBuffer = std::make_unique<FThreadBuffer>();
+		tBufferHandle.pBuffer = pBuffer.get();
+		std::lock_guard<std::mutex> lk(sBuffersMtx);
+		pBuffer->ThreadIndex = sNumThreadsRegistered++;
+		sBuffers.push_back(std::move(pBuffer));
+	}
+	return *tBufferHandle.pBuffer;
+}
+
+template<class T>
+static void Append(std::vector<uint8_t>& Bytes, const T& Value)
+{
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(&Value);
+	Bytes.insert(Bytes.end(), p, p + sizeof(T));
+}
+static void AppendBlockHeader(std::vector<uint8_t>& Bytes, EBlockType Type, size_t Size)
+{
+	Append(Bytes, FBlockHeader{ Type, static_cast<uint32_t>(Size) });
+}
+
+static FClockSync GetClockSync()
+{
+	FClockSync Sync;
+	Sync.SystemTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	Sync.Tsc = CpuTimestamp::Now();
+	return Sync;
+}
+
+
+namespace Detail
+{
+	uint32_t RegisterCallSite(FCallSite& CallSite, const EArgType* pArgTypes, size_t NumArgs)
+	{
+		std::lock_guard<std::mutex> lk(sFormatsMtx);
+		uint32_t FormatId = CallSite.FormatId.load(std::memory_order_relaxed);
+		if (FormatId != INVALID_FORMAT_ID) // registered by another thread in the meantime
+			return FormatId;
+
+		FormatId = static_cast<uint32_t>(sFormatBlocks.size());
+		const size_t FormatLength = std::min<size_t>(strlen(CallSite.pFormat), UINT16_MAX);
+		const size_t FileLength   = std::min<size_t>(strlen(CallSite.pFile)  , UINT16_MAX);
+		const FFormatHeader Header =
+		{
+			  FormatId
+			, CallSite.Line
+			, static_cast<uint8_t>(CallSite.Level)
+			, static_cast<uint8_t>(NumArgs)
+			, static_cast<uint16_t>(FormatLength)
+			, static_cast<uint16_t>(FileLength)
+		};
+
+		std::vector<uint8_t> Block;
+		Append(Block, Header);
+		Block.insert(Block.end(), pArgTypes, pArgTypes + NumArgs);
+		Block.insert(Block.end(), CallSite.pFormat, CallSite.pFormat + FormatLength);
+		Block.insert(Block.end(), CallSite.pFile  , CallSite.pFile   + FileLength);
+		sFormatBlocks.push_back(std::move(Block));
+
+		CallSite.FormatId.store(FormatId, std::memory_order_release);
+		return FormatId;
+	}
+
+	void Push(FRecord* pRecords, size_t NumRecords)
+	{
+		FThreadBuffer& Buffer = GetThreadBuffer();
+		if (!Buffer.Records.TryPushAll(pRecords, NumRecords))
+			Buffer.NumDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+
+// Appends the messages of @Buffer as a BLOCK_TYPE_RECORDS block, followed by a BLOCK_TYPE_DROPPED block if needed.
+static void Drain(FThreadBuffer& Buffer, std::vector<uint8_t>& Blocks)
+{
+	const size_t BlockHeaderOffset = Blocks.size();
+	AppendBlockHeader(Blocks, BLOCK_TYPE_RECORDS, 0);
+	Append(Blocks, Buffer.ThreadIndex);
+	const size_t NumRecords = Buffer.Records.ConsumeAll([&](const Detail::FRecord& Record)
+	{
+		Blocks.insert(Blocks.end(), Record.Bytes, Record.Bytes + RECORD_SIZE);
+	});
+	if (NumRecords == 0)
+		Blocks.resize(BlockHeaderOffset);
+	else
+		reinterpret_cast<FBlockHeader*>(&Blocks[BlockHeaderOffset])->Size = static_cast<uint32_t>(sizeof(uint32_t) + NumRecords * RECORD_SIZE);
+
+	if (const uint64_t NumDropped = Buffer.NumDroppedMessages.exchange(0, std::memory_order_relaxed))
+	{
+		AppendBlockHeader(Blocks, BLOCK_TYPE_DROPPED, sizeof(uint32_t) + sizeof(uint64_t));
+		Append(Blocks, Buffer.ThreadIndex);
+		Append(Blocks, NumDropped);
+	}
+}
+
+static void WriterThread_Main()
+{
+	size_t NumFormatsWritten = 0;
+	std::vector<uint8_t> Blocks;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lk(sWakeMtx);
+			sWakeCV.wait_for(lk, FLUSH_INTERVAL, [&]() { return sbStopWriter.load(); });
+		}
+		const bool bStopping = sbStopWriter.load();
+
+		Blocks.clear();
+		{
+			std::lock_guard<std::mutex> lk(sBuffersMtx);
+			// buffers of exited threads are released once drained: check the flag before draining
+			for (auto it = sBuffers.begin(); it != sBuffers.end(); )
+			{
+				const bool bThreadExited = (*it)->bThreadExited.load(std::memory_order_acquire);
+				Drain(**it, Blocks);
+				it = bThreadExited ? sBuffers.erase(it) : std::next(it);
+			}
+		}
+
+		// formats go first: the ones registered by now include every format the drained messages refer to
+		{
+			std::lock_guard<std::mutex> lk(sFormatsMtx);
+			for (; NumFormatsWritten < sFormatBlocks.size(); ++NumFormatsWritten)
+			{
+				const std::vector<uint8_t>& Format = sFormatBlocks[NumFormatsWritten];
+				const FBlockHeader Header = { BLOCK_TYPE_FORMAT, static_cast<uint32_t>(Format.size()) };
+				sFile.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+				sFile.write(reinterpret_cast<const char*>(Format.data()), Format.size());
+			}
+		}
+		if (!Blocks.empty() || bStopping)
+		{
+			AppendBlockHeader(Blocks, BLOCK_TYPE_CLOCK_SYNC, sizeof(FClockSync));
+			Append(Blocks, GetClockSync());
+			sFile.write(reinterpret_cast<const char*>(Blocks.data()), Blocks.size());
+			sFile.flush();
+		}
+
+		if (bStopping) // the last drain started after the stop request
+			break;
+	}
+}
+
+
+bool Initialize(const std::string& FilePath)
+{
+	if (IsEnabled())
+		return true;
+
+	sFile.open(FilePath, std::ios::binary | std::ios::trunc);
+	if (!sFile)
+	{
+		Log::Error("[BinaryLog] Cannot open file: %s", FilePath.c_str());
+		return false;
+	}
+
+	const FFileHeader Header = { FILE_MAGIC, FILE_VERSION };
+	const FBlockHeader SyncHeader = { BLOCK_TYPE_CLOCK_SYNC, sizeof(FClockSync) };
+	const FClockSync Sync = GetClockSync();
+	sFile.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	sFile.write(reinterpret_cast<const char*>(&SyncHeader), sizeof(SyncHeader));
+	sFile.write(reinterpret_cast<const char*>(&Sync), sizeof(Sync));
+
+	sbStopWriter.store(false);
+	sWriterThread = std::thread(&WriterThread_Main);
+	SetThreadDescription(sWriterThread.native_handle(), L"BinaryLogWriter");
+	Detail::gbEnabled.store(true, std::memory_order_release);
+
+	Log::Info("[BinaryLog] Logging to %s", FilePath.c_str());
+	return true;
+}
+
+void Destroy()
+{
+	if (!IsEnabled())
+		return;
+	Detail::gbEnabled.store(false, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lk(sWakeMtx);
+		sbStopWriter.store(true);
+	}
+	sWakeCV.notify_one();
+	sWriterThread.join();
+	sFile.close();
+}
+
+}	// namespace BinaryLog
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "Log.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+//
+// Binary deferred-format logging: the calling thread only stores the call site's format ID, a CpuTimestamp
+// (TSC) and the raw arguments into its ring buffer. A writer thread streams the buffers into a
+// binary file (-LogBinary[=path]) that Tools/LogDecoder turns into text:
+//
+//     BLOG_INFO("r%d (u=%llu)", NumRenderLoops, NumUpdateLoops);
+//
+// A call costs tens of nanoseconds when enabled and a load + branch otherwise, so tracing can stay
+// compiled in. Levels below LOG_COMPILE_TIME_MIN_LEVEL (Log.h) are compiled out.
+// The format string must be a literal: it's registered once per call site.
+// Arguments: integers, enums, floating point, pointers and strings (const char*, std::string),
+// strings are copied and truncated to MAX_STRING_ARG_LENGTH. Messages are dropped when the
+// thread's buffer is full, the decoder reports the number of dropped messages.
+//
+#define BLOG(LEVEL, FORMAT, ...)\
+	do {\
+		static BinaryLog::FCallSite sBinaryLogCallSite = { FORMAT, __FILE__, __LINE__, LEVEL };\
+		if (LEVEL >= LOG_COMPILE_TIME_MIN_LEVEL && BinaryLog::IsEnabled())\
+			BinaryLog::Write(sBinaryLogCallSite, ##__VA_ARGS__);\
+	} while (0)
+
+#define BLOG_VERBOSE(FORMAT, ...) BLOG(Log::LOG_LEVEL_VERBOSE, FORMAT, ##__VA_ARGS__)
+#define BLOG_INFO(FORMAT, ...)    BLOG(Log::LOG_LEVEL_INFO   , FORMAT, ##__VA_ARGS__)
+#define BLOG_WARNING(FORMAT, ...) BLOG(Log::LOG_LEVEL_WARNING, FORMAT, ##__VA_ARGS__)
+#define BLOG_ERROR(FORMAT, ...)   BLOG(Log::LOG_LEVEL_ERROR  , FORMAT, ##__VA_ARGS__)
+
+namespace BinaryLog
+{
+	constexpr uint32_t INVALID_FORMAT_ID      = 0xFFFFFFFF;
+	constexpr size_t   MAX_NUM_ARGS           = 8;
+	constexpr size_t   MAX_STRING_ARG_LENGTH  = 128;
+	constexpr size_t   BUFFER_SIZE_PER_THREAD = 64 * 1024;
+
+	struct FCallSite
+	{
+		const char*           pFormat;
+		const char*           pFile;
+		uint32_t              Line;
+		Log::ELogLevel        Level;
+		std::atomic<uint32_t> FormatId = INVALID_FORMAT_ID; // assigned on first use
+	};
+
+	enum EArgType : uint8_t
+	{
+		I32 = 0,
+		U32,
+		I64,
+		U64,
+		F64,
+		POINTER,
+		STRING, // uint16_t length followed by the characters, no null terminator
+
+		NUM_ARG_TYPES
+	};
+
+	//---------------------------------------------------------------------------------------------
+	// File format, shared with the decoder:
+	//     FFileHeader, then a sequence of FBlockHeader + payload
+	//---------------------------------------------------------------------------------------------
+	constexpr uint32_t FILE_MAGIC   = 0x474F4C42; // "BLOG"
+	constexpr uint32_t FILE_VERSION = 1;
+	struct FFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+	};
+
+	enum EBlockType : uint32_t
+	{
+		BLOCK_TYPE_CLOCK_SYNC = 0, // FClockSync: maps TSC to wall clock time, written with every flush
+		BLOCK_TYPE_FORMAT,         // FFormatHeader, arg types, format string, file name
+		BLOCK_TYPE_RECORDS,        // uint32_t thread index, messages of that thread: FRecordHeader + args, padded to RECORD_SIZE
+		BLOCK_TYPE_DROPPED,        // uint32_t thread index, uint64_t number of dropped messages
+
+		NUM_BLOCK_TYPES
+	};
+	struct FBlockHeader
+	{
+		uint32_t Type;
+		uint32_t Size; // excluding the header
+	};
+	struct FClockSync
+	{
+		uint64_t Tsc;
+		int64_t  SystemTimeNs; // since epoch
+	};
+	struct FFormatHeader
+	{
+		uint32_t FormatId;
+		uint32_t Line;
+		uint8_t  Level;
+		uint8_t  NumArgs;
+		uint16_t FormatLength;
+		uint16_t FileLength;
+	};
+
+	constexpr size_t RECORD_SIZE = 64;
+	struct FRecordHeader
+	{
+		uint64_t Tsc;
+		uint32_t FormatId;
+		uint32_t PayloadSize;
+	};
+	constexpr size_t GetNumRecords(size_t PayloadSize) { return (sizeof(FRecordHeader) + PayloadSize + RECORD_SIZE - 1) / RECORD_SIZE; }
+	constexpr size_t MAX_MESSAGE_SIZE = sizeof(FRecordHeader) + MAX_NUM_ARGS * (sizeof(uint16_t) + MAX_STRING_ARG_LENGTH);
+	constexpr size_t MAX_NUM_RECORDS_PER_MESSAGE = GetNumRecords(MAX_MESSAGE_SIZE - sizeof(FRecordHeader));
+
+	//---------------------------------------------------------------------------------------------
+
+	// @FilePath: absolute path of the output file
+	bool Initialize(const std::string& FilePath);
+	void Destroy(); // writes out the pending messages and closes the file
+
+	inline bool IsEnabled();
+
+	template<class... Args>
+	void Write(FCallSite& CallSite, const Args&... args);
+
+
+	//---------------------------------------------------------------------------------------------
+	// Implementation
+	//---------------------------------------------------------------------------------------------
+	namespace Detail
+	{
+		extern std::atomic<bool> gbEnabled;
+
+		struct alignas(RECORD_SIZE) FRecord
+		{
+			uint8_t Bytes[RECORD_SIZE];
+		};
+
+		uint32_t RegisterCallSite(FCallSite& CallSite, const EArgType* pArgTypes, size_t NumArgs);
+		void     Push(FRecord* pRecords, size_t NumRecords); // drops the message if the thread's buffer is full
+
+		template<class T> constexpr EArgType GetArgType()
+		{
+			using U = std::decay_t<T>;
+			if constexpr (std::is_enum_v<U>)                                     return GetArgType<std::underlying_type_t<U>>();
+			else if constexpr (std::is_same_v<U, bool>)                          return U32;
+			else if constexpr (std::is_integral_v<U>)                            return sizeof(U) <= 4 ? (std::is_signed_v<U> ? I32 : U32) : (std::is_signed_v<U> ? I64 : U64);
+			else if constexpr (std::is_floating_point_v<U>)                      return F64;
+			else if constexpr (std::is_same_v<U, char*> || std::is_same_v<U, const char*> || std::is_same_v<U, std::string>) return STRING;
+			else if constexpr (std::is_pointer_v<U>)                             return POINTER;
+			else
+			{
+				static_assert(sizeof(U) == 0, "BinaryLog: unsupported argument type");
+				return NUM_ARG_TYPES;
+			}
+		}
+
+		inline size_t GetStringArgLength(const char* psz)        { return psz ? strnlen(psz, MAX_STRING_ARG_LENGTH) : 0; }
+		inline size_t GetStringArgLength(const std::string& str) { return std::min(str.size(), MAX_STRING_ARG_LENGTH); }
+		inline const char* GetStringArgData(const char* psz)        { return psz; }
+		inline const char* GetStringArgData(const std::string& str) { return str.data(); }
+
+		template<class T> size_t GetArgSize(const T& arg)
+		{
+			constexpr EArgType Type = GetArgType<T>();
+			if constexpr (Type == STRING)                  return sizeof(uint16_t) + GetStringArgLength(arg);
+			else if constexpr (Type == I32 || Type == U32) return 4;
+			else                                           return 8;
+		}
+
+		template<class T> void WriteArg(uint8_t*& pDst, const T& arg)
+		{
+			using U = std::decay_t<T>;
+			constexpr EArgType Type = GetArgType<T>();
+			if constexpr (Type == STRING)
+			{
+				const uint16_t Length = static_cast<uint16_t>(GetStringArgLength(arg));
+				memcpy(pDst, &Length, sizeof(Length));
+				if (Length) memcpy(pDst + sizeof(Length), GetStringArgData(arg), Length);
+				pDst += sizeof(Length) + Length;
+			}
+			else
+			{
+				using Stored_t = std::conditional_t<Type == I32, int32_t
+					, std::conditional_t<Type == U32, uint32_t
+					, std::conditional_t<Type == I64, int64_t
+					, std::conditional_t<Type == U64, uint64_t
+					, std::conditional_t<Type == F64, double
+					, uint64_t>>>>>;
+				Stored_t Value;
+				if constexpr (Type == POINTER)        Value = static_cast<Stored_t>(reinterpret_cast<uintptr_t>(arg));
+				else if constexpr (std::is_enum_v<U>) Value = static_cast<Stored_t>(static_cast<std::underlying_type_t<U>>(arg));
+				else                                  Value = static_cast<Stored_t>(arg);
+				memcpy(pDst, &Value, sizeof(Value));
+				pDst += sizeof(Value);
+			}
+		}
+	}
+
+	inline bool IsEnabled() { return Detail::gbEnabled.load(std::memory_order_relaxed); }
+
+	template<class... Args>
+	void Write(FCallSite& CallSite, const Args&... args)
+	{
+		static_assert(sizeof...(Args) <= MAX_NUM_ARGS, "BinaryLog: too many arguments");
+
+		uint32_t FormatId = CallSite.FormatId.load(std::memory_order_acquire);
+		if (FormatId == INVALID_FORMAT_ID)
+		{
+			static constexpr std::array<EArgType, sizeof...(Args)> ARG_TYPES = { Detail::GetArgType<Args>()... };
+			FormatId = Detail::RegisterCallSite(CallSite, ARG_TYPES.data(), ARG_TYPES.size());
+		}
+
+		const size_t PayloadSize = (size_t(0) + ... + Detail::GetArgSize(args));
+		const size_t NumRecords = GetNumRecords(PayloadSize);
+
+		Detail::FRecord Records[MAX_NUM_RECORDS_PER_MESSAGE]; // left uninitialized, the padding of the last record is ignored
+		const FRecordHeader Header = { CpuTimestamp::Now(), FormatId, static_cast<uint32_t>(PayloadSize) };
+		memcpy(Records[0].Bytes, &Header, sizeof(Header));
+		uint8_t* pDst = Records[0].Bytes + sizeof(Header);
+		(Detail::WriteArg(pDst, args), ...);
+
+		Detail::Push(Records, NumRecords);
+	}
+}
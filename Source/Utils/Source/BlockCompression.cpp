@@ -0,0 +1,892 @@
+#include "BlockCompression.h"
+#include "Image.h"
+#include "Log.h"
+#include "Multithreading.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+
+#include <immintrin.h>
+
+// BC6H & BC7 4-bit index interpolation weights, out of 64
+constexpr int   BC_WEIGHTS_4BIT[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+constexpr float BC_INDEX_WEIGHTS_4BIT[16] =
+{
+	 0 / 64.0f,  4 / 64.0f,  9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+	34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f
+};
+
+constexpr int BC_NUM_REFINE_ITERATIONS[NUM_BC_QUALITIES] = { 0, 2, 6 };
+constexpr int BC_NUM_SEARCH_PASSES    [NUM_BC_QUALITIES] = { 0, 0, 2 };
+
+//
+// Block data
+//
+// The 16 pixels of a block as SoA: c[channel][pixel]. LDR formats: [0, 255], BC6H: half float bit patterns.
+struct FBlock
+{
+	alignas(16) float c[4][16];
+};
+
+// Palette of an encoded block, SoA like FBlock: Palette[channel][entry]
+struct FPalette
+{
+	alignas(16) float c[4][16];
+	int NumEntries = 0;
+};
+
+static uint16_t FloatToHalfBits(float f) // unsigned: negatives & NaN -> 0, saturates to the largest finite half
+{
+	if (!(f > 0.0f))
+		return 0;
+	if (f >= 65504.0f)
+		return 0x7BFF;
+	uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+	const int Exponent = static_cast<int>(x >> 23) - 127 + 15;
+	if (Exponent <= 0) // subnormal half
+	{
+		if (Exponent < -10)
+			return 0;
+		const uint32_t Mantissa = (x & 0x7FFFFF) | 0x800000;
+		const int Shift = 14 - Exponent;
+		return static_cast<uint16_t>((Mantissa >> Shift) + ((Mantissa >> (Shift - 1)) & 1));
+	}
+	const uint32_t h = (static_cast<uint32_t>(Exponent) << 10) + ((x >> 13) & 0x3FF) + ((x >> 12) & 1); // round: the carry propagates into the exponent
+	return static_cast<uint16_t>(std::min<uint32_t>(h, 0x7BFF));
+}
+
+static float HalfBitsToFloat(uint16_t h)
+{
+	const uint32_t Exponent = (h >> 10) & 0x1F;
+	const uint32_t Mantissa = h & 0x3FF;
+	const float Sign = (h & 0x8000) ? -1.0f : 1.0f;
+	if (Exponent == 0)
+		return Sign * std::ldexp(static_cast<float>(Mantissa), -24);
+	if (Exponent == 31)
+		return Mantissa ? NAN : Sign * INFINITY;
+	return Sign * std::ldexp(static_cast<float>(Mantissa | 0x400), static_cast<int>(Exponent) - 25);
+}
+
+struct FSourceLevel
+{
+	const void* pPixels = nullptr;
+	int         Width = 0;
+	int         Height = 0;
+	bool        bFloat = false; // RGBA32F, RGBA8 otherwise
+};
+
+static void LoadBlock(const FSourceLevel& Src, int BlockX, int BlockY, bool bHalfBits, FBlock& Block)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		const int x = std::min(BlockX * 4 + (i & 3) , Src.Width  - 1);
+		const int y = std::min(BlockY * 4 + (i >> 2), Src.Height - 1);
+		const size_t iPixel = (static_cast<size_t>(y) * Src.Width + x) * 4;
+		for (int c = 0; c < 4; ++c)
+		{
+			if (Src.bFloat)
+			{
+				const float v = static_cast<const float*>(Src.pPixels)[iPixel + c];
+				Block.c[c][i] = bHalfBits ? FloatToHalfBits(v) : std::min(std::max(v, 0.0f), 1.0f) * 255.0f; // max() first: NaN -> 0
+			}
+			else
+			{
+				const uint8_t v = static_cast<const uint8_t*>(Src.pPixels)[iPixel + c];
+				Block.c[c][i] = bHalfBits ? FloatToHalfBits(v / 255.0f) : v;
+			}
+		}
+	}
+}
+
+//
+// 128-bit block bit packing, LSB first
+//
+struct FBitWriter
+{
+	uint64_t Bits[2] = {};
+	int      Position = 0;
+
+	void Write(uint32_t Value, int NumBits)
+	{
+		for (int i = 0; i < NumBits; ++i, ++Position)
+			Bits[Position >> 6] |= static_cast<uint64_t>((Value >> i) & 1) << (Position & 63);
+	}
+	void Store(uint8_t* pOut) const { memcpy(pOut, Bits, sizeof(Bits)); }
+};
+struct FBitReader
+{
+	uint64_t Bits[2] = {};
+	int      Position = 0;
+
+	explicit FBitReader(const uint8_t* pIn) { memcpy(Bits, pIn, sizeof(Bits)); }
+	uint32_t Read(int NumBits)
+	{
+		uint32_t Value = 0;
+		for (int i = 0; i < NumBits; ++i, ++Position)
+			Value |= static_cast<uint32_t>((Bits[Position >> 6] >> (Position & 63)) & 1) << i;
+		return Value;
+	}
+};
+
+//
+// Kernels
+//
+static inline float HorizontalSum(__m128 v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+// Selects the closest palette entry of each pixel over the channels [FirstChannel, FirstChannel + NumChannels),
+// returns the squared error of the block.
+static float SelectIndices(const FBlock& Block, int FirstChannel, int NumChannels, const FPalette& Palette, uint8_t Indices[16])
+{
+	__m128 vError = _mm_setzero_ps();
+	for (int j = 0; j < 16; j += 4)
+	{
+		__m128  vBest = _mm_set1_ps(FLT_MAX);
+		__m128i vBestIndex = _mm_setzero_si128();
+		for (int i = 0; i < Palette.NumEntries; ++i)
+		{
+			__m128 vDist = _mm_setzero_ps();
+			for (int c = FirstChannel; c < FirstChannel + NumChannels; ++c)
+			{
+				const __m128 vDiff = _mm_sub_ps(_mm_load_ps(&Block.c[c][j]), _mm_set1_ps(Palette.c[c][i]));
+				vDist = _mm_add_ps(vDist, _mm_mul_ps(vDiff, vDiff));
+			}
+			const __m128i vCloser = _mm_castps_si128(_mm_cmplt_ps(vDist, vBest));
+			vBest = _mm_min_ps(vDist, vBest);
+			vBestIndex = _mm_or_si128(_mm_and_si128(vCloser, _mm_set1_epi32(i)), _mm_andnot_si128(vCloser, vBestIndex)); // SSE2 blend
+		}
+		vError = _mm_add_ps(vError, vBest);
+		const __m128i v16 = _mm_packs_epi32(vBestIndex, vBestIndex);
+		const int32_t Packed = _mm_cvtsi128_si32(_mm_packus_epi16(v16, v16));
+		memcpy(&Indices[j], &Packed, sizeof(Packed));
+	}
+	return HorizontalSum(vError);
+}
+
+// Endpoints at the extents of the projection of the pixels on the principal axis of the channels
+static void FitEndpointsPrincipalAxis(const FBlock& Block, int FirstChannel, int NumChannels, float e0[4], float e1[4])
+{
+	const int C0 = FirstChannel;
+	const int NC = NumChannels;
+	float Mean[4] = {};
+	for (int c = 0; c < NC; ++c)
+	{
+		__m128 vSum = _mm_setzero_ps();
+		for (int j = 0; j < 16; j += 4)
+			vSum = _mm_add_ps(vSum, _mm_load_ps(&Block.c[C0 + c][j]));
+		Mean[c] = HorizontalSum(vSum) / 16.0f;
+	}
+
+	// covariance
+	float Cov[4][4] = {};
+	for (int c = 0; c < NC; ++c)
+	for (int d = c; d < NC; ++d)
+	{
+		__m128 vSum = _mm_setzero_ps();
+		for (int j = 0; j < 16; j += 4)
+		{
+			const __m128 vC = _mm_sub_ps(_mm_load_ps(&Block.c[C0 + c][j]), _mm_set1_ps(Mean[c]));
+			const __m128 vD = _mm_sub_ps(_mm_load_ps(&Block.c[C0 + d][j]), _mm_set1_ps(Mean[d]));
+			vSum = _mm_add_ps(vSum, _mm_mul_ps(vC, vD));
+		}
+		Cov[c][d] = Cov[d][c] = HorizontalSum(vSum);
+	}
+
+	// power iteration, starting from the covariance row of the channel with the largest variance
+	int iMaxVariance = 0;
+	for (int c = 1; c < NC; ++c)
+		if (Cov[c][c] > Cov[iMaxVariance][iMaxVariance])
+			iMaxVariance = c;
+	float Axis[4] = {};
+	for (int c = 0; c < NC; ++c)
+		Axis[c] = Cov[iMaxVariance][c];
+	for (int Iteration = 0; Iteration < 8; ++Iteration)
+	{
+		float NewAxis[4] = {};
+		float MaxComponent = 0.0f;
+		for (int c = 0; c < NC; ++c)
+		{
+			for (int d = 0; d < NC; ++d)
+				NewAxis[c] += Cov[c][d] * Axis[d];
+			MaxComponent = std::max(MaxComponent, std::abs(NewAxis[c]));
+		}
+		if (MaxComponent <= 0.0f)
+			break;
+		for (int c = 0; c < NC; ++c)
+			Axis[c] = NewAxis[c] / MaxComponent;
+	}
+	float LengthSq = 0.0f;
+	for (int c = 0; c < NC; ++c)
+		LengthSq += Axis[c] * Axis[c];
+	if (LengthSq > 0.0f)
+		for (int c = 0; c < NC; ++c)
+			Axis[c] /= std::sqrt(LengthSq);
+
+	// project
+	__m128 vMin = _mm_set1_ps(FLT_MAX);
+	__m128 vMax = _mm_set1_ps(-FLT_MAX);
+	for (int j = 0; j < 16; j += 4)
+	{
+		__m128 vT = _mm_setzero_ps();
+		for (int c = 0; c < NC; ++c)
+			vT = _mm_add_ps(vT, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&Block.c[C0 + c][j]), _mm_set1_ps(Mean[c])), _mm_set1_ps(Axis[c])));
+		vMin = _mm_min_ps(vMin, vT);
+		vMax = _mm_max_ps(vMax, vT);
+	}
+	vMin = _mm_min_ps(vMin, _mm_movehl_ps(vMin, vMin)); vMin = _mm_min_ss(vMin, _mm_shuffle_ps(vMin, vMin, 1));
+	vMax = _mm_max_ps(vMax, _mm_movehl_ps(vMax, vMax)); vMax = _mm_max_ss(vMax, _mm_shuffle_ps(vMax, vMax, 1));
+	const float tMin = _mm_cvtss_f32(vMin);
+	const float tMax = _mm_cvtss_f32(vMax);
+	for (int c = 0; c < NC; ++c)
+	{
+		e0[C0 + c] = Mean[c] + tMin * Axis[c];
+		e1[C0 + c] = Mean[c] + tMax * Axis[c];
+	}
+}
+
+// Least squares endpoints for the given indices: minimizes sum |(1-w) e0 + w e1 - p|^2 where w is the
+// interpolation weight of each pixel's index. Returns false if the indices don't constrain both endpoints.
+static bool FitEndpointsLeastSquares(const FBlock& Block, int FirstChannel, int NumChannels, const uint8_t Indices[16], const float* pIndexWeights, float e0[4], float e1[4])
+{
+	float a = 0.0f, b = 0.0f, c = 0.0f;
+	float x[4] = {}, y[4] = {};
+	for (int i = 0; i < 16; ++i)
+	{
+		const float w = pIndexWeights[Indices[i]];
+		const float w0 = 1.0f - w;
+		a += w0 * w0;
+		b += w0 * w;
+		c += w * w;
+		for (int ch = FirstChannel; ch < FirstChannel + NumChannels; ++ch)
+		{
+			x[ch] += w0 * Block.c[ch][i];
+			y[ch] += w  * Block.c[ch][i];
+		}
+	}
+	const float Det = a * c - b * b;
+	if (std::abs(Det) < 1e-6f)
+		return false;
+	for (int ch = FirstChannel; ch < FirstChannel + NumChannels; ++ch)
+	{
+		e0[ch] = (c * x[ch] - b * y[ch]) / Det;
+		e1[ch] = (a * y[ch] - b * x[ch]) / Det;
+	}
+	return true;
+}
+
+//
+// Encoders: each format defines its quantized endpoints (FEndpoints), how to quantize float endpoints,
+// how to build the palette from quantized endpoints and how to write the block. EncodeEndpoints()
+// drives the fit / refine / search for all of them.
+//
+struct FEndpoints
+{
+	int q[2][4] = {}; // quantized endpoints
+	int p[2] = {};    // BC7 p-bits
+};
+
+struct FEncodeResult
+{
+	FEndpoints Endpoints;
+	uint8_t    Indices[16] = {};
+	float      Error = FLT_MAX;
+};
+
+template<class TFormat>
+static FEncodeResult EncodeEndpoints(const FBlock& Block, EBlockCompressionQuality Quality)
+{
+	const int C0 = TFormat::FIRST_CHANNEL;
+	const int NC = TFormat::NUM_CHANNELS;
+
+	FEncodeResult Best;
+	auto fnEvaluate = [&](const FEndpoints& Endpoints)
+	{
+		FPalette Palette;
+		TFormat::BuildPalette(Endpoints, Palette);
+		uint8_t Indices[16];
+		const float Error = SelectIndices(Block, C0, NC, Palette, Indices);
+		if (Error < Best.Error)
+		{
+			Best.Endpoints = Endpoints;
+			Best.Error = Error;
+			memcpy(Best.Indices, Indices, sizeof(Indices));
+		}
+	};
+
+	float e0[4] = {}, e1[4] = {};
+	FitEndpointsPrincipalAxis(Block, C0, NC, e0, e1);
+	fnEvaluate(TFormat::Quantize(e0, e1));
+
+	for (int Iteration = 0; Iteration < BC_NUM_REFINE_ITERATIONS[Quality] && Best.Error > 0.0f; ++Iteration)
+	{
+		if (!FitEndpointsLeastSquares(Block, C0, NC, Best.Indices, TFormat::INDEX_WEIGHTS, e0, e1))
+			break;
+		fnEvaluate(TFormat::Quantize(e0, e1));
+	}
+
+	// greedy search: step each quantized endpoint channel (and p-bit) while the error decreases
+	for (int Pass = 0; Pass < BC_NUM_SEARCH_PASSES[Quality] && Best.Error > 0.0f; ++Pass)
+	{
+		const float PassBeginError = Best.Error;
+		for (int e = 0; e < 2; ++e)
+		{
+			for (int c = C0; c < C0 + NC; ++c)
+			for (int Step : { -1, 1 })
+			{
+				FEndpoints Candidate = Best.Endpoints;
+				Candidate.q[e][c] = std::min(std::max(Candidate.q[e][c] + Step, 0), TFormat::MaxQuantizedValue(c));
+				if (Candidate.q[e][c] != Best.Endpoints.q[e][c])
+					fnEvaluate(Candidate);
+			}
+			if (TFormat::HAS_P_BITS)
+			{
+				FEndpoints Candidate = Best.Endpoints;
+				Candidate.p[e] ^= 1;
+				fnEvaluate(Candidate);
+			}
+		}
+		if (Best.Error >= PassBeginError)
+			break;
+	}
+	return Best;
+}
+
+static inline int QuantizeChannel(float v, int MaxValue, float Scale) // v * Scale rounded to [0, MaxValue]
+{
+	return std::min(std::max(static_cast<int>(v * Scale + 0.5f), 0), MaxValue);
+}
+
+struct FFormatBC1
+{
+	static constexpr int   FIRST_CHANNEL = 0;
+	static constexpr int   NUM_CHANNELS = 3;
+	static constexpr bool  HAS_P_BITS = false;
+	static constexpr float INDEX_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	static int MaxQuantizedValue(int c) { return c == 1 ? 63 : 31; }
+	static int Expand(int q, int c) { return c == 1 ? (q << 2) | (q >> 4) : (q << 3) | (q >> 2); }
+	static uint16_t Pack(const int q[4]) { return static_cast<uint16_t>((q[0] << 11) | (q[1] << 5) | q[2]); }
+
+	static FEndpoints Quantize(const float e0[4], const float e1[4])
+	{
+		FEndpoints E;
+		for (int c = 0; c < 3; ++c)
+		{
+			E.q[0][c] = QuantizeChannel(e0[c], MaxQuantizedValue(c), MaxQuantizedValue(c) / 255.0f);
+			E.q[1][c] = QuantizeChannel(e1[c], MaxQuantizedValue(c), MaxQuantizedValue(c) / 255.0f);
+		}
+		return E;
+	}
+	static void BuildPalette(const FEndpoints& E, FPalette& Palette)
+	{
+		Palette.NumEntries = 4;
+		for (int c = 0; c < 3; ++c)
+		{
+			const float v0 = static_cast<float>(Expand(E.q[0][c], c));
+			const float v1 = static_cast<float>(Expand(E.q[1][c], c));
+			for (int i = 0; i < 4; ++i)
+				Palette.c[c][i] = v0 + (v1 - v0) * INDEX_WEIGHTS[i];
+		}
+	}
+	// 4-color mode requires c0 > c1
+	static void Write(const FEncodeResult& Result, uint8_t* pOut)
+	{
+		uint16_t c0 = Pack(Result.Endpoints.q[0]);
+		uint16_t c1 = Pack(Result.Endpoints.q[1]);
+		uint8_t Indices[16];
+		memcpy(Indices, Result.Indices, sizeof(Indices));
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			for (uint8_t& i : Indices)
+				i ^= 1; // 0 <-> 1, 2 <-> 3
+		}
+		else if (c0 == c1)
+		{
+			memset(Indices, 0, sizeof(Indices)); // all palette entries are equal: stay out of the 3-color mode's black
+		}
+		uint32_t IndexBits = 0;
+		for (int i = 0; i < 16; ++i)
+			IndexBits |= static_cast<uint32_t>(Indices[i]) << (2 * i);
+		memcpy(pOut + 0, &c0, 2);
+		memcpy(pOut + 2, &c1, 2);
+		memcpy(pOut + 4, &IndexBits, 4);
+	}
+};
+
+template<int CHANNEL>
+struct FFormatBC4
+{
+	static constexpr int   FIRST_CHANNEL = CHANNEL;
+	static constexpr int   NUM_CHANNELS = 1;
+	static constexpr bool  HAS_P_BITS = false;
+	static constexpr float INDEX_WEIGHTS[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+	static int MaxQuantizedValue(int) { return 255; }
+	static FEndpoints Quantize(const float e0[4], const float e1[4])
+	{
+		FEndpoints E;
+		E.q[0][CHANNEL] = QuantizeChannel(e0[CHANNEL], 255, 1.0f);
+		E.q[1][CHANNEL] = QuantizeChannel(e1[CHANNEL], 255, 1.0f);
+		return E;
+	}
+	static void BuildPalette(const FEndpoints& E, FPalette& Palette)
+	{
+		Palette.NumEntries = 8;
+		const float v0 = static_cast<float>(E.q[0][CHANNEL]);
+		const float v1 = static_cast<float>(E.q[1][CHANNEL]);
+		for (int i = 0; i < 8; ++i)
+			Palette.c[CHANNEL][i] = v0 + (v1 - v0) * INDEX_WEIGHTS[i];
+	}
+	// 8-value mode requires a0 > a1
+	static void Write(const FEncodeResult& Result, uint8_t* pOut)
+	{
+		int a0 = Result.Endpoints.q[0][CHANNEL];
+		int a1 = Result.Endpoints.q[1][CHANNEL];
+		uint8_t Indices[16];
+		memcpy(Indices, Result.Indices, sizeof(Indices));
+		if (a0 < a1)
+		{
+			std::swap(a0, a1);
+			for (uint8_t& i : Indices)
+				i = i < 2 ? (i ^ 1) : static_cast<uint8_t>(9 - i); // weight w -> 1 - w
+		}
+		else if (a0 == a1)
+		{
+			memset(Indices, 0, sizeof(Indices)); // all palette entries are equal: stay out of the 6-value mode's 0 & 255
+		}
+		uint64_t IndexBits = 0;
+		for (int i = 0; i < 16; ++i)
+			IndexBits |= static_cast<uint64_t>(Indices[i]) << (3 * i);
+		pOut[0] = static_cast<uint8_t>(a0);
+		pOut[1] = static_cast<uint8_t>(a1);
+		memcpy(pOut + 2, &IndexBits, 6); // little endian
+	}
+};
+
+static void WriteIndices4Bit(FBitWriter& Writer, const uint8_t Indices[16])
+{
+	Writer.Write(Indices[0], 3); // anchor: the MSB is implicitly 0
+	for (int i = 1; i < 16; ++i)
+		Writer.Write(Indices[i], 4);
+}
+
+struct FFormatBC7
+{
+	static constexpr int   FIRST_CHANNEL = 0;
+	static constexpr int   NUM_CHANNELS = 4;
+	static constexpr bool  HAS_P_BITS = true;
+	static constexpr const float* INDEX_WEIGHTS = BC_INDEX_WEIGHTS_4BIT;
+
+	static int MaxQuantizedValue(int) { return 127; }
+	static FEndpoints Quantize(const float e0[4], const float e1[4])
+	{
+		FEndpoints E;
+		const float* pEndpoints[2] = { e0, e1 };
+		for (int e = 0; e < 2; ++e) // pick the p-bit that quantizes the endpoint best
+		{
+			float BestError = FLT_MAX;
+			for (int p = 0; p < 2; ++p)
+			{
+				int q[4];
+				float Error = 0.0f;
+				for (int c = 0; c < 4; ++c)
+				{
+					q[c] = QuantizeChannel(pEndpoints[e][c] - p, 127, 0.5f);
+					const float d = static_cast<float>((q[c] << 1) | p) - pEndpoints[e][c];
+					Error += d * d;
+				}
+				if (Error < BestError)
+				{
+					BestError = Error;
+					memcpy(E.q[e], q, sizeof(q));
+					E.p[e] = p;
+				}
+			}
+		}
+		return E;
+	}
+	static void BuildPalette(const FEndpoints& E, FPalette& Palette)
+	{
+		Palette.NumEntries = 16;
+		for (int c = 0; c < 4; ++c)
+		{
+			const int v0 = (E.q[0][c] << 1) | E.p[0];
+			const int v1 = (E.q[1][c] << 1) | E.p[1];
+			for (int i = 0; i < 16; ++i)
+				Palette.c[c][i] = static_cast<float>((v0 * (64 - BC_WEIGHTS_4BIT[i]) + v1 * BC_WEIGHTS_4BIT[i] + 32) >> 6);
+		}
+	}
+	static void Write(const FEncodeResult& Result, uint8_t* pOut)
+	{
+		FEndpoints E = Result.Endpoints;
+		uint8_t Indices[16];
+		memcpy(Indices, Result.Indices, sizeof(Indices));
+		if (Indices[0] & 8) // the anchor index must fit in 3 bits
+		{
+			std::swap(E.q[0], E.q[1]);
+			std::swap(E.p[0], E.p[1]);
+			for (uint8_t& i : Indices)
+				i = 15 - i;
+		}
+		FBitWriter Writer;
+		Writer.Write(1 << 6, 7); // mode 6
+		for (int c = 0; c < 4; ++c)
+		{
+			Writer.Write(E.q[0][c], 7);
+			Writer.Write(E.q[1][c], 7);
+		}
+		Writer.Write(E.p[0], 1);
+		Writer.Write(E.p[1], 1);
+		WriteIndices4Bit(Writer, Indices);
+		Writer.Store(pOut);
+	}
+};
+
+// Pixels & palette are in the half float bit pattern space, which is close to logarithmic:
+// the error metric weighs the dark and the bright values alike.
+struct FFormatBC6H
+{
+	static constexpr int   FIRST_CHANNEL = 0;
+	static constexpr int   NUM_CHANNELS = 3;
+	static constexpr bool  HAS_P_BITS = false;
+	static constexpr const float* INDEX_WEIGHTS = BC_INDEX_WEIGHTS_4BIT;
+
+	static int MaxQuantizedValue(int) { return 1023; }
+	static int Unquantize(int q) { return q == 0 ? 0 : q == 1023 ? 0xFFFF : ((q << 16) + 0x8000) >> 10; } // unsigned, 10-bit endpoints
+	static int FinishUnquantize(int v) { return (v * 31) >> 6; } // -> half float bits
+
+	static FEndpoints Quantize(const float e0[4], const float e1[4])
+	{
+		// an endpoint alone decodes to q * 31 + 15
+		FEndpoints E;
+		for (int c = 0; c < 3; ++c)
+		{
+			E.q[0][c] = QuantizeChannel(e0[c] - 15.0f, 1023, 1.0f / 31.0f);
+			E.q[1][c] = QuantizeChannel(e1[c] - 15.0f, 1023, 1.0f / 31.0f);
+		}
+		return E;
+	}
+	static void BuildPalette(const FEndpoints& E, FPalette& Palette)
+	{
+		Palette.NumEntries = 16;
+		for (int c = 0; c < 3; ++c)
+		{
+			const int v0 = Unquantize(E.q[0][c]);
+			const int v1 = Unquantize(E.q[1][c]);
+			for (int i = 0; i < 16; ++i)
+				Palette.c[c][i] = static_cast<float>(FinishUnquantize((v0 * (64 - BC_WEIGHTS_4BIT[i]) + v1 * BC_WEIGHTS_4BIT[i] + 32) >> 6));
+		}
+	}
+	static void Write(const FEncodeResult& Result, uint8_t* pOut)
+	{
+		FEndpoints E = Result.Endpoints;
+		uint8_t Indices[16];
+		memcpy(Indices, Result.Indices, sizeof(Indices));
+		if (Indices[0] & 8)
+		{
+			std::swap(E.q[0], E.q[1]);
+			for (uint8_t& i : Indices)
+				i = 15 - i;
+		}
+		FBitWriter Writer;
+		Writer.Write(0x03, 5); // mode 11
+		for (int e = 0; e < 2; ++e)
+			for (int c = 0; c < 3; ++c)
+				Writer.Write(E.q[e][c], 10);
+		WriteIndices4Bit(Writer, Indices);
+		Writer.Store(pOut);
+	}
+};
+
+template<class TFormat>
+static void EncodeBlock(const FBlock& Block, EBlockCompressionQuality Quality, uint8_t* pOut)
+{
+	TFormat::Write(EncodeEndpoints<TFormat>(Block, Quality), pOut);
+}
+
+static void EncodeBlock(EBlockCompressionFormat Format, EBlockCompressionQuality Quality, const FBlock& Block, uint8_t* pOut)
+{
+	switch (Format)
+	{
+	case BC_FORMAT_BC1 : EncodeBlock<FFormatBC1>    (Block, Quality, pOut); break;
+	case BC_FORMAT_BC3 : EncodeBlock<FFormatBC4<3>> (Block, Quality, pOut); EncodeBlock<FFormatBC1>(Block, Quality, pOut + 8); break;
+	case BC_FORMAT_BC4 : EncodeBlock<FFormatBC4<0>> (Block, Quality, pOut); break;
+	case BC_FORMAT_BC5 : EncodeBlock<FFormatBC4<0>> (Block, Quality, pOut); EncodeBlock<FFormatBC4<1>>(Block, Quality, pOut + 8); break;
+	case BC_FORMAT_BC6H: EncodeBlock<FFormatBC6H>   (Block, Quality, pOut); break;
+	case BC_FORMAT_BC7 : EncodeBlock<FFormatBC7>    (Block, Quality, pOut); break;
+	default: assert(false);
+	}
+}
+
+//
+// Decoders
+//
+static void DecodeBlockBC1(const uint8_t* pIn, uint8_t Out[16][4], bool bAlwaysFourColors)
+{
+	uint16_t c0, c1;
+	uint32_t IndexBits;
+	memcpy(&c0, pIn + 0, 2);
+	memcpy(&c1, pIn + 2, 2);
+	memcpy(&IndexBits, pIn + 4, 4);
+
+	const int q0[3] = { c0 >> 11, (c0 >> 5) & 63, c0 & 31 };
+	const int q1[3] = { c1 >> 11, (c1 >> 5) & 63, c1 & 31 };
+	uint8_t Palette[4][4];
+	for (int c = 0; c < 3; ++c)
+	{
+		const int v0 = FFormatBC1::Expand(q0[c], c);
+		const int v1 = FFormatBC1::Expand(q1[c], c);
+		Palette[0][c] = static_cast<uint8_t>(v0);
+		Palette[1][c] = static_cast<uint8_t>(v1);
+		if (c0 > c1 || bAlwaysFourColors)
+		{
+			Palette[2][c] = static_cast<uint8_t>((2 * v0 + v1 + 1) / 3);
+			Palette[3][c] = static_cast<uint8_t>((v0 + 2 * v1 + 1) / 3);
+		}
+		else
+		{
+			Palette[2][c] = static_cast<uint8_t>((v0 + v1 + 1) / 2);
+			Palette[3][c] = 0;
+		}
+	}
+	Palette[0][3] = Palette[1][3] = Palette[2][3] = 255;
+	Palette[3][3] = (c0 > c1 || bAlwaysFourColors) ? 255 : 0;
+	for (int i = 0; i < 16; ++i)
+		memcpy(Out[i], Palette[(IndexBits >> (2 * i)) & 3], 4);
+}
+
+static void DecodeBlockBC4(const uint8_t* pIn, uint8_t Out[16][4], int Channel)
+{
+	const int a0 = pIn[0];
+	const int a1 = pIn[1];
+	uint64_t IndexBits = 0;
+	memcpy(&IndexBits, pIn + 2, 6);
+
+	int Palette[8] = { a0, a1 };
+	if (a0 > a1)
+	{
+		for (int i = 2; i < 8; ++i)
+			Palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+	}
+	else
+	{
+		for (int i = 2; i < 6; ++i)
+			Palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+		Palette[6] = 0;
+		Palette[7] = 255;
+	}
+	for (int i = 0; i < 16; ++i)
+		Out[i][Channel] = static_cast<uint8_t>(Palette[(IndexBits >> (3 * i)) & 7]);
+}
+
+static bool DecodeBlockBC7(const uint8_t* pIn, uint8_t Out[16][4])
+{
+	FBitReader Reader(pIn);
+	if (Reader.Read(7) != (1 << 6))
+		return false; // not mode 6
+
+	int v[2][4];
+	for (int c = 0; c < 4; ++c)
+	{
+		v[0][c] = Reader.Read(7) << 1;
+		v[1][c] = Reader.Read(7) << 1;
+	}
+	const int p0 = Reader.Read(1);
+	const int p1 = Reader.Read(1);
+	for (int c = 0; c < 4; ++c)
+	{
+		v[0][c] |= p0;
+		v[1][c] |= p1;
+	}
+	for (int i = 0; i < 16; ++i)
+	{
+		const int w = BC_WEIGHTS_4BIT[Reader.Read(i == 0 ? 3 : 4)];
+		for (int c = 0; c < 4; ++c)
+			Out[i][c] = static_cast<uint8_t>((v[0][c] * (64 - w) + v[1][c] * w + 32) >> 6);
+	}
+	return true;
+}
+
+static bool DecodeBlockBC6H(const uint8_t* pIn, float Out[16][4])
+{
+	FBitReader Reader(pIn);
+	if (Reader.Read(5) != 0x03)
+		return false; // not mode 11
+
+	int v[2][3];
+	for (int e = 0; e < 2; ++e)
+		for (int c = 0; c < 3; ++c)
+			v[e][c] = FFormatBC6H::Unquantize(Reader.Read(10));
+	for (int i = 0; i < 16; ++i)
+	{
+		const int w = BC_WEIGHTS_4BIT[Reader.Read(i == 0 ? 3 : 4)];
+		for (int c = 0; c < 3; ++c)
+			Out[i][c] = HalfBitsToFloat(static_cast<uint16_t>(FFormatBC6H::FinishUnquantize((v[0][c] * (64 - w) + v[1][c] * w + 32) >> 6)));
+		Out[i][3] = 1.0f;
+	}
+	return true;
+}
+
+//
+// Interface
+//
+namespace BlockCompression
+{
+	size_t GetBlockSizeInBytes(EBlockCompressionFormat Format)
+	{
+		return (Format == BC_FORMAT_BC1 || Format == BC_FORMAT_BC4) ? 8 : 16;
+	}
+
+	const char* GetFormatName(EBlockCompressionFormat Format)
+	{
+		static const char* FORMAT_NAMES[NUM_BC_FORMATS] = { "BC1", "BC3", "BC4", "BC5", "BC6H", "BC7" };
+		return Format < NUM_BC_FORMATS ? FORMAT_NAMES[Format] : "Unknown";
+	}
+
+	const char* GetQualityName(EBlockCompressionQuality Quality)
+	{
+		static const char* QUALITY_NAMES[NUM_BC_QUALITIES] = { "Fast", "Normal", "High" };
+		return Quality < NUM_BC_QUALITIES ? QUALITY_NAMES[Quality] : "Unknown";
+	}
+
+	static FCompressedTexture Compress(const std::vector<FSourceLevel>& Sources, const FBlockCompressionDesc& Desc, ThreadPool* pWorkers)
+	{
+		FCompressedTexture Texture;
+		Texture.Format = Desc.Format;
+
+		const size_t BlockSize = GetBlockSizeInBytes(Desc.Format);
+		std::vector<std::pair<int, int>> BlockRows; // (level, row of blocks): the work items of all the levels
+		size_t SizeInBytes = 0;
+		for (int iMip = 0; iMip < static_cast<int>(Sources.size()); ++iMip)
+		{
+			FMipLevel Level;
+			Level.Width    = Sources[iMip].Width;
+			Level.Height   = Sources[iMip].Height;
+			Level.RowPitch = ((Level.Width + 3) / 4) * BlockSize;
+			Level.Offset   = SizeInBytes;
+			const int NumBlockRows = (Level.Height + 3) / 4;
+			SizeInBytes += Level.RowPitch * NumBlockRows;
+			Texture.Levels.push_back(Level);
+			for (int by = 0; by < NumBlockRows; ++by)
+				BlockRows.emplace_back(iMip, by);
+		}
+		Texture.pData.reset(new uint8_t[SizeInBytes]);
+		Texture.SizeInBytes = SizeInBytes;
+
+		auto fnEncodeBlockRow = [&](size_t iItem)
+		{
+			const int iMip = BlockRows[iItem].first;
+			const int by   = BlockRows[iItem].second;
+			const FSourceLevel& Src = Sources[iMip];
+			uint8_t* pOut = Texture.pData.get() + Texture.Levels[iMip].Offset + by * Texture.Levels[iMip].RowPitch;
+			const int NumBlocksX = (Src.Width + 3) / 4;
+			FBlock Block;
+			for (int bx = 0; bx < NumBlocksX; ++bx, pOut += BlockSize)
+			{
+				LoadBlock(Src, bx, by, Desc.Format == BC_FORMAT_BC6H, Block);
+				EncodeBlock(Desc.Format, Desc.Quality, Block, pOut);
+			}
+		};
+		if (pWorkers)
+			pWorkers->ParallelFor(0, BlockRows.size(), fnEncodeBlockRow);
+		else
+			for (size_t i = 0; i < BlockRows.size(); ++i)
+				fnEncodeBlockRow(i);
+
+		return Texture;
+	}
+
+	FCompressedTexture Compress(const Image& img, const FBlockCompressionDesc& Desc, ThreadPool* pWorkers)
+	{
+		if (!img.IsValid() || Desc.Format >= NUM_BC_FORMATS)
+		{
+			Log::Error("BlockCompression::Compress(): invalid image or format");
+			return FCompressedTexture{};
+		}
+		const std::vector<FSourceLevel> Sources = { FSourceLevel{ img.pData, img.Width, img.Height, img.IsHDR() } };
+		return Compress(Sources, Desc, pWorkers);
+	}
+
+	FCompressedTexture Compress(const FMipChain& Chain, const FBlockCompressionDesc& Desc, ThreadPool* pWorkers)
+	{
+		if (!Chain.IsValid() || Desc.Format >= NUM_BC_FORMATS || Chain.BytesPerPixel == 8)
+		{
+			Log::Error("BlockCompression::Compress(): invalid mip chain or format (RGBA16F chains aren't supported)");
+			return FCompressedTexture{};
+		}
+		std::vector<FSourceLevel> Sources;
+		for (size_t iMip = 0; iMip < Chain.Levels.size(); ++iMip)
+			Sources.push_back(FSourceLevel{ Chain.GetLevelData(iMip), Chain.Levels[iMip].Width, Chain.Levels[iMip].Height, Chain.BytesPerPixel == 16 });
+		return Compress(Sources, Desc, pWorkers);
+	}
+
+	Image Decompress(const FCompressedTexture& Texture, size_t iMip)
+	{
+		if (!Texture.IsValid() || iMip >= Texture.Levels.size())
+			return Image{};
+
+		const FMipLevel& Level = Texture.Levels[iMip];
+		const bool bFloat = Texture.Format == BC_FORMAT_BC6H;
+		const int BytesPerPixel = bFloat ? 16 : 4;
+		Image img = Image::CreateEmptyImage(static_cast<size_t>(Level.Width) * Level.Height * BytesPerPixel);
+		img.Width = Level.Width;
+		img.Height = Level.Height;
+		img.BytesPerPixel = BytesPerPixel;
+
+		const size_t BlockSize = GetBlockSizeInBytes(Texture.Format);
+		const uint8_t* pLevel = static_cast<const uint8_t*>(Texture.GetLevelData(iMip));
+		size_t NumUnsupportedBlocks = 0;
+		for (int by = 0; by < (Level.Height + 3) / 4; ++by)
+		for (int bx = 0; bx < (Level.Width  + 3) / 4; ++bx)
+		{
+			const uint8_t* pBlock = pLevel + by * Level.RowPitch + bx * BlockSize;
+			uint8_t Pixels[16][4] = {};
+			float   PixelsFloat[16][4] = {};
+			bool bDecoded = true;
+			switch (Texture.Format)
+			{
+			case BC_FORMAT_BC1 : DecodeBlockBC1(pBlock, Pixels, false); break;
+			case BC_FORMAT_BC3 : DecodeBlockBC1(pBlock + 8, Pixels, true); DecodeBlockBC4(pBlock, Pixels, 3); break;
+			case BC_FORMAT_BC4 : DecodeBlockBC4(pBlock, Pixels, 0); for (auto& p : Pixels) { p[3] = 255; } break;
+			case BC_FORMAT_BC5 : DecodeBlockBC4(pBlock, Pixels, 0); DecodeBlockBC4(pBlock + 8, Pixels, 1); for (auto& p : Pixels) { p[3] = 255; } break;
+			case BC_FORMAT_BC6H: bDecoded = DecodeBlockBC6H(pBlock, PixelsFloat); break;
+			case BC_FORMAT_BC7 : bDecoded = DecodeBlockBC7(pBlock, Pixels); break;
+			default: bDecoded = false; break;
+			}
+			if (!bDecoded)
+			{
+				++NumUnsupportedBlocks;
+				for (int i = 0; i < 16; ++i)
+				{
+					Pixels[i][0] = Pixels[i][2] = Pixels[i][3] = 255;
+					PixelsFloat[i][0] = PixelsFloat[i][2] = PixelsFloat[i][3] = 1.0f;
+				}
+			}
+
+			for (int i = 0; i < 16; ++i)
+			{
+				const int x = bx * 4 + (i & 3);
+				const int y = by * 4 + (i >> 2);
+				if (x >= Level.Width || y >= Level.Height)
+					continue;
+				uint8_t* pDst = static_cast<uint8_t*>(img.pData) + (static_cast<size_t>(y) * Level.Width + x) * BytesPerPixel;
+				if (bFloat) memcpy(pDst, PixelsFloat[i], 16);
+				else        memcpy(pDst, Pixels[i], 4);
+			}
+		}
+		if (NumUnsupportedBlocks > 0)
+			Log::Warning("BlockCompression::Decompress(): %zu %s blocks use modes that aren't supported by the decoder", NumUnsupportedBlocks, GetFormatName(Texture.Format));
+		return img;
+	}
+}
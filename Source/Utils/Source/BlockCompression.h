@@ -0,0 +1,75 @@
+#pragma once
+
+#include "MipChain.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct Image;
+class ThreadPool;
+
+enum EBlockCompressionFormat
+{
+	BC_FORMAT_BC1 = 0, // RGB , 4 bpp: RGB565 endpoints, 2-bit indices (opaque: always the 4-color mode)
+	BC_FORMAT_BC3,     // RGBA, 8 bpp: BC1 color + BC4 alpha
+	BC_FORMAT_BC4,     // R   , 4 bpp: 8-bit endpoints, 3-bit indices
+	BC_FORMAT_BC5,     // RG  , 8 bpp: 2x BC4, for normal maps
+	BC_FORMAT_BC6H,    // RGB half float (unsigned), 8 bpp: mode 11 (single subset, 10-bit endpoints, 4-bit indices)
+	BC_FORMAT_BC7,     // RGBA, 8 bpp: mode 6 (single subset, RGBA 7777 + p-bit endpoints, 4-bit indices)
+
+	NUM_BC_FORMATS
+};
+
+enum EBlockCompressionQuality
+{
+	BC_QUALITY_FAST = 0, // endpoints at the extents of the block's principal axis
+	BC_QUALITY_NORMAL,   // + least squares refinement of the endpoints from the selected indices
+	BC_QUALITY_HIGH,     // + more refinement iterations and a greedy search around the quantized endpoints
+
+	NUM_BC_QUALITIES
+};
+
+struct FBlockCompressionDesc
+{
+	EBlockCompressionFormat  Format = BC_FORMAT_BC7;
+	EBlockCompressionQuality Quality = BC_QUALITY_NORMAL;
+};
+
+//
+// Block compressed mip levels in one contiguous buffer, mip 0 first: the 4x4 blocks of each
+// level are stored row by row, tightly packed (FMipLevel::RowPitch is the size of a row of blocks).
+// This is the layout Texture::Create() expects, the blocks can be uploaded as they are.
+//
+struct FCompressedTexture
+{
+	EBlockCompressionFormat    Format = NUM_BC_FORMATS;
+	std::vector<FMipLevel>     Levels; // Width & Height in pixels
+	std::unique_ptr<uint8_t[]> pData;
+	size_t                     SizeInBytes = 0;
+
+	inline bool IsValid() const { return !Levels.empty(); }
+	inline       void* GetLevelData(size_t iMip)       { return pData.get() + Levels[iMip].Offset; }
+	inline const void* GetLevelData(size_t iMip) const { return pData.get() + Levels[iMip].Offset; }
+};
+
+//
+// CPU block compression encoders. The blocks are encoded with SSE4.1 kernels, the rows of blocks
+// of all the levels are distributed across @pWorkers if provided.
+// Sources are RGBA8 or RGBA32F images: the LDR formats quantize float data to 8 bits, BC6H
+// encodes 8-bit data as [0, 1] floats. Edge blocks of sizes that aren't a multiple of 4 replicate
+// the last row/column.
+//
+namespace BlockCompression
+{
+	size_t      GetBlockSizeInBytes(EBlockCompressionFormat Format); // 8: BC1 & BC4, 16: the others
+	const char* GetFormatName(EBlockCompressionFormat Format);
+	const char* GetQualityName(EBlockCompressionQuality Quality);
+
+	FCompressedTexture Compress(const Image& img, const FBlockCompressionDesc& Desc, ThreadPool* pWorkers = nullptr);
+	FCompressedTexture Compress(const FMipChain& Chain, const FBlockCompressionDesc& Desc, ThreadPool* pWorkers = nullptr);
+
+	// Decodes a level into an RGBA8 image (RGBA32F for BC6H), which must be Destroy()ed. For validating the
+	// encoders: BC7 & BC6H only decode the modes the encoders produce, other blocks come out magenta.
+	Image Decompress(const FCompressedTexture& Texture, size_t iMip = 0);
+}
@@ -0,0 +1,278 @@
+#include "CPUTopology.h"
+#include "Multithreading.h"
+
+#include <algorithm>
+#include <map>
+#include <thread>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <intrin.h> // __cpuidex
+#else
+#include <fstream>
+#include <string>
+#include <cpuid.h>
+#endif
+
+namespace SystemInfo
+{
+
+// CPUID.(EAX=07H, ECX=0):EDX[15] : processor is a hybrid part (P-cores + E-cores)
+static bool IsHybridCPU()
+{
+#if defined(_WIN32)
+	int cpui[4] = {};
+	__cpuid(cpui, 0);
+	if (cpui[0] < 7)
+		return false;
+	__cpuidex(cpui, 7, 0);
+	return (cpui[3] & (1 << 15)) != 0;
+#elif defined(__x86_64__) || defined(__i386__)
+	unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return false;
+	return (edx & (1u << 15)) != 0;
+#else
+	return false;
+#endif
+}
+
+#if defined(_WIN32)
+static void AppendLogicalProcessors(const GROUP_AFFINITY& GroupMask, std::vector<uint32_t>& LogicalProcessors)
+{
+	for (uint32_t Bit = 0; Bit < 64; ++Bit)
+		if (GroupMask.Mask & (KAFFINITY(1) << Bit))
+			LogicalProcessors.push_back(GroupMask.Group * 64u + Bit);
+}
+static bool IsInGroupMask(uint32_t LogicalProcessor, const GROUP_AFFINITY& GroupMask)
+{
+	return GroupMask.Group == LogicalProcessor / 64 && (GroupMask.Mask & (KAFFINITY(1) << (LogicalProcessor % 64))) != 0;
+}
+
+// https://docs.microsoft.com/en-us/windows/win32/api/sysinfoapi/nf-sysinfoapi-getlogicalprocessorinformationex
+static bool QueryTopologyFromOS(FCPUTopology& t)
+{
+	DWORD len = 0;
+	GetLogicalProcessorInformationEx(RelationAll, nullptr, &len);
+	if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+		return false;
+
+	std::vector<char> buffer(len);
+	if (!GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer.data(), &len))
+		return false;
+
+	std::vector<GROUP_AFFINITY> L3Masks;
+	std::vector<std::pair<DWORD, GROUP_AFFINITY>> NUMANodeMasks;
+	for (char* ptr = buffer.data(); ptr < buffer.data() + len; )
+	{
+		PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX pi = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)ptr;
+		switch (pi->Relationship)
+		{
+		case RelationProcessorCore:
+		{
+			FCPUTopology::FCore Core;
+			Core.EfficiencyClass = pi->Processor.EfficiencyClass;
+			for (WORD g = 0; g < pi->Processor.GroupCount; ++g)
+				AppendLogicalProcessors(pi->Processor.GroupMask[g], Core.LogicalProcessors);
+			t.Cores.push_back(std::move(Core));
+		} break;
+		case RelationCache:
+			if (pi->Cache.Level == 3)
+				L3Masks.push_back(pi->Cache.GroupMask);
+			break;
+		case RelationNumaNode:
+			NUMANodeMasks.push_back({ pi->NumaNode.NodeNumber, pi->NumaNode.GroupMask });
+			break;
+		}
+		ptr += pi->Size;
+	}
+
+	for (FCPUTopology::FCore& Core : t.Cores)
+	{
+		const uint32_t FirstLP = Core.LogicalProcessors.front();
+		for (size_t iL3 = 0; iL3 < L3Masks.size(); ++iL3)
+			if (IsInGroupMask(FirstLP, L3Masks[iL3]))
+				Core.L3Group = static_cast<uint32_t>(iL3);
+		for (const auto& Node : NUMANodeMasks)
+			if (IsInGroupMask(FirstLP, Node.second))
+				Core.NUMANode = Node.first;
+	}
+	t.NumL3Groups  = static_cast<uint32_t>(std::max<size_t>(1, L3Masks.size()));
+	t.NumNUMANodes = static_cast<uint32_t>(std::max<size_t>(1, NUMANodeMasks.size()));
+	return !t.Cores.empty();
+}
+
+#else // Linux
+
+static bool ReadFirstLine(const std::string& Path, std::string& Line)
+{
+	std::ifstream File(Path);
+	return File.is_open() && std::getline(File, Line) && !Line.empty();
+}
+
+// parses the kernel's cpu list format: "0-3,8,10-11"
+static std::vector<uint32_t> ParseCPUList(const std::string& List)
+{
+	std::vector<uint32_t> CPUs;
+	size_t Pos = 0;
+	while (Pos < List.size())
+	{
+		size_t End = List.find(',', Pos);
+		if (End == std::string::npos)
+			End = List.size();
+
+		const std::string Range = List.substr(Pos, End - Pos);
+		const size_t Dash = Range.find('-');
+		const uint32_t First = static_cast<uint32_t>(std::stoul(Range.substr(0, Dash)));
+		const uint32_t Last  = Dash == std::string::npos ? First : static_cast<uint32_t>(std::stoul(Range.substr(Dash + 1)));
+		for (uint32_t CPU = First; CPU <= Last; ++CPU)
+			CPUs.push_back(CPU);
+
+		Pos = End + 1;
+	}
+	return CPUs;
+}
+
+// https://www.kernel.org/doc/html/latest/admin-guide/cputopology.html
+static bool QueryTopologyFromOS(FCPUTopology& t)
+{
+	const std::string CPU_DIR = "/sys/devices/system/cpu/";
+	std::string Line;
+	if (!ReadFirstLine(CPU_DIR + "online", Line))
+		return false;
+	const std::vector<uint32_t> OnlineCPUs = ParseCPUList(Line);
+
+	// hybrid parts list their performance cores under the cpu_core PMU
+	std::vector<uint32_t> PerformanceCPUs;
+	if (ReadFirstLine("/sys/devices/cpu_core/cpus", Line))
+		PerformanceCPUs = ParseCPUList(Line);
+
+	std::map<std::pair<int, int>, size_t> CoreLookup; // (package, core_id) -> index into t.Cores
+	std::map<uint32_t, uint32_t>          L3Lookup;   // first cpu sharing the L3 -> L3Group
+	std::map<uint32_t, uint32_t>          NodeLookup; // cpu -> NUMA node
+	for (uint32_t Node = 0; ReadFirstLine("/sys/devices/system/node/node" + std::to_string(Node) + "/cpulist", Line); ++Node)
+		for (uint32_t CPU : ParseCPUList(Line))
+			NodeLookup[CPU] = Node;
+
+	for (uint32_t CPU : OnlineCPUs)
+	{
+		const std::string Dir = CPU_DIR + "cpu" + std::to_string(CPU) + "/";
+		int Package = 0, CoreID = static_cast<int>(CPU);
+		if (ReadFirstLine(Dir + "topology/physical_package_id", Line)) Package = std::stoi(Line);
+		if (ReadFirstLine(Dir + "topology/core_id", Line))             CoreID  = std::stoi(Line);
+
+		auto it = CoreLookup.find({ Package, CoreID });
+		if (it == CoreLookup.end())
+		{
+			FCPUTopology::FCore Core;
+			Core.NUMANode = NodeLookup.count(CPU) ? NodeLookup[CPU] : 0;
+			Core.EfficiencyClass = std::find(PerformanceCPUs.begin(), PerformanceCPUs.end(), CPU) != PerformanceCPUs.end() ? 1 : 0;
+
+			// find the L3 among the cache/indexN entries
+			for (int iCache = 0; ReadFirstLine(Dir + "cache/index" + std::to_string(iCache) + "/level", Line); ++iCache)
+			{
+				if (Line != "3" || !ReadFirstLine(Dir + "cache/index" + std::to_string(iCache) + "/shared_cpu_list", Line))
+					continue;
+				const uint32_t FirstCPU = ParseCPUList(Line).front();
+				auto itL3 = L3Lookup.find(FirstCPU);
+				Core.L3Group = itL3 != L3Lookup.end() ? itL3->second : (L3Lookup[FirstCPU] = static_cast<uint32_t>(L3Lookup.size()));
+			}
+
+			it = CoreLookup.emplace(std::make_pair(Package, CoreID), t.Cores.size()).first;
+			t.Cores.push_back(std::move(Core));
+		}
+		t.Cores[it->second].LogicalProcessors.push_back(CPU);
+	}
+
+	uint32_t MaxNode = 0;
+	for (const auto& Node : NodeLookup)
+		MaxNode = std::max(MaxNode, Node.second);
+	t.NumL3Groups  = static_cast<uint32_t>(std::max<size_t>(1, L3Lookup.size()));
+	t.NumNUMANodes = MaxNode + 1;
+	return !t.Cores.empty();
+}
+#endif
+
+FCPUTopology GetCPUTopology()
+{
+	FCPUTopology t;
+	if (!QueryTopologyFromOS(t))
+	{
+		t = FCPUTopology();
+		const uint32_t NumHWThreads = std::max(1u, std::thread::hardware_concurrency());
+		for (uint32_t i = 0; i < NumHWThreads; ++i)
+		{
+			FCPUTopology::FCore Core;
+			Core.LogicalProcessors.push_back(i);
+			t.Cores.push_back(std::move(Core));
+		}
+		t.NumL3Groups  = 1;
+		t.NumNUMANodes = 1;
+	}
+	else
+	{
+		t.bQueriedFromOS = true;
+	}
+	t.bHybrid = IsHybridCPU();
+
+	for (const FCPUTopology::FCore& Core : t.Cores)
+		t.NumLogicalProcessors += static_cast<uint32_t>(Core.LogicalProcessors.size());
+	return t;
+}
+
+std::vector<uint32_t> FCPUTopology::GetCoresByPreference() const
+{
+	std::vector<uint32_t> CoreIndices(Cores.size());
+	for (uint32_t i = 0; i < CoreIndices.size(); ++i)
+		CoreIndices[i] = i;
+
+	std::stable_sort(CoreIndices.begin(), CoreIndices.end(), [this](uint32_t i0, uint32_t i1)
+	{
+		const FCore& c0 = Cores[i0];
+		const FCore& c1 = Cores[i1];
+		if (c0.EfficiencyClass != c1.EfficiencyClass) return c0.EfficiencyClass > c1.EfficiencyClass;
+		if (c0.NUMANode        != c1.NUMANode       ) return c0.NUMANode        < c1.NUMANode;
+		return c0.L3Group < c1.L3Group;
+	});
+	return CoreIndices;
+}
+
+std::vector<FThreadAffinity> GetWorkerAffinities(const FCPUTopology& Topology, const std::vector<uint32_t>& CoreIndices, EThreadAffinityPolicy Policy)
+{
+	std::vector<FThreadAffinity> Affinities(CoreIndices.size());
+	for (size_t iWorker = 0; iWorker < CoreIndices.size(); ++iWorker)
+	{
+		const FCPUTopology::FCore& WorkerCore = Topology.Cores[CoreIndices[iWorker]];
+		std::vector<uint32_t>& LogicalProcessors = Affinities[iWorker].LogicalProcessors;
+		switch (Policy)
+		{
+		case EThreadAffinityPolicy::PHYSICAL_CORE:
+			LogicalProcessors = WorkerCore.LogicalProcessors;
+			break;
+		case EThreadAffinityPolicy::L3_GROUP:
+			for (uint32_t iCore : CoreIndices)
+			{
+				const FCPUTopology::FCore& Core = Topology.Cores[iCore];
+				if (Core.L3Group == WorkerCore.L3Group && Core.NUMANode == WorkerCore.NUMANode)
+					LogicalProcessors.insert(LogicalProcessors.end(), Core.LogicalProcessors.begin(), Core.LogicalProcessors.end());
+			}
+			break;
+		default: // NO_AFFINITY
+			break;
+		}
+	}
+	return Affinities;
+}
+
+const char* GetThreadAffinityPolicyName(EThreadAffinityPolicy Policy)
+{
+	switch (Policy)
+	{
+	case EThreadAffinityPolicy::NO_AFFINITY  : return "NO_AFFINITY";
+	case EThreadAffinityPolicy::PHYSICAL_CORE: return "PHYSICAL_CORE";
+	case EThreadAffinityPolicy::L3_GROUP     : return "L3_GROUP";
+	default                                  : return "UNKNOWN";
+	}
+}
+
+} // namespace SystemInfo
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+struct FThreadAffinity;
+
+namespace SystemInfo
+{
+	//
+	// Physical layout of the logical processors, used for placing threads.
+	// Logical processor indices follow the OS numbering: (ProcessorGroup * 64 + Number) on Windows,
+	// the cpu index of /sys/devices/system/cpu/cpuN on Linux.
+	//
+	struct FCPUTopology
+	{
+		struct FCore
+		{
+			std::vector<uint32_t> LogicalProcessors; // SMT siblings of the core
+			uint32_t              L3Group         = 0; // cores with the same L3Group share an L3 cache
+			uint32_t              NUMANode        = 0;
+			uint32_t              EfficiencyClass = 0; // higher is faster, only differs between cores on hybrid CPUs
+		};
+
+		std::vector<FCore> Cores;
+		uint32_t           NumLogicalProcessors = 0;
+		uint32_t           NumL3Groups          = 0;
+		uint32_t           NumNUMANodes         = 0;
+		bool               bHybrid              = false; // CPUID: performance & efficiency cores
+		bool               bQueriedFromOS       = false; // false: fallback topology, one core per hardware thread
+
+		inline size_t GetNumCores() const { return Cores.size(); }
+
+		// Returns the core indices ordered by preference for placing threads: fastest cores first,
+		// then grouped by NUMA node & L3 so that consecutive ranges of cores share caches.
+		std::vector<uint32_t> GetCoresByPreference() const;
+	};
+
+	// Queries GetLogicalProcessorInformationEx() on Windows, /sys/devices/system/cpu on Linux and CPUID.
+	// Relatively expensive, don't call in a busy loop.
+	FCPUTopology GetCPUTopology();
+
+	enum EThreadAffinityPolicy
+	{
+		NO_AFFINITY = 0, // let the OS scheduler place the threads
+		PHYSICAL_CORE,   // one worker per core, pinned to the SMT siblings of its core
+		L3_GROUP,        // workers may run on any of the given cores that share the L3 cache of their own core
+
+		NUM_THREAD_AFFINITY_POLICIES
+	};
+
+	// Returns the affinity of each worker of a thread pool running on @CoreIndices (one worker per core).
+	std::vector<FThreadAffinity> GetWorkerAffinities(const FCPUTopology& Topology, const std::vector<uint32_t>& CoreIndices, EThreadAffinityPolicy Policy);
+
+	const char* GetThreadAffinityPolicyName(EThreadAffinityPolicy Policy);
+}
@@ -0,0 +1,214 @@
+#include "CookedTexture.h"
+#include "BlockCompression.h"
+#include "MipChain.h"
+#include "Log.h"
+#include "utils.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using namespace CookedTexture;
+
+static inline uint64_t AlignUp(uint64_t Value, uint64_t Alignment) { return (Value + Alignment - 1) & ~(Alignment - 1); }
+
+static ECookedTextureFormat ToCookedFormat(EBlockCompressionFormat Format)
+{
+	switch (Format)
+	{
+	case BC_FORMAT_BC1 : return COOKED_FORMAT_BC1;
+	case BC_FORMAT_BC3 : return COOKED_FORMAT_BC3;
+	case BC_FORMAT_BC4 : return COOKED_FORMAT_BC4;
+	case BC_FORMAT_BC5 : return COOKED_FORMAT_BC5;
+	case BC_FORMAT_BC6H: return COOKED_FORMAT_BC6H;
+	case BC_FORMAT_BC7 : return COOKED_FORMAT_BC7;
+	default            : assert(false); return NUM_COOKED_FORMATS;
+	}
+}
+
+// fills the mip table the way GetCopyableFootprints() places the subresources, returns the payload size
+static uint64_t CalculateLayout(const std::vector<FMipLevel>& Levels, uint32_t BytesPerElement, bool bBlockCompressed, std::vector<FMipDesc>& OutMips)
+{
+	uint64_t Offset = 0;
+	uint64_t DataSize = 0;
+	OutMips.resize(Levels.size());
+	for (size_t i = 0; i < Levels.size(); ++i)
+	{
+		FMipDesc& Mip = OutMips[i];
+		const uint32_t NumColumns = bBlockCompressed ? (Levels[i].Width + 3) / 4 : Levels[i].Width;
+		Mip.Width          = static_cast<uint32_t>(Levels[i].Width);
+		Mip.Height         = static_cast<uint32_t>(Levels[i].Height);
+		Mip.NumRows        = bBlockCompressed ? (Levels[i].Height + 3) / 4 : Levels[i].Height;
+		Mip.RowSizeInBytes = NumColumns * BytesPerElement;
+		Mip.RowPitch       = AlignUp(Mip.RowSizeInBytes, PITCH_ALIGNMENT);
+		Mip.Offset         = AlignUp(Offset, PLACEMENT_ALIGNMENT);
+
+		// the last row isn't padded to the pitch
+		DataSize = Mip.Offset + Mip.RowPitch * (Mip.NumRows - 1) + Mip.RowSizeInBytes;
+		Offset = DataSize;
+	}
+	return DataSize;
+}
+
+static bool WriteFile(const std::string& FilePath, ECookedTextureFormat Format, const std::vector<FMipLevel>& Levels, const uint8_t* pLevelData, uint32_t BytesPerElement, uint32_t CookSettings)
+{
+	const bool bBlockCompressed = Format != COOKED_FORMAT_RGBA8 && Format != COOKED_FORMAT_RGBA16F;
+
+	std::vector<FMipDesc> Mips;
+	FFileHeader Header = {};
+	Header.Magic        = FILE_MAGIC;
+	Header.Version      = FILE_VERSION;
+	Header.Format       = Format;
+	Header.Width        = static_cast<uint32_t>(Levels[0].Width);
+	Header.Height       = static_cast<uint32_t>(Levels[0].Height);
+	Header.NumMips      = static_cast<uint32_t>(Levels.size());
+	Header.CookSettings = CookSettings;
+	Header.DataOffset   = AlignUp(sizeof(FFileHeader) + sizeof(FMipDesc) * Levels.size(), DATA_ALIGNMENT);
+	Header.DataSize     = CalculateLayout(Levels, BytesPerElement, bBlockCompressed, Mips);
+
+	DirectoryUtil::CreateFolderIfItDoesntExist(DirectoryUtil::GetFolderPath(FilePath));
+
+	// the padding between the rows & the subresources is written as zeroes: the payload is assembled
+	// in memory and written with a single call
+	std::unique_ptr<uint8_t[]> pFile(new uint8_t[Header.DataOffset + Header.DataSize]());
+	memcpy(pFile.get(), &Header, sizeof(Header));
+	memcpy(pFile.get() + sizeof(Header), Mips.data(), sizeof(FMipDesc) * Mips.size());
+	for (size_t i = 0; i < Mips.size(); ++i)
+	{
+		const uint8_t* pSrc = pLevelData + Levels[i].Offset;
+		uint8_t* pDst = pFile.get() + Header.DataOffset + Mips[i].Offset;
+		for (uint32_t Row = 0; Row < Mips[i].NumRows; ++Row)
+			memcpy(pDst + Row * Mips[i].RowPitch, pSrc + Row * Levels[i].RowPitch, Mips[i].RowSizeInBytes);
+	}
+
+	const std::string TempFilePath = FilePath + ".tmp";
+	{
+		std::ofstream File(TempFilePath, std::ios::binary | std::ios::trunc);
+		if (!File.is_open())
+		{
+			Log::Warning("CookedTexture: couldn't open %s for writing", TempFilePath.c_str());
+			return false;
+		}
+		File.write(reinterpret_cast<const char*>(pFile.get()), Header.DataOffset + Header.DataSize);
+		if (!File.good())
+		{
+			Log::Warning("CookedTexture: couldn't write %s", TempFilePath.c_str());
+			File.close();
+			std::remove(TempFilePath.c_str());
+			return false;
+		}
+	}
+
+	if (!MoveFileExA(TempFilePath.c_str(), FilePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		// another thread/process cooked the same texture and has it mapped
+		Log::Warning("CookedTexture: couldn't replace %s", FilePath.c_str());
+		std::remove(TempFilePath.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+namespace CookedTexture
+{
+	std::string GetCookedFilePath(const std::string& SourceFilePath)
+	{
+		return DirectoryUtil::GetFolderPath(SourceFilePath) + "Cooked/"
+			+ DirectoryUtil::GetFileNameWithoutExtension(SourceFilePath) + "." + FILE_EXTENSION;
+	}
+
+	bool IsUpToDate(const std::string& CookedFilePath, const std::string& SourceFilePath)
+	{
+		return DirectoryUtil::FileExists(CookedFilePath) && DirectoryUtil::IsFileNewer(CookedFilePath, SourceFilePath);
+	}
+
+	bool Write(const std::string& FilePath, const FMipChain& Chain, uint32_t CookSettings)
+	{
+		if (!Chain.IsValid() || (Chain.BytesPerPixel != 4 && Chain.BytesPerPixel != 8))
+		{
+			Log::Warning("CookedTexture::Write(): %s: only RGBA8 & RGBA16F mip chains can be cooked", FilePath.c_str());
+			return false;
+		}
+		const ECookedTextureFormat Format = Chain.BytesPerPixel == 8 ? COOKED_FORMAT_RGBA16F : COOKED_FORMAT_RGBA8;
+		return WriteFile(FilePath, Format, Chain.Levels, Chain.pData.get(), Chain.BytesPerPixel, CookSettings);
+	}
+
+	bool Write(const std::string& FilePath, const FCompressedTexture& Texture, uint32_t CookSettings)
+	{
+		if (!Texture.IsValid())
+			return false;
+		const uint32_t BlockSize = static_cast<uint32_t>(BlockCompression::GetBlockSizeInBytes(Texture.Format));
+		return WriteFile(FilePath, ToCookedFormat(Texture.Format), Texture.Levels, Texture.pData.get(), BlockSize, CookSettings);
+	}
+}
+
+
+bool CookedTextureFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	HANDLE hFile = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	mhFile = hFile;
+
+	LARGE_INTEGER FileSize = {};
+	GetFileSizeEx(hFile, &FileSize);
+	mFileSize = static_cast<size_t>(FileSize.QuadPart);
+	if (mFileSize < sizeof(FFileHeader))
+	{
+		Log::Warning("CookedTexture: %s is truncated", FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	mhMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mhMapping)
+		mpView = static_cast<const uint8_t*>(MapViewOfFile(mhMapping, FILE_MAP_READ, 0, 0, 0));
+	if (!mpView)
+	{
+		Log::Warning("CookedTexture: couldn't map %s", FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	// validate before anything dereferences the mip table or the payload
+	const FFileHeader& Header = GetHeader();
+	bool bValid = Header.Magic == FILE_MAGIC
+		&& Header.Version == FILE_VERSION
+		&& Header.Format < NUM_COOKED_FORMATS
+		&& Header.NumMips > 0 && Header.NumMips <= 16
+		&& Header.DataOffset >= sizeof(FFileHeader) + sizeof(FMipDesc) * Header.NumMips
+		&& Header.DataOffset + Header.DataSize <= mFileSize;
+	for (uint32_t i = 0; bValid && i < Header.NumMips; ++i)
+	{
+		const FMipDesc& Mip = GetMip(i);
+		bValid = Mip.NumRows > 0 && Mip.RowSizeInBytes <= Mip.RowPitch
+			&& Mip.Offset + Mip.RowPitch * (Mip.NumRows - 1) + Mip.RowSizeInBytes <= Header.DataSize;
+	}
+	if (!bValid)
+	{
+		Log::Warning("CookedTexture: %s is invalid or from another version", FilePath.c_str());
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void CookedTextureFile::Close()
+{
+	if (mpView)    UnmapViewOfFile(mpView);
+	if (mhMapping) CloseHandle(mhMapping);
+	if (mhFile)    CloseHandle(mhFile);
+	mpView = nullptr;
+	mhMapping = nullptr;
+	mhFile = nullptr;
+	mFileSize = 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct FMipChain;
+struct FCompressedTexture;
+
+enum ECookedTextureFormat : uint32_t
+{
+	COOKED_FORMAT_RGBA8 = 0, // sRGB encoded, uploaded as R8G8B8A8_UNORM like the decoded textures
+	COOKED_FORMAT_BC1,
+	COOKED_FORMAT_BC3,
+	COOKED_FORMAT_BC4,
+	COOKED_FORMAT_BC5,
+	COOKED_FORMAT_BC6H,
+	COOKED_FORMAT_BC7,
+	COOKED_FORMAT_RGBA16F, // HDR textures, see ConvertMipChainToHalf()
+
+	NUM_COOKED_FORMATS
+};
+
+//
+// Cooked texture container (.vqtex): a mip chain stored the way D3D12 places the subresources of
+// a 2D texture in an upload buffer, so loading one is a file mapping and a single memcpy into the
+// upload heap, no decoding:
+//
+//     FFileHeader | FMipDesc[NumMips] | padding | payload (at DataOffset, page aligned)
+//
+// Each mip starts at a PLACEMENT_ALIGNMENT offset from the payload and its rows are
+// PITCH_ALIGNMENT apart: the layout GetCopyableFootprints() returns for the texture at offset 0.
+//
+namespace CookedTexture
+{
+	constexpr uint32_t    FILE_MAGIC          = 0x58545156; // "VQTX"
+	constexpr uint32_t    FILE_VERSION        = 1;
+	constexpr const char* FILE_EXTENSION      = "vqtex";
+	constexpr uint64_t    PITCH_ALIGNMENT     = 256;  // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	constexpr uint64_t    PLACEMENT_ALIGNMENT = 512;  // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+	constexpr uint64_t    DATA_ALIGNMENT      = 4096; // payload offset in the file
+
+	struct FFileHeader
+	{
+		uint32_t             Magic;
+		uint32_t             Version;
+		ECookedTextureFormat Format;
+		uint32_t             Width;
+		uint32_t             Height;
+		uint32_t             NumMips;
+		uint32_t             CookSettings; // opaque to the container: the cooker's settings, a mismatch means the file is stale
+		uint32_t             Padding;
+		uint64_t             DataOffset;   // from the beginning of the file
+		uint64_t             DataSize;
+	};
+
+	struct FMipDesc
+	{
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t NumRows;        // rows of pixels, or rows of 4x4 blocks for BC formats
+		uint32_t RowSizeInBytes;
+		uint64_t RowPitch;
+		uint64_t Offset;         // from the beginning of the payload
+	};
+
+	// "Folder/Texture.png" -> "Folder/Cooked/Texture.vqtex"
+	std::string GetCookedFilePath(const std::string& SourceFilePath);
+
+	// true if @CookedFilePath exists and was written after @SourceFilePath
+	bool IsUpToDate(const std::string& CookedFilePath, const std::string& SourceFilePath);
+
+	// Writes the chain (RGBA8 or RGBA16F) or the block compressed levels into @FilePath, creating the folder if needed.
+	// The file is written next to the destination and renamed, concurrent loaders never map a partial file.
+	bool Write(const std::string& FilePath, const FMipChain& Chain, uint32_t CookSettings);
+	bool Write(const std::string& FilePath, const FCompressedTexture& Texture, uint32_t CookSettings);
+}
+
+//
+// Read-only mapping of a cooked texture file: the header, the mip table and the payload point into the mapped view.
+//
+class CookedTextureFile
+{
+public:
+	CookedTextureFile() = default;
+	~CookedTextureFile() { Close(); }
+	CookedTextureFile(const CookedTextureFile&) = delete;
+	CookedTextureFile& operator=(const CookedTextureFile&) = delete;
+
+	// maps the file and validates the header and the mip table against the file size
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	inline bool                               IsOpen()            const { return mpView != nullptr; }
+	inline const CookedTexture::FFileHeader&  GetHeader()         const { return *reinterpret_cast<const CookedTexture::FFileHeader*>(mpView); }
+	inline const CookedTexture::FMipDesc&     GetMip(size_t iMip) const { return reinterpret_cast<const CookedTexture::FMipDesc*>(mpView + sizeof(CookedTexture::FFileHeader))[iMip]; }
+	inline const uint8_t*                     GetData()           const { return mpView + GetHeader().DataOffset; }
+
+private:
+	void*          mhFile = nullptr;
+	void*          mhMapping = nullptr;
+	const uint8_t* mpView = nullptr;
+	size_t         mFileSize = 0;
+};
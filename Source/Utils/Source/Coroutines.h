@@ -0,0 +1,338 @@
+#pragma once
+
+#include "Multithreading.h"
+
+//
+// C++20 coroutine layer on top of ThreadPool for writing loading pipelines sequentially:
+//
+//     Async::Task<FImage> LoadImage(ThreadPool& CPUPool, ThreadPool& IOPool, std::string Path)
+//     {
+//         std::optional<std::vector<uint8_t>> Data = co_await Async::ReadFileAsync(Path, IOPool, &CPUPool);
+//         FImage img = Decode(*Data);                   // runs on a CPUPool worker
+//         co_await UploadPool.Schedule();               // hop to another pool
+//         ...
+//         co_return img;
+//     }
+//
+// Awaiting never blocks a worker: the coroutine is suspended and resumed by the pool
+// that completes the awaited work, so the worker picks up other tasks in the meantime.
+//
+// Requires C++20 (/std:c++20): the whole header is compiled out otherwise, check UTILS_HAS_COROUTINES.
+//
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define UTILS_HAS_COROUTINES 1
+#else
+#define UTILS_HAS_COROUTINES 0
+#endif
+
+#if UTILS_HAS_COROUTINES
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <fstream>
+#include <utility>
+
+namespace Async
+{
+	template<class T = void> class Task;
+
+	namespace Detail
+	{
+		// resumes the coroutine awaiting the task (if any) once the task completes
+		struct FFinalAwaiter
+		{
+			bool await_ready() const noexcept { return false; }
+			template<class TPromise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<TPromise> h) noexcept
+			{
+				std::coroutine_handle<> Continuation = h.promise().mContinuation;
+				return Continuation ? Continuation : std::noop_coroutine();
+			}
+			void await_resume() const noexcept {}
+		};
+
+		struct FPromiseBase
+		{
+			std::suspend_always initial_suspend() const noexcept { return {}; } // lazy: starts when awaited
+			FFinalAwaiter       final_suspend()   const noexcept { return {}; }
+			void unhandled_exception() noexcept { mpException = std::current_exception(); }
+
+			std::coroutine_handle<> mContinuation;
+			std::exception_ptr      mpException;
+		};
+
+		template<class T>
+		struct FPromise : FPromiseBase
+		{
+			Task<T> get_return_object() noexcept;
+			template<class U> void return_value(U&& Value) { mValue.emplace(std::forward<U>(Value)); }
+			T GetResult()
+			{
+				if (mpException)
+					std::rethrow_exception(mpException);
+				return std::move(*mValue);
+			}
+			std::optional<T> mValue;
+		};
+		template<>
+		struct FPromise<void> : FPromiseBase
+		{
+			Task<void> get_return_object() noexcept;
+			void return_void() noexcept {}
+			void GetResult()
+			{
+				if (mpException)
+					std::rethrow_exception(mpException);
+			}
+		};
+
+		// eagerly started coroutine that destroys itself on completion, used for driving Tasks
+		struct FDetachedTask
+		{
+			struct promise_type
+			{
+				FDetachedTask       get_return_object() noexcept { return {}; }
+				std::suspend_never  initial_suspend()   noexcept { return {}; }
+				std::suspend_never  final_suspend()     noexcept { return {}; }
+				void return_void() noexcept {}
+				void unhandled_exception() noexcept { std::terminate(); }
+			};
+		};
+	}
+
+	//
+	// Lazily started coroutine returning a T. co_await'ing a Task starts it and resumes the
+	// awaiting coroutine on the thread the task completes on. Exceptions are rethrown to the awaiter.
+	//
+	template<class T>
+	class Task
+	{
+	public:
+		using promise_type = Detail::FPromise<T>;
+		using Handle_t     = std::coroutine_handle<promise_type>;
+
+		Task() = default;
+		explicit Task(Handle_t h) : mHandle(h) {}
+		Task(Task&& other) noexcept : mHandle(std::exchange(other.mHandle, {})) {}
+		Task& operator=(Task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (mHandle) mHandle.destroy();
+				mHandle = std::exchange(other.mHandle, {});
+			}
+			return *this;
+		}
+		~Task() { if (mHandle) mHandle.destroy(); }
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		inline bool IsValid() const { return static_cast<bool>(mHandle); }
+		inline bool IsDone()  const { return !mHandle || mHandle.done(); }
+
+		// awaitable
+		bool await_ready() const noexcept { return IsDone(); }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> Awaiting) noexcept
+		{
+			mHandle.promise().mContinuation = Awaiting;
+			return mHandle; // symmetric transfer: start the task on this thread
+		}
+		T await_resume() { return mHandle.promise().GetResult(); }
+
+	private:
+		Handle_t mHandle;
+	};
+
+	template<class T> Task<T>    Detail::FPromise<T>::get_return_object()    noexcept { return Task<T>(Task<T>::Handle_t::from_promise(*this)); }
+	inline            Task<void> Detail::FPromise<void>::get_return_object() noexcept { return Task<void>(Task<void>::Handle_t::from_promise(*this)); }
+
+
+	namespace Detail
+	{
+		template<class T>
+		struct FSyncWaitState
+		{
+			std::mutex              Mtx;
+			std::condition_variable CV;
+			bool                    bDone = false;
+			std::optional<T>        Result;
+			std::exception_ptr      pException;
+		};
+		template<>
+		struct FSyncWaitState<void>
+		{
+			std::mutex              Mtx;
+			std::condition_variable CV;
+			bool                    bDone = false;
+			std::exception_ptr      pException;
+		};
+
+		template<class T>
+		FDetachedTask RunAndSignal(Task<T>& task, FSyncWaitState<T>& State)
+		{
+			try
+			{
+				if constexpr (std::is_void_v<T>) co_await task;
+				else                             State.Result.emplace(co_await task);
+			}
+			catch (...)
+			{
+				State.pException = std::current_exception();
+			}
+			// notify under the lock: SyncWait() can't return & destroy the state before we're done with it
+			std::lock_guard<std::mutex> lk(State.Mtx);
+			State.bDone = true;
+			State.CV.notify_one();
+		}
+	}
+
+	// Runs @task and blocks the calling thread until it completes. Don't call from a worker
+	// of a pool the task needs to make progress on.
+	template<class T>
+	T SyncWait(Task<T> task)
+	{
+		Detail::FSyncWaitState<T> State;
+		Detail::RunAndSignal(task, State);
+		{
+			std::unique_lock<std::mutex> lk(State.Mtx);
+			State.CV.wait(lk, [&]() { return State.bDone; });
+		}
+		if (State.pException)
+			std::rethrow_exception(State.pException);
+		if constexpr (!std::is_void_v<T>)
+			return std::move(*State.Result);
+	}
+
+
+	namespace Detail
+	{
+		struct FWhenAllCounter
+		{
+			std::atomic<size_t>     NumPending;
+			std::coroutine_handle<> Awaiting;
+
+			void OnChildComplete()
+			{
+				if (NumPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					Awaiting.resume();
+			}
+		};
+
+		template<class T, class TResult>
+		FDetachedTask RunChild(Task<T>& task, FWhenAllCounter& Counter, TResult& Result, std::exception_ptr& pException)
+		{
+			try
+			{
+				if constexpr (std::is_void_v<T>) co_await task;
+				else                             Result.emplace(co_await task);
+			}
+			catch (...)
+			{
+				pException = std::current_exception();
+			}
+			Counter.OnChildComplete();
+		}
+
+		// starts all the children and resumes the awaiting coroutine when the last one completes
+		template<class T, class TResult>
+		struct FWhenAllAwaiter
+		{
+			std::vector<Task<T>>&            Tasks;
+			std::vector<TResult>&            Results;
+			std::vector<std::exception_ptr>& Exceptions;
+			FWhenAllCounter                  Counter;
+
+			bool await_ready() const noexcept { return Tasks.empty(); }
+			bool await_suspend(std::coroutine_handle<> Awaiting)
+			{
+				Counter.NumPending.store(Tasks.size() + 1, std::memory_order_relaxed); // +1: children can't resume us before we're done starting them
+				Counter.Awaiting = Awaiting;
+				for (size_t i = 0; i < Tasks.size(); ++i)
+					RunChild(Tasks[i], Counter, Results[i], Exceptions[i]);
+				return Counter.NumPending.fetch_sub(1, std::memory_order_acq_rel) != 1; // all completed synchronously: don't suspend
+			}
+			void await_resume() const noexcept {}
+		};
+
+		struct FNoResult { void emplace() {} };
+	}
+
+	// Runs the tasks concurrently and completes when all of them have completed. The tasks start on the
+	// calling thread and run concurrently once they suspend, e.g. on co_await pool.Schedule().
+	// The first exception thrown by a task is rethrown after all the tasks completed.
+	template<class T>
+	Task<std::vector<T>> WhenAll(std::vector<Task<T>> Tasks)
+	{
+		std::vector<std::optional<T>>   Results(Tasks.size());
+		std::vector<std::exception_ptr> Exceptions(Tasks.size());
+		co_await Detail::FWhenAllAwaiter<T, std::optional<T>>{ Tasks, Results, Exceptions };
+
+		for (const std::exception_ptr& pException : Exceptions)
+			if (pException)
+				std::rethrow_exception(pException);
+
+		std::vector<T> Values;
+		Values.reserve(Results.size());
+		for (std::optional<T>& Result : Results)
+			Values.push_back(std::move(*Result));
+		co_return Values;
+	}
+	inline Task<void> WhenAll(std::vector<Task<void>> Tasks)
+	{
+		std::vector<Detail::FNoResult>  Results(Tasks.size());
+		std::vector<std::exception_ptr> Exceptions(Tasks.size());
+		co_await Detail::FWhenAllAwaiter<void, Detail::FNoResult>{ Tasks, Results, Exceptions };
+
+		for (const std::exception_ptr& pException : Exceptions)
+			if (pException)
+				std::rethrow_exception(pException);
+	}
+
+
+	//
+	// co_await ReadFileAsync(Path, IOPool, &CPUPool) : reads the whole file on a worker of @IOPool and
+	// resumes the awaiting coroutine on @pResumePool, or on the I/O worker if null.
+	// Returns std::nullopt if the file couldn't be opened.
+	//
+	class ReadFileAsync
+	{
+	public:
+		ReadFileAsync(std::string Path, ThreadPool& IOPool, ThreadPool* pResumePool = nullptr, ETaskPriority Priority = ETaskPriority::NORMAL)
+			: mPath(std::move(Path)), mpIOPool(&IOPool), mpResumePool(pResumePool), mPriority(Priority) {}
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> Awaiting)
+		{
+			// the awaiter lives in the suspended coroutine's frame until it's resumed
+			mpIOPool->AddTaskNoFuture([this, Awaiting]()
+			{
+				ReadFile();
+				if (mpResumePool)
+					mpResumePool->AddTaskNoFuture([Awaiting]() { Awaiting.resume(); }, mPriority);
+				else
+					Awaiting.resume();
+			}, mPriority);
+		}
+		std::optional<std::vector<uint8_t>> await_resume() { return std::move(mData); }
+
+	private:
+		void ReadFile()
+		{
+			std::ifstream File(mPath, std::ios::binary | std::ios::ate);
+			if (!File.is_open())
+				return;
+			const std::streamsize Size = File.tellg();
+			File.seekg(0, std::ios::beg);
+			std::vector<uint8_t> Data(static_cast<size_t>(Size));
+			if (File.read(reinterpret_cast<char*>(Data.data()), Size))
+				mData = std::move(Data);
+		}
+
+		std::string                         mPath;
+		ThreadPool*                         mpIOPool;
+		ThreadPool*                         mpResumePool;
+		ETaskPriority                       mPriority;
+		std::optional<std::vector<uint8_t>> mData;
+	};
+}
+#endif // UTILS_HAS_COROUTINES
@@ -0,0 +1,149 @@
+#include "FrameLimiter.h"
+#include "Timer.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002 // Windows 10 1803+
+#endif
+#endif
+#include <immintrin.h>
+
+// weight of the newest sample in the sleep duration estimate
+constexpr double SLEEP_ESTIMATE_SMOOTHING = 1.0 / 16.0;
+
+void FrameLimiter::Initialize(float TargetFrameRate)
+{
+	mTargetFrameRate = std::max(TargetFrameRate, 0.0f);
+	mTicksPerSecond = static_cast<double>(CpuTimestamp::GetTicksPerSecond());
+	mPeriodTicks = mTargetFrameRate > 0.0f ? static_cast<uint64_t>(mTicksPerSecond / mTargetFrameRate) : 0;
+	mNextDeadlineTicks = 0;
+	if (!IsEnabled())
+		return;
+
+#if defined(_WIN32)
+	mhWaitableTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!mhWaitableTimer)
+		Log::Warning("FrameLimiter: High resolution waitable timer isn't supported, falling back to Sleep()");
+#endif
+	Log::Info("FrameLimiter: Target frame rate: %.2f (%.3f ms)", mTargetFrameRate, 1000.0f / mTargetFrameRate);
+}
+
+void FrameLimiter::Exit()
+{
+#if defined(_WIN32)
+	if (mhWaitableTimer)
+		CloseHandle(mhWaitableTimer);
+#endif
+	mhWaitableTimer = nullptr;
+	mPeriodTicks = 0;
+}
+
+float FrameLimiter::Wait()
+{
+	if (!IsEnabled())
+		return 0.0f;
+
+	const uint64_t Now = CpuTimestamp::Now();
+	if (mNextDeadlineTicks == 0) // first frame
+		mNextDeadlineTicks = Now;
+
+	const bool bWait = Now < mNextDeadlineTicks;
+	if (bWait)
+		SleepUntil(mNextDeadlineTicks);
+	else if (mNumFrames > 0)
+		++mNumMissedDeadlines; // the frame's work took longer than the period
+	const uint64_t WakeTicks = bWait ? CpuTimestamp::Now() : Now;
+
+	const double ErrorMs = (static_cast<double>(WakeTicks) - static_cast<double>(mNextDeadlineTicks)) * 1000.0 / mTicksPerSecond;
+	++mNumFrames;
+	if (bWait) // the limiter's own accuracy, missed deadlines are counted separately
+	{
+		++mNumPacedFrames;
+		mSumAbsErrorMs += std::abs(ErrorMs);
+		mMaxErrorMs = std::max(mMaxErrorMs, std::abs(ErrorMs));
+	}
+
+	mNextDeadlineTicks += mPeriodTicks;
+	if (WakeTicks >= mNextDeadlineTicks) // more than a period late: restart the schedule rather than catching up
+		mNextDeadlineTicks = WakeTicks + mPeriodTicks;
+
+	return static_cast<float>(ErrorMs);
+}
+
+void FrameLimiter::SleepUntil(uint64_t DeadlineTicks)
+{
+	// sleep while there's more time left than a sleep is expected to take
+	uint64_t Now = CpuTimestamp::Now();
+	const uint64_t SleepBeginTicks = Now;
+	while (Now < DeadlineTicks)
+	{
+		const double RemainingSeconds = static_cast<double>(DeadlineTicks - Now) / mTicksPerSecond;
+		const double SleepEstimate = mSleepMean + std::sqrt(mSleepVariance);
+		if (RemainingSeconds <= SleepEstimate)
+			break;
+
+		SleepOneMillisecond();
+
+		const uint64_t AfterSleep = CpuTimestamp::Now();
+		const double Observed = static_cast<double>(AfterSleep - Now) / mTicksPerSecond;
+		const double Delta = Observed - mSleepMean;
+		mSleepMean += SLEEP_ESTIMATE_SMOOTHING * Delta;
+		mSleepVariance = (1.0 - SLEEP_ESTIMATE_SMOOTHING) * (mSleepVariance + SLEEP_ESTIMATE_SMOOTHING * Delta * Delta);
+		Now = AfterSleep;
+	}
+	mSleepTicks += Now - SleepBeginTicks;
+
+	// spin for the rest
+	const uint64_t SpinBeginTicks = Now;
+	while (Now < DeadlineTicks)
+	{
+		_mm_pause();
+		Now = CpuTimestamp::Now();
+	}
+	mSpinTicks += Now - SpinBeginTicks;
+}
+
+void FrameLimiter::SleepOneMillisecond()
+{
+#if defined(_WIN32)
+	if (mhWaitableTimer)
+	{
+		LARGE_INTEGER DueTime = {};
+		DueTime.QuadPart = -10000; // relative, in 100ns units
+		if (SetWaitableTimerEx(mhWaitableTimer, &DueTime, 0, nullptr, nullptr, nullptr, 0))
+		{
+			WaitForSingleObject(mhWaitableTimer, INFINITE);
+			return;
+		}
+	}
+	Sleep(1);
+#else
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+}
+
+void FrameLimiter::LogStats() const
+{
+	if (!IsEnabled() || mNumFrames == 0)
+		return;
+
+	const double TotalWaitMs = (mSleepTicks + mSpinTicks) * 1000.0 / mTicksPerSecond;
+	Log::Info("FrameLimiter: %.2f FPS target, %llu frames, pacing error avg=%.4f ms max=%.4f ms, %llu missed deadlines (%.1f%%), wait: %.1f%% sleeping %.1f%% spinning, sleep estimate=%.3f ms"
+		, mTargetFrameRate
+		, mNumFrames
+		, mNumPacedFrames ? mSumAbsErrorMs / mNumPacedFrames : 0.0
+		, mMaxErrorMs
+		, mNumMissedDeadlines
+		, 100.0 * mNumMissedDeadlines / mNumFrames
+		, TotalWaitMs > 0.0 ? 100.0 * mSleepTicks / (mSleepTicks + mSpinTicks) : 0.0
+		, TotalWaitMs > 0.0 ? 100.0 * mSpinTicks  / (mSleepTicks + mSpinTicks) : 0.0
+		, (mSleepMean + std::sqrt(mSleepVariance)) * 1000.0
+	);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+//
+// Paces a loop to a target frame rate: Wait() blocks until the next frame's deadline.
+//
+// The wait sleeps in ~1ms steps while the remaining time is larger than the expected sleep
+// duration (tracked as mean + stddev of the observed sleeps, which depend on the OS timer
+// resolution and the scheduler), and spins on the timestamp for the rest, which keeps the
+// pacing error in the microseconds while leaving the core idle for most of the wait.
+//
+// Deadlines advance by a fixed period so that the pacing doesn't drift; a frame that misses
+// its deadline by more than a period restarts the schedule instead of catching up with a burst.
+//
+class FrameLimiter
+{
+public:
+	void Initialize(float TargetFrameRate); // <= 0: disabled, Wait() returns immediately
+	void Exit();
+
+	inline bool  IsEnabled() const { return mPeriodTicks != 0; }
+	inline float GetTargetFrameRate() const { return mTargetFrameRate; }
+
+	// Blocks until the deadline of the next frame. Returns the pacing error in milliseconds:
+	// how late the call returned relative to the deadline (negative: early), 0 when disabled.
+	float Wait();
+
+	// logs the achieved pacing: average/max error of the frames that waited, the number of missed
+	// deadlines (frames whose work took longer than the period), time spent sleeping vs spinning
+	void LogStats() const;
+
+private:
+	void SleepUntil(uint64_t DeadlineTicks);
+	void SleepOneMillisecond();
+
+	float    mTargetFrameRate = 0.0f;
+	uint64_t mPeriodTicks = 0;
+	uint64_t mNextDeadlineTicks = 0;
+	void*    mhWaitableTimer = nullptr; // high resolution waitable timer, if the OS supports it
+
+	// duration of a 1ms sleep in seconds, exponential moving mean & variance.
+	// Starts pessimistic: the first waits spin more until the estimate converges.
+	double   mSleepMean = 2e-3;
+	double   mSleepVariance = 1e-6;
+	double   mTicksPerSecond = 0.0;
+
+	// stats
+	uint64_t mNumFrames = 0;
+	uint64_t mNumMissedDeadlines = 0;
+	uint64_t mNumPacedFrames = 0;     // frames that waited for their deadline
+	double   mSumAbsErrorMs = 0.0;    // of the paced frames
+	double   mMaxErrorMs = 0.0;
+	uint64_t mSleepTicks = 0;
+	uint64_t mSpinTicks = 0;
+};
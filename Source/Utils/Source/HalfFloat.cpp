@@ -0,0 +1,218 @@
+#include "HalfFloat.h"
+#include "Multithreading.h"
+#include "SystemInfo.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <immintrin.h>
+
+//
+// SSE2 kernels: the bit manipulations of the scalar versions on 4 values, without branches
+//
+// float -> half:
+//   - |f| >= 65536                                : infinity, NaN -> quiet NaN keeping the top of the payload like vcvtps2ph
+//                                                   (65520+ rounds up to infinity below)
+//   - |f| <  2^-14 (half denormals)               : adding 0.5 lets the FPU round the mantissa into the low bits
+//   - normals                                     : rebias the exponent, round to nearest even on the 13 dropped bits
+//
+static inline __m128i FloatToHalf4_SSE2(__m128 v)
+{
+	const __m128i vSignMask     = _mm_set1_epi32(0x80000000);
+	const __m128i vF16Max       = _mm_set1_epi32((127 + 16) << 23);
+	const __m128i vInfinity     = _mm_set1_epi32(255 << 23);
+	const __m128i vDenormLimit  = _mm_set1_epi32(113 << 23);
+	const __m128  vDenormMagic  = _mm_castsi128_ps(_mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23));
+	const __m128i vRebias       = _mm_set1_epi32(((15 - 127) << 23) + 0xFFF);
+
+	const __m128i Bits = _mm_castps_si128(v);
+	const __m128i Sign = _mm_and_si128(Bits, vSignMask);
+	const __m128i Abs  = _mm_xor_si128(Bits, Sign); // < 2^31: the signed compares below are fine
+
+	// infinity & NaN
+	const __m128i bNaN      = _mm_cmpgt_epi32(Abs, vInfinity);
+	const __m128i NaNBits   = _mm_or_si128(_mm_set1_epi32(0x0200), _mm_and_si128(_mm_srli_epi32(Abs, 13), _mm_set1_epi32(0x03FF)));
+	const __m128i InfOrNaN  = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(bNaN, NaNBits));
+
+	// denormals
+	const __m128i Denormal  = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(Abs), vDenormMagic)), _mm_castps_si128(vDenormMagic));
+
+	// normals
+	const __m128i MantissaOdd = _mm_and_si128(_mm_srli_epi32(Abs, 13), _mm_set1_epi32(1));
+	const __m128i Normal      = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(Abs, vRebias), MantissaOdd), 13);
+
+	const __m128i bOverflow = _mm_cmpgt_epi32(Abs, _mm_sub_epi32(vF16Max, _mm_set1_epi32(1))); // Abs >= F16Max, Abs + 1 would wrap for NaNs
+	const __m128i bDenormal = _mm_cmplt_epi32(Abs, vDenormLimit);
+
+	__m128i Half = _mm_or_si128(_mm_and_si128(bDenormal, Denormal), _mm_andnot_si128(bDenormal, Normal));
+	Half = _mm_or_si128(_mm_and_si128(bOverflow, InfOrNaN), _mm_andnot_si128(bOverflow, Half));
+	return _mm_or_si128(Half, _mm_srli_epi32(Sign, 16));
+}
+
+// half -> float: shift the exponent & mantissa in place and rescale the exponent bias with a multiply,
+// which also normalizes the denormals. Infinity & NaN get the float's max exponent, NaNs are quieted like vcvtph2ps.
+static inline __m128 HalfToFloat4_SSE2(__m128i h)
+{
+	const __m128  vMagic     = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+	const __m128  vWasInfNaN = _mm_castsi128_ps(_mm_set1_epi32((127 + 16) << 23));
+
+	const __m128i Abs         = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+	const __m128i ExpMantissa = _mm_slli_epi32(Abs, 13);
+	const __m128  Scaled      = _mm_mul_ps(_mm_castsi128_ps(ExpMantissa), vMagic);
+	const __m128  bInfNaN     = _mm_cmpge_ps(Scaled, vWasInfNaN);
+	const __m128i QuietNaN    = _mm_and_si128(_mm_cmpgt_epi32(Abs, _mm_set1_epi32(0x7C00)), _mm_set1_epi32(0x00400000));
+	const __m128  Value       = _mm_or_ps(_mm_or_ps(Scaled, _mm_and_ps(bInfNaN, _mm_castsi128_ps(_mm_set1_epi32(255 << 23)))), _mm_castsi128_ps(QuietNaN));
+	const __m128i Sign        = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+	return _mm_or_ps(Value, _mm_castsi128_ps(Sign));
+}
+
+static void FloatToHalf_SSE2(const float* pSrc, uint16_t* pDst, size_t Count)
+{
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		// the halves are in the low 16 bits, sign extended: packs doesn't saturate them
+		const __m128i Lo = _mm_srai_epi32(_mm_slli_epi32(FloatToHalf4_SSE2(_mm_loadu_ps(pSrc + i    )), 16), 16);
+		const __m128i Hi = _mm_srai_epi32(_mm_slli_epi32(FloatToHalf4_SSE2(_mm_loadu_ps(pSrc + i + 4)), 16), 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_packs_epi32(Lo, Hi));
+	}
+	for (; i < Count; ++i)
+		pDst[i] = HalfFloat::FromFloat(pSrc[i]);
+}
+
+static void HalfToFloat_SSE2(const uint16_t* pSrc, float* pDst, size_t Count)
+{
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+		_mm_storeu_ps(pDst + i    , HalfToFloat4_SSE2(_mm_unpacklo_epi16(h, _mm_setzero_si128())));
+		_mm_storeu_ps(pDst + i + 4, HalfToFloat4_SSE2(_mm_unpackhi_epi16(h, _mm_setzero_si128())));
+	}
+	for (; i < Count; ++i)
+		pDst[i] = HalfFloat::ToFloat(pSrc[i]);
+}
+
+//
+// F16C kernels
+//
+static void FloatToHalf_F16C(const float* pSrc, uint16_t* pDst, size_t Count)
+{
+	size_t i = 0;
+	for (; i + 16 <= Count; i += 16)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i    ), _mm256_cvtps_ph(_mm256_loadu_ps(pSrc + i    ), _MM_FROUND_TO_NEAREST_INT));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i + 8), _mm256_cvtps_ph(_mm256_loadu_ps(pSrc + i + 8), _MM_FROUND_TO_NEAREST_INT));
+	}
+	for (; i + 8 <= Count; i += 8)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm256_cvtps_ph(_mm256_loadu_ps(pSrc + i), _MM_FROUND_TO_NEAREST_INT));
+	for (; i < Count; ++i)
+		pDst[i] = HalfFloat::FromFloat(pSrc[i]);
+}
+
+static void HalfToFloat_F16C(const uint16_t* pSrc, float* pDst, size_t Count)
+{
+	size_t i = 0;
+	for (; i + 16 <= Count; i += 16)
+	{
+		_mm256_storeu_ps(pDst + i    , _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i    ))));
+		_mm256_storeu_ps(pDst + i + 8, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i + 8))));
+	}
+	for (; i + 8 <= Count; i += 8)
+		_mm256_storeu_ps(pDst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i))));
+	for (; i < Count; ++i)
+		pDst[i] = HalfFloat::ToFloat(pSrc[i]);
+}
+
+static bool UseF16C()
+{
+	static const bool sbUseF16C = SystemInfo::GetCPUFeatures().bF16C;
+	return sbUseF16C;
+}
+
+template<class TSrc, class TDst, class FKernel>
+static void Convert(const TSrc* pSrc, TDst* pDst, size_t Count, ThreadPool* pWorkers, FKernel&& fnKernel)
+{
+	if (!pWorkers)
+	{
+		fnKernel(pSrc, pDst, Count);
+		return;
+	}
+	// chunks of 64 values: the vector loops never split across the workers
+	constexpr size_t CHUNK_SIZE = 64;
+	const size_t NumChunks = (Count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	pWorkers->ParallelForRange(0, NumChunks, [&](size_t iBegin, size_t iEnd)
+	{
+		const size_t Begin = iBegin * CHUNK_SIZE;
+		const size_t End = std::min(iEnd * CHUNK_SIZE, Count);
+		fnKernel(pSrc + Begin, pDst + Begin, End - Begin);
+	});
+}
+
+
+namespace HalfFloat
+{
+	uint16_t FromFloat(float f)
+	{
+		uint32_t Bits;
+		memcpy(&Bits, &f, sizeof(Bits));
+		const uint32_t Sign = Bits & 0x80000000u;
+		uint32_t Abs = Bits ^ Sign;
+
+		uint16_t Half;
+		if (Abs >= (127u + 16u) << 23) // rounds past the largest half
+		{
+			Half = Abs > (255u << 23) ? static_cast<uint16_t>(0x7E00 | ((Abs >> 13) & 0x03FF)) : 0x7C00;
+		}
+		else if (Abs < (113u << 23)) // denormal
+		{
+			const uint32_t MagicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+			float Magic, Value;
+			memcpy(&Magic, &MagicBits, sizeof(Magic));
+			memcpy(&Value, &Abs, sizeof(Value));
+			Value += Magic;
+			memcpy(&Abs, &Value, sizeof(Abs));
+			Half = static_cast<uint16_t>(Abs - MagicBits);
+		}
+		else
+		{
+			const uint32_t MantissaOdd = (Abs >> 13) & 1;
+			Abs += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + MantissaOdd;
+			Half = static_cast<uint16_t>(Abs >> 13);
+		}
+		return Half | static_cast<uint16_t>(Sign >> 16);
+	}
+
+	float ToFloat(uint16_t h)
+	{
+		const uint32_t MagicBits = (254u - 15u) << 23;
+		const uint32_t WasInfNaNBits = (127u + 16u) << 23;
+		float Magic, WasInfNaN, Value;
+		memcpy(&Magic, &MagicBits, sizeof(Magic));
+		memcpy(&WasInfNaN, &WasInfNaNBits, sizeof(WasInfNaN));
+
+		uint32_t Bits = static_cast<uint32_t>(h & 0x7FFF) << 13;
+		memcpy(&Value, &Bits, sizeof(Value));
+		Value *= Magic;
+		memcpy(&Bits, &Value, sizeof(Bits));
+		if (Value >= WasInfNaN)
+			Bits |= 255u << 23;
+		if ((h & 0x7FFF) > 0x7C00)
+			Bits |= 0x00400000; // quiet NaN
+		Bits |= static_cast<uint32_t>(h & 0x8000) << 16;
+		memcpy(&Value, &Bits, sizeof(Value));
+		return Value;
+	}
+
+	void FromFloat(const float* pSrc, uint16_t* pDst, size_t Count, ThreadPool* pWorkers)
+	{
+		if (UseF16C()) Convert(pSrc, pDst, Count, pWorkers, FloatToHalf_F16C);
+		else           Convert(pSrc, pDst, Count, pWorkers, FloatToHalf_SSE2);
+	}
+
+	void ToFloat(const uint16_t* pSrc, float* pDst, size_t Count, ThreadPool* pWorkers)
+	{
+		if (UseF16C()) Convert(pSrc, pDst, Count, pWorkers, HalfToFloat_F16C);
+		else           Convert(pSrc, pDst, Count, pWorkers, HalfToFloat_SSE2);
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+//
+// IEEE 754 binary16 conversions, rounding to nearest even: values out of the half range become
+// infinity, NaNs stay NaNs (quieted, the top of the payload kept), small values become denormals.
+// All the paths return the same bits as the F16C instructions.
+// The array versions use F16C when the CPU has it (8 values per instruction) and SSE2 otherwise,
+// the arrays are split across @pWorkers if provided.
+//
+namespace HalfFloat
+{
+	uint16_t FromFloat(float f);
+	float    ToFloat(uint16_t h);
+
+	void FromFloat(const float* pSrc, uint16_t* pDst, size_t Count, ThreadPool* pWorkers = nullptr);
+	void ToFloat(const uint16_t* pSrc, float* pDst, size_t Count, ThreadPool* pWorkers = nullptr);
+}
@@ -1,6 +1,8 @@
 #include "Image.h"
 #include "Log.h"
 #include "utils.h"
+#include "Multithreading.h"
+#include "SystemInfo.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -16,52 +18,277 @@
 #include <set>
 #include <cmath>
 #include <cassert>
+#include <algorithm>
+
+#include <immintrin.h>
 
 static const std::set<std::string> S_HDR_FORMATS = { "hdr", "exr" };
 static bool IsHDRFileExtension(const std::string& ext) { return S_HDR_FORMATS.find(ext) != S_HDR_FORMATS.end(); }
 
-static float CalculateMaxLuminance(const float* pData, int width, int height, int numComponents)
+//
+// Statistics
+//
+constexpr float LUMINANCE_WEIGHT_R = 0.2126f; // Rec.709
+constexpr float LUMINANCE_WEIGHT_G = 0.7152f;
+constexpr float LUMINANCE_WEIGHT_B = 0.0722f;
+constexpr float HISTOGRAM_BINS_PER_STOP = IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS / (IMAGE_LUMINANCE_HISTOGRAM_MAX_LOG2 - IMAGE_LUMINANCE_HISTOGRAM_MIN_LOG2);
+
+// log2(1 + t), t in [0, 1): least squares fit, max error 3e-5
+constexpr float LOG2_C1 =  1.4418255f;
+constexpr float LOG2_C2 = -0.708678912f;
+constexpr float LOG2_C3 =  0.415411186f;
+constexpr float LOG2_C4 = -0.194408323f;
+constexpr float LOG2_C5 =  0.0458789501f;
+
+// the SIMD kernels accumulate the sums in floats for this many pixels before adding them to the double sums
+constexpr size_t STATISTICS_NUM_PIXELS_PER_FLOAT_SUM = 4096;
+
+struct FImageStatisticsAccumulator
+{
+    double   SumLuminance     = 0.0;
+    double   SumLog2Luminance = 0.0;
+    float    MaxLuminance     = 0.0f;
+    float    MaxComponent     = 0.0f;
+    std::array<uint32_t, IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS> Histogram = {};
+};
+
+static FImageStatisticsAccumulator CombineStatistics(const FImageStatisticsAccumulator& a, const FImageStatisticsAccumulator& b)
+{
+    FImageStatisticsAccumulator c;
+    c.SumLuminance     = a.SumLuminance + b.SumLuminance;
+    c.SumLog2Luminance = a.SumLog2Luminance + b.SumLog2Luminance;
+    c.MaxLuminance     = std::max(a.MaxLuminance, b.MaxLuminance);
+    c.MaxComponent     = std::max(a.MaxComponent, b.MaxComponent);
+    for (int i = 0; i < IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS; ++i)
+        c.Histogram[i] = a.Histogram[i] + b.Histogram[i];
+    return c;
+}
+
+static void AccumulateStatistics_Scalar(const float* pRGBA, size_t NumPixels, FImageStatisticsAccumulator& Acc)
+{
+    for (size_t i = 0; i < NumPixels; ++i)
+    {
+        const float r = pRGBA[i * 4 + 0];
+        const float g = pRGBA[i * 4 + 1];
+        const float b = pRGBA[i * 4 + 2];
+        const float WeightedSum = LUMINANCE_WEIGHT_R * r + LUMINANCE_WEIGHT_G * g + LUMINANCE_WEIGHT_B * b;
+        const float Lum = WeightedSum > 0.0f ? WeightedSum : 0.0f; // NaNs to 0, as in the SIMD kernels
+        const float Log2Lum = std::log2(Lum + IMAGE_LUMINANCE_LOG_DELTA);
+        const float Bin = std::clamp((Log2Lum - IMAGE_LUMINANCE_HISTOGRAM_MIN_LOG2) * HISTOGRAM_BINS_PER_STOP, 0.0f, IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS - 1.0f);
+
+        Acc.MaxLuminance = std::max(Acc.MaxLuminance, Lum);
+        Acc.MaxComponent = std::max(Acc.MaxComponent, std::max(r, std::max(g, b)));
+        Acc.SumLuminance += Lum;
+        Acc.SumLog2Luminance += Log2Lum;
+        ++Acc.Histogram[static_cast<int>(Bin)];
+    }
+}
+
+// x > 0: exponent + polynomial approximation of the mantissa's log2
+static inline __m128 Log2_SSE(__m128 x)
+{
+    const __m128i Bits     = _mm_castps_si128(x);
+    const __m128  Exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(Bits, 23), _mm_set1_epi32(127)));
+    const __m128  t        = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(Bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000))), _mm_set1_ps(1.0f));
+    __m128 p = _mm_set1_ps(LOG2_C5);
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(LOG2_C4));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(LOG2_C3));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(LOG2_C2));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(LOG2_C1));
+    return _mm_add_ps(Exponent, _mm_mul_ps(p, t));
+}
+static inline __m256 Log2_AVX2(__m256 x)
+{
+    const __m256i Bits     = _mm256_castps_si256(x);
+    const __m256  Exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(Bits, 23), _mm256_set1_epi32(127)));
+    const __m256  t        = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(Bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000))), _mm256_set1_ps(1.0f));
+    __m256 p = _mm256_set1_ps(LOG2_C5);
+    p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(LOG2_C4));
+    p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(LOG2_C3));
+    p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(LOG2_C2));
+    p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(LOG2_C1));
+    return _mm256_add_ps(Exponent, _mm256_mul_ps(p, t));
+}
+
+static inline float HorizontalSum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+}
+static inline float HorizontalMax(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+// 4 pixels per iteration: transposed into R, G, B vectors
+static size_t AccumulateStatistics_SSE(const float* pRGBA, size_t NumPixels, FImageStatisticsAccumulator& Acc)
+{
+    const __m128 vWeightR     = _mm_set1_ps(LUMINANCE_WEIGHT_R);
+    const __m128 vWeightG     = _mm_set1_ps(LUMINANCE_WEIGHT_G);
+    const __m128 vWeightB     = _mm_set1_ps(LUMINANCE_WEIGHT_B);
+    const __m128 vLogDelta    = _mm_set1_ps(IMAGE_LUMINANCE_LOG_DELTA);
+    const __m128 vMinLog2     = _mm_set1_ps(IMAGE_LUMINANCE_HISTOGRAM_MIN_LOG2);
+    const __m128 vBinsPerStop = _mm_set1_ps(HISTOGRAM_BINS_PER_STOP);
+    const __m128 vMaxBin      = _mm_set1_ps(IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS - 1.0f);
+    const __m128 vZero        = _mm_setzero_ps();
+
+    const size_t NumPixelsSIMD = NumPixels & ~size_t(3);
+    __m128 vMaxLuminance = vZero;
+    __m128 vMaxComponent = vZero;
+    alignas(16) int32_t Bins[4];
+    for (size_t iBlock = 0; iBlock < NumPixelsSIMD; iBlock += STATISTICS_NUM_PIXELS_PER_FLOAT_SUM)
+    {
+        const size_t iBlockEnd = std::min(NumPixelsSIMD, iBlock + STATISTICS_NUM_PIXELS_PER_FLOAT_SUM);
+        __m128 vSumLuminance = vZero;
+        __m128 vSumLog2Luminance = vZero;
+        for (size_t i = iBlock; i < iBlockEnd; i += 4)
+        {
+            __m128 r = _mm_loadu_ps(pRGBA + i * 4 + 0);
+            __m128 g = _mm_loadu_ps(pRGBA + i * 4 + 4);
+            __m128 b = _mm_loadu_ps(pRGBA + i * 4 + 8);
+            __m128 a = _mm_loadu_ps(pRGBA + i * 4 + 12);
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+
+            // max(x, 0) also maps NaNs to 0
+            const __m128 Lum     = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r, vWeightR), _mm_mul_ps(g, vWeightG)), _mm_mul_ps(b, vWeightB)), vZero);
+            const __m128 Log2Lum = Log2_SSE(_mm_add_ps(Lum, vLogDelta));
+            const __m128 Bin     = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(Log2Lum, vMinLog2), vBinsPerStop), vZero), vMaxBin);
+
+            vMaxLuminance     = _mm_max_ps(vMaxLuminance, Lum);
+            vMaxComponent     = _mm_max_ps(vMaxComponent, _mm_max_ps(r, _mm_max_ps(g, b)));
+            vSumLuminance     = _mm_add_ps(vSumLuminance, Lum);
+            vSumLog2Luminance = _mm_add_ps(vSumLog2Luminance, Log2Lum);
+
+            _mm_store_si128(reinterpret_cast<__m128i*>(Bins), _mm_cvttps_epi32(Bin));
+            ++Acc.Histogram[Bins[0]];
+            ++Acc.Histogram[Bins[1]];
+            ++Acc.Histogram[Bins[2]];
+            ++Acc.Histogram[Bins[3]];
+        }
+        Acc.SumLuminance     += HorizontalSum(vSumLuminance);
+        Acc.SumLog2Luminance += HorizontalSum(vSumLog2Luminance);
+    }
+    Acc.MaxLuminance = std::max(Acc.MaxLuminance, HorizontalMax(vMaxLuminance));
+    Acc.MaxComponent = std::max(Acc.MaxComponent, HorizontalMax(vMaxComponent));
+    return NumPixelsSIMD;
+}
+
+// 8 pixels per iteration: 2 pixels per register, transposed within the 128-bit lanes, which
+// leaves the R, G, B vectors with the pixels out of order: irrelevant to the statistics.
+static size_t AccumulateStatistics_AVX2(const float* pRGBA, size_t NumPixels, FImageStatisticsAccumulator& Acc)
 {
-    float MaxLuminance = 0.0f;
-    float MaxLuminance2 = 0.0f;
-    float MaxLuminance3 = 0.0f;
-    float MaxLightLevel = 0.0f;
-    float LuminanceSum = 0.0f;
-    
-    for(int h=0; h< height; ++h) // row
-    for(int w = 0; w < width; ++w) // col
+    const __m256 vWeightR     = _mm256_set1_ps(LUMINANCE_WEIGHT_R);
+    const __m256 vWeightG     = _mm256_set1_ps(LUMINANCE_WEIGHT_G);
+    const __m256 vWeightB     = _mm256_set1_ps(LUMINANCE_WEIGHT_B);
+    const __m256 vLogDelta    = _mm256_set1_ps(IMAGE_LUMINANCE_LOG_DELTA);
+    const __m256 vMinLog2     = _mm256_set1_ps(IMAGE_LUMINANCE_HISTOGRAM_MIN_LOG2);
+    const __m256 vBinsPerStop = _mm256_set1_ps(HISTOGRAM_BINS_PER_STOP);
+    const __m256 vMaxBin      = _mm256_set1_ps(IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS - 1.0f);
+    const __m256 vZero        = _mm256_setzero_ps();
+
+    const size_t NumPixelsSIMD = NumPixels & ~size_t(7);
+    __m256 vMaxLuminance = vZero;
+    __m256 vMaxComponent = vZero;
+    alignas(32) int32_t Bins[8];
+    for (size_t iBlock = 0; iBlock < NumPixelsSIMD; iBlock += STATISTICS_NUM_PIXELS_PER_FLOAT_SUM)
     {
-        const int pxIndex = (w  + width * h) * numComponents;
-        const float& r = pData[pxIndex + 0];
-        const float& g = pData[pxIndex + 1];
-        const float& b = pData[pxIndex + 2];
-
-        const float lum = 0.2126f * r + 0.7152f * g + 0.0722f * b;
-        if (lum > MaxLuminance) 
-            MaxLuminance = lum;
-
-        const float lum2 = 0.299f * r + 0.587f * g + 0.114f * b;
-        if (lum2 > MaxLuminance2)
-            MaxLuminance2 = lum2;
-
-        const float lum3 = std::sqrtf(0.299f * r * r + 0.587f * g * g + 0.114f * b * b);
-        if (lum3 > MaxLuminance3)
-            MaxLuminance3 = lum3;
-
-        if (MaxLightLevel <= r)
-            MaxLightLevel = r;
-        if (MaxLightLevel <= g)
-            MaxLightLevel = g;
-        if (MaxLightLevel <= b)
-            MaxLightLevel = b;
-
-        LuminanceSum += lum;
+        const size_t iBlockEnd = std::min(NumPixelsSIMD, iBlock + STATISTICS_NUM_PIXELS_PER_FLOAT_SUM);
+        __m256 vSumLuminance = vZero;
+        __m256 vSumLog2Luminance = vZero;
+        for (size_t i = iBlock; i < iBlockEnd; i += 8)
+        {
+            const __m256 p01 = _mm256_loadu_ps(pRGBA + i * 4 + 0);
+            const __m256 p23 = _mm256_loadu_ps(pRGBA + i * 4 + 8);
+            const __m256 p45 = _mm256_loadu_ps(pRGBA + i * 4 + 16);
+            const __m256 p67 = _mm256_loadu_ps(pRGBA + i * 4 + 24);
+            const __m256 t0 = _mm256_unpacklo_ps(p01, p23); // r0 r2 g0 g2 | r1 r3 g1 g3
+            const __m256 t1 = _mm256_unpackhi_ps(p01, p23); // b0 b2 a0 a2 | b1 b3 a1 a3
+            const __m256 t2 = _mm256_unpacklo_ps(p45, p67);
+            const __m256 t3 = _mm256_unpackhi_ps(p45, p67);
+            const __m256 r = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)); // r0 r2 r4 r6 | r1 r3 r5 r7
+            const __m256 g = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+            const __m256 b = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+
+            const __m256 Lum     = _mm256_max_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, vWeightR), _mm256_mul_ps(g, vWeightG)), _mm256_mul_ps(b, vWeightB)), vZero);
+            const __m256 Log2Lum = Log2_AVX2(_mm256_add_ps(Lum, vLogDelta));
+            const __m256 Bin     = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(Log2Lum, vMinLog2), vBinsPerStop), vZero), vMaxBin);
+
+            vMaxLuminance     = _mm256_max_ps(vMaxLuminance, Lum);
+            vMaxComponent     = _mm256_max_ps(vMaxComponent, _mm256_max_ps(r, _mm256_max_ps(g, b)));
+            vSumLuminance     = _mm256_add_ps(vSumLuminance, Lum);
+            vSumLog2Luminance = _mm256_add_ps(vSumLog2Luminance, Log2Lum);
+
+            _mm256_store_si256(reinterpret_cast<__m256i*>(Bins), _mm256_cvttps_epi32(Bin));
+            for (int32_t iBin : Bins)
+                ++Acc.Histogram[iBin];
+        }
+        Acc.SumLuminance     += HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(vSumLuminance), _mm256_extractf128_ps(vSumLuminance, 1)));
+        Acc.SumLog2Luminance += HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(vSumLog2Luminance), _mm256_extractf128_ps(vSumLog2Luminance, 1)));
     }
+    Acc.MaxLuminance = std::max(Acc.MaxLuminance, HorizontalMax(_mm_max_ps(_mm256_castps256_ps128(vMaxLuminance), _mm256_extractf128_ps(vMaxLuminance, 1))));
+    Acc.MaxComponent = std::max(Acc.MaxComponent, HorizontalMax(_mm_max_ps(_mm256_castps256_ps128(vMaxComponent), _mm256_extractf128_ps(vMaxComponent, 1))));
+    return NumPixelsSIMD;
+}
+
+static void AccumulateStatistics(const float* pRGBA, size_t NumPixels, FImageStatisticsAccumulator& Acc)
+{
+    static const bool sbUseAVX2 = SystemInfo::GetCPUFeatures().bAVX2;
+    const size_t NumPixelsSIMD = sbUseAVX2
+        ? AccumulateStatistics_AVX2(pRGBA, NumPixels, Acc)
+        : AccumulateStatistics_SSE (pRGBA, NumPixels, Acc);
+    AccumulateStatistics_Scalar(pRGBA + NumPixelsSIMD * 4, NumPixels - NumPixelsSIMD, Acc);
+}
 
+FImageStatistics Image::CalculateStatistics(const float* pRGBA, size_t NumPixels, ThreadPool* pWorkers)
+{
+    FImageStatistics Stats;
+    if (NumPixels == 0)
+        return Stats;
+
+    auto fnAccumulate = [pRGBA](size_t iBegin, size_t iEnd, FImageStatisticsAccumulator Acc)
+    {
+        AccumulateStatistics(pRGBA + iBegin * 4, iEnd - iBegin, Acc);
+        return Acc;
+    };
+    const FImageStatisticsAccumulator Acc = pWorkers
+        ? pWorkers->ParallelReduce(size_t(0), NumPixels, FImageStatisticsAccumulator{}, fnAccumulate, CombineStatistics)
+        : fnAccumulate(0, NumPixels, FImageStatisticsAccumulator{});
+
+    Stats.NumPixels          = NumPixels;
+    Stats.MaxLuminance       = Acc.MaxLuminance;
+    Stats.MaxComponent       = Acc.MaxComponent;
+    Stats.AvgLuminance       = static_cast<float>(Acc.SumLuminance / NumPixels);
+    Stats.LogAvgLuminance    = static_cast<float>(std::exp2(Acc.SumLog2Luminance / NumPixels));
+    Stats.LuminanceHistogram = Acc.Histogram;
+    return Stats;
+}
+
+float FImageStatistics::GetLuminancePercentile(float Percentile) const
+{
+    if (NumPixels == 0)
+        return 0.0f;
+
+    // interpolate within the bin where the cumulative count reaches the target
+    const double Target = std::clamp(Percentile, 0.0f, 100.0f) / 100.0 * NumPixels;
+    double NumPixelsBelow = 0.0;
+    for (int i = 0; i < IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS; ++i)
+    {
+        const double NumPixelsInBin = LuminanceHistogram[i];
+        if (NumPixelsInBin > 0.0 && NumPixelsBelow + NumPixelsInBin >= Target)
+        {
+            const double Fraction = (Target - NumPixelsBelow) / NumPixelsInBin;
+            const double Log2Lum = IMAGE_LUMINANCE_HISTOGRAM_MIN_LOG2 + (i + Fraction) / HISTOGRAM_BINS_PER_STOP;
+            return std::min(std::max(static_cast<float>(std::exp2(Log2Lum) - IMAGE_LUMINANCE_LOG_DELTA), 0.0f), MaxLuminance);
+        }
+        NumPixelsBelow += NumPixelsInBin;
+    }
     return MaxLuminance;
 }
 
-Image Image::LoadFromFile(const char* pFilePath)
+Image Image::LoadFromFile(const char* pFilePath, ThreadPool* pWorkers)
 {
     constexpr int reqComp = 0;
 
@@ -80,13 +307,13 @@ Image Image::LoadFromFile(const char* pFilePath)
     {
         Log::Error("Error loading file: %s", pFilePath);
     }
-    img.BytesPerPixel = bHDR 
-        ? NumImageComponents * 4 // HDR=RGBA32F -> 16 Bytes/Pixel = 4 Bytes / component
-        : NumImageComponents;    // SDR=RGBA8   -> 4  Bytes/Pixel = 1 Byte  / component
+    img.BytesPerPixel = bHDR // 4 components are requested regardless of the file's: NumImageComponents only describes the file
+        ? 16  // HDR=RGBA32F -> 16 Bytes/Pixel = 4 Bytes / component
+        : 4;  // SDR=RGBA8   -> 4  Bytes/Pixel = 1 Byte  / component
 
     if (img.pData && bHDR)
     {
-        img.MaxLuminance = CalculateMaxLuminance(static_cast<const float*>(img.pData), img.Width, img.Height, 4);
+        img.Statistics = CalculateStatistics(static_cast<const float*>(img.pData), static_cast<size_t>(img.Width) * img.Height, pWorkers); // loaded as RGBA32F
     }
 
     return img;
@@ -135,7 +362,7 @@ Image Image::CreateResizedImage(const Image& img, unsigned TargetWidth, unsigned
     {
         NewImage.Width = TargetWidth;
         NewImage.Height = TargetHeight;
-        NewImage.MaxLuminance = img.MaxLuminance;
+        NewImage.Statistics = img.Statistics;
         NewImage.BytesPerPixel = img.BytesPerPixel;
     }
 
@@ -184,7 +411,7 @@ void Image::Destroy()
 unsigned short Image::CalculateMipLevelCount(unsigned __int64 w, unsigned __int64 h)
 {
     int mips = 0;
-    while (w >= 1 && h >= 1)
+    while (w >= 1 || h >= 1) // full chain: down to 1x1, the smaller dimension stays at 1
     {
         ++mips;
         w >>= 1;
@@ -1,8 +1,34 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+
+class ThreadPool;
+
+// log2(luminance) histogram: 4 bins per stop over [2^-16, 2^16), the first & last bins also take the values out of range
+constexpr int   IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS = 128;
+constexpr float IMAGE_LUMINANCE_HISTOGRAM_MIN_LOG2 = -16.0f;
+constexpr float IMAGE_LUMINANCE_HISTOGRAM_MAX_LOG2 =  16.0f;
+constexpr float IMAGE_LUMINANCE_LOG_DELTA          = 1.0f / 65536.0f; // added to the luminance before log2() so that black pixels don't produce -inf
+
+// Luminance statistics of an HDR image: Rec.709 luminance of the linear RGB values
+struct FImageStatistics
+{
+    size_t NumPixels       = 0;
+    float  MaxLuminance    = 0.0f;
+    float  AvgLuminance    = 0.0f;
+    float  LogAvgLuminance = 0.0f; // geometric mean: exp2(avg(log2(DELTA + L))), the 'key' of the image for tone mapping
+    float  MaxComponent    = 0.0f; // max light level: the brightest R, G or B value
+    std::array<uint32_t, IMAGE_LUMINANCE_HISTOGRAM_NUM_BINS> LuminanceHistogram = {};
+
+    // @Percentile in [0, 100], estimated from the histogram: within a quarter stop
+    float GetLuminancePercentile(float Percentile) const;
+};
+
 struct Image
 {
-    static Image LoadFromFile(const char* pFilePath);
+    // @pWorkers: optional, splits the HDR statistics computation across the pool's workers
+    static Image LoadFromFile(const char* pFilePath, ThreadPool* pWorkers = nullptr);
     static Image CreateEmptyImage(size_t bytes);
 
     static Image CreateResizedImage(const Image& img, unsigned TargetWidth, unsigned TargetHeight);
@@ -15,6 +41,9 @@ struct Image
     bool IsHDR() const { return BytesPerPixel > 4; }
     size_t GetSizeInBytes() const { return BytesPerPixel * x * y; }
 
+    // Single pass over RGBA32F pixels with SSE/AVX2 kernels, parallelized across @pWorkers if provided
+    static FImageStatistics CalculateStatistics(const float* pRGBA, size_t NumPixels, ThreadPool* pWorkers = nullptr);
+
     static unsigned short CalculateMipLevelCount(unsigned __int64 w, unsigned __int64 h);
     unsigned short CalculateMipLevelCount() const { return CalculateMipLevelCount(this->Width, this->Height); };
 
@@ -22,5 +51,5 @@ struct Image
     union { int y; int Height; };
     int BytesPerPixel = 0;
     void* pData = nullptr;
-    float MaxLuminance = 0.0f;
+    FImageStatistics Statistics; // HDR images only
 };
\ No newline at end of file
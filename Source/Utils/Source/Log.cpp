@@ -1,10 +1,14 @@
 #include "Log.h"
+#include "BinaryLog.h"
 #include "utils.h"
+#include "Multithreading.h"
 
 #include <fstream>
 #include <iostream>
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <chrono>
 
 #include <fcntl.h>
 #include <io.h>
@@ -21,8 +25,25 @@ namespace Log
 using namespace std;
 
 constexpr const char* DEFAULT_LOGFILE_NAME = "Log.txt";
+constexpr const char* DEFAULT_BINARY_LOGFILE_NAME = "Log.blog";
 static std::ofstream sOutFile;
 
+static const char* LOG_LEVEL_PREFIXES[NUM_LOG_LEVELS] =
+{
+	  "[VERBOSE]\t: "
+	, "   [INFO]\t: "
+	, "[WARNING]\t: "
+	, "  [ERROR]\t: "
+};
+
+static void WriteToOutputs(const std::string& s)
+{
+	OutputDebugString(s.c_str());  // vs
+	if (sOutFile.is_open())
+		sOutFile << s;             // file
+	cout << s;                     // console
+}
+
 // checks if the specifiec path is only a file name, construct absolute path
 // - if yes, CurrentPath+FileName
 // - if no, check wether absolute path is provided
@@ -157,10 +178,365 @@ void InitConsole()
 	}
 }
 
+//---------------------------------------------------------------------------------------------
+//
+// Async logging
+//
+//---------------------------------------------------------------------------------------------
+namespace AsyncWriter
+{
+	// Messages go through the per-thread SPSC rings as a byte stream cut into fixed size records: 
+	// a FMessageHeader followed by the text, spanning as many consecutive records as needed.
+	struct FMessageHeader
+	{
+		int64_t   TimeNs;  // system_clock, captured on the logging thread
+		uint32_t  Length;  // of the text, excluding the header
+		ELogLevel Level;
+	};
+	struct FRecord
+	{
+		char Bytes[128];
+	};
+	constexpr size_t NUM_RECORDS_PER_THREAD      = ASYNC_LOG_BUFFER_SIZE_PER_THREAD / sizeof(FRecord);
+	constexpr size_t MAX_NUM_RECORDS_PER_MESSAGE = (sizeof(FMessageHeader) + LEN_MSG_BUFFER + sizeof(FRecord) - 1) / sizeof(FRecord);
+	static_assert(MAX_NUM_RECORDS_PER_MESSAGE <= NUM_RECORDS_PER_THREAD, "Async log buffer can't hold the longest message");
+
+	// wake the writer up early when a buffer is filling up, otherwise it runs every FLUSH_INTERVAL
+	constexpr std::chrono::milliseconds FLUSH_INTERVAL(10);
+	constexpr size_t                    WAKE_UP_THRESHOLD_NUM_RECORDS = NUM_RECORDS_PER_THREAD / 2;
+
+	struct FThreadBuffer
+	{
+		SPSCChannel<FRecord, NUM_RECORDS_PER_THREAD> Records;
+		std::atomic<uint64_t> NumDroppedMessages = 0;
+		std::atomic<bool>     bThreadExited = false;
+
+		// writer thread: message being reassembled from the records
+		FMessageHeader PendingHeader = {};
+		std::string    PendingText;
+		bool           bHasPendingMessage = false;
+	};
+
+	struct FFormattedMessage
+	{
+		int64_t     TimeNs;
+		std::string Text;
+	};
+
+	static std::atomic<bool>        sbEnabled = false;
+	static std::atomic<int>         sNumPushesInFlight = 0; // Destroy() waits for the pushes that saw sbEnabled before stopping the writer
+	static EAsyncLogOverflowPolicy  sOverflowPolicy = EAsyncLogOverflowPolicy::DROP;
+	static std::thread              sWriterThread;
+	static std::atomic<bool>        sbStopWriter = false;
+
+	static std::mutex                                  sBuffersMtx; // guards the list, not the buffers
+	static std::vector<std::unique_ptr<FThreadBuffer>> sBuffers;     // owned here: outlives the threads until drained
+
+	static std::mutex               sWakeMtx;
+	static std::condition_variable  sWakeCV;
+	static std::atomic<bool>        sbWakeRequested = false;
+	static std::condition_variable  sDrainCompletedCV;
+	static uint64_t                 sNumDrainsCompleted = 0; // guarded by sWakeMtx
+
+	struct FThreadBufferHandle
+	{
+		FThreadBuffer* pBuffer = nullptr;
+		~FThreadBufferHandle() { if (pBuffer) pBuffer->bThreadExited.store(true, std::memory_order_release); }
+	};
+	static thread_local FThreadBufferHandle tBufferHandle;
+
+	static FThreadBuffer& GetThreadBuffer()
+	{
+		if (!tBufferHandle.pBuffer)
+		{
+			std::unique_ptr<FThreadBuffer> pBuffer = std::make_unique<FThreadBuffer>();
+			tBufferHandle.pBuffer = pBuffer.get();
+			std::lock_guard<std::mutex> lk(sBuffersMtx);
+			sBuffers.push_back(std::move(pBuffer));
+		}
+		return *tBufferHandle.pBuffer;
+	}
+
+	static void WakeWriter()
+	{
+		if (sbWakeRequested.exchange(true, std::memory_order_acq_rel))
+			return; // already requested: no need for another notification
+		{ std::lock_guard<std::mutex> lk(sWakeMtx); } // the writer can't be between its predicate check and its wait
+		sWakeCV.notify_one();
+	}
+
+	// returns false if the writer is stopped before the message could be queued: write it synchronously then
+	static bool Push(ELogLevel Level, const char* pMsg, size_t Length)
+	{
+		FThreadBuffer& Buffer = GetThreadBuffer();
+		Length = std::min(Length, LEN_MSG_BUFFER);
+
+		const size_t NumBytes   = sizeof(FMessageHeader) + Length;
+		const size_t NumRecords = (NumBytes + sizeof(FRecord) - 1) / sizeof(FRecord);
+		const bool bDropWhenFull = sOverflowPolicy == EAsyncLogOverflowPolicy::DROP && Level != LOG_LEVEL_ERROR; // errors are never dropped
+		if (bDropWhenFull && Buffer.Records.GetCapacity() - Buffer.Records.GetNumItems() < NumRecords)
+		{
+			Buffer.NumDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+			WakeWriter();
+			return true;
+		}
+
+		FRecord Records[MAX_NUM_RECORDS_PER_MESSAGE];
+		const FMessageHeader Header = 
+		{
+			  std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+			, static_cast<uint32_t>(Length)
+			, Level
+		};
+		char* pBytes = Records[0].Bytes;
+		memcpy(pBytes, &Header, sizeof(Header));
+		memcpy(pBytes + sizeof(Header), pMsg, Length);
+
+		// wait for room, the message may be published in several parts
+		size_t NumPushed = 0;
+		while (NumPushed < NumRecords)
+		{
+			const size_t n = Buffer.Records.TryPushBatch(&Records[NumPushed], NumRecords - NumPushed);
+			NumPushed += n;
+			if (n == 0)
+			{
+				// no writer to make room anymore. Destroy() only stops it once the pushes in flight are
+				// done, a message is never left half published
+				if (NumPushed == 0 && sbStopWriter.load(std::memory_order_acquire))
+					return false;
+				WakeWriter();
+				std::this_thread::yield();
+			}
+		}
+
+		if (Level == LOG_LEVEL_ERROR || Buffer.Records.GetNumItems() >= WAKE_UP_THRESHOLD_NUM_RECORDS)
+			WakeWriter();
+		return true;
+	}
+
+	// returns false if async logging is disabled or being destroyed
+	static bool TryPush(ELogLevel Level, const char* pMsg, size_t Length)
+	{
+		// seq_cst on both sides: either Destroy() sees this push in flight or this push sees sbEnabled == false
+		sNumPushesInFlight.fetch_add(1, std::memory_order_seq_cst);
+		const bool bPushed = sbEnabled.load(std::memory_order_seq_cst) && Push(Level, pMsg, Length);
+		sNumPushesInFlight.fetch_sub(1, std::memory_order_release);
+		return bPushed;
+	}
+
+	static void AppendFormattedMessage(const FMessageHeader& Header, const std::string& Text, std::vector<FFormattedMessage>& Messages)
+	{
+		// the timestamp only has a resolution of a second
+		static std::time_t sCachedTime = 0;
+		static std::string sCachedTimeString;
+		const std::time_t Time = static_cast<std::time_t>(Header.TimeNs / 1000000000);
+		if (Time != sCachedTime || sCachedTimeString.empty())
+		{
+			sCachedTime = Time;
+			sCachedTimeString = "[" + GetTimeAsString(Time) + "]";
+		}
+		Messages.push_back({ Header.TimeNs, sCachedTimeString + LOG_LEVEL_PREFIXES[Header.Level] + Text + "\n" });
+	}
+
+	static void Drain(FThreadBuffer& Buffer, std::vector<FFormattedMessage>& Messages)
+	{
+		Buffer.Records.ConsumeAll([&](const FRecord& Record)
+		{
+			const char* pBytes = Record.Bytes;
+			size_t NumBytes = sizeof(Record.Bytes);
+			if (!Buffer.bHasPendingMessage)
+			{
+				memcpy(&Buffer.PendingHeader, pBytes, sizeof(FMessageHeader));
+				pBytes   += sizeof(FMessageHeader);
+				NumBytes -= sizeof(FMessageHeader);
+				Buffer.PendingText.clear();
+				Buffer.bHasPendingMessage = true;
+			}
+
+			const size_t NumTextBytes = std::min<size_t>(NumBytes, Buffer.PendingHeader.Length - Buffer.PendingText.size());
+			Buffer.PendingText.append(pBytes, NumTextBytes);
+			if (Buffer.PendingText.size() == Buffer.PendingHeader.Length)
+			{
+				AppendFormattedMessage(Buffer.PendingHeader, Buffer.PendingText, Messages);
+				Buffer.bHasPendingMessage = false;
+			}
+		});
+
+		if (const uint64_t NumDropped = Buffer.NumDroppedMessages.exchange(0, std::memory_order_relaxed))
+		{
+			const std::string Text = "[Log] Async log buffer full: dropped " + std::to_string(NumDropped) + " message(s)";
+			FMessageHeader Header = { Messages.empty() ? 0 : Messages.back().TimeNs, 0, LOG_LEVEL_WARNING };
+			AppendFormattedMessage(Header, Text, Messages);
+		}
+	}
+
+	// Drains every buffer and writes out the messages ordered by time.
+	// Returns when the buffers are empty, not including the messages pushed while draining.
+	static void DrainAll(std::vector<FFormattedMessage>& Messages, std::string& Batch)
+	{
+		std::vector<FThreadBuffer*> Buffers;
+		{
+			std::lock_guard<std::mutex> lk(sBuffersMtx);
+			// buffers of exited threads are released once drained: check the flag before draining
+			for (auto it = sBuffers.begin(); it != sBuffers.end(); )
+			{
+				FThreadBuffer& Buffer = **it;
+				if (Buffer.bThreadExited.load(std::memory_order_acquire))
+				{
+					Drain(Buffer, Messages);
+					it = sBuffers.erase(it);
+					continue;
+				}
+				Buffers.push_back(&Buffer);
+				++it;
+			}
+		}
+		for (FThreadBuffer* pBuffer : Buffers)
+			Drain(*pBuffer, Messages);
+
+		if (Messages.empty())
+			return;
+
+		std::stable_sort(Messages.begin(), Messages.end(), [](const FFormattedMessage& a, const FFormattedMessage& b) { return a.TimeNs < b.TimeNs; });
+		Batch.clear();
+		for (const FFormattedMessage& Message : Messages)
+			Batch += Message.Text;
+		Messages.clear();
+
+		WriteToOutputs(Batch);
+		if (sOutFile.is_open())
+			sOutFile.flush();
+		cout.flush();
+	}
+
+	static void WriterThread_Main()
+	{
+		std::vector<FFormattedMessage> Messages;
+		std::string Batch;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lk(sWakeMtx);
+				sWakeCV.wait_for(lk, FLUSH_INTERVAL, [&]() { return sbWakeRequested.load() || sbStopWriter.load(); });
+				sbWakeRequested.store(false);
+			}
+
+			const bool bStopping = sbStopWriter.load();
+			DrainAll(Messages, Batch);
+			{
+				std::lock_guard<std::mutex> lk(sWakeMtx);
+				++sNumDrainsCompleted;
+			}
+			sDrainCompletedCV.notify_all();
+
+			if (bStopping) // the last drain started after the stop request
+				break;
+		}
+	}
+
+	static void Initialize(EAsyncLogOverflowPolicy OverflowPolicy)
+	{
+		sOverflowPolicy = OverflowPolicy;
+		sbStopWriter.store(false);
+		sWriterThread = std::thread(&WriterThread_Main);
+		SetThreadDescription(sWriterThread.native_handle(), L"LogWriter");
+		sbEnabled.store(true, std::memory_order_release);
+	}
+
+	static void Destroy()
+	{
+		if (!sbEnabled.load())
+			return;
+		sbEnabled.store(false, std::memory_order_seq_cst); // threads logging from now on write synchronously
+
+		// the pushes that saw sbEnabled == true still need the writer to make room: stop it once they're done,
+		// its last drain then picks up every message they queued
+		while (sNumPushesInFlight.load(std::memory_order_seq_cst) != 0)
+			std::this_thread::yield();
+		sbStopWriter.store(true);
+		WakeWriter();
+		sWriterThread.join();
+	}
+
+	static void Flush()
+	{
+		std::unique_lock<std::mutex> lk(sWakeMtx);
+		// a drain in progress may have missed the latest messages: wait for the one after it
+		const uint64_t NumDrainsToWaitFor = sNumDrainsCompleted + 2;
+		sbWakeRequested.store(true);
+		sWakeCV.notify_one();
+		sDrainCompletedCV.wait(lk, [&]() { return sNumDrainsCompleted >= NumDrainsToWaitFor || !sbEnabled.load(); });
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+//
+// Rate limiting
+//
+//---------------------------------------------------------------------------------------------
+static std::mutex                 sRateLimitersMtx;
+static std::vector<FRateLimiter*> sRateLimiters; // static locals of the call sites: report the pending suppressions on Destroy()
+
+FRateLimiter::FRateLimiter(ELogLevel Level, uint32_t MaxMessagesPerSecond, const char* pFile, int Line)
+	: mLevel(Level)
+	, mMaxMessagesPerSecond(MaxMessagesPerSecond)
+	, mpFile(pFile)
+	, mLine(Line)
+{
+	std::lock_guard<std::mutex> lk(sRateLimitersMtx);
+	sRateLimiters.push_back(this);
+}
+
+bool FRateLimiter::ShouldLog()
+{
+	const int64_t NowMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	int64_t WindowBeginMs = mWindowBeginMs.load(std::memory_order_relaxed);
+	if (NowMs - WindowBeginMs >= 1000 && mWindowBeginMs.compare_exchange_strong(WindowBeginMs, NowMs, std::memory_order_relaxed))
+		mNumMessagesInWindow.store(0, std::memory_order_relaxed);
+
+	// check before incrementing: a flooding call site doesn't keep writing to the counter
+	if (mNumMessagesInWindow.load(std::memory_order_relaxed) >= mMaxMessagesPerSecond
+		|| mNumMessagesInWindow.fetch_add(1, std::memory_order_relaxed) >= mMaxMessagesPerSecond)
+	{
+		mNumSuppressedMessages.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	ReportSuppressedMessages();
+	return true;
+}
+
+void FRateLimiter::ReportSuppressedMessages()
+{
+	const uint32_t NumSuppressed = mNumSuppressedMessages.exchange(0, std::memory_order_relaxed);
+	if (NumSuppressed == 0)
+		return;
+
+	char msg[LEN_MSG_BUFFER];
+	const int len = sprintf_s(msg, "%s(%d): %u similar message(s) suppressed (limit: %u/s)", mpFile, mLine, NumSuppressed, mMaxMessagesPerSecond);
+	Write(mLevel, msg, len > 0 ? static_cast<size_t>(len) : 0);
+}
+
+
 void Initialize(const LogInitializeParams& params)
 {
 	if (params.bLogConsole) InitConsole();
 	if (params.bLogFile)    InitLogFile(params.LogFilePath.c_str());
+	if (params.bLogAsync)
+	{
+		AsyncWriter::Initialize(params.AsyncOverflowPolicy);
+		Log::Info("[Log] Async logging enabled, overflow policy: %s", params.AsyncOverflowPolicy == EAsyncLogOverflowPolicy::BLOCK ? "BLOCK" : "DROP");
+	}
+	if (params.bLogBinary)
+	{
+		const std::string FilePath = ParseAndValidateArgument(params.BinaryLogFilePath.empty() ? DEFAULT_BINARY_LOGFILE_NAME : params.BinaryLogFilePath.c_str());
+		std::string errMsg = "";
+		CreateFolderHierarchy(DirectoryUtil::GetFolderPath(FilePath), errMsg);
+		if (!errMsg.empty())
+			Log::Error("[BinaryLog] %s", errMsg.c_str());
+		BinaryLog::Initialize(FilePath);
+	}
 
 #if LOG_RUN_UNIT_TEST
 	Log::Info("Test");
@@ -171,6 +547,15 @@ void Initialize(const LogInitializeParams& params)
 
 void Destroy()
 {
+	{
+		std::lock_guard<std::mutex> lk(sRateLimitersMtx);
+		for (FRateLimiter* pRateLimiter : sRateLimiters)
+			pRateLimiter->ReportSuppressedMessages();
+	}
+
+	BinaryLog::Destroy();
+	AsyncWriter::Destroy();
+
 	std::string msg = GetCurrentTimeAsStringWithBrackets() + "[Log] Exit()";
 	if (sOutFile.is_open())
 	{
@@ -181,36 +566,17 @@ void Destroy()
 	OutputDebugString(msg.c_str());
 }
 
-void Error(const std::string & s)
+void Flush()
 {
-	std::string err = GetCurrentTimeAsStringWithBrackets() + "  [ERROR]\t: ";
-	err += s + "\n";
-	
-	OutputDebugString(err.c_str());		// vs
-	if (sOutFile.is_open()) 
-		sOutFile << err;				// file
-	cout << err;						// console
-}
-
-void Warning(const std::string & s)
-{
-	std::string warn = GetCurrentTimeAsStringWithBrackets() + "[WARNING]\t: ";
-	warn += s + "\n";
-	
-	OutputDebugString(warn.c_str());
-	if (sOutFile.is_open()) 
-		sOutFile << warn;
-	cout << warn;
+	if (AsyncWriter::sbEnabled.load(std::memory_order_acquire))
+		AsyncWriter::Flush();
 }
 
-void Info(const std::string & s)
+void Write(ELogLevel Level, const char* pMsg, size_t Length)
 {
-	std::string info = GetCurrentTimeAsStringWithBrackets() + "   [INFO]\t: " + s + "\n";
-	OutputDebugString(info.c_str());
-	
-	if (sOutFile.is_open()) 
-		sOutFile << info;
-	cout << info;
+	if (AsyncWriter::sbEnabled.load(std::memory_order_relaxed) && AsyncWriter::TryPush(Level, pMsg, Length))
+		return;
+	WriteToOutputs(GetCurrentTimeAsStringWithBrackets() + LOG_LEVEL_PREFIXES[Level] + std::string(pMsg, Length) + "\n");
 }
 
 }	// namespace Log
\ No newline at end of file
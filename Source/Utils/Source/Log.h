@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 namespace Settings { struct Logger; }
@@ -7,15 +9,70 @@ namespace Settings { struct Logger; }
 
 
 
-#define VARIADIC_LOG_FN(FN_NAME)\
+#define VARIADIC_LOG_FN(FN_NAME, LEVEL)\
 template<class... Args>\
 void FN_NAME(const char* format, Args&&... args)\
 {\
 	char msg[LEN_MSG_BUFFER];\
-	sprintf_s(msg, format, args...);\
-	##FN_NAME(std::string(msg));\
+	const int len = sprintf_s(msg, format, args...);\
+	Write(LEVEL, msg, len > 0 ? static_cast<size_t>(len) : 0);\
 }
 
+//
+// LOG_VERBOSE/INFO/WARNING/ERROR(format, args...)
+//
+// Calls below LOG_COMPILE_TIME_MIN_LEVEL expand to nothing: the arguments aren't evaluated
+// and no formatting code is generated. Levels are numbered as in Log::ELogLevel:
+// 0=VERBOSE 1=INFO 2=WARNING 3=ERROR. Release builds drop VERBOSE unless overridden.
+//
+// LOG_*_RATE_LIMITED(MaxPerSecond, format, args...) logs at most MaxPerSecond messages per
+// second from that call site. The suppressed ones only cost a clock read, their number is
+// reported with the next message that goes through, or on Log::Destroy().
+//
+#ifndef LOG_COMPILE_TIME_MIN_LEVEL
+	#ifdef NDEBUG
+		#define LOG_COMPILE_TIME_MIN_LEVEL 1
+	#else
+		#define LOG_COMPILE_TIME_MIN_LEVEL 0
+	#endif
+#endif
+
+#define LOG_RATE_LIMITED_IMPL(LEVEL, FN_NAME, MAX_PER_SECOND, ...)\
+	do {\
+		static Log::FRateLimiter sLogRateLimiter(LEVEL, MAX_PER_SECOND, __FILE__, __LINE__);\
+		if (sLogRateLimiter.ShouldLog())\
+			FN_NAME(__VA_ARGS__);\
+	} while (0)
+
+#if LOG_COMPILE_TIME_MIN_LEVEL <= 0
+	#define LOG_VERBOSE(...)                  Log::Verbose(__VA_ARGS__)
+	#define LOG_VERBOSE_RATE_LIMITED(N, ...)  LOG_RATE_LIMITED_IMPL(Log::LOG_LEVEL_VERBOSE, Log::Verbose, N, __VA_ARGS__)
+#else
+	#define LOG_VERBOSE(...)                  do {} while (0)
+	#define LOG_VERBOSE_RATE_LIMITED(N, ...)  do {} while (0)
+#endif
+#if LOG_COMPILE_TIME_MIN_LEVEL <= 1
+	#define LOG_INFO(...)                     Log::Info(__VA_ARGS__)
+	#define LOG_INFO_RATE_LIMITED(N, ...)     LOG_RATE_LIMITED_IMPL(Log::LOG_LEVEL_INFO, Log::Info, N, __VA_ARGS__)
+#else
+	#define LOG_INFO(...)                     do {} while (0)
+	#define LOG_INFO_RATE_LIMITED(N, ...)     do {} while (0)
+#endif
+#if LOG_COMPILE_TIME_MIN_LEVEL <= 2
+	#define LOG_WARNING(...)                  Log::Warning(__VA_ARGS__)
+	#define LOG_WARNING_RATE_LIMITED(N, ...)  LOG_RATE_LIMITED_IMPL(Log::LOG_LEVEL_WARNING, Log::Warning, N, __VA_ARGS__)
+#else
+	#define LOG_WARNING(...)                  do {} while (0)
+	#define LOG_WARNING_RATE_LIMITED(N, ...)  do {} while (0)
+#endif
+#if LOG_COMPILE_TIME_MIN_LEVEL <= 3
+	#define LOG_ERROR(...)                    Log::Error(__VA_ARGS__)
+	#define LOG_ERROR_RATE_LIMITED(N, ...)    LOG_RATE_LIMITED_IMPL(Log::LOG_LEVEL_ERROR, Log::Error, N, __VA_ARGS__)
+#else
+	#define LOG_ERROR(...)                    do {} while (0)
+	#define LOG_ERROR_RATE_LIMITED(N, ...)    do {} while (0)
+#endif
+
 namespace Log
 {
 	enum Mode : unsigned	// unused.
@@ -29,24 +86,89 @@ namespace Log
 
 	//---------------------------------------------------------------------------------------------
 
+	enum ELogLevel : unsigned char
+	{
+		LOG_LEVEL_VERBOSE = 0,
+		LOG_LEVEL_INFO,
+		LOG_LEVEL_WARNING,
+		LOG_LEVEL_ERROR,
+
+		NUM_LOG_LEVELS
+	};
+	static_assert(LOG_LEVEL_ERROR == 3, "LOG_COMPILE_TIME_MIN_LEVEL checks assume the ELogLevel values");
+
+	// What a thread does when its async log buffer is full
+	enum EAsyncLogOverflowPolicy
+	{
+		DROP = 0, // discard the message (except errors), the number of dropped messages is logged by the writer thread
+		BLOCK,    // wait for the writer thread to make room
+
+		NUM_ASYNC_LOG_OVERFLOW_POLICIES
+	};
+
+	//---------------------------------------------------------------------------------------------
+
 	constexpr size_t LEN_MSG_BUFFER = 4096;
 	struct LogInitializeParams 
 	{
 		bool bLogConsole        = false;
 		bool bLogFile           = false;
 		std::string LogFilePath = "./";
+
+		// Async mode: logging threads only copy the message into a bounded per-thread ring buffer
+		// (ASYNC_LOG_BUFFER_SIZE_PER_THREAD), a writer thread formats and writes them out in batches.
+		bool                    bLogAsync           = false;
+		EAsyncLogOverflowPolicy AsyncOverflowPolicy = EAsyncLogOverflowPolicy::DROP;
+
+		// Binary mode: enables the BLOG_*() macros (BinaryLog.h), decoded offline by Tools/LogDecoder
+		bool                    bLogBinary          = false;
+		std::string             BinaryLogFilePath   = "";
 	};
+	constexpr size_t ASYNC_LOG_BUFFER_SIZE_PER_THREAD = 64 * 1024;
 
 	//---------------------------------------------------------------------------------------------
 
 	void Initialize(const LogInitializeParams& params);
-	void Destroy();
+	void Destroy(); // writes out all the pending async messages before returning
+
+	// Blocks until the messages logged before the call are written out. No-op in sync mode.
+	void Flush();
 
-	void Info(const std::string& s);
-	void Error(const std::string& s);
-	void Warning(const std::string& s);
+	void Write(ELogLevel Level, const char* pMsg, size_t Length);
+
+	inline void Verbose(const std::string& s) { Write(LOG_LEVEL_VERBOSE, s.data(), s.size()); }
+	inline void Info   (const std::string& s) { Write(LOG_LEVEL_INFO   , s.data(), s.size()); }
+	inline void Error  (const std::string& s) { Write(LOG_LEVEL_ERROR  , s.data(), s.size()); }
+	inline void Warning(const std::string& s) { Write(LOG_LEVEL_WARNING, s.data(), s.size()); }
 	
-	VARIADIC_LOG_FN(Error)
-	VARIADIC_LOG_FN(Warning)
-	VARIADIC_LOG_FN(Info)
+	VARIADIC_LOG_FN(Error  , LOG_LEVEL_ERROR  )
+	VARIADIC_LOG_FN(Warning, LOG_LEVEL_WARNING)
+	VARIADIC_LOG_FN(Info   , LOG_LEVEL_INFO   )
+	VARIADIC_LOG_FN(Verbose, LOG_LEVEL_VERBOSE)
+
+	//---------------------------------------------------------------------------------------------
+
+	// Per call site state of the LOG_*_RATE_LIMITED() macros, a static local of the call site.
+	// Thread-safe, the limit is approximate when several threads hit the call site at once.
+	class FRateLimiter
+	{
+	public:
+		FRateLimiter(ELogLevel Level, uint32_t MaxMessagesPerSecond, const char* pFile, int Line);
+
+		// Returns false if the message should be suppressed. Before returning true, logs
+		// the number of messages suppressed since the last one.
+		bool ShouldLog();
+
+		// logs the number of messages suppressed since the last one, if any
+		void ReportSuppressedMessages();
+
+	private:
+		const ELogLevel       mLevel;
+		const uint32_t        mMaxMessagesPerSecond;
+		const char*           mpFile;
+		const int             mLine;
+		std::atomic<int64_t>  mWindowBeginMs = 0;
+		std::atomic<uint32_t> mNumMessagesInWindow = 0;
+		std::atomic<uint32_t> mNumSuppressedMessages = 0;
+	};
 }
\ No newline at end of file
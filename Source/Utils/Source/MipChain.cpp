@@ -0,0 +1,456 @@
+#include "MipChain.h"
+#include "HalfFloat.h"
+#include "Image.h"
+#include "Log.h"
+#include "Multithreading.h"
+#include "SystemInfo.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include <immintrin.h>
+
+constexpr float KAISER_RADIUS  = 3.0f; // in destination pixels
+constexpr float KAISER_ALPHA   = 4.0f;
+constexpr float LANCZOS_RADIUS = 3.0f;
+
+// linear [0, 1] -> sRGB8 table size: fine enough to stay within ~0.1 LSB of the exact conversion
+constexpr int LINEAR_TO_SRGB8_TABLE_SIZE = 16384;
+
+//
+// Color conversion
+//
+static float SRGBToLinearExact(float c) { return c <= 0.04045f   ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); }
+static float LinearToSRGBExact(float c) { return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f; }
+
+struct FColorConversionTables
+{
+	FColorConversionTables()
+	{
+		for (int i = 0; i < 256; ++i)
+		{
+			SRGB8ToLinear[i] = SRGBToLinearExact(i / 255.0f);
+			UNorm8ToFloat[i] = i / 255.0f;
+		}
+		for (int i = 0; i < LINEAR_TO_SRGB8_TABLE_SIZE; ++i)
+			LinearToSRGB8[i] = static_cast<uint8_t>(LinearToSRGBExact(i / float(LINEAR_TO_SRGB8_TABLE_SIZE - 1)) * 255.0f + 0.5f);
+	}
+	std::array<float  , 256>                        SRGB8ToLinear;
+	std::array<float  , 256>                        UNorm8ToFloat;
+	std::array<uint8_t, LINEAR_TO_SRGB8_TABLE_SIZE> LinearToSRGB8;
+};
+static const FColorConversionTables& GetColorConversionTables()
+{
+	static const FColorConversionTables sTables;
+	return sTables;
+}
+
+static void DecodeRow_RGBA8(const uint8_t* pSrc, float* pDst, int NumPixels, bool bSRGB)
+{
+	const FColorConversionTables& Tables = GetColorConversionTables();
+	const float* pRGB   = bSRGB ? Tables.SRGB8ToLinear.data() : Tables.UNorm8ToFloat.data();
+	const float* pAlpha = Tables.UNorm8ToFloat.data();
+	for (int i = 0; i < NumPixels * 4; i += 4)
+	{
+		pDst[i + 0] = pRGB[pSrc[i + 0]];
+		pDst[i + 1] = pRGB[pSrc[i + 1]];
+		pDst[i + 2] = pRGB[pSrc[i + 2]];
+		pDst[i + 3] = pAlpha[pSrc[i + 3]];
+	}
+}
+
+static void EncodeRow_RGBA8(const float* pSrc, uint8_t* pDst, int NumPixels, bool bSRGB)
+{
+	const __m128 vZero = _mm_setzero_ps();
+	const __m128 vOne  = _mm_set1_ps(1.0f);
+	const __m128 vHalf = _mm_set1_ps(0.5f);
+	if (bSRGB)
+	{
+		const uint8_t* pTable = GetColorConversionTables().LinearToSRGB8.data();
+		const __m128 vScale = _mm_setr_ps(LINEAR_TO_SRGB8_TABLE_SIZE - 1, LINEAR_TO_SRGB8_TABLE_SIZE - 1, LINEAR_TO_SRGB8_TABLE_SIZE - 1, 255.0f); // RGB: table index, A: value
+		for (int i = 0; i < NumPixels * 4; i += 4)
+		{
+			const __m128  v    = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pSrc + i), vZero), vOne); // max() first: NaN -> 0
+			const __m128i vIdx = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, vScale), vHalf));
+			pDst[i + 0] = pTable[_mm_cvtsi128_si32(vIdx)];
+			pDst[i + 1] = pTable[_mm_cvtsi128_si32(_mm_shuffle_epi32(vIdx, _MM_SHUFFLE(1, 1, 1, 1)))]; // SSE2 only: no _mm_extract_epi32()
+			pDst[i + 2] = pTable[_mm_cvtsi128_si32(_mm_shuffle_epi32(vIdx, _MM_SHUFFLE(2, 2, 2, 2)))];
+			pDst[i + 3] = static_cast<uint8_t>(_mm_cvtsi128_si32(_mm_shuffle_epi32(vIdx, _MM_SHUFFLE(3, 3, 3, 3))));
+		}
+	}
+	else
+	{
+		const __m128 vScale = _mm_set1_ps(255.0f);
+		for (int i = 0; i < NumPixels * 4; i += 4)
+		{
+			const __m128  v  = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pSrc + i), vZero), vOne);
+			const __m128i v8 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, vScale), vHalf));
+			const __m128i v16 = _mm_packs_epi32(v8, v8);
+			const int32_t Packed = _mm_cvtsi128_si32(_mm_packus_epi16(v16, v16));
+			memcpy(pDst + i, &Packed, sizeof(Packed));
+		}
+	}
+}
+
+//
+// Filters
+//
+static float Sinc(float x)
+{
+	x *= 3.14159265358979f;
+	return std::abs(x) < 1e-5f ? 1.0f : std::sin(x) / x;
+}
+
+// modified Bessel function of the first kind, order 0
+static double BesselI0(double x)
+{
+	double Sum = 1.0, Term = 1.0;
+	const double HalfXSq = 0.25 * x * x;
+	for (int k = 1; k < 32 && Term > 1e-12 * Sum; ++k)
+	{
+		Term *= HalfXSq / (double(k) * k);
+		Sum += Term;
+	}
+	return Sum;
+}
+
+static float GetFilterRadius(EMipFilter Filter)
+{
+	switch (Filter)
+	{
+	case MIP_FILTER_KAISER : return KAISER_RADIUS;
+	case MIP_FILTER_LANCZOS: return LANCZOS_RADIUS;
+	default                : return 0.5f;
+	}
+}
+
+// @x: distance to the filter center in destination pixels
+static float EvaluateFilter(EMipFilter Filter, float x)
+{
+	switch (Filter)
+	{
+	case MIP_FILTER_KAISER:
+	{
+		if (std::abs(x) >= KAISER_RADIUS)
+			return 0.0f;
+		const float t = x / KAISER_RADIUS;
+		static const double sInvI0Alpha = 1.0 / BesselI0(KAISER_ALPHA);
+		return Sinc(x) * static_cast<float>(BesselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) * sInvI0Alpha);
+	}
+	case MIP_FILTER_LANCZOS:
+		return std::abs(x) < LANCZOS_RADIUS ? Sinc(x) * Sinc(x / LANCZOS_RADIUS) : 0.0f;
+	default:
+		return std::abs(x) <= 0.5f ? 1.0f : 0.0f;
+	}
+}
+
+// Normalized weights of a separable 1D downsampling filter. The taps of each destination pixel are
+// a contiguous range of NumTaps source pixels (zero-padded), out of bounds taps are clamped to the edge.
+struct FFilterWeights
+{
+	int                NumTaps = 0;
+	std::vector<int>   First;   // per destination pixel: first source pixel
+	std::vector<float> Weights; // per destination pixel: NumTaps weights
+};
+
+static FFilterWeights ComputeFilterWeights(EMipFilter Filter, int SrcSize, int DstSize)
+{
+	const double Scale   = double(SrcSize) / DstSize; // source pixels per destination pixel
+	const double Support = GetFilterRadius(Filter) * Scale;
+
+	FFilterWeights W;
+	W.NumTaps = std::min(SrcSize, static_cast<int>(std::ceil(2.0 * Support)) + 2);
+	W.First.resize(DstSize);
+	W.Weights.resize(static_cast<size_t>(DstSize) * W.NumTaps, 0.0f);
+
+	for (int i = 0; i < DstSize; ++i)
+	{
+		const double Center = (i + 0.5) * Scale;
+		const int jBegin = static_cast<int>(std::floor(Center - Support));
+		const int jEnd   = static_cast<int>(std::ceil (Center + Support));
+		W.First[i] = std::min(std::max(jBegin, 0), SrcSize - W.NumTaps);
+
+		float* pWeights = &W.Weights[static_cast<size_t>(i) * W.NumTaps];
+		double Sum = 0.0;
+		for (int j = jBegin; j < jEnd; ++j)
+		{
+			const double w = Filter == MIP_FILTER_BOX
+				? std::max(0.0, std::min(j + 1.0, Center + Support) - std::max(double(j), Center - Support)) // area coverage
+				: EvaluateFilter(Filter, static_cast<float>((j + 0.5 - Center) / Scale));
+			const int k = std::min(std::max(j, 0), SrcSize - 1) - W.First[i];
+			assert(k >= 0 && k < W.NumTaps);
+			pWeights[k] += static_cast<float>(w);
+			Sum += w;
+		}
+		for (int k = 0; k < W.NumTaps; ++k)
+			pWeights[k] = static_cast<float>(pWeights[k] / Sum);
+	}
+	return W;
+}
+
+//
+// Kernels: RGBA32F rows, 1 pixel = 1x __m128
+//
+// pDst[x] = average of the 2x2 pixels at (2x, 2x+1) of pRow0 & pRow1
+static void BoxDownsampleRow_SSE(const float* pRow0, const float* pRow1, float* pDst, int DstWidth)
+{
+	const __m128 vQuarter = _mm_set1_ps(0.25f);
+	for (int x = 0; x < DstWidth; ++x)
+	{
+		const __m128 Sum0 = _mm_add_ps(_mm_loadu_ps(pRow0 + x * 8), _mm_loadu_ps(pRow0 + x * 8 + 4));
+		const __m128 Sum1 = _mm_add_ps(_mm_loadu_ps(pRow1 + x * 8), _mm_loadu_ps(pRow1 + x * 8 + 4));
+		_mm_storeu_ps(pDst + x * 4, _mm_mul_ps(_mm_add_ps(Sum0, Sum1), vQuarter));
+	}
+}
+static void BoxDownsampleRow_AVX2(const float* pRow0, const float* pRow1, float* pDst, int DstWidth)
+{
+	const __m256 vQuarter = _mm256_set1_ps(0.25f);
+	int x = 0;
+	for (; x + 2 <= DstWidth; x += 2)
+	{
+		const __m256 a = _mm256_add_ps(_mm256_loadu_ps(pRow0 + x * 8    ), _mm256_loadu_ps(pRow1 + x * 8    )); // columns 2x  , 2x+1
+		const __m256 b = _mm256_add_ps(_mm256_loadu_ps(pRow0 + x * 8 + 8), _mm256_loadu_ps(pRow1 + x * 8 + 8)); // columns 2x+2, 2x+3
+		const __m256 Sum = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+		_mm256_storeu_ps(pDst + x * 4, _mm256_mul_ps(Sum, vQuarter));
+	}
+	BoxDownsampleRow_SSE(pRow0 + x * 8, pRow1 + x * 8, pDst + x * 4, DstWidth - x);
+}
+
+static void FilterRowHorizontal_SSE(const float* pSrc, float* pDst, int DstWidth, const FFilterWeights& W)
+{
+	for (int x = 0; x < DstWidth; ++x)
+	{
+		const float* pS = pSrc + static_cast<size_t>(W.First[x]) * 4;
+		const float* pW = &W.Weights[static_cast<size_t>(x) * W.NumTaps];
+		__m128 Acc = _mm_setzero_ps();
+		for (int k = 0; k < W.NumTaps; ++k)
+			Acc = _mm_add_ps(Acc, _mm_mul_ps(_mm_set1_ps(pW[k]), _mm_loadu_ps(pS + k * 4)));
+		_mm_storeu_ps(pDst + x * 4, Acc);
+	}
+}
+static void FilterRowHorizontal_AVX2(const float* pSrc, float* pDst, int DstWidth, const FFilterWeights& W)
+{
+	const __m256i vBroadcastPair = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1); // [w0 w1] -> [w0 w0 w0 w0 w1 w1 w1 w1]
+	for (int x = 0; x < DstWidth; ++x)
+	{
+		const float* pS = pSrc + static_cast<size_t>(W.First[x]) * 4;
+		const float* pW = &W.Weights[static_cast<size_t>(x) * W.NumTaps];
+		__m256 Acc = _mm256_setzero_ps();
+		int k = 0;
+		for (; k + 2 <= W.NumTaps; k += 2) // 2 taps / iteration
+		{
+			const __m256 vW = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pW + k)))), vBroadcastPair);
+			Acc = _mm256_fmadd_ps(vW, _mm256_loadu_ps(pS + k * 4), Acc);
+		}
+		__m128 Acc4 = _mm_add_ps(_mm256_castps256_ps128(Acc), _mm256_extractf128_ps(Acc, 1));
+		if (k < W.NumTaps)
+			Acc4 = _mm_fmadd_ps(_mm_set1_ps(pW[k]), _mm_loadu_ps(pS + k * 4), Acc4);
+		_mm_storeu_ps(pDst + x * 4, Acc4);
+	}
+}
+
+// pDst[i] = sum_k Weights[k] * ppSrcRows[k][i], @NumFloats is a multiple of 4
+static void FilterRowVertical_SSE(const float* const* ppSrcRows, const float* pWeights, int NumTaps, float* pDst, size_t NumFloats, size_t iBegin = 0)
+{
+	for (size_t i = iBegin; i < NumFloats; i += 4)
+	{
+		__m128 Acc = _mm_setzero_ps();
+		for (int k = 0; k < NumTaps; ++k)
+			Acc = _mm_add_ps(Acc, _mm_mul_ps(_mm_set1_ps(pWeights[k]), _mm_loadu_ps(ppSrcRows[k] + i)));
+		_mm_storeu_ps(pDst + i, Acc);
+	}
+}
+static void FilterRowVertical_AVX2(const float* const* ppSrcRows, const float* pWeights, int NumTaps, float* pDst, size_t NumFloats)
+{
+	size_t i = 0;
+	for (; i + 8 <= NumFloats; i += 8)
+	{
+		__m256 Acc = _mm256_setzero_ps();
+		for (int k = 0; k < NumTaps; ++k)
+			Acc = _mm256_fmadd_ps(_mm256_set1_ps(pWeights[k]), _mm256_loadu_ps(ppSrcRows[k] + i), Acc);
+		_mm256_storeu_ps(pDst + i, Acc);
+	}
+	FilterRowVertical_SSE(ppSrcRows, pWeights, NumTaps, pDst, NumFloats, i);
+}
+
+static bool UseAVX2()
+{
+	static const bool sbUseAVX2 = SystemInfo::GetCPUFeatures().bAVX2 && SystemInfo::GetCPUFeatures().bFMA;
+	return sbUseAVX2;
+}
+static void BoxDownsampleRow(const float* pRow0, const float* pRow1, float* pDst, int DstWidth)
+{
+	if (UseAVX2()) BoxDownsampleRow_AVX2(pRow0, pRow1, pDst, DstWidth);
+	else           BoxDownsampleRow_SSE (pRow0, pRow1, pDst, DstWidth);
+}
+static void FilterRowHorizontal(const float* pSrc, float* pDst, int DstWidth, const FFilterWeights& W)
+{
+	if (UseAVX2()) FilterRowHorizontal_AVX2(pSrc, pDst, DstWidth, W);
+	else           FilterRowHorizontal_SSE (pSrc, pDst, DstWidth, W);
+}
+static void FilterRowVertical(const float* const* ppSrcRows, const float* pWeights, int NumTaps, float* pDst, size_t NumFloats)
+{
+	if (UseAVX2()) FilterRowVertical_AVX2(ppSrcRows, pWeights, NumTaps, pDst, NumFloats);
+	else           FilterRowVertical_SSE (ppSrcRows, pWeights, NumTaps, pDst, NumFloats);
+}
+
+//
+// Mip chain
+//
+template<class F> static void ForEachRow(ThreadPool* pWorkers, int NumRows, F&& fn)
+{
+	if (pWorkers)
+		pWorkers->ParallelFor(0, static_cast<size_t>(NumRows), [&fn](size_t y) { fn(static_cast<int>(y)); });
+	else
+		for (int y = 0; y < NumRows; ++y)
+			fn(y);
+}
+
+FMipChain GenerateMipChain(const Image& img, const FMipChainDesc& Desc, ThreadPool* pWorkers)
+{
+	FMipChain Chain;
+	if (!img.IsValid())
+	{
+		Log::Error("GenerateMipChain(): invalid image");
+		return Chain;
+	}
+
+	const bool bFloat = img.IsHDR();
+	const bool bSRGB = Desc.bSRGB && !bFloat;
+	Chain.BytesPerPixel = bFloat ? 16 : 4; // stb_image is always asked for 4 components
+	assert(img.BytesPerPixel == Chain.BytesPerPixel);
+
+	const unsigned short NumMipsFullChain = Image::CalculateMipLevelCount(img.Width, img.Height);
+	const unsigned short NumMips = Desc.MaxNumMips > 0 ? std::min(Desc.MaxNumMips, NumMipsFullChain) : NumMipsFullChain;
+
+	size_t SizeInBytes = 0;
+	Chain.Levels.resize(NumMips);
+	for (unsigned short iMip = 0; iMip < NumMips; ++iMip)
+	{
+		FMipLevel& Level = Chain.Levels[iMip];
+		Level.Width    = std::max(1, img.Width  >> iMip);
+		Level.Height   = std::max(1, img.Height >> iMip);
+		Level.RowPitch = static_cast<size_t>(Level.Width) * Chain.BytesPerPixel;
+		Level.Offset   = SizeInBytes;
+		SizeInBytes += Level.RowPitch * Level.Height;
+	}
+	Chain.pData.reset(new uint8_t[SizeInBytes]);
+	Chain.SizeInBytes = SizeInBytes;
+	memcpy(Chain.pData.get(), img.pData, Chain.Levels[0].RowPitch * Chain.Levels[0].Height);
+	if (NumMips == 1)
+		return Chain;
+
+	// RGBA32F levels are filtered in place in the chain. RGBA8 levels are quantized, so the filtering runs
+	// on linear float copies of the levels (ping-pong buffers), level 0 is decoded row by row as it's read.
+	std::array<std::vector<float>, 2> LinearLevels;
+	if (!bFloat)
+	{
+		for (int iMip = 1; iMip < NumMips && iMip < 3; ++iMip) // the largest level of each parity
+			LinearLevels[iMip & 1].resize(static_cast<size_t>(Chain.Levels[iMip].Width) * Chain.Levels[iMip].Height * 4);
+	}
+	auto fnGetLinearLevel = [&](int iMip) -> float*
+	{
+		return bFloat
+			? reinterpret_cast<float*>(Chain.GetLevelData(iMip))
+			: LinearLevels[iMip & 1].data();
+	};
+	// returns row @y of level @iMip as RGBA32F, @pScratch (Width * 4 floats) is used for decoding RGBA8 level 0
+	auto fnGetSourceRow = [&](int iMip, int y, float* pScratch) -> const float*
+	{
+		const FMipLevel& Level = Chain.Levels[iMip];
+		if (bFloat || iMip > 0)
+			return fnGetLinearLevel(iMip) + static_cast<size_t>(y) * Level.Width * 4;
+		DecodeRow_RGBA8(Chain.pData.get() + y * Level.RowPitch, pScratch, Level.Width, bSRGB);
+		return pScratch;
+	};
+	auto fnEncodeRow = [&](int iMip, int y)
+	{
+		if (bFloat)
+			return; // already in place
+		const FMipLevel& Level = Chain.Levels[iMip];
+		EncodeRow_RGBA8(fnGetLinearLevel(iMip) + static_cast<size_t>(y) * Level.Width * 4, Chain.pData.get() + Level.Offset + y * Level.RowPitch, Level.Width, bSRGB);
+	};
+
+	std::vector<float> Intermediate; // generic filter: horizontally filtered rows of the source level
+	for (int iMip = 1; iMip < NumMips; ++iMip)
+	{
+		// safe point between the levels: texture loads run this as BACKGROUND work on the pools the frames use
+		if (pWorkers)
+			pWorkers->YieldToFrameCriticalTasks();
+
+		const FMipLevel& Src = Chain.Levels[iMip - 1];
+		const FMipLevel& Dst = Chain.Levels[iMip];
+		float* pDstLinear = fnGetLinearLevel(iMip);
+		const size_t DstRowFloats = static_cast<size_t>(Dst.Width) * 4;
+
+		const bool bBoxFastPath = Desc.Filter == MIP_FILTER_BOX && Src.Width == Dst.Width * 2 && Src.Height == Dst.Height * 2;
+		if (bBoxFastPath)
+		{
+			ForEachRow(pWorkers, Dst.Height, [&](int y)
+			{
+				thread_local std::vector<float> tScratch;
+				tScratch.resize(static_cast<size_t>(Src.Width) * 8);
+				const float* pRow0 = fnGetSourceRow(iMip - 1, 2 * y    , tScratch.data());
+				const float* pRow1 = fnGetSourceRow(iMip - 1, 2 * y + 1, tScratch.data() + Src.Width * 4);
+				BoxDownsampleRow(pRow0, pRow1, pDstLinear + y * DstRowFloats, Dst.Width);
+				fnEncodeRow(iMip, y);
+			});
+			continue;
+		}
+
+		// separable filter: source rows -> horizontal pass -> Intermediate -> vertical pass -> destination rows
+		const FFilterWeights WeightsX = ComputeFilterWeights(Desc.Filter, Src.Width , Dst.Width );
+		const FFilterWeights WeightsY = ComputeFilterWeights(Desc.Filter, Src.Height, Dst.Height);
+		Intermediate.resize(DstRowFloats * Src.Height);
+
+		ForEachRow(pWorkers, Src.Height, [&](int y)
+		{
+			thread_local std::vector<float> tScratch;
+			tScratch.resize(static_cast<size_t>(Src.Width) * 4);
+			FilterRowHorizontal(fnGetSourceRow(iMip - 1, y, tScratch.data()), Intermediate.data() + y * DstRowFloats, Dst.Width, WeightsX);
+		});
+		ForEachRow(pWorkers, Dst.Height, [&](int y)
+		{
+			thread_local std::vector<const float*> tSrcRows;
+			tSrcRows.resize(WeightsY.NumTaps);
+			for (int k = 0; k < WeightsY.NumTaps; ++k)
+				tSrcRows[k] = Intermediate.data() + (WeightsY.First[y] + k) * DstRowFloats;
+
+			float* pDstRow = pDstLinear + y * DstRowFloats;
+			FilterRowVertical(tSrcRows.data(), &WeightsY.Weights[static_cast<size_t>(y) * WeightsY.NumTaps], WeightsY.NumTaps, pDstRow, DstRowFloats);
+			if (bFloat) // sharpening filters have negative lobes: don't let them produce negative radiance
+			{
+				for (size_t i = 0; i < DstRowFloats; ++i)
+					pDstRow[i] = std::max(pDstRow[i], 0.0f);
+			}
+			fnEncodeRow(iMip, y);
+		});
+	}
+	return Chain;
+}
+
+void ConvertMipChainToHalf(FMipChain& Chain, ThreadPool* pWorkers)
+{
+	if (!Chain.IsValid() || Chain.BytesPerPixel != 16)
+	{
+		Log::Error("ConvertMipChainToHalf(): expects an RGBA32F mip chain");
+		return;
+	}
+
+	// the levels are tightly packed: the whole chain converts as one array, offsets & pitches halve
+	const size_t NumFloats = Chain.SizeInBytes / sizeof(float);
+	std::unique_ptr<uint8_t[]> pHalfData(new uint8_t[NumFloats * sizeof(uint16_t)]);
+	HalfFloat::FromFloat(reinterpret_cast<const float*>(Chain.pData.get()), reinterpret_cast<uint16_t*>(pHalfData.get()), NumFloats, pWorkers);
+
+	for (FMipLevel& Level : Chain.Levels)
+	{
+		Level.Offset /= 2;
+		Level.RowPitch /= 2;
+	}
+	Chain.pData = std::move(pHalfData);
+	Chain.SizeInBytes = NumFloats * sizeof(uint16_t);
+	Chain.BytesPerPixel = 8;
+}
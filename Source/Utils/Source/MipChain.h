@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct Image;
+class ThreadPool;
+
+enum EMipFilter
+{
+	MIP_FILTER_BOX = 0, // 2x2 average (area coverage for odd dimensions), the fast path
+	MIP_FILTER_KAISER,  // Kaiser-windowed sinc, 3 lobes: sharper than box with little ringing
+	MIP_FILTER_LANCZOS, // Lanczos3: sharpest, rings the most around high contrast edges
+
+	NUM_MIP_FILTERS
+};
+
+struct FMipChainDesc
+{
+	EMipFilter     Filter = MIP_FILTER_BOX;
+	bool           bSRGB = true;   // RGBA8 only: RGB is sRGB encoded and gets filtered in linear space, alpha is always linear
+	unsigned short MaxNumMips = 0; // 0: full chain down to 1x1
+};
+
+struct FMipLevel
+{
+	int    Width = 0;
+	int    Height = 0;
+	size_t Offset = 0;   // in bytes, from FMipChain::pData
+	size_t RowPitch = 0; // tightly packed: Width * BytesPerPixel
+};
+
+//
+// All the mip levels of an image in one contiguous buffer, mip 0 first, tightly packed:
+// the layout Texture::Create() expects for uploading the subresources.
+//
+struct FMipChain
+{
+	std::vector<FMipLevel>     Levels;
+	std::unique_ptr<uint8_t[]> pData; // not a vector: zero-initializing the buffer before filling it is measurable on large images
+	size_t                     SizeInBytes = 0;
+	int                        BytesPerPixel = 0; // 4: RGBA8, 16: RGBA32F, 8: RGBA16F (ConvertMipChainToHalf())
+
+	inline bool IsValid() const { return !Levels.empty(); }
+	inline       void* GetLevelData(size_t iMip)       { return pData.get() + Levels[iMip].Offset; }
+	inline const void* GetLevelData(size_t iMip) const { return pData.get() + Levels[iMip].Offset; }
+};
+
+// Builds the mip chain of an RGBA8 or RGBA32F image (level 0 is a copy of @img).
+// Each level is filtered from the previous one in float, linear space, with SSE/AVX2 kernels.
+// The rows of each level are split across @pWorkers if provided (ParallelFor keeps the rows of
+// the small levels on the calling thread).
+FMipChain GenerateMipChain(const Image& img, const FMipChainDesc& Desc, ThreadPool* pWorkers = nullptr);
+
+// Converts an RGBA32F chain to RGBA16F in a new buffer, for R16G16B16A16_FLOAT textures: halves the memory
+// and the upload size. Uses the F16C kernels of HalfFloat, split across @pWorkers if provided.
+void ConvertMipChainToHalf(FMipChain& Chain, ThreadPool* pWorkers = nullptr);
@@ -1,9 +1,28 @@
 #include "Multithreading.h"
 #include "Utils.h"
 #include "Log.h"
+#include "Profiler.h"
 
 #include <cassert>
 #include <algorithm>
+#include <cmath>
+
+#if defined(_WIN32)
+#pragma comment(lib, "Synchronization.lib") // WaitOnAddress()
+#else
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+static inline void CPUPause() { _mm_pause(); }
+#else
+static inline void CPUPause() { std::this_thread::yield(); }
+#endif
 
 void Semaphore::Wait()
 {
@@ -20,26 +39,207 @@ void Semaphore::Signal()
 	cv.notify_one();
 }
 
+bool LightweightSemaphore::TryWait()
+{
+	int Count = mCount.load(std::memory_order_relaxed);
+	while (Count > 0)
+	{
+		if (mCount.compare_exchange_weak(Count, Count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+			return true;
+	}
+	return false;
+}
+
+void LightweightSemaphore::Wait()
+{
+	static const bool bSpin = std::thread::hardware_concurrency() > 1; // spinning only delays the signaling thread on a single core
+
+	if (bSpin)
+	{
+		for (int i = 0; i < NUM_SPIN_ITERATIONS; ++i)
+		{
+			if (TryWait())
+				return;
+			CPUPause();
+		}
+	}
+
+	while (!TryWait())
+	{
+		// mNumWaiters is incremented before WaitOnCount() compares the count against 0, and Signal()
+		// increments the count before reading mNumWaiters: either the wait returns immediately 
+		// or Signal() sees the waiter and wakes it up.
+		mNumWaiters.fetch_add(1);
+		WaitOnCount();
+		mNumWaiters.fetch_sub(1);
+	}
+}
+
+void LightweightSemaphore::Signal()
+{
+	int Count = mCount.load(std::memory_order_relaxed);
+	do
+	{
+		if (Count >= mMaxCount)
+			return;
+	} while (!mCount.compare_exchange_weak(Count, Count + 1));
+
+	if (mNumWaiters.load() > 0)
+		WakeOneWaiter();
+}
+
+// blocks while the count is 0, may return spuriously
+void LightweightSemaphore::WaitOnCount()
+{
+	int Zero = 0;
+#if defined(_WIN32)
+	WaitOnAddress(&mCount, &Zero, sizeof(mCount), INFINITE);
+#else
+	syscall(SYS_futex, reinterpret_cast<int*>(&mCount), FUTEX_WAIT_PRIVATE, Zero, nullptr, nullptr, 0);
+#endif
+}
+
+void LightweightSemaphore::WakeOneWaiter()
+{
+#if defined(_WIN32)
+	WakeByAddressSingle(&mCount);
+#else
+	syscall(SYS_futex, reinterpret_cast<int*>(&mCount), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+//
+// TaskStoragePool
+//
+namespace TaskStoragePool
+{
+	// upper bound on the recycled blocks kept around after a burst of large tasks
+	constexpr size_t MAX_NUM_FREE_BLOCKS = 4096;
+
+	struct FFreeList
+	{
+		~FFreeList() { for (void* pBlock : Blocks) ::operator delete(pBlock); }
+
+		std::mutex         Mtx;
+		std::vector<void*> Blocks;
+	};
+	static FFreeList& GetFreeList()
+	{
+		static FFreeList FreeList;
+		return FreeList;
+	}
+
+	void* Allocate(size_t NumBytes)
+	{
+		if (NumBytes > BLOCK_SIZE)
+			return ::operator new(NumBytes);
+
+		FFreeList& FreeList = GetFreeList();
+		{
+			std::lock_guard<std::mutex> lk(FreeList.Mtx);
+			if (!FreeList.Blocks.empty())
+			{
+				void* pBlock = FreeList.Blocks.back();
+				FreeList.Blocks.pop_back();
+				return pBlock;
+			}
+		}
+		return ::operator new(BLOCK_SIZE);
+	}
+
+	void Free(void* pBlock, size_t NumBytes)
+	{
+		if (NumBytes <= BLOCK_SIZE)
+		{
+			FFreeList& FreeList = GetFreeList();
+			std::lock_guard<std::mutex> lk(FreeList.Mtx);
+			if (FreeList.Blocks.size() < MAX_NUM_FREE_BLOCKS)
+			{
+				FreeList.Blocks.push_back(pBlock);
+				return;
+			}
+		}
+		::operator delete(pBlock);
+	}
+}
+
 static void SetThreadName(std::thread& th, const wchar_t* threadName) {
 	HRESULT hr = SetThreadDescription(th.native_handle(), threadName);
 	if (FAILED(hr)) {
 		// Handle error if needed
 	}
 }
-void ThreadPool::Initialize(size_t numThreads, const std::string& ThreadPoolName, unsigned int MarkerColor)
+bool SetThreadAffinity(std::thread& th, const FThreadAffinity& Affinity)
+{
+	if (Affinity.LogicalProcessors.empty())
+		return true;
+
+#if defined(_WIN32)
+	GROUP_AFFINITY GroupAffinity = {};
+	GroupAffinity.Group = static_cast<WORD>(Affinity.LogicalProcessors.front() / 64);
+	for (uint32_t LogicalProcessor : Affinity.LogicalProcessors)
+	{
+		if (LogicalProcessor / 64 == GroupAffinity.Group)
+			GroupAffinity.Mask |= KAFFINITY(1) << (LogicalProcessor % 64);
+	}
+	return SetThreadGroupAffinity(th.native_handle(), &GroupAffinity, nullptr) != 0;
+#else
+	cpu_set_t CPUSet;
+	CPU_ZERO(&CPUSet);
+	for (uint32_t LogicalProcessor : Affinity.LogicalProcessors)
+		CPU_SET(LogicalProcessor, &CPUSet);
+	return pthread_setaffinity_np(th.native_handle(), sizeof(CPUSet), &CPUSet) == 0;
+#endif
+}
+
+// Set for the lifetime of the worker threads so that tasks added from within a task land on 
+// the calling worker's own deque (WORK_STEALING), and so that workers find their own stats counters.
+static thread_local ThreadPool* tpWorkerThreadPool = nullptr;
+static thread_local size_t      tWorkerIndex       = 0;
+
+void ThreadPool::Initialize(size_t numThreads, const std::string& ThreadPoolName, unsigned int MarkerColor, EThreadPoolSchedulingMode SchedulingMode, const std::vector<FThreadAffinity>& WorkerAffinities)
 {
 	mMarkerColor = MarkerColor;
 	mThreadPoolName = ThreadPoolName;
+	mSchedulingMode = SchedulingMode;
 	mbStopWorkers.store(false);
+
+	mWorkerCounters.resize(numThreads + 1); // + non-worker threads
+	for (std::unique_ptr<FWorkerCounters>& pCounters : mWorkerCounters)
+		pCounters = std::make_unique<FWorkerCounters>();
+	mStatsResetTime = TaskClock::now();
+
+	if (mSchedulingMode == EThreadPoolSchedulingMode::WORK_STEALING)
+	{
+		mWorkerQueues.resize(numThreads);
+		for (std::unique_ptr<WorkStealingQueue>& pQueue : mWorkerQueues)
+			pQueue = std::make_unique<WorkStealingQueue>();
+	}
+
 	for (auto i = 0u; i < numThreads; ++i)
 	{
-		mWorkers.emplace_back(std::thread(&ThreadPool::Execute, this));
+		if (mSchedulingMode == EThreadPoolSchedulingMode::WORK_STEALING)
+			mWorkers.emplace_back(std::thread(&ThreadPool::Execute_WorkStealing, this, i));
+		else
+			mWorkers.emplace_back(std::thread(&ThreadPool::Execute, this, i));
 		SetThreadName(mWorkers.back(), StrUtil::ASCIIToUnicode(ThreadPoolName).c_str());
+
+		if (!WorkerAffinities.empty())
+		{
+			const FThreadAffinity& Affinity = WorkerAffinities[i % WorkerAffinities.size()];
+			if (!Affinity.LogicalProcessors.empty() && !SetThreadAffinity(mWorkers.back(), Affinity))
+				Log::Warning("[%s] Couldn't set the affinity of worker %u", ThreadPoolName.c_str(), i);
+		}
 	}
 }
 void ThreadPool::Destroy()
 {
-	mbStopWorkers.store(true);
+	{
+		// take the lock so a worker can't miss the notification between 
+		// evaluating its wait predicate and going to sleep.
+		std::lock_guard<std::mutex> lk(mMtx);
+		mbStopWorkers.store(true);
+	}
 
 	mCondVar.notify_all();
 
@@ -51,17 +251,255 @@ void ThreadPool::Destroy()
 
 void ThreadPool::RunRemainingTasksOnThisThread()
 {
-	Task task; 
-	while (mTaskQueue.IsQueueEmpty())
+	FQueuedTask task;
+	while (TryGetTask(task, ETaskPriority::BACKGROUND))
+		RunQueuedTask(task);
+}
+
+size_t ThreadPool::YieldToFrameCriticalTasks()
+{
+	if (!HasPendingFrameCriticalTasks())
+		return 0;
+
+	size_t NumTasksExecuted = 0;
+	FQueuedTask task;
+	while (TryGetTask(task, ETaskPriority::FRAME_CRITICAL))
+	{
+		RunQueuedTask(task);
+		++NumTasksExecuted;
+	}
+	return NumTasksExecuted;
+}
+
+ThreadPool::FLaneStats ThreadPool::GetLaneStats(ETaskPriority Priority) const
+{
+	uint64_t TotalWaitNs = 0;
+	uint64_t MaxWaitNs = 0;
+	FLaneStats Stats = {};
+	for (const std::unique_ptr<FWorkerCounters>& pCounters : mWorkerCounters)
+	{
+		const FLaneCounters& c = pCounters->Lanes[Priority];
+		Stats.NumTasks += c.NumTasks.load(std::memory_order_relaxed);
+		TotalWaitNs    += c.TotalWaitNs.load(std::memory_order_relaxed);
+		MaxWaitNs       = std::max(MaxWaitNs, c.MaxWaitNs.load(std::memory_order_relaxed));
+	}
+	Stats.AvgWaitTimeMs  = Stats.NumTasks ? (TotalWaitNs * 1e-6) / Stats.NumTasks : 0.0;
+	Stats.MaxWaitTimeMs  = MaxWaitNs * 1e-6;
+	Stats.NumQueuedTasks = std::max(0, mNumQueuedTasksPerLane[Priority].load(std::memory_order_relaxed));
+	return Stats;
+}
+
+void ThreadPool::ResetLaneStats()
+{
+	for (std::unique_ptr<FWorkerCounters>& pCounters : mWorkerCounters)
+	{
+		for (FLaneCounters& c : pCounters->Lanes)
+		{
+			c.NumTasks.store(0, std::memory_order_relaxed);
+			c.TotalWaitNs.store(0, std::memory_order_relaxed);
+			c.MaxWaitNs.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+ThreadPool::FStats ThreadPool::GetStats() const
+{
+	const double ElapsedMs = std::chrono::duration<double, std::milli>(TaskClock::now() - mStatsResetTime).count();
+	auto fnGetWorkerStats = [ElapsedMs](const FWorkerCounters& c, bool bWorkerThread)
+	{
+		FWorkerStats Stats = {};
+		Stats.NumTasks    = c.NumTasks.load(std::memory_order_relaxed);
+		Stats.NumSteals   = c.NumSteals.load(std::memory_order_relaxed);
+		Stats.BusyTimeMs  = c.BusyNs.load(std::memory_order_relaxed) * 1e-6;
+		Stats.IdleTimeMs  = bWorkerThread ? std::max(0.0, ElapsedMs - Stats.BusyTimeMs) : 0.0;
+		Stats.Utilization = bWorkerThread && ElapsedMs > 0.0 ? std::min(1.0, Stats.BusyTimeMs / ElapsedMs) : 0.0;
+		return Stats;
+	};
+
+	FStats Stats = {};
+	Stats.ElapsedTimeMs  = ElapsedMs;
+	for (size_t i = 0; i < mWorkerCounters.size(); ++i)
+	{
+		const FWorkerCounters& c = *mWorkerCounters[i];
+		const bool bWorkerThread = i < mWorkers.size();
+		const FWorkerStats WorkerStats = fnGetWorkerStats(c, bWorkerThread);
+		if (bWorkerThread) Stats.Workers.push_back(WorkerStats);
+		else               Stats.ExternalThreads = WorkerStats;
+
+		Stats.NumTasks += WorkerStats.NumTasks;
+		Stats.PeakQueueDepth = std::max(Stats.PeakQueueDepth, static_cast<int>(c.PeakQueueDepth.load(std::memory_order_relaxed)));
+		for (size_t iBucket = 0; iBucket < FTimeHistogram::NUM_BUCKETS; ++iBucket)
+		{
+			Stats.WaitTime.Counts[iBucket]      += c.WaitTimeHistogram[iBucket].load(std::memory_order_relaxed);
+			Stats.ExecutionTime.Counts[iBucket] += c.ExecutionTimeHistogram[iBucket].load(std::memory_order_relaxed);
+		}
+	}
+	return Stats;
+}
+
+void ThreadPool::ResetStats()
+{
+	for (std::unique_ptr<FWorkerCounters>& pCounters : mWorkerCounters)
+	{
+		FWorkerCounters& c = *pCounters;
+		c.NumTasks.store(0, std::memory_order_relaxed);
+		c.NumSteals.store(0, std::memory_order_relaxed);
+		c.BusyNs.store(0, std::memory_order_relaxed);
+		c.PeakQueueDepth.store(0, std::memory_order_relaxed);
+		for (std::atomic<uint64_t>& Count : c.WaitTimeHistogram)      Count.store(0, std::memory_order_relaxed);
+		for (std::atomic<uint64_t>& Count : c.ExecutionTimeHistogram) Count.store(0, std::memory_order_relaxed);
+	}
+	ResetLaneStats();
+	mStatsResetTime = TaskClock::now();
+}
+
+void ThreadPool::LogStats() const
+{
+	const FStats Stats = GetStats();
+	const char* pName = mThreadPoolName.c_str();
+	Log::Info("[%s] %llu tasks in %.1fms, peak queue depth: %d", pName, Stats.NumTasks, Stats.ElapsedTimeMs, Stats.PeakQueueDepth);
+	Log::Info("[%s]   Wait time (ms)      : p50 <= %.3f | p90 <= %.3f | p99 <= %.3f", pName
+		, Stats.WaitTime.GetPercentileMs(0.50), Stats.WaitTime.GetPercentileMs(0.90), Stats.WaitTime.GetPercentileMs(0.99));
+	Log::Info("[%s]   Execution time (ms) : p50 <= %.3f | p90 <= %.3f | p99 <= %.3f", pName
+		, Stats.ExecutionTime.GetPercentileMs(0.50), Stats.ExecutionTime.GetPercentileMs(0.90), Stats.ExecutionTime.GetPercentileMs(0.99));
+	for (size_t i = 0; i < Stats.Workers.size(); ++i)
+	{
+		const FWorkerStats& w = Stats.Workers[i];
+		Log::Info("[%s]   Worker %-2zu : %6llu tasks | %5llu steals | busy %8.1fms | idle %8.1fms | utilization %5.1f%%", pName
+			, i, w.NumTasks, w.NumSteals, w.BusyTimeMs, w.IdleTimeMs, w.Utilization * 100.0);
+	}
+	Log::Info("[%s]   Other threads : %6llu tasks | busy %8.1fms", pName, Stats.ExternalThreads.NumTasks, Stats.ExternalThreads.BusyTimeMs);
+}
+
+ThreadPool::FWorkerCounters& ThreadPool::GetCountersOfCallingThread(bool& bSingleWriter)
+{
+	bSingleWriter = tpWorkerThreadPool == this;
+	return *mWorkerCounters[bSingleWriter ? tWorkerIndex : mWorkers.size()];
+}
+
+// Worker counters only have one writer: a plain load/store is enough and cheaper than a locked RMW.
+static inline void AddToCounter(std::atomic<uint64_t>& Counter, uint64_t Value, bool bSingleWriter)
+{
+	if (bSingleWriter)
+		Counter.store(Counter.load(std::memory_order_relaxed) + Value, std::memory_order_relaxed);
+	else
+		Counter.fetch_add(Value, std::memory_order_relaxed);
+}
+static inline void UpdateMax(std::atomic<uint64_t>& Max, uint64_t Value, bool bSingleWriter)
+{
+	uint64_t CurrentMax = Max.load(std::memory_order_relaxed);
+	if (bSingleWriter)
+	{
+		if (Value > CurrentMax)
+			Max.store(Value, std::memory_order_relaxed);
+		return;
+	}
+	while (Value > CurrentMax && !Max.compare_exchange_weak(CurrentMax, Value, std::memory_order_relaxed));
+}
+
+double FTimeHistogram::GetBucketUpperBoundMs(size_t iBucket)
+{
+	return static_cast<double>(uint64_t(1) << iBucket) * 1e-3;
+}
+
+uint64_t FTimeHistogram::GetNumSamples() const
+{
+	uint64_t NumSamples = 0;
+	for (uint64_t Count : Counts)
+		NumSamples += Count;
+	return NumSamples;
+}
+
+double FTimeHistogram::GetPercentileMs(double Percentile) const
+{
+	const uint64_t NumSamples = GetNumSamples();
+	if (NumSamples == 0)
+		return 0.0;
+
+	const uint64_t Rank = static_cast<uint64_t>(std::ceil(Percentile * NumSamples));
+	uint64_t NumSamplesBelow = 0;
+	for (size_t iBucket = 0; iBucket < NUM_BUCKETS; ++iBucket)
+	{
+		NumSamplesBelow += Counts[iBucket];
+		if (NumSamplesBelow >= Rank)
+			return GetBucketUpperBoundMs(iBucket);
+	}
+	return GetBucketUpperBoundMs(NUM_BUCKETS - 1);
+}
+
+void ThreadPool::AddQueuedTask(FQueuedTask&& task)
+{
+	++mNumQueuedTasksPerLane[task.Priority];
+	if (mSchedulingMode == EThreadPoolSchedulingMode::WORK_STEALING)
 	{
-		mTaskQueue.PopTask(task);
-		task(); 
-		mTaskQueue.OnTaskComplete(); 
+		AddTask_WorkStealing(std::move(task));
+		return;
 	}
+
+	mTaskQueue.AddTask(std::move(task));
+	//Log::Info("[%s] TaskQueue::AddTask()", this->mThreadPoolName.c_str());
+
+	mCondVar.notify_one();
+	//Log::Info("[%s] Signal::NotifyOne()", this->mThreadPoolName.c_str());
 }
-void ThreadPool::Execute()
+
+bool ThreadPool::TryGetTask(FQueuedTask& task, ETaskPriority LowestPriority)
 {
-	Task task;
+	if (mSchedulingMode == EThreadPoolSchedulingMode::WORK_STEALING)
+	{
+		if (mWorkerQueues.empty())
+			return false;
+		const size_t iQueue = tpWorkerThreadPool == this ? tWorkerIndex : 0;
+		return TryGetTask_WorkStealing(iQueue, task, LowestPriority);
+	}
+	return mTaskQueue.TryPopTask(task, LowestPriority);
+}
+
+void ThreadPool::RunQueuedTask(FQueuedTask& task)
+{
+	bool bSingleWriter = false;
+	FWorkerCounters& c = GetCountersOfCallingThread(bSingleWriter);
+
+	// queue depth is sampled when the tasks are picked up rather than on the AddTask() path
+	uint64_t QueueDepth = 0;
+	for (const std::atomic<int>& NumQueuedTasks : mNumQueuedTasksPerLane)
+		QueueDepth += std::max(0, NumQueuedTasks.load(std::memory_order_relaxed));
+	UpdateMax(c.PeakQueueDepth, QueueDepth, bSingleWriter);
+
+	--mNumQueuedTasksPerLane[task.Priority];
+
+	const TaskClock::time_point StartTime = TaskClock::now();
+	const uint64_t WaitNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(StartTime - task.EnqueueTime).count());
+	FLaneCounters& Lane = c.Lanes[task.Priority];
+	AddToCounter(Lane.NumTasks, 1, bSingleWriter);
+	AddToCounter(Lane.TotalWaitNs, WaitNs, bSingleWriter);
+	UpdateMax(Lane.MaxWaitNs, WaitNs, bSingleWriter);
+	AddToCounter(c.WaitTimeHistogram[FTimeHistogram::GetBucketIndex(WaitNs)], 1, bSingleWriter);
+
+	{
+		PROFILE_SCOPE("Task");
+		task.fnTask();
+	}
+	task.fnTask = nullptr; // release captures before signaling completion
+
+	const uint64_t ExecutionNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(TaskClock::now() - StartTime).count());
+	AddToCounter(c.NumTasks, 1, bSingleWriter);
+	AddToCounter(c.BusyNs, ExecutionNs, bSingleWriter);
+	AddToCounter(c.ExecutionTimeHistogram[FTimeHistogram::GetBucketIndex(ExecutionNs)], 1, bSingleWriter);
+
+	if (mSchedulingMode == EThreadPoolSchedulingMode::WORK_STEALING)
+		--mNumActiveTasks;
+	else
+		mTaskQueue.OnTaskComplete();
+}
+
+void ThreadPool::Execute(size_t iWorker)
+{
+	tpWorkerThreadPool = this;
+	tWorkerIndex = iWorker;
+	Profiler::SetThreadName(GetThreadPoolWorkerName() + " " + std::to_string(iWorker), mMarkerColor);
+
+	FQueuedTask task;
 
 	std::unique_lock lock(mMtx, std::defer_lock);
 
@@ -72,22 +510,289 @@ void ThreadPool::Execute()
 
 		if (mbStopWorkers)
 			break;
-		
-		mTaskQueue.PopTask(task);
+
+		// RunRemainingTasksOnThisThread() & YieldToFrameCriticalTasks() pop without mMtx:
+		// the task seen by the predicate may be gone already, go back to waiting
+		const bool bPopped = mTaskQueue.TryPopTask(task);
 
 		lock.unlock();
 
-		task();
-		mTaskQueue.OnTaskComplete();
+		if (!bPopped)
+			continue;
+
+		RunQueuedTask(task);
+	}
+
+	tpWorkerThreadPool = nullptr;
+}
+
+void ThreadPool::Execute_WorkStealing(size_t iWorker)
+{
+	tpWorkerThreadPool = this;
+	tWorkerIndex = iWorker;
+	Profiler::SetThreadName(GetThreadPoolWorkerName() + " " + std::to_string(iWorker), mMarkerColor);
+
+	// number of failed pop/steal rounds before parking the worker on the condition variable
+	constexpr int NUM_SPIN_ROUNDS_BEFORE_SLEEP = 64;
+
+	FQueuedTask task;
+	int NumFailedRounds = 0;
+	while (!mbStopWorkers)
+	{
+		if (TryGetTask_WorkStealing(iWorker, task))
+		{
+			NumFailedRounds = 0;
+			RunQueuedTask(task);
+			continue;
+		}
+
+		if (++NumFailedRounds < NUM_SPIN_ROUNDS_BEFORE_SLEEP)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Nothing to run or steal: park. mNumSleepingWorkers is incremented before the 
+		// predicate reads mNumQueuedTasks, and AddTask_WorkStealing() increments mNumQueuedTasks
+		// before reading mNumSleepingWorkers, so at least one side always observes the other
+		// and a wake-up can't be lost.
+		std::unique_lock<std::mutex> lk(mMtx);
+		++mNumSleepingWorkers;
+		mCondVar.wait(lk, [&] { return mbStopWorkers || mNumQueuedTasks.load() > 0; });
+		--mNumSleepingWorkers;
+		NumFailedRounds = 0;
 	}
+
+	tpWorkerThreadPool = nullptr;
 }
 
-void TaskQueue::PopTask(Task& task)
+void ThreadPool::AddTask_WorkStealing(FQueuedTask&& task)
+{
+	if (mWorkerQueues.empty()) // pool with no workers: nothing would ever pick the task up
+	{
+		++mNumActiveTasks;
+		RunQueuedTask(task);
+		return;
+	}
+
+	// workers push into their own deque, other threads distribute the tasks round-robin
+	const bool bCalledFromWorker = tpWorkerThreadPool == this;
+	const size_t iQueue = bCalledFromWorker
+		? tWorkerIndex
+		: mNextWorkerQueue.fetch_add(1, std::memory_order_relaxed) % mWorkerQueues.size();
+
+	++mNumActiveTasks;
+	mWorkerQueues[iQueue]->Push(std::move(task));
+	++mNumQueuedTasks;
+
+	if (mNumSleepingWorkers.load() > 0)
+	{
+		{ std::lock_guard<std::mutex> lk(mMtx); } // see Execute_WorkStealing()
+		mCondVar.notify_one();
+	}
+}
+
+// Lanes are visited in priority order: a worker steals a FRAME_CRITICAL task from another 
+// worker before it looks at its own NORMAL or BACKGROUND tasks.
+bool ThreadPool::TryGetTask_WorkStealing(size_t iWorker, FQueuedTask& task, ETaskPriority LowestPriority)
+{
+	const size_t NumQueues = mWorkerQueues.size();
+	for (int iLane = 0; iLane <= LowestPriority; ++iLane)
+	{
+		const ETaskPriority Priority = static_cast<ETaskPriority>(iLane);
+		if (mNumQueuedTasksPerLane[Priority].load(std::memory_order_relaxed) <= 0)
+			continue;
+
+		if (mWorkerQueues[iWorker]->TryPop(task, Priority))
+		{
+			--mNumQueuedTasks;
+			return true;
+		}
+
+		// steal: start from the neighbor so that the victims are spread over the workers
+		for (size_t i = 1; i < NumQueues; ++i)
+		{
+			const size_t iVictim = (iWorker + i) % NumQueues;
+			if (mWorkerQueues[iVictim]->TrySteal(task, Priority))
+			{
+				--mNumQueuedTasks;
+				bool bSingleWriter = false;
+				AddToCounter(GetCountersOfCallingThread(bSingleWriter).NumSteals, 1, bSingleWriter);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool TaskQueue::TryPopTask(FQueuedTask& task, ETaskPriority LowestPriority)
 {
 	std::lock_guard<std::mutex> lk(mutex);
-	
-	task = std::move(queue.front());
-	queue.pop();
+	for (int iLane = 0; iLane <= LowestPriority; ++iLane)
+	{
+		std::queue<FQueuedTask>& queue = queues[iLane];
+		if (queue.empty())
+			continue;
+
+		task = std::move(queue.front());
+		queue.pop();
+		return true;
+	}
+	return false;
+}
+
+bool TaskQueue::IsQueueEmpty() const
+{
+	std::lock_guard<std::mutex> lk(mutex);
+	for (const std::queue<FQueuedTask>& queue : queues)
+		if (!queue.empty())
+			return false;
+	return true;
+}
+
+void WorkStealingQueue::Push(FQueuedTask&& task)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	mDeques[task.Priority].push_back(std::move(task));
+}
+
+bool WorkStealingQueue::TryPop(FQueuedTask& task, ETaskPriority Priority)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	std::deque<FQueuedTask>& Deque = mDeques[Priority];
+	if (Deque.empty())
+		return false;
+
+	task = std::move(Deque.back());
+	Deque.pop_back();
+	return true;
+}
+
+bool WorkStealingQueue::TrySteal(FQueuedTask& task, ETaskPriority Priority)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	std::deque<FQueuedTask>& Deque = mDeques[Priority];
+	if (Deque.empty())
+		return false;
+
+	task = std::move(Deque.front());
+	Deque.pop_front();
+	return true;
+}
+
+bool WorkStealingQueue::IsEmpty() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	for (const std::deque<FQueuedTask>& Deque : mDeques)
+		if (!Deque.empty())
+			return false;
+	return true;
+}
+
+void TaskGraph::AddDependency(TaskID Predecessor, TaskID Successor)
+{
+	assert(Predecessor < mTasks.size() && Successor < mTasks.size());
+	assert(Predecessor != Successor);
+	mTasks[Predecessor].Successors.push_back(Successor);
+	++mTasks[Successor].NumPredecessors;
+}
+
+#ifdef _DEBUG
+// Kahn's algorithm: returns true if every task can be reached through the root tasks, i.e. there's no cycle.
+static bool IsAcyclic(const std::deque<TaskGraph::TaskID>& Roots, const std::vector<std::vector<TaskGraph::TaskID>>& Successors, std::vector<int> NumPredecessors)
+{
+	std::deque<TaskGraph::TaskID> Ready = Roots;
+	size_t NumVisited = 0;
+	while (!Ready.empty())
+	{
+		const TaskGraph::TaskID id = Ready.front();
+		Ready.pop_front();
+		++NumVisited;
+		for (TaskGraph::TaskID Successor : Successors[id])
+			if (--NumPredecessors[Successor] == 0)
+				Ready.push_back(Successor);
+	}
+	return NumVisited == Successors.size();
+}
+#endif
+
+void TaskGraph::Dispatch(ThreadPool& pool, ETaskPriority Priority)
+{
+	mpThreadPool = &pool;
+	mPriority = Priority;
+
+	std::deque<TaskID> Roots;
+	for (TaskID id = 0; id < mTasks.size(); ++id)
+	{
+		FTaskNode& node = mTasks[id];
+		node.NumPendingPredecessors.store(node.NumPredecessors);
+		if (node.NumPredecessors == 0)
+			Roots.push_back(id);
+	}
+
+#ifdef _DEBUG
+	{
+		std::vector<std::vector<TaskID>> Successors(mTasks.size());
+		std::vector<int> NumPredecessors(mTasks.size());
+		for (TaskID id = 0; id < mTasks.size(); ++id)
+		{
+			Successors[id] = mTasks[id].Successors;
+			NumPredecessors[id] = mTasks[id].NumPredecessors;
+		}
+		assert(IsAcyclic(Roots, Successors, NumPredecessors)); // a cycle would never complete
+	}
+#endif
+
+	{
+		std::lock_guard<std::mutex> lk(mMtx);
+		mNumPendingTasks = mTasks.size();
+	}
+
+	for (TaskID id : Roots)
+		ScheduleTask(id);
+}
+
+void TaskGraph::Wait()
+{
+	std::unique_lock<std::mutex> lk(mMtx);
+	mCondVar.wait(lk, [&]() { return mNumPendingTasks == 0; });
+}
+
+bool TaskGraph::IsDone() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	return mNumPendingTasks == 0;
+}
+
+void TaskGraph::Reset()
+{
+	assert(IsDone());
+	mTasks.clear();
+	mpThreadPool = nullptr;
+}
+
+void TaskGraph::ScheduleTask(TaskID id)
+{
+	mpThreadPool->AddTaskNoFuture([this, id]()
+	{
+		mTasks[id].fnTask();
+		OnTaskComplete(id);
+	}, mPriority);
+}
+
+void TaskGraph::OnTaskComplete(TaskID id)
+{
+	for (TaskID Successor : mTasks[id].Successors)
+	{
+		if (--mTasks[Successor].NumPendingPredecessors == 0)
+			ScheduleTask(Successor);
+	}
+
+	// The last decrement happens under the lock so that a thread polling IsDone() 
+	// can't observe completion & destroy the graph while we're still in here.
+	std::lock_guard<std::mutex> lk(mMtx);
+	if (--mNumPendingTasks == 0)
+		mCondVar.notify_all();
 }
 
 std::vector<std::pair<size_t, size_t>> PartitionWorkItemsIntoRanges(size_t NumWorkItems, size_t NumWorkerThreadCount)
@@ -3,8 +3,20 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <deque>
 #include <future>
 #include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <type_traits>
+#include <new>
+#include <cstddef>
+#include <array>
+#include <cstdint>
 
 // utility function for checking if a std::future<> is ready without blocking
 template<typename R> bool is_ready(std::future<R> const& f) { return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
@@ -29,27 +41,213 @@ private:
 	std::condition_variable cv;
 };
 
+//
+// Semaphore with the same semantics (count clamped to max) without a mutex or a condition variable:
+// - Signal() is a CAS on the count, and only makes a syscall when a thread is actually parked.
+// - Wait() takes a token with a CAS if available, otherwise spins for a short while 
+//   before parking the thread on the count with WaitOnAddress() (futex on Linux).
+// Intended for the frame handoffs where the other side signals within microseconds most of the time.
+//
+class LightweightSemaphore
+{
+public:
+	// number of pause iterations before parking, skipped on single core machines
+	static constexpr int NUM_SPIN_ITERATIONS = 2048;
+
+	LightweightSemaphore(int val, int max) : mCount(val), mMaxCount(max) {}
+
+	inline void P() { Wait(); }
+	inline void V() { Signal(); }
+	void Wait();
+	void Signal();
+	bool TryWait();
+
+	inline int GetCount() const { return mCount.load(std::memory_order_relaxed); }
+
+private:
+	void WaitOnCount();
+	void WakeOneWaiter();
+
+	std::atomic<int> mCount;
+	std::atomic<int> mNumWaiters = 0;
+	const int        mMaxCount;
+};
+
 
 // --------------------------------------------------------------------------------------------------------------------------------------
 //
 // Thread Pool
 //
 //---------------------------------------------------------------------------------------------------------------------------------------
+//
+// Storage for the captures that don't fit into a Task's inline buffer.
+// Fixed size blocks are recycled through a free list instead of going back to the heap,
+// larger captures fall back to operator new.
+//
+namespace TaskStoragePool
+{
+	constexpr size_t BLOCK_SIZE = 256;
+
+	void* Allocate(size_t NumBytes);
+	void  Free(void* pBlock, size_t NumBytes);
+}
+
+//
+// Move-only void() callable for the thread pools. Unlike std::function<>, a Task
+// - stores captures up to INLINE_STORAGE_SIZE bytes inline, without touching the heap,
+// - accepts move-only callables (std::packaged_task<>, lambdas capturing unique_ptr<>...),
+// - is exactly one cache line.
+//
+class Task
+{
+public:
+	static constexpr size_t INLINE_STORAGE_SIZE      = 48;
+	static constexpr size_t INLINE_STORAGE_ALIGNMENT = 16;
+
+	Task() = default;
+	Task(std::nullptr_t) {}
+	template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task> && !std::is_same_v<std::decay_t<F>, std::nullptr_t>>>
+	Task(F&& fn);
+	Task(Task&& other) noexcept;
+	~Task() { Reset(); }
+
+	Task& operator=(Task&& other) noexcept;
+	Task& operator=(std::nullptr_t) { Reset(); return *this; }
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	inline void operator()() { mpOps->pfnInvoke(mStorage); }
+	inline explicit operator bool() const { return mpOps != nullptr; }
+
+private:
+	struct FOps
+	{
+		void (*pfnInvoke)(void* pStorage);
+		void (*pfnMove)(void* pDst, void* pSrc); // move-constructs pDst from pSrc and destroys pSrc
+		void (*pfnDestroy)(void* pStorage);
+	};
+
+	template<class F> static constexpr bool IsStoredInline() 
+	{ 
+		return sizeof(F) <= INLINE_STORAGE_SIZE 
+			&& alignof(F) <= INLINE_STORAGE_ALIGNMENT
+			&& std::is_nothrow_move_constructible_v<F>;
+	}
+	template<class F> struct FInlineOps;
+	template<class F> struct FPooledOps;
+
+	void Reset();
+
+	alignas(INLINE_STORAGE_ALIGNMENT) unsigned char mStorage[INLINE_STORAGE_SIZE];
+	const FOps* mpOps = nullptr;
+};
+static_assert(sizeof(Task) == 64, "Task is expected to fit a cache line");
+
+template<class F>
+struct Task::FInlineOps
+{
+	static void Invoke(void* pStorage) { (*static_cast<F*>(pStorage))(); }
+	static void Move(void* pDst, void* pSrc) { new (pDst) F(std::move(*static_cast<F*>(pSrc))); static_cast<F*>(pSrc)->~F(); }
+	static void Destroy(void* pStorage) { static_cast<F*>(pStorage)->~F(); }
+	static constexpr FOps OPS = { &Invoke, &Move, &Destroy };
+};
+template<class F>
+struct Task::FPooledOps // mStorage holds a F* pointing into a TaskStoragePool block
+{
+	static F*& Ptr(void* pStorage) { return *static_cast<F**>(pStorage); }
+	static void Invoke(void* pStorage) { (*Ptr(pStorage))(); }
+	static void Move(void* pDst, void* pSrc) { new (pDst) F*(Ptr(pSrc)); }
+	static void Destroy(void* pStorage) { Ptr(pStorage)->~F(); TaskStoragePool::Free(Ptr(pStorage), sizeof(F)); }
+	static constexpr FOps OPS = { &Invoke, &Move, &Destroy };
+};
+
+template<class F, class>
+Task::Task(F&& fn)
+{
+	using FStored = std::decay_t<F>;
+	if constexpr (IsStoredInline<FStored>())
+	{
+		new (mStorage) FStored(std::forward<F>(fn));
+		mpOps = &FInlineOps<FStored>::OPS;
+	}
+	else
+	{
+		static_assert(alignof(FStored) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Over-aligned task captures are not supported");
+		void* pBlock = TaskStoragePool::Allocate(sizeof(FStored));
+		new (mStorage) FStored*(new (pBlock) FStored(std::forward<F>(fn)));
+		mpOps = &FPooledOps<FStored>::OPS;
+	}
+}
+inline Task::Task(Task&& other) noexcept
+{
+	if (other.mpOps)
+	{
+		other.mpOps->pfnMove(mStorage, other.mStorage);
+		mpOps = other.mpOps;
+		other.mpOps = nullptr;
+	}
+}
+inline Task& Task::operator=(Task&& other) noexcept
+{
+	if (this != &other)
+	{
+		Reset();
+		if (other.mpOps)
+		{
+			other.mpOps->pfnMove(mStorage, other.mStorage);
+			mpOps = other.mpOps;
+			other.mpOps = nullptr;
+		}
+	}
+	return *this;
+}
+inline void Task::Reset()
+{
+	if (mpOps)
+	{
+		mpOps->pfnDestroy(mStorage);
+		mpOps = nullptr;
+	}
+}
+
+//
+// Priority lanes of the thread pools. Workers always pick up the tasks of the highest
+// non-empty lane first, the lanes are FIFO within themselves (LIFO for a worker's own
+// deque in WORK_STEALING mode).
+//
+enum ETaskPriority
+{
+	FRAME_CRITICAL = 0, // work the current frame waits on
+	NORMAL,             // default
+	BACKGROUND,         // long running work such as streaming & loading, see ThreadPool::YieldToFrameCriticalTasks()
+
+	NUM_TASK_PRIORITIES
+};
+
+using TaskClock = std::chrono::steady_clock;
+struct FQueuedTask
+{
+	Task                  fnTask;
+	TaskClock::time_point EnqueueTime;
+	ETaskPriority         Priority = ETaskPriority::NORMAL;
+};
+
 //
 // Task Queue for thread pools
 //
-using Task = std::function<void()>;
 class TaskQueue
 {
 
 // http://www.cplusplus.com/reference/thread/thread/
 // https://stackoverflow.com/a/32593825/2034041
 public:
-	template<class T>
-	void AddTask(std::shared_ptr<T>& pTask);
-	void PopTask(Task& task);
+	void AddTask(FQueuedTask&& task);
 
-	inline bool IsQueueEmpty()      const { std::unique_lock<std::mutex> lock(mutex); return queue.empty(); }
+	// pops the oldest task of the highest non-empty lane up to @LowestPriority.
+	// Can fail even if IsQueueEmpty() just returned false: external threads pop without the pool's lock.
+	bool TryPopTask(FQueuedTask& task, ETaskPriority LowestPriority = ETaskPriority::BACKGROUND);
+
+	bool        IsQueueEmpty()      const;
 	inline int  GetNumActiveTasks() const { return activeTasks; }
 
 	// must be called after Task() completes.
@@ -58,16 +256,80 @@ public:
 private:
 	std::atomic<int> activeTasks = 0;
 	mutable std::mutex mutex; // https://stackoverflow.com/a/25521702/2034041
-	std::queue<Task> queue;
+	std::array<std::queue<FQueuedTask>, NUM_TASK_PRIORITIES> queues;
 };
-template<class T>
-inline void TaskQueue::AddTask(std::shared_ptr<T>& pTask)
+inline void TaskQueue::AddTask(FQueuedTask&& task)
 {
 	std::unique_lock<std::mutex> lock(mutex);
-	queue.emplace([=]() { (*pTask)(); });
+	queues[task.Priority].push(std::move(task));
 	++activeTasks;
 }
 
+//
+// Per-worker task deque used by the work-stealing scheduler.
+// The owning worker pushes & pops at the back (LIFO, keeps the most recently 
+// spawned - cache-warm - work local) while idle workers steal from the front 
+// (FIFO, oldest and usually largest work items first). Each deque has its own 
+// lock so contention is spread over the workers instead of a single queue.
+// There's one deque per priority lane.
+//
+class alignas(64) WorkStealingQueue
+{
+public:
+	void Push(FQueuedTask&& task);
+	bool TryPop(FQueuedTask& task, ETaskPriority Priority);
+	bool TrySteal(FQueuedTask& task, ETaskPriority Priority);
+
+	bool IsEmpty() const;
+
+private:
+	mutable std::mutex                                       mMtx;
+	std::array<std::deque<FQueuedTask>, NUM_TASK_PRIORITIES> mDeques;
+};
+
+//
+// Set of logical processors a thread is allowed to run on, no restriction if empty.
+// Processor indices follow the OS numbering: (ProcessorGroup * 64 + Number) on Windows, 
+// see SystemInfo::FCPUTopology for building these from the CPU topology.
+//
+struct FThreadAffinity
+{
+	std::vector<uint32_t> LogicalProcessors;
+};
+// On Windows a thread can only run within a single processor group: the group of the first processor is used.
+bool SetThreadAffinity(std::thread& th, const FThreadAffinity& Affinity);
+
+enum EThreadPoolSchedulingMode
+{
+	SHARED_QUEUE = 0, // single mutex-guarded FIFO, every worker waits on the same condition variable
+	WORK_STEALING,    // per-worker deques, workers pop locally and steal from each other when idle
+
+	NUM_THREAD_POOL_SCHEDULING_MODES
+};
+
+//
+// Log2 histogram of durations: bucket 0 counts the samples under 1us, bucket i the samples in [2^(i-1), 2^i)us.
+//
+struct FTimeHistogram
+{
+	static constexpr size_t NUM_BUCKETS = 24; // the last bucket also counts everything above 2^22us (~4s)
+
+	std::array<uint64_t, NUM_BUCKETS> Counts = {};
+
+	static inline size_t GetBucketIndex(uint64_t DurationNs)
+	{
+		size_t iBucket = 0;
+		for (uint64_t us = DurationNs / 1000; us != 0 && iBucket < NUM_BUCKETS - 1; us >>= 1)
+			++iBucket;
+		return iBucket;
+	}
+	static double GetBucketUpperBoundMs(size_t iBucket);
+
+	uint64_t GetNumSamples() const;
+
+	// Returns the upper bound of the bucket containing the given percentile [0, 1]
+	double GetPercentileMs(double Percentile) const;
+};
 
 
 //
@@ -79,11 +341,16 @@ class ThreadPool
 public:
 	inline static const size_t sHardwareThreadCount = std::thread::hardware_concurrency();
 
-	void Initialize(size_t numWorkers, const std::string& ThreadPoolName, unsigned int MarkerColor = 0xFFAAAAAA);
+	// @WorkerAffinities : optional, worker i runs on WorkerAffinities[i % WorkerAffinities.size()]
+	void Initialize(size_t numWorkers, const std::string& ThreadPoolName, unsigned int MarkerColor = 0xFFAAAAAA
+		, EThreadPoolSchedulingMode SchedulingMode = EThreadPoolSchedulingMode::SHARED_QUEUE
+		, const std::vector<FThreadAffinity>& WorkerAffinities = {}
+	);
 	void Destroy();
 
-	inline int GetNumActiveTasks() const { return IsExiting() ? 0 : mTaskQueue.GetNumActiveTasks(); };
+	inline int GetNumActiveTasks() const { return IsExiting() ? 0 : (mSchedulingMode == WORK_STEALING ? mNumActiveTasks.load() : mTaskQueue.GetNumActiveTasks()); };
 	inline size_t GetThreadPoolSize() const { return mWorkers.size(); }
+	inline EThreadPoolSchedulingMode GetSchedulingMode() const { return mSchedulingMode; }
 	
 	inline std::string GetThreadPoolName() const { return mThreadPoolName; }
 	inline std::string GetThreadPoolWorkerName() const { return mThreadPoolName + "_Worker"; }
@@ -95,10 +362,101 @@ public:
 	// containing the return type of the added task.
 	//
 	template<class T>
-	decltype(auto) AddTask(T&& task);
+	decltype(auto) AddTask(T&& task, ETaskPriority Priority = ETaskPriority::NORMAL);
+
+	// Adds a fire-and-forget task: no std::future<> / shared state is created, 
+	// captures that fit in Task::INLINE_STORAGE_SIZE don't allocate at all.
+	// Use this for the tasks whose completion is tracked by other means (counters, TaskGraph...).
+	//
+	template<class T>
+	void AddTaskNoFuture(T&& task, ETaskPriority Priority = ETaskPriority::NORMAL);
+
+	// Safe point for long running BACKGROUND tasks: runs the queued FRAME_CRITICAL tasks 
+	// on the calling thread before returning to the background work. Cheap when there's none.
+	// Returns the number of tasks executed.
+	size_t YieldToFrameCriticalTasks();
+	inline bool HasPendingFrameCriticalTasks() const { return mNumQueuedTasksPerLane[ETaskPriority::FRAME_CRITICAL].load(std::memory_order_relaxed) > 0; }
+
+	// Time spent by the tasks in the queue of each lane, from AddTask() until a worker picked them up.
+	struct FLaneStats
+	{
+		uint64_t NumTasks;      // tasks picked up since the last ResetLaneStats()
+		double   AvgWaitTimeMs;
+		double   MaxWaitTimeMs;
+		int      NumQueuedTasks; // currently waiting
+	};
+	FLaneStats GetLaneStats(ETaskPriority Priority) const;
+	void       ResetLaneStats();
+
+	// Telemetry for tuning the pool sizes: the counters are kept per worker thread and
+	// only aggregated when GetStats() is called. Approximate while tasks are running.
+	struct FWorkerStats
+	{
+		uint64_t NumTasks;    // tasks executed
+		uint64_t NumSteals;   // tasks taken from the deque of another worker (WORK_STEALING)
+		double   BusyTimeMs;  // time spent executing tasks
+		double   IdleTimeMs;  // time spent looking for tasks or sleeping
+		double   Utilization; // BusyTime / (BusyTime + IdleTime)
+	};
+	struct FStats
+	{
+		double                    ElapsedTimeMs;   // since Initialize() or the last ResetStats()
+		uint64_t                  NumTasks;
+		int                       PeakQueueDepth;  // max number of tasks waiting, sampled when tasks are picked up
+		FTimeHistogram            WaitTime;        // AddTask() -> start of execution
+		FTimeHistogram            ExecutionTime;
+		std::vector<FWorkerStats> Workers;
+		FWorkerStats              ExternalThreads; // tasks run by non-worker threads: RunRemainingTasksOnThisThread(), ParallelFor() callers...
+	};
+	FStats GetStats() const;
+	void   ResetStats(); // also resets the lane stats
+	void   LogStats() const;
+
+	// Runs @fn(i) for every i in [Begin, End) on the workers of this pool and the calling thread, 
+	// and returns once all the iterations have completed.
+	// - The calling thread participates, the range is split into chunks that are claimed dynamically
+	//   so a slow or late worker doesn't stall the whole range.
+	// - The chunk (grain) size is derived from the per-item cost measured on the calling thread,
+	//   small ranges of cheap items complete on the calling thread without waking any workers.
+	template<class F> void ParallelFor(size_t Begin, size_t End, F&& fn);
+
+	// Same as ParallelFor() but @fn(iBegin, iEnd) is called once per chunk, which lets the 
+	// callee keep per-chunk state or vectorize its inner loop.
+	template<class F> void ParallelForRange(size_t Begin, size_t End, F&& fn);
+
+	// Reduces [Begin, End) in parallel and returns the result:
+	// - @fnRange(iBegin, iEnd, Accumulator) -> T : accumulates the given chunk onto Accumulator
+	// - @fnReduce(T, T) -> T                     : combines two partial results
+	// @Identity is used to initialize every partial result. The order in which partial results are 
+	// combined isn't deterministic, which may matter for floating point sums.
+	template<class T, class FRange, class FReduce> 
+	T ParallelReduce(size_t Begin, size_t End, const T& Identity, FRange&& fnRange, FReduce&& fnReduce);
+
+	// C++20 coroutines: 'co_await pool.Schedule()' suspends the calling coroutine and resumes it
+	// on a worker of this pool. See Coroutines.h for the awaitable Async::Task<T>.
+	struct FScheduleAwaiter
+	{
+		ThreadPool*   pPool;
+		ETaskPriority Priority;
+
+		inline bool await_ready() const noexcept { return false; }
+		template<class TCoroutineHandle> void await_suspend(TCoroutineHandle hCoroutine) { pPool->AddTaskNoFuture([hCoroutine]() mutable { hCoroutine.resume(); }, Priority); }
+		inline void await_resume() const noexcept {}
+	};
+	inline FScheduleAwaiter Schedule(ETaskPriority Priority = ETaskPriority::NORMAL) { return FScheduleAwaiter{ this, Priority }; }
 
 private:
-	void Execute(); // workers run Execute();
+	void Execute(size_t iWorker); // workers run Execute();
+	void Execute_WorkStealing(size_t iWorker);
+
+	void AddQueuedTask(FQueuedTask&& task);
+	void AddTask_WorkStealing(FQueuedTask&& task);
+	bool TryGetTask_WorkStealing(size_t iWorker, FQueuedTask& task, ETaskPriority LowestPriority = ETaskPriority::BACKGROUND);
+	bool TryGetTask(FQueuedTask& task, ETaskPriority LowestPriority);
+	void RunQueuedTask(FQueuedTask& task); // records the queue wait time, runs and releases the task
+
+	struct FWorkerCounters;
+	FWorkerCounters& GetCountersOfCallingThread(bool& bSingleWriter);
 
 	std::mutex               mMtx;
 	std::condition_variable  mCondVar;
@@ -107,27 +465,272 @@ private:
 	std::vector<std::thread> mWorkers;
 	std::string              mThreadPoolName;
 
+	// work-stealing scheduler state
+	EThreadPoolSchedulingMode                       mSchedulingMode = EThreadPoolSchedulingMode::SHARED_QUEUE;
+	std::vector<std::unique_ptr<WorkStealingQueue>> mWorkerQueues;
+	std::atomic<int>                                mNumActiveTasks     = 0; // queued + executing
+	std::atomic<int>                                mNumQueuedTasks     = 0; // queued, not yet picked up by a worker
+	std::atomic<int>                                mNumSleepingWorkers = 0;
+	std::atomic<size_t>                             mNextWorkerQueue    = 0; // round-robin target for tasks added from non-worker threads
+
+	// priority lanes
+	std::array<std::atomic<int>, NUM_TASK_PRIORITIES> mNumQueuedTasksPerLane = {}; // incremented before the task is queued
+
+	// telemetry: one cache line aligned set of counters per worker, written by the worker only, 
+	// plus a shared set for the non-worker threads at index GetThreadPoolSize()
+	struct FLaneCounters
+	{
+		std::atomic<uint64_t> NumTasks    = 0;
+		std::atomic<uint64_t> TotalWaitNs = 0;
+		std::atomic<uint64_t> MaxWaitNs   = 0;
+	};
+	struct alignas(64) FWorkerCounters
+	{
+		std::atomic<uint64_t> NumTasks       = 0;
+		std::atomic<uint64_t> NumSteals      = 0;
+		std::atomic<uint64_t> BusyNs         = 0;
+		std::atomic<uint64_t> PeakQueueDepth = 0;
+		std::array<std::atomic<uint64_t>, FTimeHistogram::NUM_BUCKETS> WaitTimeHistogram = {};
+		std::array<std::atomic<uint64_t>, FTimeHistogram::NUM_BUCKETS> ExecutionTimeHistogram = {};
+		std::array<FLaneCounters, NUM_TASK_PRIORITIES>                  Lanes;
+	};
+	std::vector<std::unique_ptr<FWorkerCounters>> mWorkerCounters;
+	TaskClock::time_point                         mStatsResetTime;
+
 public:
 	unsigned int             mMarkerColor;
 };
 
 template<class T>
-decltype(auto) ThreadPool::AddTask(T&& task)
+decltype(auto) ThreadPool::AddTask(T&& task, ETaskPriority Priority)
 {
-	// use a shared_ptr<> of packaged tasks here as we execute them in the thread pool workers as well
-	// as accesing its get_future() on the thread that calls this AddTask() function.
-	auto pTask = std::make_shared< std::packaged_task<decltype(task())()>>(std::forward<T>(task));
-	mTaskQueue.AddTask(pTask);
-	//Log::Info("[%s] TaskQueue::AddTask()", this->mThreadPoolName.c_str());
+	// the packaged_task is moved into the Task, the future shares its state with it
+	std::packaged_task<decltype(task())()> PackagedTask(std::forward<T>(task));
+	auto Future = PackagedTask.get_future();
+	AddTaskNoFuture(std::move(PackagedTask), Priority);
+	return Future;
+}
 
-	mCondVar.notify_one();
-	//Log::Info("[%s] Signal::NotifyOne()", this->mThreadPoolName.c_str());
-	return pTask->get_future();
+template<class T>
+void ThreadPool::AddTaskNoFuture(T&& task, ETaskPriority Priority)
+{
+	AddQueuedTask(FQueuedTask{ Task(std::forward<T>(task)), TaskClock::now(), Priority });
 }
 
 std::vector<std::pair<size_t, size_t>> PartitionWorkItemsIntoRanges(size_t NumWorkItems, size_t NumWorkerThreadCount);
 size_t CalculateNumThreadsToUse(const size_t NumWorkItems, const size_t NumWorkerThreads, const size_t NumMinimumWorkItemCountPerThread);
 
+//
+// ParallelFor / ParallelReduce
+//
+// Target duration of a chunk. Long enough to amortize claiming it, short enough to balance the load.
+constexpr double PARALLEL_FOR_TARGET_CHUNK_DURATION_SECONDS = 50e-6; 
+
+// The calling thread measures the per-item cost on a few chunks of growing size until this duration is reached.
+constexpr double PARALLEL_FOR_COST_PROBE_DURATION_SECONDS = 10e-6;
+
+// Upper bound on the grain size so that each participant gets at least a few chunks to balance with.
+constexpr size_t PARALLEL_FOR_MIN_NUM_CHUNKS_PER_PARTICIPANT = 4;
+
+template<class T, class FRange, class FReduce>
+T ThreadPool::ParallelReduce(size_t Begin, size_t End, const T& Identity, FRange&& fnRange, FReduce&& fnReduce)
+{
+	using Clock = std::chrono::steady_clock;
+	if (Begin >= End)
+		return Identity;
+
+	// The state is shared with the helper tasks through a shared_ptr<>: a helper that gets picked up
+	// after all the items are already processed only touches this state and returns, the callables 
+	// (which live on this stack frame) are only accessed by participants that claimed a valid chunk,
+	// i.e. while this function is still waiting for that chunk to complete.
+	struct FState
+	{
+		using FRangeFn  = std::remove_reference_t<FRange>; // the callables may be passed as lvalues
+		using FReduceFn = std::remove_reference_t<FReduce>;
+
+		FState(size_t Begin, size_t End, const T& Identity, FRangeFn& fnRange, FReduceFn& fnReduce)
+			: NextItem(Begin), End(End), Identity(Identity), Result(Identity), pfnRange(&fnRange), pfnReduce(&fnReduce) {}
+		
+		std::atomic<size_t> NextItem;
+		std::atomic<size_t> NumItemsCompleted = 0;
+		const size_t        End;
+		size_t              GrainSize = 1;
+		const T             Identity;
+		std::mutex          MtxResult;
+		T                   Result;
+		FRangeFn*           pfnRange;
+		FReduceFn*          pfnReduce;
+
+		// claims chunks until the range is exhausted, returns the number of items processed
+		size_t Participate(T& Accumulator)
+		{
+			size_t NumProcessed = 0;
+			for (;;)
+			{
+				const size_t iBegin = NextItem.fetch_add(GrainSize);
+				if (iBegin >= End)
+					break;
+				const size_t iEnd = std::min(iBegin + GrainSize, End);
+				Accumulator = (*pfnRange)(iBegin, iEnd, std::move(Accumulator));
+				NumProcessed += iEnd - iBegin;
+			}
+			return NumProcessed;
+		}
+		void Complete(const T& Accumulator, size_t NumProcessed)
+		{
+			if (NumProcessed == 0)
+				return;
+			{
+				std::lock_guard<std::mutex> lk(MtxResult);
+				Result = (*pfnReduce)(Result, Accumulator);
+			}
+			NumItemsCompleted.fetch_add(NumProcessed); // after the merge: caller reads Result once all items are completed
+		}
+	};
+	std::shared_ptr<FState> pState = std::make_shared<FState>(Begin, End, Identity, fnRange, fnReduce);
+	FState& state = *pState;
+
+	const size_t NumItems = End - Begin;
+	T Accumulator = Identity;
+	size_t NumProcessed = 0;
+
+	// measure the per-item cost on the calling thread with doubling chunk sizes
+	double ProbeDuration = 0.0;
+	size_t ProbeSize = 1;
+	while (ProbeDuration < PARALLEL_FOR_COST_PROBE_DURATION_SECONDS)
+	{
+		const size_t iBegin = state.NextItem.fetch_add(ProbeSize);
+		if (iBegin >= End)
+			break;
+		const size_t iEnd = std::min(iBegin + ProbeSize, End);
+
+		const Clock::time_point t0 = Clock::now();
+		Accumulator = fnRange(iBegin, iEnd, std::move(Accumulator));
+		ProbeDuration += std::chrono::duration<double>(Clock::now() - t0).count();
+
+		NumProcessed += iEnd - iBegin;
+		ProbeSize *= 2;
+	}
+
+	const size_t NumItemsRemaining = NumItems - std::min(NumItems, state.NextItem.load() - Begin);
+	if (NumItemsRemaining > 0)
+	{
+		const double SecondsPerItem = std::max(ProbeDuration / NumProcessed, 1e-10);
+		const size_t NumParticipantsMax = GetThreadPoolSize() + 1;
+		const size_t GrainSizeForTargetDuration = static_cast<size_t>(PARALLEL_FOR_TARGET_CHUNK_DURATION_SECONDS / SecondsPerItem);
+		const size_t GrainSizeForBalance = NumItemsRemaining / (NumParticipantsMax * PARALLEL_FOR_MIN_NUM_CHUNKS_PER_PARTICIPANT);
+		state.GrainSize = std::max<size_t>(1, std::min(GrainSizeForTargetDuration, GrainSizeForBalance));
+
+		// don't wake more workers than there are chunks
+		const size_t NumParticipants = IsExiting() ? 1 : CalculateNumThreadsToUse(NumItemsRemaining, NumParticipantsMax, state.GrainSize);
+		for (size_t i = 1; i < NumParticipants; ++i)
+		{
+			AddTaskNoFuture([pState]()
+			{
+				T HelperAccumulator = pState->Identity;
+				const size_t NumHelperProcessed = pState->Participate(HelperAccumulator);
+				pState->Complete(HelperAccumulator, NumHelperProcessed);
+			});
+		}
+
+		NumProcessed += state.Participate(Accumulator);
+	}
+	state.Complete(Accumulator, NumProcessed);
+
+	// wait for the chunks claimed by the helpers
+	while (state.NumItemsCompleted.load() != NumItems)
+		std::this_thread::yield();
+
+	return state.Result;
+}
+
+template<class F>
+void ThreadPool::ParallelForRange(size_t Begin, size_t End, F&& fn)
+{
+	ParallelReduce(Begin, End, char(0)
+		, [&fn](size_t iBegin, size_t iEnd, char) { fn(iBegin, iEnd); return char(0); }
+		, [](char, char) { return char(0); }
+	);
+}
+
+template<class F>
+void ThreadPool::ParallelFor(size_t Begin, size_t End, F&& fn)
+{
+	ParallelForRange(Begin, End, [&fn](size_t iBegin, size_t iEnd)
+	{
+		for (size_t i = iBegin; i < iEnd; ++i)
+			fn(i);
+	});
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------------------------
+//
+// Task Graph
+//
+//---------------------------------------------------------------------------------------------------------------------------------------
+//
+// A set of tasks with dependencies (a DAG) that executes on a ThreadPool.
+// - Tasks are declared with their predecessors through AddTask() / AddDependency()
+// - Dispatch() schedules the tasks without predecessors on the thread pool and returns,
+//   any other task is scheduled automatically once all of its predecessors complete.
+// - IsDone() / Wait() poll / block on the completion of the whole graph.
+//
+// The graph must outlive its execution and must not be modified after Dispatch() 
+// until it's done. Don't Wait() on a worker thread of the pool the graph runs on.
+//
+class TaskGraph
+{
+public:
+	using TaskID = size_t;
+
+	template<class T>
+	TaskID AddTask(T&& task, std::initializer_list<TaskID> Predecessors = {});
+	void   AddDependency(TaskID Predecessor, TaskID Successor);
+
+	// @Priority is used for every task of the graph
+	void Dispatch(ThreadPool& pool, ETaskPriority Priority = ETaskPriority::NORMAL);
+	void Wait();
+	bool IsDone() const;
+
+	// clears the tasks so the graph can be rebuilt, graph must be done or not dispatched yet.
+	void Reset();
+
+	inline size_t GetNumTasks() const { return mTasks.size(); }
+
+private:
+	struct FTaskNode
+	{
+		FTaskNode(Task&& task) : fnTask(std::move(task)) {}
+
+		Task                fnTask;
+		std::vector<TaskID> Successors;
+		int                 NumPredecessors = 0;
+		std::atomic<int>    NumPendingPredecessors = 0;
+	};
+
+	void ScheduleTask(TaskID id);
+	void OnTaskComplete(TaskID id);
+
+	std::deque<FTaskNode>   mTasks; // deque: nodes hold atomics and must not be relocated when the graph grows
+	ThreadPool*             mpThreadPool = nullptr;
+	ETaskPriority           mPriority    = ETaskPriority::NORMAL;
+
+	mutable std::mutex      mMtx;
+	std::condition_variable mCondVar;
+	size_t                  mNumPendingTasks = 0; // guarded by mMtx
+};
+
+template<class T>
+TaskGraph::TaskID TaskGraph::AddTask(T&& task, std::initializer_list<TaskID> Predecessors)
+{
+	const TaskID id = mTasks.size();
+	mTasks.emplace_back(Task(std::forward<T>(task)));
+	for (TaskID Predecessor : Predecessors)
+		AddDependency(Predecessor, id);
+	return id;
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------------------------
 //
@@ -173,6 +776,330 @@ private:
 	int iBuffer = 0; // ping-pong index
 };
 
+// --------------------------------------------------------------------------------------------------------------------------------------
+//
+// MPSC Channel
+//
+//---------------------------------------------------------------------------------------------------------------------------------------
+//
+// Bounded lock-free multi-producer / single-consumer queue of fixed size records.
+// - Producers claim a slot with a CAS on the enqueue position, copy the record in and publish it 
+//   through the slot's sequence number (Vyukov's bounded queue), no lock and no allocation per item.
+// - The consumer drains in batches: ConsumeAll() only processes the records published before the 
+//   call so a producer that keeps pushing can't stall the consumer.
+// - Push() yields while the channel is full, TryPush() returns false instead.
+//
+template<class T, size_t Capacity>
+class MPSCChannel
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MPSCChannel capacity must be a power of 2");
+	static_assert(std::is_trivially_copyable_v<T>, "MPSCChannel records must be trivially copyable");
+public:
+	MPSCChannel();
+
+	bool TryPush(const T& item);
+	void Push(const T& item);
+
+	bool TryPop(T& item);
+
+	// pops up to @MaxCount records into @pItems, returns the number of records popped
+	size_t TryPopBatch(T* pItems, size_t MaxCount);
+
+	// calls @fn(const T&) on every record published so far, returns the number of records consumed
+	template<class F> size_t ConsumeAll(F&& fn);
+
+	// approximate, may be stale by the time it returns. Safe from any thread: the dequeue position is read
+	// first, the enqueue position read after it can't be behind it
+	inline size_t GetNumItems() const
+	{
+		const size_t DequeuePos = mDequeuePos.load(std::memory_order_acquire);
+		return mEnqueuePos.load(std::memory_order_acquire) - DequeuePos;
+	}
+	inline bool IsEmpty() const { return GetNumItems() == 0; }
+
+private:
+	struct FCell
+	{
+		std::atomic<size_t> Sequence;
+		T                   Data;
+	};
+	static constexpr size_t MASK = Capacity - 1;
+
+	std::array<FCell, Capacity> mCells;
+	alignas(64) std::atomic<size_t> mEnqueuePos; // shared by the producers
+	alignas(64) std::atomic<size_t> mDequeuePos; // written by the consumer only, read by GetNumItems()
+};
+
+template<class T, size_t Capacity>
+MPSCChannel<T, Capacity>::MPSCChannel()
+	: mEnqueuePos(0)
+	, mDequeuePos(0)
+{
+	for (size_t i = 0; i < Capacity; ++i)
+		mCells[i].Sequence.store(i, std::memory_order_relaxed);
+}
+
+template<class T, size_t Capacity>
+bool MPSCChannel<T, Capacity>::TryPush(const T& item)
+{
+	size_t Pos = mEnqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		FCell& cell = mCells[Pos & MASK];
+		const size_t Sequence = cell.Sequence.load(std::memory_order_acquire);
+		const intptr_t Diff = static_cast<intptr_t>(Sequence) - static_cast<intptr_t>(Pos);
+		if (Diff == 0) // slot is free for this position: try to claim it
+		{
+			if (mEnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+			{
+				cell.Data = item;
+				cell.Sequence.store(Pos + 1, std::memory_order_release);
+				return true;
+			}
+			// CAS failure reloaded Pos
+		}
+		else if (Diff < 0) // slot still holds the record from the previous lap: full
+		{
+			return false;
+		}
+		else // another producer claimed this position
+		{
+			Pos = mEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template<class T, size_t Capacity>
+void MPSCChannel<T, Capacity>::Push(const T& item)
+{
+	while (!TryPush(item))
+		std::this_thread::yield();
+}
+
+template<class T, size_t Capacity>
+bool MPSCChannel<T, Capacity>::TryPop(T& item)
+{
+	return TryPopBatch(&item, 1) == 1;
+}
+
+template<class T, size_t Capacity>
+size_t MPSCChannel<T, Capacity>::TryPopBatch(T* pItems, size_t MaxCount)
+{
+	size_t Pos = mDequeuePos.load(std::memory_order_relaxed);
+	size_t NumPopped = 0;
+	while (NumPopped < MaxCount)
+	{
+		FCell& cell = mCells[Pos & MASK];
+		if (cell.Sequence.load(std::memory_order_acquire) != Pos + 1) // not published yet
+			break;
+
+		pItems[NumPopped++] = cell.Data;
+		cell.Sequence.store(Pos + Capacity, std::memory_order_release); // hand the slot back to the producers
+		mDequeuePos.store(++Pos, std::memory_order_release);
+	}
+	return NumPopped;
+}
+
+template<class T, size_t Capacity>
+template<class F>
+size_t MPSCChannel<T, Capacity>::ConsumeAll(F&& fn)
+{
+	const size_t EndPos = mEnqueuePos.load(std::memory_order_acquire);
+	size_t Pos = mDequeuePos.load(std::memory_order_relaxed);
+	size_t NumConsumed = 0;
+	while (Pos != EndPos)
+	{
+		FCell& cell = mCells[Pos & MASK];
+		if (cell.Sequence.load(std::memory_order_acquire) != Pos + 1) // claimed but not written yet
+			break;
+
+		const T item = cell.Data; // copy out first so the slot can be recycled while fn() runs
+		cell.Sequence.store(Pos + Capacity, std::memory_order_release);
+		mDequeuePos.store(++Pos, std::memory_order_release);
+		++NumConsumed;
+		fn(item);
+	}
+	return NumConsumed;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------
+//
+// SPSC Channel
+//
+//---------------------------------------------------------------------------------------------------------------------------------------
+//
+// Bounded lock-free single-producer / single-consumer ring for streaming data between a fixed pair
+// of threads, e.g. a loader thread handing finished uploads over to the render thread.
+// - The producer only writes mWritePos and the consumer only writes mReadPos, each on its own cache line
+//   along with a cached copy of the other side's position: the shared line is only touched when the
+//   cached position says the ring looks full (producer) or empty (consumer).
+// - Batch operations publish once per batch instead of once per item.
+// - Items are moved in and out, T doesn't need to be default constructible or copyable.
+//
+template<class T, size_t Capacity>
+class SPSCChannel
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SPSCChannel capacity must be a power of 2");
+public:
+	SPSCChannel() = default;
+	~SPSCChannel();
+	SPSCChannel(const SPSCChannel&) = delete;
+	SPSCChannel& operator=(const SPSCChannel&) = delete;
+
+	// producer thread
+	template<class... Args> bool TryEmplace(Args&&... args);
+	inline bool TryPush(T&& item)      { return TryEmplace(std::move(item)); }
+	inline bool TryPush(const T& item) { return TryEmplace(item); }
+	void Push(T&& item); // yields while the channel is full
+
+	// moves up to @Count items from @pItems into the channel, returns the number of items pushed
+	size_t TryPushBatch(T* pItems, size_t Count);
+
+	// moves either all or none of the @Count items, the consumer sees them all at once
+	bool TryPushAll(T* pItems, size_t Count);
+
+	// consumer thread
+	bool TryPop(T& item);
+
+	// moves up to @MaxCount items into @pItems, returns the number of items popped
+	size_t TryPopBatch(T* pItems, size_t MaxCount);
+
+	// calls @fn(T&) on every item pushed so far, returns the number of items consumed
+	template<class F> size_t ConsumeAll(F&& fn);
+
+	// approximate when called from another thread than the consumer/producer
+	inline size_t GetNumItems() const { return mWritePos.load(std::memory_order_acquire) - mReadPos.load(std::memory_order_acquire); }
+	inline bool IsEmpty() const { return GetNumItems() == 0; }
+	static constexpr size_t GetCapacity() { return Capacity; }
+
+private:
+	static constexpr size_t MASK = Capacity - 1;
+	inline T* GetSlot(size_t Pos) { return std::launder(reinterpret_cast<T*>(&mSlots[Pos & MASK])); }
+	size_t GetNumFreeSlots(size_t Count);     // producer: refreshes mCachedReadPos only if needed
+	size_t GetNumPublishedItems(size_t Count); // consumer: refreshes mCachedWritePos only if needed
+
+	alignas(64) std::atomic<size_t> mWritePos = 0;
+	size_t                          mCachedReadPos = 0;  // producer's copy of mReadPos
+	alignas(64) std::atomic<size_t> mReadPos = 0;
+	size_t                          mCachedWritePos = 0; // consumer's copy of mWritePos
+	alignas(64) std::aligned_storage_t<sizeof(T), alignof(T)> mSlots[Capacity];
+};
+
+template<class T, size_t Capacity>
+SPSCChannel<T, Capacity>::~SPSCChannel()
+{
+	if constexpr (!std::is_trivially_destructible_v<T>)
+	{
+		const size_t WritePos = mWritePos.load(std::memory_order_acquire);
+		for (size_t Pos = mReadPos.load(std::memory_order_relaxed); Pos != WritePos; ++Pos)
+			GetSlot(Pos)->~T();
+	}
+}
+
+template<class T, size_t Capacity>
+size_t SPSCChannel<T, Capacity>::GetNumFreeSlots(size_t Count)
+{
+	const size_t WritePos = mWritePos.load(std::memory_order_relaxed);
+	size_t NumFree = Capacity - (WritePos - mCachedReadPos);
+	if (NumFree < Count)
+	{
+		mCachedReadPos = mReadPos.load(std::memory_order_acquire);
+		NumFree = Capacity - (WritePos - mCachedReadPos);
+	}
+	return NumFree;
+}
+
+template<class T, size_t Capacity>
+size_t SPSCChannel<T, Capacity>::GetNumPublishedItems(size_t Count)
+{
+	const size_t ReadPos = mReadPos.load(std::memory_order_relaxed);
+	size_t NumItems = mCachedWritePos - ReadPos;
+	if (NumItems < Count)
+	{
+		mCachedWritePos = mWritePos.load(std::memory_order_acquire);
+		NumItems = mCachedWritePos - ReadPos;
+	}
+	return NumItems;
+}
+
+template<class T, size_t Capacity>
+template<class... Args>
+bool SPSCChannel<T, Capacity>::TryEmplace(Args&&... args)
+{
+	if (GetNumFreeSlots(1) == 0)
+		return false;
+	const size_t WritePos = mWritePos.load(std::memory_order_relaxed);
+	new (&mSlots[WritePos & MASK]) T(std::forward<Args>(args)...);
+	mWritePos.store(WritePos + 1, std::memory_order_release);
+	return true;
+}
+
+template<class T, size_t Capacity>
+void SPSCChannel<T, Capacity>::Push(T&& item)
+{
+	while (!TryEmplace(std::move(item)))
+		std::this_thread::yield();
+}
+
+template<class T, size_t Capacity>
+size_t SPSCChannel<T, Capacity>::TryPushBatch(T* pItems, size_t Count)
+{
+	const size_t NumPushed = std::min(Count, GetNumFreeSlots(Count));
+	const size_t WritePos = mWritePos.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < NumPushed; ++i)
+		new (&mSlots[(WritePos + i) & MASK]) T(std::move(pItems[i]));
+	if (NumPushed)
+		mWritePos.store(WritePos + NumPushed, std::memory_order_release);
+	return NumPushed;
+}
+
+template<class T, size_t Capacity>
+bool SPSCChannel<T, Capacity>::TryPushAll(T* pItems, size_t Count)
+{
+	if (GetNumFreeSlots(Count) < Count)
+		return false;
+	return TryPushBatch(pItems, Count) == Count;
+}
+
+template<class T, size_t Capacity>
+bool SPSCChannel<T, Capacity>::TryPop(T& item)
+{
+	return TryPopBatch(&item, 1) == 1;
+}
+
+template<class T, size_t Capacity>
+size_t SPSCChannel<T, Capacity>::TryPopBatch(T* pItems, size_t MaxCount)
+{
+	const size_t NumPopped = std::min(MaxCount, GetNumPublishedItems(MaxCount));
+	const size_t ReadPos = mReadPos.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < NumPopped; ++i)
+	{
+		T* pSlot = GetSlot(ReadPos + i);
+		pItems[i] = std::move(*pSlot);
+		pSlot->~T();
+	}
+	if (NumPopped)
+		mReadPos.store(ReadPos + NumPopped, std::memory_order_release);
+	return NumPopped;
+}
+
+template<class T, size_t Capacity>
+template<class F>
+size_t SPSCChannel<T, Capacity>::ConsumeAll(F&& fn)
+{
+	const size_t NumItems = GetNumPublishedItems(Capacity);
+	const size_t ReadPos = mReadPos.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < NumItems; ++i)
+	{
+		T* pSlot = GetSlot(ReadPos + i);
+		fn(*pSlot);
+		pSlot->~T();
+	}
+	if (NumItems)
+		mReadPos.store(ReadPos + NumItems, std::memory_order_release);
+	return NumItems;
+}
+
 // --------------------------------------------------------------------------------------------------------------------------------------
 //
 // ConcurrentQueue
@@ -188,7 +1115,8 @@ public:
 	ConcurrentQueue(void (*pfnProcess)(T&)) : mpfnProcess(pfnProcess) {}
 
 	void Enqueue(T&& item);
-	T Dequeue();
+	T Dequeue(); // queue must not be empty
+	bool TryDequeue(T& item);
 
 	void ProcessItems();
 
@@ -210,11 +1138,22 @@ template<class T>
 inline T ConcurrentQueue<T>::Dequeue()
 {
 	std::lock_guard<std::mutex> lk(mMtx);
-	T item = mQueue.front();
+	T item = std::move(mQueue.front());
 	mQueue.pop();
 	return item;
 }
 
+template<class T>
+inline bool ConcurrentQueue<T>::TryDequeue(T& item)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	if (mQueue.empty())
+		return false;
+	item = std::move(mQueue.front());
+	mQueue.pop();
+	return true;
+}
+
 template<class T>
 inline void ConcurrentQueue<T>::ProcessItems()
 {
@@ -0,0 +1,383 @@
+#pragma once
+
+#include "Multithreading.h"
+
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <numeric>
+
+//
+// Data parallel primitives built on ThreadPool::ParallelFor():
+// - RadixSort()       : LSD radix sort of 32/64-bit unsigned keys, optionally carrying a payload
+// - ExclusiveScan()   : prefix sums with a user-provided associative operation
+//   InclusiveScan()
+// - Compact()         : stream compaction, copies the elements satisfying a predicate, order preserved
+// - StablePartition() : moves the elements satisfying a predicate to the front, order preserved in both groups
+//
+// The input is split into a fixed number of contiguous blocks, a few per participating thread,
+// the calling thread participates. Inputs smaller than PARALLEL_ALGORITHMS_MIN_NUM_ELEMENTS
+// are processed on the calling thread only.
+// Predicates & operations are called concurrently and more than once per element: they must be pure.
+//
+namespace Parallel
+{
+	constexpr size_t PARALLEL_ALGORITHMS_MIN_NUM_ELEMENTS = 16 * 1024;
+	constexpr size_t NUM_BLOCKS_PER_PARTICIPANT           = 4;
+
+	constexpr size_t RADIX_SORT_DIGIT_BITS  = 8;
+	constexpr size_t RADIX_SORT_NUM_BUCKETS = size_t(1) << RADIX_SORT_DIGIT_BITS;
+
+	namespace Detail
+	{
+		struct FBlocks
+		{
+			size_t NumElements;
+			size_t NumBlocks;
+			size_t BlockSize;
+
+			inline size_t Begin(size_t iBlock) const { return std::min(NumElements, iBlock * BlockSize); }
+			inline size_t End  (size_t iBlock) const { return std::min(NumElements, (iBlock + 1) * BlockSize); }
+		};
+		inline FBlocks SplitIntoBlocks(const ThreadPool& Pool, size_t NumElements, size_t NumBlocksPerParticipant = NUM_BLOCKS_PER_PARTICIPANT)
+		{
+			const size_t NumParticipants = Pool.GetThreadPoolSize() + 1;
+			const size_t MaxNumBlocks    = std::max<size_t>(1, NumElements / (PARALLEL_ALGORITHMS_MIN_NUM_ELEMENTS / 4));
+			const size_t NumBlocks = NumElements < PARALLEL_ALGORITHMS_MIN_NUM_ELEMENTS
+				? 1
+				: std::min(MaxNumBlocks, NumParticipants * NumBlocksPerParticipant);
+			const size_t BlockSize = (NumElements + NumBlocks - 1) / std::max<size_t>(1, NumBlocks);
+			return { NumElements, NumBlocks, std::max<size_t>(1, BlockSize) };
+		}
+
+		template<class F>
+		inline void ForEachBlock(ThreadPool& Pool, const FBlocks& Blocks, F&& fn)
+		{
+			if (Blocks.NumBlocks == 1)
+				fn(size_t(0));
+			else
+				Pool.ParallelFor(0, Blocks.NumBlocks, fn);
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------
+	// Scan
+	// ------------------------------------------------------------------------------------------------------------
+	//
+	// pOut[i] = Init op pIn[0] op ... op pIn[i-1]. pIn and pOut may be the same array.
+	//
+	template<class T, class TOp = std::plus<T>>
+	void ExclusiveScan(ThreadPool& Pool, const T* pIn, T* pOut, size_t Count, T Init, TOp&& op = TOp());
+
+	//
+	// pOut[i] = pIn[0] op ... op pIn[i]. pIn and pOut may be the same array.
+	//
+	template<class T, class TOp = std::plus<T>>
+	void InclusiveScan(ThreadPool& Pool, const T* pIn, T* pOut, size_t Count, TOp&& op = TOp());
+
+	// ------------------------------------------------------------------------------------------------------------
+	// Compaction & partitioning
+	// ------------------------------------------------------------------------------------------------------------
+	//
+	// Copies the elements of pIn satisfying @pred into pOut, preserving their order.
+	// pOut must have room for Count elements, returns the number of elements copied.
+	//
+	template<class T, class TPred>
+	size_t Compact(ThreadPool& Pool, const T* pIn, size_t Count, T* pOut, TPred&& pred);
+
+	//
+	// Reorders pData so that the elements satisfying @pred come first, keeping the relative order
+	// within both groups (std::stable_partition). Returns the number of elements satisfying @pred.
+	// Uses a temporary buffer of Count elements.
+	//
+	template<class T, class TPred>
+	size_t StablePartition(ThreadPool& Pool, T* pData, size_t Count, TPred&& pred);
+
+	// ------------------------------------------------------------------------------------------------------------
+	// Sorting
+	// ------------------------------------------------------------------------------------------------------------
+	//
+	// Stable LSD radix sort of 32/64-bit unsigned keys in ascending order, 8 bits per pass.
+	// Passes where all the keys share the same digit are skipped, e.g. 64-bit keys only using their low bits.
+	// The payload overload applies the same permutation to pValues.
+	//
+	template<class TKey>
+	void RadixSort(ThreadPool& Pool, TKey* pKeys, size_t Count);
+
+	template<class TKey, class TValue>
+	void RadixSort(ThreadPool& Pool, TKey* pKeys, TValue* pValues, size_t Count);
+}
+
+
+// ================================================================================================================
+//
+// Implementation
+//
+// ================================================================================================================
+namespace Parallel
+{
+	namespace Detail
+	{
+		// Shared by the scans: reduces each block, scans the block sums on the calling thread,
+		// then scans each block again starting from its offset.
+		template<bool bInclusive, class T, class TOp>
+		void Scan(ThreadPool& Pool, const T* pIn, T* pOut, size_t Count, const T* pInit, TOp& op)
+		{
+			if (Count == 0)
+				return;
+
+			auto fnScanRange = [&](size_t Begin, size_t End, bool bHasOffset, T Offset)
+			{
+				size_t i = Begin;
+				if (!bHasOffset) // inclusive scan of the first block
+				{
+					Offset = pIn[i];
+					pOut[i++] = Offset;
+				}
+				for (; i < End; ++i)
+				{
+					const T Value = pIn[i]; // read before writing: pIn may alias pOut
+					if constexpr (bInclusive)
+					{
+						Offset = op(Offset, Value);
+						pOut[i] = Offset;
+					}
+					else
+					{
+						pOut[i] = Offset;
+						Offset = op(Offset, Value);
+					}
+				}
+			};
+
+			const FBlocks Blocks = SplitIntoBlocks(Pool, Count);
+			if (Blocks.NumBlocks == 1)
+			{
+				fnScanRange(0, Count, pInit != nullptr, pInit ? *pInit : T());
+				return;
+			}
+
+			// the last block's sum isn't needed
+			std::vector<T> BlockSums(Blocks.NumBlocks - 1);
+			Pool.ParallelFor(0, Blocks.NumBlocks - 1, [&](size_t iBlock)
+			{
+				const size_t Begin = Blocks.Begin(iBlock);
+				const size_t End   = Blocks.End(iBlock);
+				T Sum = pIn[Begin];
+				for (size_t i = Begin + 1; i < End; ++i)
+					Sum = op(Sum, pIn[i]);
+				BlockSums[iBlock] = Sum;
+			});
+
+			std::vector<T> BlockOffsets(Blocks.NumBlocks);
+			if (pInit)
+				BlockOffsets[0] = *pInit;
+			for (size_t iBlock = 1; iBlock < Blocks.NumBlocks; ++iBlock)
+				BlockOffsets[iBlock] = (iBlock == 1 && !pInit) ? BlockSums[0] : op(BlockOffsets[iBlock - 1], BlockSums[iBlock - 1]);
+
+			Pool.ParallelFor(0, Blocks.NumBlocks, [&](size_t iBlock)
+			{
+				fnScanRange(Blocks.Begin(iBlock), Blocks.End(iBlock), iBlock > 0 || pInit != nullptr, BlockOffsets[iBlock]);
+			});
+		}
+
+		// Counts the elements satisfying @pred per block and returns the exclusive prefix sum of the counts,
+		// with the total in the last entry.
+		template<class T, class TPred>
+		std::vector<size_t> CountPerBlock(ThreadPool& Pool, const FBlocks& Blocks, const T* pIn, TPred& pred)
+		{
+			std::vector<size_t> Offsets(Blocks.NumBlocks + 1, 0);
+			ForEachBlock(Pool, Blocks, [&](size_t iBlock)
+			{
+				size_t NumSelected = 0;
+				for (size_t i = Blocks.Begin(iBlock), End = Blocks.End(iBlock); i < End; ++i)
+					NumSelected += pred(pIn[i]) ? 1 : 0;
+				Offsets[iBlock + 1] = NumSelected;
+			});
+			std::partial_sum(Offsets.begin(), Offsets.end(), Offsets.begin());
+			return Offsets;
+		}
+
+		template<class TKey>
+		inline size_t GetDigit(TKey Key, size_t iPass)
+		{
+			return static_cast<size_t>((Key >> (iPass * RADIX_SORT_DIGIT_BITS)) & (RADIX_SORT_NUM_BUCKETS - 1));
+		}
+
+		// pValues may be null: TValue is then only a placeholder
+		template<class TKey, class TValue>
+		void RadixSort(ThreadPool& Pool, TKey* pKeys, TValue* pValues, size_t Count)
+		{
+			static_assert(std::is_unsigned_v<TKey> && (sizeof(TKey) == 4 || sizeof(TKey) == 8), "RadixSort() supports 32/64-bit unsigned keys");
+			constexpr size_t NUM_PASSES = sizeof(TKey) * 8 / RADIX_SORT_DIGIT_BITS;
+			if (Count < 2)
+				return;
+
+			const FBlocks Blocks = SplitIntoBlocks(Pool, Count, 1); // one block per participant: a histogram per block
+			using Histogram_t = std::array<size_t, RADIX_SORT_NUM_BUCKETS>;
+			std::vector<Histogram_t> BlockHistograms(Blocks.NumBlocks);
+
+			// histograms of every digit computed in a single read of the keys: the digit counts don't depend
+			// on the order of the keys, so they tell which passes can be skipped before any pass runs.
+			std::vector<std::array<Histogram_t, NUM_PASSES>> BlockDigitHistograms(Blocks.NumBlocks);
+			ForEachBlock(Pool, Blocks, [&](size_t iBlock)
+			{
+				std::array<Histogram_t, NUM_PASSES>& Histograms = BlockDigitHistograms[iBlock];
+				for (Histogram_t& h : Histograms)
+					h.fill(0);
+				for (size_t i = Blocks.Begin(iBlock), End = Blocks.End(iBlock); i < End; ++i)
+					for (size_t iPass = 0; iPass < NUM_PASSES; ++iPass)
+						++Histograms[iPass][GetDigit(pKeys[i], iPass)];
+			});
+			std::array<bool, NUM_PASSES> bSkipPass = {};
+			for (size_t iPass = 0; iPass < NUM_PASSES; ++iPass)
+			{
+				for (size_t Digit = 0; Digit < RADIX_SORT_NUM_BUCKETS; ++Digit)
+				{
+					size_t NumKeys = 0;
+					for (size_t iBlock = 0; iBlock < Blocks.NumBlocks; ++iBlock)
+						NumKeys += BlockDigitHistograms[iBlock][iPass][Digit];
+					if (NumKeys == Count)
+						bSkipPass[iPass] = true;
+				}
+			}
+
+			std::vector<TKey>   TempKeys(Count);
+			std::vector<TValue> TempValues(pValues ? Count : 0);
+			TKey*   pSrcKeys   = pKeys;
+			TKey*   pDstKeys   = TempKeys.data();
+			TValue* pSrcValues = pValues;
+			TValue* pDstValues = TempValues.data();
+
+			bool bFirstPass = true;
+			for (size_t iPass = 0; iPass < NUM_PASSES; ++iPass)
+			{
+				if (bSkipPass[iPass])
+					continue;
+
+				// the first pass reuses the digit histograms, the following ones see the keys reordered across blocks
+				if (!bFirstPass)
+				{
+					ForEachBlock(Pool, Blocks, [&](size_t iBlock)
+					{
+						Histogram_t& h = BlockHistograms[iBlock];
+						h.fill(0);
+						for (size_t i = Blocks.Begin(iBlock), End = Blocks.End(iBlock); i < End; ++i)
+							++h[GetDigit(pSrcKeys[i], iPass)];
+					});
+				}
+				else
+				{
+					for (size_t iBlock = 0; iBlock < Blocks.NumBlocks; ++iBlock)
+						BlockHistograms[iBlock] = BlockDigitHistograms[iBlock][iPass];
+				}
+
+				// digit-major exclusive scan: the keys of block N land after the keys of block N-1 with the same digit
+				size_t Offset = 0;
+				for (size_t Digit = 0; Digit < RADIX_SORT_NUM_BUCKETS; ++Digit)
+				{
+					for (size_t iBlock = 0; iBlock < Blocks.NumBlocks; ++iBlock)
+					{
+						const size_t NumKeys = BlockHistograms[iBlock][Digit];
+						BlockHistograms[iBlock][Digit] = Offset;
+						Offset += NumKeys;
+					}
+				}
+
+				ForEachBlock(Pool, Blocks, [&](size_t iBlock)
+				{
+					Histogram_t& DstOffsets = BlockHistograms[iBlock];
+					for (size_t i = Blocks.Begin(iBlock), End = Blocks.End(iBlock); i < End; ++i)
+					{
+						const size_t iDst = DstOffsets[GetDigit(pSrcKeys[i], iPass)]++;
+						pDstKeys[iDst] = pSrcKeys[i];
+						if (pValues)
+							pDstValues[iDst] = std::move(pSrcValues[i]);
+					}
+				});
+
+				std::swap(pSrcKeys, pDstKeys);
+				std::swap(pSrcValues, pDstValues);
+				bFirstPass = false;
+			}
+
+			// odd number of passes executed: the result is in the temporary buffers
+			if (pSrcKeys != pKeys)
+			{
+				ForEachBlock(Pool, Blocks, [&](size_t iBlock)
+				{
+					const size_t Begin = Blocks.Begin(iBlock);
+					const size_t End   = Blocks.End(iBlock);
+					std::memcpy(pKeys + Begin, pSrcKeys + Begin, (End - Begin) * sizeof(TKey));
+					if (pValues)
+						std::move(pSrcValues + Begin, pSrcValues + End, pValues + Begin);
+				});
+			}
+		}
+	}
+
+	template<class T, class TOp>
+	void ExclusiveScan(ThreadPool& Pool, const T* pIn, T* pOut, size_t Count, T Init, TOp&& op)
+	{
+		Detail::Scan<false>(Pool, pIn, pOut, Count, &Init, op);
+	}
+
+	template<class T, class TOp>
+	void InclusiveScan(ThreadPool& Pool, const T* pIn, T* pOut, size_t Count, TOp&& op)
+	{
+		Detail::Scan<true>(Pool, pIn, pOut, Count, static_cast<const T*>(nullptr), op);
+	}
+
+	template<class T, class TPred>
+	size_t Compact(ThreadPool& Pool, const T* pIn, size_t Count, T* pOut, TPred&& pred)
+	{
+		const Detail::FBlocks Blocks = Detail::SplitIntoBlocks(Pool, Count);
+		const std::vector<size_t> Offsets = Detail::CountPerBlock(Pool, Blocks, pIn, pred);
+		Detail::ForEachBlock(Pool, Blocks, [&](size_t iBlock)
+		{
+			T* pDst = pOut + Offsets[iBlock];
+			for (size_t i = Blocks.Begin(iBlock), End = Blocks.End(iBlock); i < End; ++i)
+				if (pred(pIn[i]))
+					*pDst++ = pIn[i];
+		});
+		return Offsets.back();
+	}
+
+	template<class T, class TPred>
+	size_t StablePartition(ThreadPool& Pool, T* pData, size_t Count, TPred&& pred)
+	{
+		const Detail::FBlocks Blocks = Detail::SplitIntoBlocks(Pool, Count);
+		const std::vector<size_t> Offsets = Detail::CountPerBlock(Pool, Blocks, pData, pred);
+		const size_t NumSelected = Offsets.back();
+
+		std::vector<T> Temp(Count);
+		Detail::ForEachBlock(Pool, Blocks, [&](size_t iBlock)
+		{
+			const size_t Begin = Blocks.Begin(iBlock);
+			T* pSelected = Temp.data() + Offsets[iBlock];
+			T* pRejected = Temp.data() + NumSelected + (Begin - Offsets[iBlock]); // rejected elements before this block
+			for (size_t i = Begin, End = Blocks.End(iBlock); i < End; ++i)
+			{
+				if (pred(pData[i])) *pSelected++ = std::move(pData[i]);
+				else                *pRejected++ = std::move(pData[i]);
+			}
+		});
+		Detail::ForEachBlock(Pool, Blocks, [&](size_t iBlock)
+		{
+			std::move(Temp.begin() + Blocks.Begin(iBlock), Temp.begin() + Blocks.End(iBlock), pData + Blocks.Begin(iBlock));
+		});
+		return NumSelected;
+	}
+
+	template<class TKey>
+	void RadixSort(ThreadPool& Pool, TKey* pKeys, size_t Count)
+	{
+		Detail::RadixSort<TKey, uint8_t>(Pool, pKeys, nullptr, Count);
+	}
+
+	template<class TKey, class TValue>
+	void RadixSort(ThreadPool& Pool, TKey* pKeys, TValue* pValues, size_t Count)
+	{
+		Detail::RadixSort<TKey, TValue>(Pool, pKeys, pValues, Count);
+	}
+}
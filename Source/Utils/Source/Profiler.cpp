@@ -0,0 +1,293 @@
+#include "Profiler.h"
+#include "Log.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Profiler
+{
+namespace Detail
+{
+	std::atomic<bool> gbCapturing = false;
+}
+
+static_assert((NUM_EVENTS_PER_THREAD & (NUM_EVENTS_PER_THREAD - 1)) == 0, "NUM_EVENTS_PER_THREAD must be a power of 2");
+
+struct FEvent
+{
+	const char* pName;
+	uint64_t    BeginTicks;
+	uint64_t    EndTicks;
+};
+
+struct FThreadEvents
+{
+	std::string               Name;  // guarded by sThreadsMtx
+	uint32_t                  Color = DEFAULT_THREAD_COLOR;
+	uint32_t                  TrackIndex = 0;
+	std::unique_ptr<FEvent[]> pEvents = std::make_unique<FEvent[]>(NUM_EVENTS_PER_THREAD);
+	std::atomic<uint64_t>     NumEvents = 0;    // recorded during the capture, can exceed NUM_EVENTS_PER_THREAD
+	std::atomic<uint32_t>     CaptureIndex = 0; // capture the events belong to
+};
+
+// threads are never unregistered: an exited thread's events can still be part of the capture
+static std::mutex                                  sThreadsMtx;
+static std::vector<std::unique_ptr<FThreadEvents>> sThreads;
+static thread_local FThreadEvents*                 tpThreadEvents = nullptr;
+
+static std::atomic<uint32_t> sCaptureIndex = 0;
+
+// requested capture, guarded by sRequestMtx
+static std::mutex  sRequestMtx;
+static uint32_t    sRequestedNumFrames = 0;
+static std::string sRequestedFilePath;
+
+// running capture, only accessed by the thread calling BeginFrame()
+struct FCapture
+{
+	bool                  bRunning = false;
+	uint32_t              NumFrames = 0;
+	std::string           FilePath;
+	std::vector<uint64_t> FrameBeginTicks;
+};
+static FCapture sCapture;
+
+// a finished capture copied out of the ring buffers, which the next capture reuses
+struct FThreadCapture
+{
+	std::string         Name;
+	uint32_t            Color;
+	uint32_t            TrackIndex;
+	std::vector<FEvent> Events;
+};
+struct FCaptureData
+{
+	std::string                 FilePath;
+	std::vector<uint64_t>       FrameBeginTicks;
+	std::vector<FThreadCapture> Threads;
+	size_t                      NumOverwrittenEvents = 0;
+};
+
+// the trace is serialized & written off the frame thread: the future of std::async() waits
+// for the previous trace when it's replaced, and for the last one at exit
+static std::future<void> sWriteTraceTask;
+
+
+static FThreadEvents& GetThreadEvents()
+{
+	if (!tpThreadEvents)
+	{
+		std::unique_ptr<FThreadEvents> pEvents = std::make_unique<FThreadEvents>();
+		tpThreadEvents = pEvents.get();
+		std::lock_guard<std::mutex> lk(sThreadsMtx);
+		pEvents->TrackIndex = static_cast<uint32_t>(sThreads.size()) + 1; // track 0: frames
+		pEvents->Name = "Thread " + std::to_string(pEvents->TrackIndex);
+		sThreads.push_back(std::move(pEvents));
+	}
+	return *tpThreadEvents;
+}
+
+void SetThreadName(const std::string& Name, uint32_t Color)
+{
+	FThreadEvents& Events = GetThreadEvents();
+	std::lock_guard<std::mutex> lk(sThreadsMtx);
+	Events.Name = Name;
+	Events.Color = Color;
+}
+
+void Detail::RecordEvent(const char* pName, uint64_t BeginTicks, uint64_t EndTicks)
+{
+	if (!IsCapturing()) // scope ended after the capture, which may be being written out
+		return;
+
+	FThreadEvents& Events = GetThreadEvents();
+
+	const uint32_t CaptureIndex = sCaptureIndex.load(std::memory_order_acquire);
+	if (Events.CaptureIndex.load(std::memory_order_relaxed) != CaptureIndex) // first event of this thread in the capture
+	{
+		Events.NumEvents.store(0, std::memory_order_relaxed);
+		Events.CaptureIndex.store(CaptureIndex, std::memory_order_release);
+	}
+
+	const uint64_t iEvent = Events.NumEvents.load(std::memory_order_relaxed);
+	Events.pEvents[iEvent & (NUM_EVENTS_PER_THREAD - 1)] = { pName, BeginTicks, EndTicks };
+	Events.NumEvents.store(iEvent + 1, std::memory_order_release);
+}
+
+
+//
+// Chrome trace export
+//
+// Chrome's trace viewer only takes the colors of its own palette ("cname"), pick the closest one.
+static const char* GetClosestTraceColorName(uint32_t Color)
+{
+	struct FTraceColor { const char* pName; int R, G, B; };
+	static const FTraceColor TRACE_COLORS[] =
+	{
+		  { "thread_state_running"  , 126, 200, 148 }
+		, { "thread_state_runnable" , 133, 160, 210 }
+		, { "thread_state_iowait"   , 255, 140,   0 }
+		, { "rail_response"         ,  67, 135, 253 }
+		, { "rail_animation"        , 244,  74,  63 }
+		, { "rail_idle"             , 238, 142,   0 }
+		, { "rail_load"             ,  13, 168,  97 }
+		, { "good"                  ,   0, 125,   0 }
+		, { "bad"                   , 180, 125,   0 }
+		, { "terrible"              , 180,   0,   0 }
+		, { "yellow"                , 255, 255,   0 }
+		, { "olive"                 , 100, 100,   0 }
+		, { "generic_work"          , 125, 125, 125 }
+		, { "grey"                  , 221, 221, 221 }
+		, { "black"                 ,   0,   0,   0 }
+	};
+	const int R = (Color >> 16) & 0xFF;
+	const int G = (Color >>  8) & 0xFF;
+	const int B = (Color >>  0) & 0xFF;
+
+	const FTraceColor* pClosest = &TRACE_COLORS[0];
+	int MinDistance = INT_MAX;
+	for (const FTraceColor& c : TRACE_COLORS)
+	{
+		const int Distance = (c.R - R) * (c.R - R) + (c.G - G) * (c.G - G) + (c.B - B) * (c.B - B);
+		if (Distance < MinDistance)
+		{
+			MinDistance = Distance;
+			pClosest = &c;
+		}
+	}
+	return pClosest->pName;
+}
+
+static FCaptureData CopyCapture(const FCapture& Capture)
+{
+	FCaptureData Data;
+	Data.FilePath = Capture.FilePath;
+	Data.FrameBeginTicks = Capture.FrameBeginTicks;
+
+	const uint32_t CaptureIndex = sCaptureIndex.load(std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lk(sThreadsMtx);
+	for (const std::unique_ptr<FThreadEvents>& pThread : sThreads)
+	{
+		const FThreadEvents& Thread = *pThread;
+		if (Thread.CaptureIndex.load(std::memory_order_acquire) != CaptureIndex)
+			continue; // nothing recorded during this capture
+
+		const uint64_t NumRecorded = Thread.NumEvents.load(std::memory_order_acquire);
+		const uint64_t iFirst = NumRecorded > NUM_EVENTS_PER_THREAD ? NumRecorded - NUM_EVENTS_PER_THREAD : 0;
+		Data.NumOverwrittenEvents += static_cast<size_t>(iFirst);
+
+		FThreadCapture ThreadCapture = { Thread.Name, Thread.Color, Thread.TrackIndex, {} };
+		ThreadCapture.Events.reserve(static_cast<size_t>(NumRecorded - iFirst));
+		for (uint64_t i = iFirst; i < NumRecorded; ++i)
+			ThreadCapture.Events.push_back(Thread.pEvents[i & (NUM_EVENTS_PER_THREAD - 1)]);
+		Data.Threads.push_back(std::move(ThreadCapture));
+	}
+	return Data;
+}
+
+static bool WriteChromeTrace(const FCaptureData& Capture)
+{
+	const uint64_t CaptureBeginTicks = Capture.FrameBeginTicks.front();
+	const double   MicrosecondsPerTick = 1e6 / CpuTimestamp::GetTicksPerSecond();
+	auto fnToMicroseconds = [&](uint64_t Ticks) { return (static_cast<double>(Ticks) - static_cast<double>(CaptureBeginTicks)) * MicrosecondsPerTick; };
+
+	std::string Json;
+	char Line[512];
+	bool bFirstEvent = true;
+	auto fnAppend = [&](int Length)
+	{
+		if (!bFirstEvent) Json += ",\n";
+		Json.append(Line, std::min<size_t>(std::max(Length, 0), sizeof(Line) - 1));
+		bFirstEvent = false;
+	};
+
+	Json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	fnAppend(snprintf(Line, sizeof(Line), R"({"name":"process_name","ph":"M","pid":0,"tid":0,"args":{"name":"Engine"}})"));
+	fnAppend(snprintf(Line, sizeof(Line), R"({"name":"thread_name","ph":"M","pid":0,"tid":0,"args":{"name":"Frames"}})"));
+	for (size_t i = 0; i + 1 < Capture.FrameBeginTicks.size(); ++i)
+	{
+		const double Begin = fnToMicroseconds(Capture.FrameBeginTicks[i]);
+		const double End   = fnToMicroseconds(Capture.FrameBeginTicks[i + 1]);
+		fnAppend(snprintf(Line, sizeof(Line), R"({"name":"Frame %zu","ph":"X","pid":0,"tid":0,"ts":%.3f,"dur":%.3f})", i, Begin, End - Begin));
+	}
+
+	size_t NumEvents = 0;
+	for (const FThreadCapture& Thread : Capture.Threads)
+	{
+		const char* pColor = GetClosestTraceColorName(Thread.Color);
+		fnAppend(snprintf(Line, sizeof(Line), R"({"name":"thread_name","ph":"M","pid":0,"tid":%u,"args":{"name":"%s"}})", Thread.TrackIndex, StrUtil::EscapeJSON(Thread.Name).c_str()));
+		fnAppend(snprintf(Line, sizeof(Line), R"({"name":"thread_sort_index","ph":"M","pid":0,"tid":%u,"args":{"sort_index":%u}})", Thread.TrackIndex, Thread.TrackIndex));
+		for (const FEvent& Event : Thread.Events)
+		{
+			const double Begin = fnToMicroseconds(Event.BeginTicks);
+			const double End   = fnToMicroseconds(Event.EndTicks);
+			fnAppend(snprintf(Line, sizeof(Line), R"({"name":"%s","ph":"X","pid":0,"tid":%u,"ts":%.3f,"dur":%.3f,"cname":"%s"})"
+				, StrUtil::EscapeJSON(Event.pName).c_str(), Thread.TrackIndex, Begin, End - Begin, pColor));
+		}
+		NumEvents += Thread.Events.size();
+	}
+	Json += "\n]}\n";
+
+	std::ofstream File(Capture.FilePath);
+	if (!File)
+	{
+		Log::Error("[Profiler] Cannot open file: %s", Capture.FilePath.c_str());
+		return false;
+	}
+	File.write(Json.data(), Json.size());
+
+	Log::Info("[Profiler] Captured %zu frames, %zu events: %s", Capture.FrameBeginTicks.size() - 1, NumEvents, Capture.FilePath.c_str());
+	if (Capture.NumOverwrittenEvents)
+		Log::Warning("[Profiler] %zu events were overwritten, NUM_EVENTS_PER_THREAD=%zu is too small for the capture", Capture.NumOverwrittenEvents, NUM_EVENTS_PER_THREAD);
+	return true;
+}
+
+
+void RequestCapture(uint32_t NumFrames, const std::string& FilePath)
+{
+	std::lock_guard<std::mutex> lk(sRequestMtx);
+	if (sRequestedNumFrames || NumFrames == 0)
+		return;
+	sRequestedNumFrames = NumFrames;
+	sRequestedFilePath = FilePath;
+}
+
+void BeginFrame()
+{
+	const uint64_t Now = CpuTimestamp::Now();
+	if (sCapture.bRunning)
+	{
+		sCapture.FrameBeginTicks.push_back(Now);
+		if (sCapture.FrameBeginTicks.size() <= sCapture.NumFrames)
+			return;
+
+		// last frame ended: copy the events out here, the serialization & the file I/O would hitch the frame
+		Detail::gbCapturing.store(false, std::memory_order_relaxed);
+		sWriteTraceTask = std::async(std::launch::async, [Data = CopyCapture(sCapture)]() { WriteChromeTrace(Data); });
+		sCapture.bRunning = false;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lk(sRequestMtx);
+	if (sRequestedNumFrames == 0)
+		return;
+
+	sCapture.bRunning = true;
+	sCapture.NumFrames = std::exchange(sRequestedNumFrames, 0);
+	sCapture.FilePath = std::move(sRequestedFilePath);
+	sCapture.FrameBeginTicks.clear();
+	sCapture.FrameBeginTicks.push_back(Now);
+	sCaptureIndex.fetch_add(1, std::memory_order_release);
+	Detail::gbCapturing.store(true, std::memory_order_relaxed);
+	Log::Info("[Profiler] Capturing %u frames...", sCapture.NumFrames);
+}
+
+}	// namespace Profiler
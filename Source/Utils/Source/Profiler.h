@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Timer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//
+// CPU profiler: PROFILE_SCOPE("UpdateScene") records the scope's begin/end CpuTimestamps into a
+// per-thread ring buffer while a capture is running. Profiler::RequestCapture() captures a number
+// of frames (Profiler::BeginFrame() marks the frames) and writes them as Chrome trace JSON, to be
+// opened in chrome://tracing or ui.perfetto.dev.
+//
+// Costs a load + branch when no capture is running, two timestamps and a ring buffer write otherwise.
+// Scope names must outlive the capture: use string literals. Compile out with PROFILER_ENABLED 0.
+//
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_SCOPE(NAME) Profiler::FScope PROFILER_CONCAT(ProfileScope_, __LINE__)(NAME)
+#else
+#define PROFILE_SCOPE(NAME)
+#endif
+
+namespace Profiler
+{
+	constexpr uint32_t DEFAULT_THREAD_COLOR       = 0xFFAAAAAA; // same as ThreadPool's default marker color
+	constexpr size_t   NUM_EVENTS_PER_THREAD      = 32 * 1024;  // ring buffer: the oldest events of a capture are overwritten
+	constexpr uint32_t DEFAULT_CAPTURE_NUM_FRAMES = 60;
+
+	// Names the calling thread's track in the captures. @Color: 0xAARRGGBB, mapped to the closest
+	// color Chrome's trace viewer supports. Threads that don't call this show up as "Thread <n>".
+	void SetThreadName(const std::string& Name, uint32_t Color = DEFAULT_THREAD_COLOR);
+
+	// Call once per frame from the thread driving the frames: starts & ends the requested captures.
+	// When the capture ends, its events are copied out and the trace is written by a background thread.
+	void BeginFrame();
+
+	// Captures the next @NumFrames frames into @FilePath, ignored if a capture is already pending or running.
+	void RequestCapture(uint32_t NumFrames, const std::string& FilePath);
+
+	namespace Detail
+	{
+		extern std::atomic<bool> gbCapturing;
+		void RecordEvent(const char* pName, uint64_t BeginTicks, uint64_t EndTicks);
+	}
+	inline bool IsCapturing() { return Detail::gbCapturing.load(std::memory_order_relaxed); }
+
+	class FScope
+	{
+	public:
+		explicit FScope(const char* pName) : mpName(pName), mBeginTicks(IsCapturing() ? CpuTimestamp::Now() : 0) {}
+		~FScope() { if (mBeginTicks) Detail::RecordEvent(mpName, mBeginTicks, CpuTimestamp::Now()); }
+
+		FScope(const FScope&) = delete;
+		FScope& operator=(const FScope&) = delete;
+
+	private:
+		const char* mpName;
+		uint64_t    mBeginTicks; // 0: the capture wasn't running when the scope began
+	};
+}
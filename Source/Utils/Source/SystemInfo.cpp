@@ -801,6 +801,36 @@ std::vector<FGPUInfo> GetGPUInfo(/*TODO: feature level*/)
 // CPU
 //
 // ----------------------------------------------------------------------------------------------------------------------------------------------
+static FCPUFeatures QueryCPUFeatures()
+{
+	FCPUFeatures f;
+	std::array<int, 4> cpui;
+	__cpuid(cpui.data(), 0);
+	const int nIds = cpui[0];
+	if (nIds < 1)
+		return f;
+
+	// https://en.wikipedia.org/wiki/CPUID#EAX=1:_Processor_Info_and_Feature_Bits
+	__cpuidex(cpui.data(), 1, 0);
+	const bool bOSXSAVE = (cpui[2] & (1 << 27)) != 0;
+	const bool bYMMStateEnabled = bOSXSAVE && (_xgetbv(0) & 0x6) == 0x6; // XMM & YMM state saved by the OS
+	f.bSSE41 = (cpui[2] & (1 << 19)) != 0;
+	f.bAVX   = (cpui[2] & (1 << 28)) != 0 && bYMMStateEnabled;
+	f.bFMA   = (cpui[2] & (1 << 12)) != 0 && f.bAVX;
+	f.bF16C  = (cpui[2] & (1 << 29)) != 0 && f.bAVX;
+	if (nIds >= 7)
+	{
+		__cpuidex(cpui.data(), 7, 0);
+		f.bAVX2 = (cpui[1] & (1 << 5)) != 0 && f.bAVX;
+	}
+	return f;
+}
+const FCPUFeatures& GetCPUFeatures()
+{
+	static const FCPUFeatures sFeatures = QueryCPUFeatures();
+	return sFeatures;
+}
+
 FCPUInfo GetCPUInfo()
 {
 	FCPUInfo i;
@@ -42,6 +42,16 @@ namespace SystemInfo
 		unsigned long GetDCacheLineSize(short Level) const;
 		unsigned long GetICacheSize(int* pOutNumCaches = nullptr) const;
 	};
+	// Instruction set extensions the SIMD code paths dispatch on. AVX* also require
+	// the OS to save the YMM registers on context switches (OSXSAVE + XCR0).
+	struct FCPUFeatures
+	{
+		bool bSSE41 = false;
+		bool bAVX   = false;
+		bool bAVX2  = false;
+		bool bFMA   = false;
+		bool bF16C  = false;
+	};
 	
 	//
 	// GPU
@@ -154,6 +164,7 @@ namespace SystemInfo
 	// The CPUID instruction is relatively expensive, therefore don't 
 	// call this function in a busy loop.
 	FCPUInfo                  GetCPUInfo();
+	const FCPUFeatures&       GetCPUFeatures(); // queried once, cheap to call from hot paths
 	std::vector<FGPUInfo>     GetGPUInfo();
 	std::vector<FMonitorInfo> GetDisplayInfo();
 	FRAMInfo                  GetRAMInfo();
@@ -1,4 +1,7 @@
 #include "Timer.h"
+#include "Log.h"
+
+#include <array>
 
 Timer::Timer()
 	:
@@ -7,7 +10,7 @@ Timer::Timer()
 	Reset();
 }
 
-TimeStamp GetNow() { return std::chrono::system_clock::now();}
+TimeStamp GetNow() { return std::chrono::steady_clock::now(); }
 
 float Timer::TotalTime() const
 {
@@ -74,7 +77,6 @@ float Timer::Tick()
 	dt = currTime - prevTime;
 
 	prevTime = currTime;
-	dt = dt.count() < 0.0f ? dt.zero() : dt;	// make sure dt >= 0 (is this necessary?)
 
 	return dt.count();
 }
@@ -89,3 +91,81 @@ float Timer::GetStopDuration() const
 	return stopDuration.count();
 }
 
+
+//
+// CpuTimestamp
+//
+static bool HasInvariantTsc()
+{
+	std::array<int, 4> cpui;
+	__cpuid(cpui.data(), 0x80000000);
+	if (static_cast<unsigned>(cpui[0]) < 0x80000007)
+		return false;
+	__cpuid(cpui.data(), 0x80000007);
+	return (cpui[3] & (1 << 8)) != 0; // EDX[8]: invariant TSC
+}
+
+namespace CpuTimestamp
+{
+namespace Detail
+{
+	std::atomic<int> gTimestampSource = TIMESTAMP_SOURCE_UNRESOLVED;
+
+	ETimestampSource ResolveTimestampSource()
+	{
+		static const ETimestampSource sSource = HasInvariantTsc() ? TIMESTAMP_SOURCE_TSC : TIMESTAMP_SOURCE_STEADY_CLOCK;
+		gTimestampSource.store(sSource, std::memory_order_relaxed);
+		return sSource;
+	}
+}
+
+struct FCalibrationBegin
+{
+	uint64_t                              Ticks;
+	std::chrono::steady_clock::time_point Time;
+};
+static const FCalibrationBegin& GetCalibrationBegin()
+{
+	static const FCalibrationBegin sBegin = { CpuTimestamp::Now(), std::chrono::steady_clock::now() };
+	return sBegin;
+}
+// start of the calibration interval: static initialization, or the first calibration if it happens earlier
+static const bool sbCalibrationStarted = (GetCalibrationBegin(), true);
+
+static double Calibrate()
+{
+	using namespace std::chrono;
+	if (!IsUsingTsc())
+		return static_cast<double>(steady_clock::period::den) / static_cast<double>(steady_clock::period::num);
+
+	constexpr duration<double> MIN_CALIBRATION_DURATION(0.02);
+	const FCalibrationBegin& Begin = GetCalibrationBegin();
+	steady_clock::time_point EndTime = steady_clock::now();
+	uint64_t                 EndTicks = CpuTimestamp::Now();
+	while (EndTime - Begin.Time < MIN_CALIBRATION_DURATION)
+	{
+		EndTime = steady_clock::now();
+		EndTicks = CpuTimestamp::Now();
+	}
+	const double TicksPerSecond = static_cast<double>(EndTicks - Begin.Ticks) / duration<double>(EndTime - Begin.Time).count();
+	Log::Info("[CpuTimestamp] Invariant TSC: %.3f GHz", TicksPerSecond * 1e-9);
+	return TicksPerSecond;
+}
+
+double GetTicksPerSecond()
+{
+	static const double sTicksPerSecond = Calibrate();
+	return sTicksPerSecond;
+}
+
+bool IsUsingTsc() { return Detail::ResolveTimestampSource() == Detail::TIMESTAMP_SOURCE_TSC; }
+}
+
+ScopedTimer::~ScopedTimer()
+{
+	const uint64_t Ticks = CpuTimestamp::Now() - mBegin;
+	if (mpAccumulatedTicks)
+		*mpAccumulatedTicks += Ticks;
+	if (mpLabel)
+		Log::Info("[ScopedTimer] %s: %.3f ms", mpLabel, CpuTimestamp::ToMilliseconds(Ticks));
+}
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 
-using TimeStamp = std::chrono::time_point<std::chrono::system_clock>;	// TimeStamp != std::time_t
+#include <intrin.h> // __rdtsc
+
+// steady_clock: monotonic, Tick() can't return negative deltas when the system time is adjusted
+using TimeStamp = std::chrono::time_point<std::chrono::steady_clock>;	// TimeStamp != std::time_t
 using Duration  = std::chrono::duration<float>;
 
 class Timer
@@ -37,3 +42,70 @@ private:
 	bool      bIsStopped;
 };
 
+
+
+//
+// Timestamps for timing hot code, a few ns per call: rdtsc if the CPU has an invariant TSC
+// (constant rate, synchronized across cores), steady_clock ticks otherwise.
+// rdtsc isn't serializing: fine for timing loops and scopes, not single instructions.
+//
+namespace CpuTimestamp
+{
+	namespace Detail
+	{
+		enum ETimestampSource : int
+		{
+			TIMESTAMP_SOURCE_UNRESOLVED = 0,
+			TIMESTAMP_SOURCE_TSC,
+			TIMESTAMP_SOURCE_STEADY_CLOCK,
+
+			NUM_TIMESTAMP_SOURCES
+		};
+		// constant initialized: resolved on the first Now(), also when called during the static initialization of another file
+		extern std::atomic<int> gTimestampSource;
+		ETimestampSource ResolveTimestampSource();
+	}
+
+	inline uint64_t Now()
+	{
+		int Source = Detail::gTimestampSource.load(std::memory_order_relaxed);
+		if (Source == Detail::TIMESTAMP_SOURCE_UNRESOLVED)
+			Source = Detail::ResolveTimestampSource();
+		return Source == Detail::TIMESTAMP_SOURCE_TSC
+			? __rdtsc()
+			: static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	}
+
+	// The TSC frequency is calibrated against steady_clock on the first call
+	// (blocks for up to ~20ms if called right after startup).
+	double GetTicksPerSecond();
+	bool   IsUsingTsc();
+
+	inline double ToSeconds     (uint64_t Ticks) { return static_cast<double>(Ticks) / GetTicksPerSecond(); }
+	inline double ToMilliseconds(uint64_t Ticks) { return ToSeconds(Ticks) * 1000.0; }
+}
+
+//
+// Measures the time spent in a scope:
+//
+//     uint64_t Ticks = 0;
+//     for (...) { ScopedTimer t(Ticks); HotFunction(); } // accumulates CpuTimestamp ticks
+//     Log::Info("HotFunction: %.3f ms", CpuTimestamp::ToMilliseconds(Ticks));
+//
+//     { ScopedTimer t("LoadScene"); LoadScene(); }         // logs "[ScopedTimer] LoadScene: 12.345 ms"
+//
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(uint64_t& AccumulatedTicks) : mpAccumulatedTicks(&AccumulatedTicks), mpLabel(nullptr), mBegin(CpuTimestamp::Now()) {}
+	explicit ScopedTimer(const char* pLabel)         : mpAccumulatedTicks(nullptr), mpLabel(pLabel), mBegin(CpuTimestamp::Now()) {}
+	~ScopedTimer();
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+	uint64_t*   mpAccumulatedTicks;
+	const char* mpLabel;
+	uint64_t    mBegin;
+};
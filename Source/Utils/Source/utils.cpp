@@ -187,6 +187,18 @@ namespace StrUtil
 		ss << std::fixed << std::setprecision(0) << newMagnitudeInUnits << unit;
 		return ss.str();
 	}
+
+	std::string EscapeJSON(const std::string& s)
+	{
+		std::string Escaped;
+		Escaped.reserve(s.size());
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\') Escaped += '\\';
+			if (static_cast<unsigned char>(c) >= 0x20) Escaped += c;
+		}
+		return Escaped;
+	}
 }
 
 //---------------------------------------------------------------------------------------------
@@ -415,11 +427,11 @@ namespace MathUtil
 
 // GLOBAL NAMESPACE
 //
-std::string GetCurrentTimeAsString()
+std::string GetCurrentTimeAsString() { return GetTimeAsString(std::time(0)); }
+std::string GetTimeAsString(std::time_t Time)
 {
-	const std::time_t now = std::time(0);
 	std::tm tmNow;	// current time
-	localtime_s(&tmNow, &now);
+	localtime_s(&tmNow, &Time);
 
 	// YYYY-MM-DD_HH-MM-SS
 	std::stringstream ss;
@@ -3,6 +3,7 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <ctime>
 #include <locale>
 #include <codecvt>
 
@@ -54,6 +55,9 @@ namespace StrUtil
 	}
 
 	std::string FormatByte(unsigned long long bytes);
+
+	// for string values of JSON files: escapes quotes & backslashes, drops the control characters
+	std::string EscapeJSON(const std::string& s);
 }
 
 
@@ -111,6 +115,7 @@ namespace DirectoryUtil
 // returns current time in format "YYYY-MM-DD_HH-MM-SS"
 std::string GetCurrentTimeAsString();
 std::string GetCurrentTimeAsStringWithBrackets();
+std::string GetTimeAsString(std::time_t Time);
 
 
 